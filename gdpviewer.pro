@@ -6,20 +6,46 @@ TEMPLATE = app
 TARGET = gdpviewer
 INCLUDEPATH += src
 
+QT += network
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
 unix {
 	CONFIG += link_pkgconfig
-	PKGCONFIG += gstreamer-1.0
+	PKGCONFIG += gstreamer-1.0 gstreamer-app-1.0 gstreamer-video-1.0 libzstd
 }
 
 CONFIG += link_pkgconfig
-PKGCONFIG += gstreamer-1.0
+PKGCONFIG += gstreamer-1.0 gstreamer-app-1.0 gstreamer-video-1.0 libzstd
 
 gitinfo.commands = src/verinfo/verinfo.sh src/version src/version_info.h
 gitinfo.target = gitinfo
 QMAKE_EXTRA_TARGETS += gitinfo
 
 # Input
-HEADERS += src/dataprotocol.h src/dp-private.h src/MainWindow.h
-SOURCES += src/main.cpp src/dataprotocol.c src/MainWindow.cpp
+HEADERS += src/dataprotocol.h src/dp-private.h src/MainWindow.h \
+	src/PagedArray.h src/GdpFile.h src/PacketIndex.h src/PacketDetails.h \
+	src/PacketModel.h src/MemoryBudget.h src/DetailCache.h src/Stats.h \
+	src/StatsPanel.h src/Indexer.h src/Cli.h \
+	src/ThumbnailProvider.h src/ThumbnailStrip.h src/ClockTime.h \
+	src/SegmentTracker.h src/PacketTableModel.h src/ParallelSort.h \
+	src/Selection.h src/Filter.h src/TextIndex.h src/TextSearch.h \
+	src/Analyzer.h src/NalParser.h src/NalAnalyzer.h src/PacketCaps.h \
+	src/AudioLevels.h src/AudioOverview.h src/WaveformView.h \
+	src/VideoStats.h src/VideoAnalytics.h src/LumaPlot.h \
+	src/Extractor.h src/Replayer.h src/GdpArchive.h src/ArchiveConverter.h \
+	src/BackgroundIndexer.h src/StreamMonitor.h src/MetricsServer.h \
+	src/TimelineMerger.h src/MergedTableModel.h \
+	src/Exporter.h src/KernelCopy.h src/Splitter.h
+SOURCES += src/main.cpp src/dataprotocol.c src/MainWindow.cpp \
+	src/GdpFile.cpp src/PacketIndex.cpp src/PacketDetails.cpp src/PacketModel.cpp \
+	src/DetailCache.cpp src/Stats.cpp src/StatsPanel.cpp src/Indexer.cpp src/Cli.cpp \
+	src/ThumbnailProvider.cpp src/ThumbnailStrip.cpp src/ClockTime.cpp \
+	src/SegmentTracker.cpp src/PacketTableModel.cpp \
+	src/Filter.cpp src/TextIndex.cpp src/TextSearch.cpp \
+	src/Analyzer.cpp src/NalParser.cpp src/NalAnalyzer.cpp src/PacketCaps.cpp \
+	src/AudioLevels.cpp src/AudioOverview.cpp src/WaveformView.cpp \
+	src/VideoStats.cpp src/VideoAnalytics.cpp src/LumaPlot.cpp \
+	src/Extractor.cpp src/Replayer.cpp src/GdpArchive.cpp src/ArchiveConverter.cpp \
+	src/BackgroundIndexer.cpp src/StreamMonitor.cpp src/MetricsServer.cpp \
+	src/TimelineMerger.cpp src/MergedTableModel.cpp \
+	src/Exporter.cpp src/KernelCopy.cpp src/Splitter.cpp
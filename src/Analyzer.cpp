@@ -0,0 +1,221 @@
+#include "Analyzer.h"
+#include "GdpFile.h"
+#include "PacketCaps.h"
+
+#include <QRunnable>
+#include <QThread>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <QVector>
+
+// index records read at a time by the pass over the index
+static const int SCAN_CHUNK = 65536;
+
+// the pass only reads caps packets, which are small
+static const qint64 SCAN_WINDOW = 4 * 1024 * 1024;
+
+// analyzers started together, which wait for the end of their pass before
+// they go
+struct AnalyzerGroup
+{
+	QMutex mutex;
+	QWaitCondition done;
+	bool running;
+};
+
+
+class AnalyzerTask: public QRunnable
+{
+	public:
+		// a worker of <panalyzer>
+		AnalyzerTask(Analyzer *panalyzer):
+			m_panalyzer(panalyzer)
+		{
+		}
+
+		// the pass over the index for <analyzers>
+		AnalyzerTask(const QList<Analyzer *> &analyzers):
+			m_panalyzer(NULL),
+			m_analyzers(analyzers)
+		{
+		}
+
+		virtual void run()
+		{
+			if(m_panalyzer)
+				m_panalyzer -> work();
+			else
+				Analyzer::scan(m_analyzers);
+		}
+
+	private:
+		Analyzer *m_panalyzer;
+		QList<Analyzer *> m_analyzers;
+};
+
+
+Analyzer::Analyzer(QSharedPointer<PacketIndex> pindex, const QString &fileName, int chunk, QObject *parent):
+	QObject(parent),
+	m_pindex(pindex),
+	m_fileName(fileName),
+	m_chunk(chunk),
+	m_windowSize(64 * 1024 * 1024),
+	m_items(0),
+	m_nextChunk(0),
+	m_workers(0),
+	m_ready(0),
+	m_stopping(0)
+{
+	m_pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() - 1));
+}
+
+
+void Analyzer::setWindowSize(qint64 bytes)
+{
+	m_windowSize = bytes;
+}
+
+
+bool Analyzer::isReady() const
+{
+	return m_ready.loadAcquire();
+}
+
+
+void Analyzer::start(const QList<Analyzer *> &analyzers)
+{
+	if(analyzers.isEmpty())
+		return;
+
+	QSharedPointer<AnalyzerGroup> pgroup(new AnalyzerGroup());
+	pgroup -> running = true;
+
+	for(int i = 0; i < analyzers.size(); i++)
+		analyzers[i] -> m_pgroup = pgroup;
+
+	analyzers.first() -> m_pool.start(new AnalyzerTask(analyzers));
+}
+
+
+void Analyzer::complete()
+{
+}
+
+
+void Analyzer::stop()
+{
+	m_stopping.store(1);
+
+	if(m_pgroup)
+	{
+		QMutexLocker locker(&m_pgroup -> mutex);
+		while(m_pgroup -> running)
+			m_pgroup -> done.wait(&m_pgroup -> mutex);
+	}
+
+	m_pool.waitForDone();
+}
+
+
+bool Analyzer::isStopping() const
+{
+	return m_stopping.load();
+}
+
+
+void Analyzer::scan(const QList<Analyzer *> &analyzers)
+{
+	QSharedPointer<AnalyzerGroup> pgroup = analyzers.first() -> m_pgroup;
+	PacketIndex *pindex = analyzers.first() -> m_pindex.data();
+
+	GdpFile file;
+	file.open(analyzers.first() -> m_fileName);
+	file.setWindowSize(SCAN_WINDOW);
+
+	QVector<bool> active(analyzers.size(), true);
+	bool stopping = false;
+
+	QVector<PacketRecord> chunk(SCAN_CHUNK);
+	const qint64 size = pindex -> size();
+
+	for(qint64 first = 0; first < size && !stopping; first += chunk.size())
+	{
+		qint64 count = pindex -> read(first, chunk.size(), chunk.data());
+
+		for(qint64 i = 0; i < count; i++)
+		{
+			const PacketRecord &record = chunk[i];
+			GstCaps *pcaps = isCapsPacket(record) ? packetCaps(file, record) : NULL;
+
+			for(int a = 0; a < analyzers.size(); a++)
+			{
+				if(active[a])
+					active[a] = analyzers[a] -> scanPacket(first + i, record, pcaps);
+			}
+
+			if(pcaps)
+				gst_caps_unref(pcaps);
+		}
+
+		for(int a = 0; a < analyzers.size(); a++)
+			stopping = stopping || analyzers[a] -> isStopping();
+	}
+
+	// the analyzers are alive until the group is released
+	for(int a = 0; a < analyzers.size(); a++)
+		analyzers[a] -> startWorkers(!stopping);
+
+	QMutexLocker locker(&pgroup -> mutex);
+	pgroup -> running = false;
+	pgroup -> done.wakeAll();
+}
+
+
+void Analyzer::startWorkers(bool scanned)
+{
+	m_items = scanned ? prepare() : 0;
+
+	if(m_items <= 0 || isStopping())
+	{
+		publish();
+		return;
+	}
+
+	m_workers.store(m_pool.maxThreadCount());
+	for(int i = 0; i < m_pool.maxThreadCount(); i++)
+		m_pool.start(new AnalyzerTask(this));
+}
+
+
+void Analyzer::work()
+{
+	GdpFile file;
+	file.open(m_fileName);
+	file.setWindowSize(m_windowSize / m_pool.maxThreadCount());
+
+	for(;;)
+	{
+		qint64 first = (qint64) m_nextChunk.fetchAndAddRelaxed(1) * m_chunk;
+		if(first >= m_items || isStopping())
+			break;
+
+		process(file, first, qMin(m_items, first + m_chunk));
+	}
+
+	// the last worker out completes the results
+	if(m_workers.fetchAndAddOrdered(-1) == 1)
+	{
+		if(!isStopping())
+			complete();
+
+		publish();
+	}
+}
+
+
+void Analyzer::publish()
+{
+	m_ready.storeRelease(1);
+	emit finished();
+}
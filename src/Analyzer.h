@@ -0,0 +1,81 @@
+#ifndef ANALYZER_H_
+#define ANALYZER_H_
+
+#include <QObject>
+#include <QSharedPointer>
+#include <QThreadPool>
+#include <QList>
+#include <QAtomicInt>
+
+#include <gst/gst.h>
+
+#include "PacketIndex.h"
+
+class GdpFile;
+struct AnalyzerGroup;
+
+// Base of the analyzers that measure the packets of a dump in the
+// background. A single pass over the index, shared by all the analyzers
+// started together, parses each caps packet once and shows every packet to
+// each analyzer in order. Each analyzer then has a pool of workers take
+// chunks of the items it collected, and the last worker out completes the
+// results and announces them.
+class Analyzer: public QObject
+{
+	Q_OBJECT
+	public:
+		Analyzer(QSharedPointer<PacketIndex> pindex, const QString &fileName, int chunk, QObject *parent = 0);
+
+		// the window is shared by the workers
+		void setWindowSize(qint64 bytes);
+		bool isReady() const;
+
+		// runs the pass over the index for <analyzers> on the pool of the
+		// first one
+		static void start(const QList<Analyzer *> &analyzers);
+
+	signals:
+		void finished();
+
+	protected:
+		// <pcaps> is set for caps packets; false gives up the analysis
+		virtual bool scanPacket(qint64 row, const PacketRecord &record, GstCaps *pcaps) = 0;
+
+		// after the pass, the number of items for the workers
+		virtual qint64 prepare() = 0;
+
+		virtual void process(GdpFile &file, qint64 first, qint64 last) = 0;
+
+		// run by the last worker out, unless the analyzer is stopping
+		virtual void complete();
+
+		// stops the pass and the workers; the destructors of the analyzers
+		// call it before their members go
+		void stop();
+		bool isStopping() const;
+
+		QSharedPointer<PacketIndex> m_pindex;
+		QString m_fileName;
+		QThreadPool m_pool;
+
+	private:
+		friend class AnalyzerTask;
+
+		static void scan(const QList<Analyzer *> &analyzers);
+		void startWorkers(bool scanned);
+		void work();
+		void publish();
+
+		int m_chunk;
+		qint64 m_windowSize;
+		qint64 m_items;
+		QSharedPointer<AnalyzerGroup> m_pgroup;
+
+		QAtomicInt m_nextChunk;
+		QAtomicInt m_workers;
+		QAtomicInt m_ready;
+		QAtomicInt m_stopping;
+};
+
+
+#endif
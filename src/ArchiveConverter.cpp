@@ -0,0 +1,475 @@
+#include "ArchiveConverter.h"
+#include "GdpArchive.h"
+#include "GdpFile.h"
+#include "PacketIndex.h"
+#include "PagedArray.h"
+#include "dataprotocol.h"
+
+#include <QFile>
+#include <QTemporaryFile>
+#include <QDir>
+#include <QCache>
+#include <QVector>
+#include <QElapsedTimer>
+#include <QCryptographicHash>
+
+#include <cstring>
+
+#include <zstd.h>
+
+static const int BATCH_SIZE = 4096;
+
+// uncompressed size a zstd frame is closed at
+static const int BLOCK_SIZE = 1024 * 1024;
+
+static const qint64 COPY_CHUNK = 4 * 1024 * 1024;
+
+// distinct payloads remembered for deduplication, the most recently seen
+static const int DEDUP_ENTRIES = 256 * 1024;
+
+// payload table entries written at a time
+static const int PAYLOAD_CHUNK = 65536;
+
+namespace
+{
+	// Payloads waiting for their frame to be written, one writer for buffer
+	// payloads and one for caps and events.
+	struct PendingBlock
+	{
+		QByteArray data;
+		QVector<quint32> ids;
+		QVector<ArchivePayload> payloads;
+	};
+
+	class BlockWriter
+	{
+		public:
+			BlockWriter(QFile *pfile, int level):
+				m_pfile(pfile),
+				m_pcontext(ZSTD_createCCtx())
+			{
+				ZSTD_CCtx_setParameter(m_pcontext, ZSTD_c_compressionLevel, level);
+				ZSTD_CCtx_setParameter(m_pcontext, ZSTD_c_checksumFlag, 1);
+			}
+
+			~BlockWriter()
+			{
+				ZSTD_freeCCtx(m_pcontext);
+			}
+
+			// the payload table is paged to a temporary file, as it grows with
+			// the dump
+			bool open()
+			{
+				return m_payloads.open(QDir::tempPath());
+			}
+
+			quint32 add(int kind, const guint8 *data, quint32 length)
+			{
+				PendingBlock &pending = m_pending[kind];
+				if(!pending.data.isEmpty() && pending.data.size() + (qint64) length > BLOCK_SIZE)
+					flush(kind);
+
+				ArchivePayload payload;
+				memset(&payload, 0, sizeof(payload));
+				payload.offset = pending.data.size();
+				payload.length = length;
+
+				quint32 id = m_payloads.size();
+				if(!m_payloads.append(payload))
+				{
+					m_error = "Problem with writing payload table in `" + QDir::tempPath() + "`";
+					return GdpArchive::NO_PAYLOAD;
+				}
+
+				pending.data.append((const char *) data, length);
+				pending.ids.append(id);
+				pending.payloads.append(payload);
+
+				if(pending.data.size() >= BLOCK_SIZE)
+					flush(kind);
+
+				return id;
+			}
+
+			bool flush(int kind)
+			{
+				PendingBlock &pending = m_pending[kind];
+				if(pending.data.isEmpty())
+					return true;
+
+				m_compressed.resize(ZSTD_compressBound(pending.data.size()));
+				size_t res = ZSTD_compress2(m_pcontext, m_compressed.data(), m_compressed.size(),
+					pending.data.constData(), pending.data.size());
+				if(ZSTD_isError(res))
+				{
+					m_error = ZSTD_getErrorName(res);
+					return false;
+				}
+
+				ArchiveBlock block;
+				block.pos = m_pfile -> pos();
+				block.compressedSize = res;
+				block.size = pending.data.size();
+
+				if(m_pfile -> write(m_compressed.constData(), res) != (qint64) res)
+				{
+					m_error = "Problem with writing to `" + m_pfile -> fileName() + "`";
+					return false;
+				}
+
+				for(int i = 0; i < pending.ids.size(); i++)
+				{
+					pending.payloads[i].block = m_blocks.size();
+					m_payloads.set(pending.ids[i], pending.payloads[i]);
+				}
+				m_blocks.append(block);
+
+				pending.data.clear();
+				pending.ids.clear();
+				pending.payloads.clear();
+				return true;
+			}
+
+			const PagedArray<ArchivePayload> &payloads() const
+			{
+				return m_payloads;
+			}
+
+			const QVector<ArchiveBlock> &blocks() const
+			{
+				return m_blocks;
+			}
+
+			QString errorString() const
+			{
+				return m_error;
+			}
+
+		private:
+			QFile *m_pfile;
+			ZSTD_CCtx *m_pcontext;
+			PendingBlock m_pending[2];
+			PagedArray<ArchivePayload> m_payloads;
+			QVector<ArchiveBlock> m_blocks;
+			QByteArray m_compressed;
+			QString m_error;
+	};
+}
+
+
+ArchiveConverter::ArchiveConverter(QObject *parent):
+	QObject(parent),
+	m_windowSize(64 * 1024 * 1024),
+	m_level(3),
+	m_cancel(0)
+{
+	reset();
+}
+
+
+void ArchiveConverter::setWindowSize(qint64 bytes)
+{
+	m_windowSize = bytes;
+}
+
+
+void ArchiveConverter::setCompressionLevel(int level)
+{
+	m_level = level;
+}
+
+
+qint64 ArchiveConverter::packetCount() const
+{
+	return m_packets;
+}
+
+
+qint64 ArchiveConverter::payloadCount() const
+{
+	return m_payloads;
+}
+
+
+qint64 ArchiveConverter::bytesRead() const
+{
+	return m_read;
+}
+
+
+qint64 ArchiveConverter::bytesWritten() const
+{
+	return m_written;
+}
+
+
+QString ArchiveConverter::errorString() const
+{
+	return m_error;
+}
+
+
+void ArchiveConverter::cancel()
+{
+	m_cancel.store(1);
+}
+
+
+void ArchiveConverter::reset()
+{
+	m_cancel.store(0);
+	m_packets = 0;
+	m_payloads = 0;
+	m_read = 0;
+	m_written = 0;
+	m_error.clear();
+}
+
+
+bool ArchiveConverter::toArchive(const QString &fileName, PacketIndex *pindex, const QString &output)
+{
+	reset();
+
+	GdpFile file;
+	if(!file.open(fileName))
+	{
+		m_error = "Problem with open file `" + fileName + "` for reading";
+		return false;
+	}
+	file.setWindowSize(m_windowSize);
+
+	if(file.archive())
+	{
+		m_error = "File `" + fileName + "` is already an archive";
+		return false;
+	}
+
+	QFile out(output);
+	if(!out.open(QIODevice::WriteOnly | QIODevice::Truncate))
+	{
+		m_error = "Problem with open file `" + output + "` for writing";
+		return false;
+	}
+
+	// the packet table goes after the frames, so it waits in a temporary file
+	QTemporaryFile packets(QDir::tempPath() + "/gdpviewer-packets-XXXXXX");
+	if(!packets.open())
+	{
+		m_error = "Problem with creating temporary file in `" + QDir::tempPath() + "`";
+		return false;
+	}
+
+	ArchiveHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, GdpArchive::MAGIC, sizeof(header.magic));
+	header.version = GdpArchive::VERSION;
+	header.gdpSize = file.size();
+
+	if(out.write((const char *) &header, sizeof(header)) != sizeof(header))
+	{
+		m_error = "Problem with writing to `" + output + "`";
+		return false;
+	}
+
+	BlockWriter writer(&out, m_level);
+	if(!writer.open())
+	{
+		m_error = "Problem with creating temporary file in `" + QDir::tempPath() + "`";
+		return false;
+	}
+
+	// payloads repeat close to each other, so a bounded cache of the recent
+	// ones finds most duplicates
+	QCache<QByteArray, quint32> ids(DEDUP_ENTRIES);
+	QVector<PacketRecord> records(BATCH_SIZE);
+	QVector<ArchivePacket> batch(BATCH_SIZE);
+	qint64 expected = 0;
+
+	QElapsedTimer timer;
+	timer.start();
+
+	const qint64 size = pindex -> size();
+	for(qint64 first = 0; first < size; first += BATCH_SIZE)
+	{
+		if(m_cancel.load())
+		{
+			m_error = "Conversion cancelled";
+			return false;
+		}
+
+		qint64 count = pindex -> read(first, BATCH_SIZE, records.data());
+		for(qint64 i = 0; i < count; i++)
+		{
+			const PacketRecord &record = records[i];
+			const qint64 length = GST_DP_HEADER_LENGTH + (qint64) record.payloadLength;
+
+			const guint8 *data = file.data(record.filePos, length);
+			if(!data || record.filePos != expected)
+			{
+				m_error = "File `" + fileName + "` is incorrect gdp file";
+				return false;
+			}
+			expected += length;
+
+			ArchivePacket &packet = batch[i];
+			memset(&packet, 0, sizeof(packet));
+			packet.gdpPos = record.filePos;
+			packet.payload = GdpArchive::NO_PAYLOAD;
+			memcpy(packet.header, data, GST_DP_HEADER_LENGTH);
+
+			if(record.payloadLength)
+			{
+				const guint8 *payload = data + GST_DP_HEADER_LENGTH;
+
+				// the length keeps payloads of different sizes apart even if
+				// their hashes collide
+				QByteArray key = QCryptographicHash::hash(QByteArray::fromRawData((const char *) payload, record.payloadLength),
+					QCryptographicHash::Sha1);
+				key.append((const char *) &record.payloadLength, sizeof(record.payloadLength));
+
+				quint32 *pid = ids.object(key);
+				if(pid)
+					packet.payload = *pid;
+				else
+				{
+					int kind = record.payloadType == GST_DP_PAYLOAD_BUFFER ? 0 : 1;
+					packet.payload = writer.add(kind, payload, record.payloadLength);
+					ids.insert(key, new quint32(packet.payload));
+
+					if(!writer.errorString().isEmpty())
+					{
+						m_error = writer.errorString();
+						return false;
+					}
+				}
+			}
+
+			m_read += length;
+		}
+
+		if(packets.write((const char *) batch.constData(), count * sizeof(ArchivePacket)) != (qint64) (count * sizeof(ArchivePacket)))
+		{
+			m_error = "Problem with writing to `" + packets.fileName() + "`";
+			return false;
+		}
+
+		m_packets += count;
+
+		if(timer.elapsed() > 50)
+		{
+			emit progress(expected, file.size());
+			timer.restart();
+		}
+	}
+
+	if(!writer.flush(0) || !writer.flush(1))
+	{
+		m_error = writer.errorString();
+		return false;
+	}
+
+	header.tailLength = file.size() - expected;
+	if(header.tailLength >= GST_DP_HEADER_LENGTH)
+	{
+		m_error = "File `" + fileName + "` is incorrect gdp file";
+		return false;
+	}
+
+	if(header.tailLength)
+		memcpy(header.tail, file.data(expected, header.tailLength), header.tailLength);
+
+	const PagedArray<ArchivePayload> &payloads = writer.payloads();
+	const QVector<ArchiveBlock> &blocks = writer.blocks();
+
+	header.packetCount = m_packets;
+	header.payloadCount = payloads.size();
+	header.blockCount = blocks.size();
+	header.packetTablePos = out.pos();
+	header.payloadTablePos = header.packetTablePos + header.packetCount * sizeof(ArchivePacket);
+	header.blockTablePos = header.payloadTablePos + header.payloadCount * sizeof(ArchivePayload);
+
+	bool res = packets.seek(0);
+	while(res && !packets.atEnd())
+	{
+		QByteArray chunk = packets.read(COPY_CHUNK);
+		res = !chunk.isEmpty() && out.write(chunk) == chunk.size();
+	}
+
+	QVector<ArchivePayload> table(PAYLOAD_CHUNK);
+	for(qint64 first = 0; res && first < payloads.size(); first += PAYLOAD_CHUNK)
+	{
+		qint64 count = payloads.read(first, PAYLOAD_CHUNK, table.data());
+		res = count > 0 && out.write((const char *) table.constData(), count * sizeof(ArchivePayload))
+			== (qint64) (count * sizeof(ArchivePayload));
+	}
+
+	res = res && out.write((const char *) blocks.constData(), blocks.size() * sizeof(ArchiveBlock))
+		== (qint64) (blocks.size() * sizeof(ArchiveBlock));
+	res = res && out.seek(0) && out.write((const char *) &header, sizeof(header)) == sizeof(header);
+
+	if(!res)
+	{
+		m_error = "Problem with writing to `" + output + "`";
+		return false;
+	}
+
+	m_payloads = payloads.size();
+	m_written = out.size();
+
+	emit progress(file.size(), file.size());
+	return true;
+}
+
+
+bool ArchiveConverter::toGdp(const QString &fileName, const QString &output)
+{
+	reset();
+
+	GdpFile file;
+	if(!file.open(fileName) || !file.archive())
+	{
+		m_error = "File `" + fileName + "` is not a gdp archive";
+		return false;
+	}
+	file.setWindowSize(m_windowSize);
+
+	QFile out(output);
+	if(!out.open(QIODevice::WriteOnly | QIODevice::Truncate))
+	{
+		m_error = "Problem with open file `" + output + "` for writing";
+		return false;
+	}
+
+	m_packets = file.archive() -> packetCount();
+
+	const qint64 size = file.size();
+	for(qint64 pos = 0; pos < size; pos += COPY_CHUNK)
+	{
+		if(m_cancel.load())
+		{
+			m_error = "Conversion cancelled";
+			return false;
+		}
+
+		const qint64 length = qMin(COPY_CHUNK, size - pos);
+		const guint8 *data = file.data(pos, length);
+		if(!data)
+		{
+			m_error = "Problem with reading archive `" + fileName + "`";
+			return false;
+		}
+
+		if(out.write((const char *) data, length) != length)
+		{
+			m_error = "Problem with writing to `" + output + "`";
+			return false;
+		}
+
+		m_read += length;
+		m_written += length;
+		emit progress(pos + length, size);
+	}
+
+	return true;
+}
@@ -0,0 +1,50 @@
+#ifndef ARCHIVE_CONVERTER_H_
+#define ARCHIVE_CONVERTER_H_
+
+#include <QObject>
+#include <QString>
+#include <QAtomicInt>
+
+class PacketIndex;
+
+// Converts an indexed gdp dump to a gdp archive and an archive back to the
+// dump it was made from.
+class ArchiveConverter: public QObject
+{
+	Q_OBJECT
+	public:
+		explicit ArchiveConverter(QObject *parent = 0);
+
+		void setWindowSize(qint64 bytes);
+		void setCompressionLevel(int level);
+
+		bool toArchive(const QString &fileName, PacketIndex *pindex, const QString &output);
+		bool toGdp(const QString &fileName, const QString &output);
+
+		qint64 packetCount() const;
+		qint64 payloadCount() const;
+		qint64 bytesRead() const;
+		qint64 bytesWritten() const;
+		QString errorString() const;
+
+	public slots:
+		void cancel();
+
+	signals:
+		void progress(qint64 done, qint64 total);
+
+	private:
+		void reset();
+
+		qint64 m_windowSize;
+		int m_level;
+		QAtomicInt m_cancel;
+		qint64 m_packets;
+		qint64 m_payloads;
+		qint64 m_read;
+		qint64 m_written;
+		QString m_error;
+};
+
+
+#endif
@@ -0,0 +1,225 @@
+#include "AudioLevels.h"
+
+#include <QtGlobal>
+
+#include <cmath>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// samples summed in float before being added to the double totals
+static const gsize BLOCK = 4096;
+
+namespace
+{
+	inline float sampleValue(AudioFormat::SampleFormat format, const guint8 *p)
+	{
+		switch(format)
+		{
+			case AudioFormat::S16:
+			{
+				gint16 value;
+				memcpy(&value, p, sizeof(value));
+				return value * (1.0f / 32768.0f);
+			}
+			case AudioFormat::S32:
+			{
+				gint32 value;
+				memcpy(&value, p, sizeof(value));
+				return value * (1.0f / 2147483648.0f);
+			}
+			case AudioFormat::F32:
+			{
+				float value;
+				memcpy(&value, p, sizeof(value));
+				return value;
+			}
+			default:
+				return 0;
+		}
+	}
+
+
+	void measureScalar(const AudioFormat &format, const guint8 *data, gsize first, gsize samples, float *ppeak, double *psum)
+	{
+		const int size = format.sampleSize();
+
+		for(gsize i = first; i < samples; i++)
+		{
+			float value = sampleValue(format.format, data + i * size);
+			int channel = i % format.channels;
+
+			ppeak[channel] = qMax(ppeak[channel], std::fabs(value));
+			psum[channel] += (double) value * value;
+		}
+	}
+
+
+#ifdef __SSE2__
+	// eight samples as two vectors of four floats in full scale units
+	inline void load(AudioFormat::SampleFormat format, const guint8 *p, __m128 *plow, __m128 *phigh)
+	{
+		if(format == AudioFormat::S16)
+		{
+			const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+			__m128i v = _mm_loadu_si128((const __m128i *) p);
+			*plow = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16)), scale);
+			*phigh = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16)), scale);
+		}
+		else if(format == AudioFormat::S32)
+		{
+			const __m128 scale = _mm_set1_ps(1.0f / 2147483648.0f);
+			*plow = _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *) p)), scale);
+			*phigh = _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *) (p + 16))), scale);
+		}
+		else
+		{
+			*plow = _mm_loadu_ps((const float *) p);
+			*phigh = _mm_loadu_ps((const float *) (p + 16));
+		}
+	}
+
+
+	// Eight samples are taken at a time, so with 1, 2, 4 or 8 channels every
+	// lane always holds the same channel and the sums can be kept in lanes
+	// until the end.
+	template <AudioFormat::SampleFormat FORMAT>
+	gsize measureVector(const guint8 *data, gsize samples, int channels, float *ppeak, double *psum)
+	{
+		const int size = FORMAT == AudioFormat::S16 ? 2 : 4;
+		const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+
+		__m128 peak[2] = {_mm_setzero_ps(), _mm_setzero_ps()};
+		double total[8] = {0};
+
+		gsize i = 0;
+		while(i + 8 <= samples)
+		{
+			__m128 sum[2] = {_mm_setzero_ps(), _mm_setzero_ps()};
+			gsize end = qMin(samples - samples % 8, i + BLOCK);
+
+			for(; i < end; i += 8)
+			{
+				__m128 v[2];
+				load(FORMAT, data + i * size, &v[0], &v[1]);
+
+				for(int h = 0; h < 2; h++)
+				{
+					peak[h] = _mm_max_ps(peak[h], _mm_and_ps(v[h], absMask));
+					sum[h] = _mm_add_ps(sum[h], _mm_mul_ps(v[h], v[h]));
+				}
+			}
+
+			float lanes[8];
+			_mm_storeu_ps(lanes, sum[0]);
+			_mm_storeu_ps(lanes + 4, sum[1]);
+			for(int j = 0; j < 8; j++)
+				total[j] += lanes[j];
+		}
+
+		float lanes[8];
+		_mm_storeu_ps(lanes, peak[0]);
+		_mm_storeu_ps(lanes + 4, peak[1]);
+
+		for(int j = 0; j < 8; j++)
+		{
+			ppeak[j % channels] = qMax(ppeak[j % channels], lanes[j]);
+			psum[j % channels] += total[j];
+		}
+
+		return i;
+	}
+#endif
+}
+
+
+int AudioFormat::sampleSize() const
+{
+	return format == S16 ? 2 : (format == None ? 0 : 4);
+}
+
+
+AudioFormat AudioLevels::formatFromCaps(const GstCaps *caps)
+{
+	AudioFormat format;
+
+	if(!caps || gst_caps_get_size(caps) == 0)
+		return format;
+
+	const GstStructure *pstructure = gst_caps_get_structure(caps, 0);
+	if(!gst_structure_has_name(pstructure, "audio/x-raw"))
+		return format;
+
+	const gchar *layout = gst_structure_get_string(pstructure, "layout");
+	if(layout && strcmp(layout, "interleaved"))
+		return format;
+
+	int channels = 0, rate = 0;
+	if(!gst_structure_get_int(pstructure, "channels", &channels) || channels < 1 || channels > AudioFormat::MAX_CHANNELS)
+		return format;
+	gst_structure_get_int(pstructure, "rate", &rate);
+
+	const gchar *name = gst_structure_get_string(pstructure, "format");
+	if(!name)
+		return format;
+
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+	if(!strcmp(name, "S16LE"))
+		format.format = AudioFormat::S16;
+	else if(!strcmp(name, "S32LE"))
+		format.format = AudioFormat::S32;
+	else if(!strcmp(name, "F32LE"))
+		format.format = AudioFormat::F32;
+#else
+	if(!strcmp(name, "S16BE"))
+		format.format = AudioFormat::S16;
+	else if(!strcmp(name, "S32BE"))
+		format.format = AudioFormat::S32;
+	else if(!strcmp(name, "F32BE"))
+		format.format = AudioFormat::F32;
+#endif
+
+	if(format.format != AudioFormat::None)
+	{
+		format.channels = channels;
+		format.rate = rate;
+	}
+
+	return format;
+}
+
+
+void AudioLevels::measure(const AudioFormat &format, const guint8 *data, gsize size, AudioLevel *plevels)
+{
+	float peak[AudioFormat::MAX_CHANNELS] = {0};
+	double sum[AudioFormat::MAX_CHANNELS] = {0};
+
+	if(format.format == AudioFormat::None)
+		return;
+
+	const gsize frames = size / (format.sampleSize() * format.channels);
+	const gsize samples = frames * format.channels;
+	gsize done = 0;
+
+#ifdef __SSE2__
+	if(8 % format.channels == 0)
+	{
+		if(format.format == AudioFormat::S16)
+			done = measureVector<AudioFormat::S16>(data, samples, format.channels, peak, sum);
+		else if(format.format == AudioFormat::S32)
+			done = measureVector<AudioFormat::S32>(data, samples, format.channels, peak, sum);
+		else
+			done = measureVector<AudioFormat::F32>(data, samples, format.channels, peak, sum);
+	}
+#endif
+
+	measureScalar(format, data, done, samples, peak, sum);
+
+	for(int i = 0; i < format.channels; i++)
+	{
+		plevels[i].peak = peak[i];
+		plevels[i].power = frames ? sum[i] / frames : 0;
+	}
+}
@@ -0,0 +1,53 @@
+#ifndef AUDIO_LEVELS_H_
+#define AUDIO_LEVELS_H_
+
+#include <gst/gst.h>
+
+// Interleaved raw audio layout taken from audio/x-raw caps. Only the native
+// endian S16, S32 and F32 formats are measured.
+struct AudioFormat
+{
+	enum SampleFormat
+	{
+		None,
+		S16,
+		S32,
+		F32
+	};
+
+	AudioFormat():
+		format(None),
+		channels(0),
+		rate(0)
+	{
+	}
+
+	int sampleSize() const;
+
+	SampleFormat format;
+	int channels;
+	int rate;
+
+	static const int MAX_CHANNELS = 8;
+};
+
+// Peak of the absolute sample values and mean square of one channel, both
+// relative to full scale. Mean squares rather than RMS are kept, as they can
+// be averaged.
+struct AudioLevel
+{
+	float peak;
+	float power;
+};
+
+class AudioLevels
+{
+	public:
+		static AudioFormat formatFromCaps(const GstCaps *caps);
+
+		// fills one level per channel
+		static void measure(const AudioFormat &format, const guint8 *data, gsize size, AudioLevel *plevels);
+};
+
+
+#endif
@@ -0,0 +1,290 @@
+#include "AudioOverview.h"
+#include "GdpFile.h"
+#include "dataprotocol.h"
+
+#include <QDir>
+
+#include <algorithm>
+
+// buffers handed to a worker at a time
+static const int CHUNK = 1024;
+
+// buffers stored, and entries of the pyramid built, at a time
+static const int BATCH = 65536;
+
+AudioOverview::AudioOverview(QSharedPointer<PacketIndex> pindex, const QString &fileName, QObject *parent):
+	Analyzer(pindex, fileName, CHUNK, parent),
+	m_format(-1),
+	m_last(0),
+	m_ok(true),
+	m_channels(0)
+{
+	m_buffers.setMaxMappedBytes(8 * 1024 * 1024);
+	m_levels.setMaxMappedBytes(8 * 1024 * 1024);
+}
+
+
+AudioOverview::~AudioOverview()
+{
+	stop();
+}
+
+
+int AudioOverview::channels() const
+{
+	return isReady() ? m_channels : 0;
+}
+
+
+qint64 AudioOverview::bufferCount() const
+{
+	return isReady() ? m_buffers.size() : 0;
+}
+
+
+guint64 AudioOverview::startTime() const
+{
+	return bufferCount() ? buffer(0).start : 0;
+}
+
+
+guint64 AudioOverview::endTime() const
+{
+	return bufferCount() ? buffer(bufferCount() - 1).end : 0;
+}
+
+
+qint64 AudioOverview::firstEndingAfter(guint64 time) const
+{
+	// ends are kept in order along with the starts
+	qint64 low = 0, high = bufferCount();
+	while(low < high)
+	{
+		qint64 middle = low + (high - low) / 2;
+		if(buffer(middle).end <= time)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	return low;
+}
+
+
+qint64 AudioOverview::firstStartingAt(guint64 time) const
+{
+	qint64 low = 0, high = bufferCount();
+	while(low < high)
+	{
+		qint64 middle = low + (high - low) / 2;
+		if(buffer(middle).start < time)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	return low;
+}
+
+
+qint64 AudioOverview::packetRow(qint64 i) const
+{
+	return buffer(i).row;
+}
+
+
+guint64 AudioOverview::bufferStart(qint64 i) const
+{
+	return buffer(i).start;
+}
+
+
+guint64 AudioOverview::bufferEnd(qint64 i) const
+{
+	return buffer(i).end;
+}
+
+
+bool AudioOverview::isGap(qint64 i) const
+{
+	return buffer(i).gap;
+}
+
+
+void AudioOverview::levels(qint64 first, qint64 last, AudioLevel *plevels) const
+{
+	for(int c = 0; c < m_channels; c++)
+		plevels[c].peak = plevels[c].power = 0;
+
+	if(first >= last)
+		return;
+
+	// the level where the range covers one or two entries, taking in a few
+	// buffers around it
+	int level = 0;
+	while(level + 1 < m_levelStarts.size() && ((last - first) >> (level + 1)) > 0)
+		level++;
+
+	qint64 begin = first >> level;
+	qint64 end = ((last - 1) >> level) + 1;
+
+	QVector<AudioLevel> entries((end - begin) * m_channels);
+	m_levels.read((m_levelStarts[level] + begin) * m_channels, entries.size(), entries.data());
+
+	for(qint64 i = 0; i < end - begin; i++)
+	{
+		for(int c = 0; c < m_channels; c++)
+		{
+			const AudioLevel &entry = entries[i * m_channels + c];
+			plevels[c].peak = qMax(plevels[c].peak, entry.peak);
+			plevels[c].power += entry.power;
+		}
+	}
+
+	for(int c = 0; c < m_channels; c++)
+		plevels[c].power /= end - begin;
+}
+
+
+AudioOverview::Buffer AudioOverview::buffer(qint64 i) const
+{
+	return m_buffers.at(i);
+}
+
+
+bool AudioOverview::scanPacket(qint64 row, const PacketRecord &record, GstCaps *pcaps)
+{
+	if(pcaps)
+	{
+		AudioFormat audio = AudioLevels::formatFromCaps(pcaps);
+		m_format = audio.format != AudioFormat::None ? m_formats.size() : -1;
+		if(m_format >= 0)
+		{
+			m_formats.append(audio);
+			m_channels = qMax(m_channels, audio.channels);
+		}
+	}
+	else if(record.payloadType == GST_DP_PAYLOAD_BUFFER && m_format >= 0)
+	{
+		const AudioFormat &audio = m_formats[m_format];
+
+		// the lane needs times in order, buffers without a timestamp or
+		// going back follow the previous one
+		Buffer buffer;
+		buffer.row = row;
+		buffer.start = GST_CLOCK_TIME_IS_VALID(record.timestamp) ? qMax(record.timestamp, m_last) : m_last;
+		buffer.format = m_format;
+		buffer.gap = record.bufferFlags & GST_BUFFER_FLAG_GAP;
+
+		guint64 duration = record.duration;
+		if(!GST_CLOCK_TIME_IS_VALID(duration) && audio.rate > 0)
+			duration = gst_util_uint64_scale(record.payloadLength / (audio.sampleSize() * audio.channels), GST_SECOND, audio.rate);
+
+		buffer.end = buffer.start + (GST_CLOCK_TIME_IS_VALID(duration) ? duration : 0);
+		m_last = buffer.end = qMax(buffer.end, m_last);
+
+		m_pending.append(buffer);
+		if(m_pending.size() == BATCH)
+			m_ok = flushBuffers();
+	}
+
+	return m_ok;
+}
+
+
+bool AudioOverview::flushBuffers()
+{
+	if(m_pending.isEmpty())
+		return true;
+
+	if(!m_buffers.isOpen() && !m_buffers.open(QDir::tempPath()))
+		return false;
+
+	bool res = m_buffers.append(m_pending.constData(), m_pending.size());
+	m_pending.clear();
+
+	return res;
+}
+
+
+// level 0 is laid out for the workers, which fill it in any order
+qint64 AudioOverview::prepare()
+{
+	m_ok = m_ok && flushBuffers() && m_buffers.size() > 0
+		&& m_levels.open(QDir::tempPath()) && m_levels.extend(m_buffers.size() * m_channels);
+
+	if(!m_ok)
+	{
+		m_buffers.close();
+		m_levels.close();
+		return 0;
+	}
+
+	m_levelStarts.append(0);
+	return m_buffers.size();
+}
+
+
+void AudioOverview::process(GdpFile &file, qint64 first, qint64 last)
+{
+	QVector<Buffer> buffers(last - first);
+	qint64 count = m_buffers.read(first, buffers.size(), buffers.data());
+
+	// formats with fewer channels leave the others silent
+	QVector<AudioLevel> levels(count * m_channels);
+
+	for(qint64 i = 0; i < count; i++)
+	{
+		PacketRecord record = m_pindex -> at(buffers[i].row);
+		const guint8 *payload = record.payloadLength ? file.data(record.filePos + GST_DP_HEADER_LENGTH, record.payloadLength) : NULL;
+
+		if(payload)
+			AudioLevels::measure(m_formats[buffers[i].format], payload, record.payloadLength, levels.data() + i * m_channels);
+	}
+
+	m_levels.write(first * m_channels, levels.size(), levels.constData());
+}
+
+
+// each level halves the one below, which is read back in batches
+void AudioOverview::complete()
+{
+	qint64 entries = m_buffers.size();
+	QVector<AudioLevel> lower, upper;
+
+	while(entries > 1)
+	{
+		const qint64 lowerStart = m_levelStarts.last();
+		const qint64 upperEntries = (entries + 1) / 2;
+
+		for(qint64 first = 0; first < entries; first += BATCH)
+		{
+			qint64 count = qMin<qint64>(BATCH, entries - first);
+			lower.resize(count * m_channels);
+			m_levels.read((lowerStart + first) * m_channels, lower.size(), lower.data());
+
+			qint64 pairs = (count + 1) / 2;
+			upper.resize(pairs * m_channels);
+
+			for(qint64 i = 0; i < pairs; i++)
+			{
+				qint64 left = 2 * i;
+				qint64 right = qMin(left + 1, count - 1);
+
+				for(int c = 0; c < m_channels; c++)
+				{
+					const AudioLevel &a = lower[left * m_channels + c];
+					const AudioLevel &b = lower[right * m_channels + c];
+					upper[i * m_channels + c].peak = qMax(a.peak, b.peak);
+					upper[i * m_channels + c].power = (a.power + b.power) / 2;
+				}
+			}
+
+			if(!m_levels.append(upper.constData(), upper.size()))
+				return;
+		}
+
+		m_levelStarts.append(lowerStart + entries);
+		entries = upperEntries;
+	}
+}
@@ -0,0 +1,72 @@
+#ifndef AUDIO_OVERVIEW_H_
+#define AUDIO_OVERVIEW_H_
+
+#include <QVector>
+
+#include "Analyzer.h"
+#include "PagedArray.h"
+#include "AudioLevels.h"
+
+// Peak and RMS levels of every raw audio buffer of a dump, per channel,
+// measured in the background by a pool of workers and aggregated into a
+// pyramid of levels where each level halves the number of entries of the
+// one below. Any range of buffers is then summarized from a few entries,
+// whatever the zoom of the view. The buffers and all levels of the pyramid
+// are kept in paged arrays.
+class AudioOverview: public Analyzer
+{
+	Q_OBJECT
+	public:
+		AudioOverview(QSharedPointer<PacketIndex> pindex, const QString &fileName, QObject *parent = 0);
+		~AudioOverview();
+
+		int channels() const;
+		qint64 bufferCount() const;
+
+		guint64 startTime() const;
+		guint64 endTime() const;
+
+		qint64 firstEndingAfter(guint64 time) const;
+		qint64 firstStartingAt(guint64 time) const;
+
+		qint64 packetRow(qint64 buffer) const;
+		guint64 bufferStart(qint64 buffer) const;
+		guint64 bufferEnd(qint64 buffer) const;
+		bool isGap(qint64 buffer) const;
+
+		void levels(qint64 first, qint64 last, AudioLevel *plevels) const;
+
+	protected:
+		virtual bool scanPacket(qint64 row, const PacketRecord &record, GstCaps *pcaps);
+		virtual qint64 prepare();
+		virtual void process(GdpFile &file, qint64 first, qint64 last);
+		virtual void complete();
+
+	private:
+		struct Buffer
+		{
+			qint64 row;
+			guint64 start;
+			guint64 end;
+			int format;
+			bool gap;
+		};
+
+		bool flushBuffers();
+		Buffer buffer(qint64 i) const;
+
+		PagedArray<Buffer> m_buffers;
+		QVector<Buffer> m_pending;
+		QVector<AudioFormat> m_formats;
+		int m_format;
+		guint64 m_last;
+		bool m_ok;
+
+		// entries of the level i start at record m_levelStarts[i] * m_channels
+		PagedArray<AudioLevel> m_levels;
+		QVector<qint64> m_levelStarts;
+		int m_channels;
+};
+
+
+#endif
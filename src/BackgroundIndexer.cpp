@@ -0,0 +1,104 @@
+#include "BackgroundIndexer.h"
+#include "PacketIndex.h"
+#include "TextIndex.h"
+
+#include <QRunnable>
+#include <QDir>
+
+class BackgroundIndexTask: public QRunnable
+{
+	public:
+		BackgroundIndexTask(BackgroundIndexer *pindexer):
+			m_pindexer(pindexer)
+		{
+		}
+
+		virtual void run()
+		{
+			m_pindexer -> run();
+		}
+
+	private:
+		BackgroundIndexer *m_pindexer;
+};
+
+
+BackgroundIndexer::BackgroundIndexer(const QString &fileName, qint64 windowSize, qint64 indexBytes, qint64 textBytes, QObject *parent):
+	QObject(parent),
+	m_fileName(fileName),
+	m_indexBytes(indexBytes),
+	m_textBytes(textBytes),
+	m_result(Indexer::Cancelled)
+{
+	m_pool.setMaxThreadCount(1);
+	m_indexer.setWindowSize(windowSize);
+	connect(&m_indexer, SIGNAL(progress(qint64, qint64)), SIGNAL(progress(qint64, qint64)));
+}
+
+
+BackgroundIndexer::~BackgroundIndexer()
+{
+	cancel();
+	m_pool.waitForDone();
+}
+
+
+bool BackgroundIndexer::start()
+{
+	m_pindex = QSharedPointer<PacketIndex>(new PacketIndex());
+	if(!m_pindex -> open(QDir::tempPath()))
+	{
+		m_error = "Problem with creating packet index in `" + QDir::tempPath() + "`";
+		return false;
+	}
+	m_pindex -> setMaxMappedBytes(m_indexBytes);
+
+	m_ptext = QSharedPointer<TextIndex>(new TextIndex(m_textBytes));
+	if(!m_ptext -> open(QDir::tempPath()))
+	{
+		m_error = "Problem with creating text index in `" + QDir::tempPath() + "`";
+		return false;
+	}
+	m_indexer.setTextIndex(m_ptext.data());
+
+	m_pool.start(new BackgroundIndexTask(this));
+	return true;
+}
+
+
+void BackgroundIndexer::cancel()
+{
+	m_indexer.cancel();
+}
+
+
+Indexer::Result BackgroundIndexer::result() const
+{
+	return m_result;
+}
+
+
+QString BackgroundIndexer::errorString() const
+{
+	return m_error;
+}
+
+
+QSharedPointer<PacketIndex> BackgroundIndexer::packetIndex() const
+{
+	return m_pindex;
+}
+
+
+QSharedPointer<TextIndex> BackgroundIndexer::textIndex() const
+{
+	return m_ptext;
+}
+
+
+void BackgroundIndexer::run()
+{
+	m_result = m_indexer.run(m_fileName, m_pindex.data());
+	m_error = m_indexer.errorString();
+	emit finished();
+}
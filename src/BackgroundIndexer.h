@@ -0,0 +1,52 @@
+#ifndef BACKGROUND_INDEXER_H_
+#define BACKGROUND_INDEXER_H_
+
+#include <QObject>
+#include <QSharedPointer>
+#include <QThreadPool>
+#include <QString>
+
+#include "Indexer.h"
+
+class PacketIndex;
+class TextIndex;
+
+// Runs an Indexer over a whole dump on a worker thread, for a dump that is
+// already shown from a sampled index.
+class BackgroundIndexer: public QObject
+{
+	Q_OBJECT
+	public:
+		BackgroundIndexer(const QString &fileName, qint64 windowSize, qint64 indexBytes, qint64 textBytes, QObject *parent = 0);
+		~BackgroundIndexer();
+
+		bool start();
+		void cancel();
+
+		Indexer::Result result() const;
+		QString errorString() const;
+		QSharedPointer<PacketIndex> packetIndex() const;
+		QSharedPointer<TextIndex> textIndex() const;
+
+	signals:
+		void progress(qint64 pos, qint64 size);
+		void finished();
+
+	private:
+		friend class BackgroundIndexTask;
+
+		void run();
+
+		QString m_fileName;
+		qint64 m_indexBytes;
+		qint64 m_textBytes;
+		QThreadPool m_pool;
+		Indexer m_indexer;
+		Indexer::Result m_result;
+		QString m_error;
+		QSharedPointer<PacketIndex> m_pindex;
+		QSharedPointer<TextIndex> m_ptext;
+};
+
+
+#endif
@@ -0,0 +1,756 @@
+#include "Cli.h"
+#include "Indexer.h"
+#include "PacketIndex.h"
+#include "MemoryBudget.h"
+#include "Stats.h"
+#include "Filter.h"
+#include "Extractor.h"
+#include "Replayer.h"
+#include "ArchiveConverter.h"
+#include "StreamMonitor.h"
+#include "MetricsServer.h"
+#include "TimelineMerger.h"
+#include "MergedTableModel.h"
+#include "Exporter.h"
+#include "Splitter.h"
+#include "GdpFile.h"
+#include "PacketCaps.h"
+#include "dataprotocol.h"
+
+#include <QCoreApplication>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QMap>
+#include <QTextStream>
+#include <QDir>
+#include <QTimer>
+
+#include <cstring>
+
+namespace
+{
+	const char *s_commands[] =
+	{
+		"--stats-json",
+		"--extract",
+		"--replay",
+		"--archive",
+		"--unarchive",
+		"--quick-look",
+		"--monitor",
+		"--merge",
+		"--export",
+		"--split",
+		NULL
+	};
+
+	// how often followed files are checked for new data
+	const int MONITOR_POLL_MS = 200;
+
+	const char *resultName(Indexer::Result result)
+	{
+		switch(result)
+		{
+			case Indexer::Finished: return "finished";
+			case Indexer::OpenError: return "open_error";
+			case Indexer::IndexError: return "index_error";
+			case Indexer::FormatError: return "format_error";
+			case Indexer::Cancelled: return "cancelled";
+		}
+
+		return "unknown";
+	}
+
+	int statsJson(const QCommandLineParser &parser, const MemoryBudget &budget)
+	{
+		QTextStream out(stdout);
+		QTextStream err(stderr);
+
+		QStringList files = parser.positionalArguments();
+		if(files.isEmpty())
+		{
+			err << "no input files\n";
+			return 1;
+		}
+
+		int res = 0;
+		for(int i = 0; i < files.size(); i++)
+		{
+			Stats::reset();
+
+			PacketIndex index;
+			if(!index.open(QDir::tempPath()))
+			{
+				err << "Problem with creating packet index in `" << QDir::tempPath() << "`\n";
+				return 1;
+			}
+			index.setMaxMappedBytes(budget.indexBytes);
+
+			Indexer indexer;
+			indexer.setWindowSize(budget.windowBytes);
+
+			qint64 start = Stats::now();
+			Indexer::Result result = indexer.run(files[i], &index);
+			qint64 elapsed = Stats::now() - start;
+
+			if(result != Indexer::Finished)
+			{
+				err << indexer.errorString() << "\n";
+				res = 1;
+			}
+
+			QJsonObject obj = Stats::toJson();
+			obj.insert("file", files[i]);
+			obj.insert("result", QString(resultName(result)));
+			obj.insert("packets", (double) index.size());
+			obj.insert("time_ns", (double) elapsed);
+
+			out << QJsonDocument(obj).toJson(QJsonDocument::Indented);
+		}
+
+		return res;
+	}
+
+	int quickLook(const QCommandLineParser &parser, const MemoryBudget &budget)
+	{
+		QTextStream out(stdout);
+		QTextStream err(stderr);
+
+		QStringList files = parser.positionalArguments();
+		if(files.isEmpty())
+		{
+			err << "no input files\n";
+			return 1;
+		}
+
+		int res = 0;
+		for(int i = 0; i < files.size(); i++)
+		{
+			PacketIndex index;
+			if(!index.open(QDir::tempPath()))
+			{
+				err << "Problem with creating packet index in `" << QDir::tempPath() << "`\n";
+				return 1;
+			}
+			index.setMaxMappedBytes(budget.indexBytes);
+
+			Indexer indexer;
+			indexer.setWindowSize(budget.windowBytes);
+			indexer.setSampling(Indexer::QUICK_LOOK_REGIONS, Indexer::QUICK_LOOK_REGION_BYTES);
+
+			if(indexer.run(files[i], &index) != Indexer::Finished)
+			{
+				err << indexer.errorString() << "\n";
+				res = 1;
+				continue;
+			}
+
+			// distinct caps and the count of every event type in the sample
+			GdpFile file;
+			file.open(files[i]);
+
+			QStringList caps;
+			QMap<QString, int> events;
+			for(qint64 row = 0; row < index.size(); row++)
+			{
+				PacketRecord record = index.at(row);
+				GstCaps *pcaps = packetCaps(file, record);
+				if(pcaps)
+				{
+					gchar *str = gst_caps_to_string(pcaps);
+					if(!caps.contains(str))
+						caps.append(str);
+					g_free(str);
+					gst_caps_unref(pcaps);
+				}
+
+				if(record.payloadType >= GST_DP_PAYLOAD_EVENT_NONE)
+					events[gst_event_type_get_name((GstEventType) (record.payloadType - GST_DP_PAYLOAD_EVENT_NONE))]++;
+			}
+
+			Indexer::Estimate estimate = indexer.estimate();
+			QJsonObject obj;
+			obj.insert("file", files[i]);
+			obj.insert("sampled", estimate.sampled);
+			obj.insert("sampled_packets", (double) index.size());
+
+			if(estimate.sampled)
+			{
+				obj.insert("sampled_bytes", (double) estimate.sampledBytes);
+				obj.insert("estimated_packets", (double) estimate.packets);
+				obj.insert("estimated_buffers", (double) estimate.buffers);
+				obj.insert("estimated_bytes", (double) estimate.bytes);
+				obj.insert("estimated_bitrate", estimate.bitrate);
+				if(GST_CLOCK_TIME_IS_VALID(estimate.duration))
+					obj.insert("estimated_duration_ns", (double) estimate.duration);
+			}
+
+			QJsonObject eventCounts;
+			for(QMap<QString, int>::const_iterator it = events.constBegin(); it != events.constEnd(); ++it)
+				eventCounts.insert(it.key(), it.value());
+
+			obj.insert("caps", QJsonArray::fromStringList(caps));
+			obj.insert("events", eventCounts);
+
+			out << QJsonDocument(obj).toJson(QJsonDocument::Indented);
+		}
+
+		return res;
+	}
+
+	int extract(const QCommandLineParser &parser, const MemoryBudget &budget)
+	{
+		QTextStream out(stdout);
+		QTextStream err(stderr);
+
+		QStringList files = parser.positionalArguments();
+		if(files.size() != 1)
+		{
+			err << "--extract needs exactly one input file\n";
+			return 1;
+		}
+
+		Filter filter;
+		filter.setWindowSize(budget.windowBytes);
+		if(!filter.compile(parser.value("filter")))
+		{
+			err << "Incorrect filter: " << filter.errorString() << "\n";
+			return 1;
+		}
+
+		PacketIndex index;
+		if(!index.open(QDir::tempPath()))
+		{
+			err << "Problem with creating packet index in `" << QDir::tempPath() << "`\n";
+			return 1;
+		}
+		index.setMaxMappedBytes(budget.indexBytes);
+
+		Indexer indexer;
+		indexer.setWindowSize(budget.windowBytes);
+
+		if(indexer.run(files[0], &index) != Indexer::Finished)
+		{
+			err << indexer.errorString() << "\n";
+			return 1;
+		}
+
+		// an empty selection takes every buffer
+		Selection selection;
+		if(!filter.isEmpty())
+			selection = filter.run(&index, files[0]);
+
+		Extractor extractor;
+		Extractor::Mode mode = parser.isSet("per-buffer") ? Extractor::PerBuffer : Extractor::Concatenate;
+
+		if(!extractor.run(files[0], &index, selection, parser.value("extract"), mode))
+		{
+			err << extractor.errorString() << "\n";
+			return 1;
+		}
+
+		out << extractor.bufferCount() << " buffers, " << extractor.bytesWritten() << " bytes written\n";
+		return 0;
+	}
+
+	int archive(const QCommandLineParser &parser, const MemoryBudget &budget)
+	{
+		QTextStream out(stdout);
+		QTextStream err(stderr);
+
+		QStringList files = parser.positionalArguments();
+		if(files.size() != 1)
+		{
+			err << "--archive and --unarchive need exactly one input file\n";
+			return 1;
+		}
+
+		ArchiveConverter converter;
+		converter.setWindowSize(budget.windowBytes);
+		converter.setCompressionLevel(parser.value("compression-level").toInt());
+
+		if(parser.isSet("unarchive"))
+		{
+			if(!converter.toGdp(files[0], parser.value("unarchive")))
+			{
+				err << converter.errorString() << "\n";
+				return 1;
+			}
+
+			out << converter.packetCount() << " packets, " << converter.bytesWritten() << " bytes written\n";
+			return 0;
+		}
+
+		PacketIndex index;
+		if(!index.open(QDir::tempPath()))
+		{
+			err << "Problem with creating packet index in `" << QDir::tempPath() << "`\n";
+			return 1;
+		}
+		index.setMaxMappedBytes(budget.indexBytes);
+
+		Indexer indexer;
+		indexer.setWindowSize(budget.windowBytes);
+
+		if(indexer.run(files[0], &index) != Indexer::Finished)
+		{
+			err << indexer.errorString() << "\n";
+			return 1;
+		}
+
+		if(!converter.toArchive(files[0], &index, parser.value("archive")))
+		{
+			err << converter.errorString() << "\n";
+			return 1;
+		}
+
+		out << converter.packetCount() << " packets, " << converter.payloadCount() << " distinct payloads, "
+			<< converter.bytesRead() << " bytes in, " << converter.bytesWritten() << " bytes out\n";
+		return 0;
+	}
+
+	int replay(const QCommandLineParser &parser, const MemoryBudget &budget)
+	{
+		QTextStream out(stdout);
+		QTextStream err(stderr);
+
+		QStringList files = parser.positionalArguments();
+		if(files.size() != 1)
+		{
+			err << "--replay needs exactly one input file\n";
+			return 1;
+		}
+
+		Replayer::Pacing pacing = Replayer::AsFastAsPossible;
+		double speed = 1.0;
+
+		QString mode = parser.value("pacing");
+		if(mode == "original")
+			pacing = Replayer::OriginalPacing;
+		else if(mode != "fast")
+		{
+			bool ok = false;
+			speed = mode.toDouble(&ok);
+			if(!ok || speed <= 0)
+			{
+				err << "Incorrect pacing `" << mode << "`, expected fast, original or a speed factor\n";
+				return 1;
+			}
+			pacing = Replayer::Speed;
+		}
+
+		QSharedPointer<PacketIndex> pindex(new PacketIndex());
+		if(!pindex -> open(QDir::tempPath()))
+		{
+			err << "Problem with creating packet index in `" << QDir::tempPath() << "`\n";
+			return 1;
+		}
+		pindex -> setMaxMappedBytes(budget.indexBytes);
+
+		Indexer indexer;
+		indexer.setWindowSize(budget.windowBytes);
+
+		if(indexer.run(files[0], pindex.data()) != Indexer::Finished)
+		{
+			err << indexer.errorString() << "\n";
+			return 1;
+		}
+
+		Replayer replayer(pindex, files[0]);
+		replayer.setWindowSize(budget.windowBytes);
+		replayer.setPacing(pacing, speed);
+
+		qint64 first = parser.isSet("from") ? parser.value("from").toLongLong() : 0;
+		qint64 last = parser.isSet("to") ? parser.value("to").toLongLong() : -1;
+
+		if(!replayer.start(parser.value("replay"), first, last))
+		{
+			err << replayer.errorString() << "\n";
+			return 1;
+		}
+
+		replayer.wait();
+
+		Replayer::Report report = replayer.report();
+		out << report.packets << " packets, " << report.buffers << " buffers, " << report.bytes << " bytes in "
+			<< report.elapsed / 1000000 << " ms, " << report.throughput() / (1024 * 1024) << " MB/s\n";
+		if(pacing != Replayer::AsFastAsPossible)
+			out << "jitter: mean " << report.meanJitter / 1000 << " us, max " << report.maxJitter / 1000 << " us\n";
+		if(report.skippedEvents)
+			out << report.skippedEvents << " events not replayed\n";
+
+		if(!replayer.errorString().isEmpty())
+		{
+			err << replayer.errorString() << "\n";
+			return 1;
+		}
+
+		return 0;
+	}
+
+	int merge(const QCommandLineParser &parser, const MemoryBudget &budget)
+	{
+		QTextStream out(stdout);
+		QTextStream err(stderr);
+
+		QStringList files = parser.positionalArguments();
+		if(files.size() < 2)
+		{
+			err << "--merge needs at least two input files\n";
+			return 1;
+		}
+
+		TimelineMerger::Key key = TimelineMerger::RunningTime;
+		if(parser.value("merge-key") == "pts")
+			key = TimelineMerger::Pts;
+		else if(parser.value("merge-key") != "running-time")
+		{
+			err << "Incorrect merge key `" << parser.value("merge-key") << "`, expected running-time or pts\n";
+			return 1;
+		}
+
+		// the indexes and the merged timeline share the index memory
+		qint64 indexBytes = budget.indexBytes / (files.size() + 1);
+
+		TimelineMerger merger;
+		merger.setKey(key);
+		merger.setMaxMappedBytes(indexBytes);
+
+		for(int i = 0; i < files.size(); i++)
+		{
+			QSharedPointer<PacketIndex> pindex(new PacketIndex());
+			if(!pindex -> open(QDir::tempPath()))
+			{
+				err << "Problem with creating packet index in `" << QDir::tempPath() << "`\n";
+				return 1;
+			}
+			pindex -> setMaxMappedBytes(indexBytes);
+
+			Indexer indexer;
+			indexer.setWindowSize(budget.windowBytes);
+
+			if(indexer.run(files[i], pindex.data()) != Indexer::Finished)
+			{
+				err << indexer.errorString() << "\n";
+				return 1;
+			}
+
+			merger.addSource(files[i], pindex);
+		}
+
+		if(!merger.run())
+		{
+			err << merger.errorString() << "\n";
+			return 1;
+		}
+
+		// one tab separated line per packet, under a header line
+		for(int column = 0; column < MergedTableModel::ColumnCount; column++)
+			out << (column ? "\t" : "") << MergedTableModel::columnName(column);
+		out << "\n";
+
+		const int BATCH_SIZE = 4096;
+		QVector<MergedRecord> records(BATCH_SIZE);
+		for(qint64 first = 0; first < merger.size(); first += BATCH_SIZE)
+		{
+			qint64 count = merger.read(first, BATCH_SIZE, records.data());
+			for(qint64 i = 0; i < count; i++)
+			{
+				for(int column = 0; column < MergedTableModel::ColumnCount; column++)
+					out << (column ? "\t" : "") << MergedTableModel::text(merger, records[i], column);
+				out << "\n";
+			}
+		}
+
+		return 0;
+	}
+
+	int exportIndex(const QCommandLineParser &parser, const MemoryBudget &budget)
+	{
+		QTextStream out(stdout);
+		QTextStream err(stderr);
+
+		QStringList files = parser.positionalArguments();
+		if(files.size() != 1)
+		{
+			err << "--export needs exactly one input file\n";
+			return 1;
+		}
+
+		QString output = parser.value("export");
+		Exporter::Format format = Exporter::formatOf(output);
+		if(parser.isSet("format"))
+		{
+			if(parser.value("format") == "arrow")
+				format = Exporter::Arrow;
+			else if(parser.value("format") == "csv")
+				format = Exporter::Csv;
+			else
+			{
+				err << "Incorrect format `" << parser.value("format") << "`, expected arrow or csv\n";
+				return 1;
+			}
+		}
+
+		Filter filter;
+		filter.setWindowSize(budget.windowBytes);
+		if(!filter.compile(parser.value("filter")))
+		{
+			err << "Incorrect filter: " << filter.errorString() << "\n";
+			return 1;
+		}
+
+		PacketIndex index;
+		if(!index.open(QDir::tempPath()))
+		{
+			err << "Problem with creating packet index in `" << QDir::tempPath() << "`\n";
+			return 1;
+		}
+		index.setMaxMappedBytes(budget.indexBytes);
+
+		Indexer indexer;
+		indexer.setWindowSize(budget.windowBytes);
+
+		if(indexer.run(files[0], &index) != Indexer::Finished)
+		{
+			err << indexer.errorString() << "\n";
+			return 1;
+		}
+
+		// an empty selection takes every packet
+		Selection selection;
+		if(!filter.isEmpty())
+			selection = filter.run(&index, files[0]);
+
+		Exporter exporter;
+		exporter.setWindowSize(budget.windowBytes);
+		exporter.setHashes(parser.isSet("hashes"));
+
+		if(!exporter.run(files[0], &index, selection, output, format))
+		{
+			err << exporter.errorString() << "\n";
+			return 1;
+		}
+
+		out << exporter.rowCount() << " rows, " << exporter.bytesWritten() << " bytes written\n";
+		return 0;
+	}
+
+	int split(const QCommandLineParser &parser, const MemoryBudget &budget)
+	{
+		QTextStream out(stdout);
+		QTextStream err(stderr);
+
+		QStringList files = parser.positionalArguments();
+		if(files.size() != 1)
+		{
+			err << "--split needs exactly one input file\n";
+			return 1;
+		}
+
+		if(!parser.isSet("split-duration") && !parser.isSet("split-size"))
+		{
+			err << "--split needs --split-duration or --split-size\n";
+			return 1;
+		}
+
+		Splitter splitter;
+		splitter.setWindowSize(budget.windowBytes);
+
+		if(parser.isSet("split-duration"))
+		{
+			bool ok = false;
+			double seconds = parser.value("split-duration").toDouble(&ok);
+			if(!ok || seconds <= 0)
+			{
+				err << "Incorrect chunk duration `" << parser.value("split-duration") << "`\n";
+				return 1;
+			}
+			splitter.setMaxDuration(seconds * GST_SECOND);
+		}
+
+		if(parser.isSet("split-size"))
+		{
+			bool ok = false;
+			qint64 megabytes = parser.value("split-size").toLongLong(&ok);
+			if(!ok || megabytes <= 0)
+			{
+				err << "Incorrect chunk size `" << parser.value("split-size") << "`\n";
+				return 1;
+			}
+			splitter.setMaxBytes(megabytes * 1024 * 1024);
+		}
+
+		PacketIndex index;
+		if(!index.open(QDir::tempPath()))
+		{
+			err << "Problem with creating packet index in `" << QDir::tempPath() << "`\n";
+			return 1;
+		}
+		index.setMaxMappedBytes(budget.indexBytes);
+
+		Indexer indexer;
+		indexer.setWindowSize(budget.windowBytes);
+
+		if(indexer.run(files[0], &index) != Indexer::Finished)
+		{
+			err << indexer.errorString() << "\n";
+			return 1;
+		}
+
+		if(!splitter.run(files[0], &index, parser.value("split")))
+		{
+			err << splitter.errorString() << "\n";
+			return 1;
+		}
+
+		QStringList chunks = splitter.chunks();
+		for(int i = 0; i < chunks.size(); i++)
+			out << chunks[i] << "\n";
+
+		out << chunks.size() << " chunks, " << splitter.bytesWritten() << " bytes written\n";
+		return 0;
+	}
+
+	int monitor(QCoreApplication &app, const QCommandLineParser &parser)
+	{
+		QTextStream err(stderr);
+
+		QStringList sources = parser.positionalArguments();
+		if(sources.isEmpty())
+		{
+			err << "no sources to monitor\n";
+			return 1;
+		}
+
+		bool ok = false;
+		quint16 port = parser.value("listen").toUShort(&ok);
+		if(!ok)
+		{
+			err << "Incorrect port `" << parser.value("listen") << "`\n";
+			return 1;
+		}
+
+		guint64 threshold = parser.value("gap-threshold").toULongLong(&ok) * GST_MSECOND;
+		if(!ok)
+		{
+			err << "Incorrect gap threshold `" << parser.value("gap-threshold") << "`\n";
+			return 1;
+		}
+
+		MetricsServer server;
+		QTimer timer;
+		timer.setInterval(MONITOR_POLL_MS);
+
+		for(int i = 0; i < sources.size(); i++)
+		{
+			StreamMonitor *pmonitor = new StreamMonitor(sources[i], &server);
+			pmonitor -> setGapThreshold(threshold);
+			QObject::connect(&timer, SIGNAL(timeout()), pmonitor, SLOT(poll()));
+			server.addMonitor(pmonitor);
+			pmonitor -> start();
+		}
+
+		if(!server.listen(port) || (parser.isSet("socket") && !server.listenLocal(parser.value("socket"))))
+		{
+			err << server.errorString() << "\n";
+			return 1;
+		}
+
+		timer.start();
+		return app.exec();
+	}
+}
+
+
+bool Cli::isCommand(int argc, char **argv)
+{
+	for(int i = 1; i < argc; i++)
+		for(int j = 0; s_commands[j]; j++)
+		{
+			size_t length = strlen(s_commands[j]);
+			if(!strncmp(argv[i], s_commands[j], length) && (argv[i][length] == '\0' || argv[i][length] == '='))
+				return true;
+		}
+
+	return false;
+}
+
+
+void Cli::addOptions(QCommandLineParser &parser)
+{
+	parser.setApplicationDescription("Viewer for GStreamer gdp dumps");
+	parser.addHelpOption();
+	parser.addPositionalArgument("files", "gdp dumps to open");
+
+	parser.addOption(QCommandLineOption("stats-json", "Index the files and print performance counters as JSON."));
+	parser.addOption(QCommandLineOption("quick-look", "Index only the start, the end and spaced regions of the files and print estimated totals, caps and events as JSON."));
+	parser.addOption(QCommandLineOption("extract", "Write the buffer payloads of the file to <output>.", "output"));
+	parser.addOption(QCommandLineOption("per-buffer", "With --extract, write each buffer to its own file in the <output> directory."));
+	parser.addOption(QCommandLineOption("filter", "With --extract or --export, only take the packets matching <expression>.", "expression"));
+	parser.addOption(QCommandLineOption("replay", "Push the packets of the file into the <pipeline> description through appsrc.", "pipeline"));
+	parser.addOption(QCommandLineOption("pacing", "With --replay, pace the buffers: fast, original or a speed factor such as 2.", "mode", "fast"));
+	parser.addOption(QCommandLineOption("from", "With --replay, first packet to push.", "row"));
+	parser.addOption(QCommandLineOption("to", "With --replay, last packet to push.", "row"));
+	parser.addOption(QCommandLineOption("archive", "Write the file as a gdp archive to <output>.", "output"));
+	parser.addOption(QCommandLineOption("unarchive", "Write the gdp archive back as the dump it was made from to <output>.", "output"));
+	parser.addOption(QCommandLineOption("compression-level", "With --archive, zstd compression level.", "level", "3"));
+	parser.addOption(QCommandLineOption("merge", "Interleave the packets of the files, dumps of one pipeline, into one timeline printed as tab separated lines."));
+	parser.addOption(QCommandLineOption("merge-key", "With --merge, order the packets by running-time or pts.", "key", "running-time"));
+	parser.addOption(QCommandLineOption("export", "Write the packet index of the file as a table to <output>.", "output"));
+	parser.addOption(QCommandLineOption("format", "With --export, arrow or csv; by default csv for a .csv output and arrow otherwise.", "format"));
+	parser.addOption(QCommandLineOption("hashes", "With --export, add a column with a hash of each buffer payload."));
+	parser.addOption(QCommandLineOption("split", "Cut the file at keyframes into chunks that decode on their own, written to the <output> directory.", "output"));
+	parser.addOption(QCommandLineOption("split-duration", "With --split, seconds of a chunk.", "seconds"));
+	parser.addOption(QCommandLineOption("split-size", "With --split, megabytes of a chunk.", "MB"));
+	parser.addOption(QCommandLineOption("monitor", "Follow the growing files or tcp://host:port streams and serve their metrics for Prometheus."));
+	parser.addOption(QCommandLineOption("listen", "With --monitor, local port to serve metrics over http on.", "port", "9464"));
+	parser.addOption(QCommandLineOption("socket", "With --monitor, also write the metrics to clients of the unix socket <path>.", "path"));
+	parser.addOption(QCommandLineOption("gap-threshold", "With --monitor, milliseconds between buffers that count as a timestamp gap.", "ms", "100"));
+	parser.addOption(QCommandLineOption("trace", "Write trace events of the session to <file>.", "file"));
+	parser.addOption(QCommandLineOption("memory-limit", "Memory limit in megabytes.", "MB", "512"));
+}
+
+
+int Cli::run(QCoreApplication &app)
+{
+	QCommandLineParser parser;
+	addOptions(parser);
+	parser.process(app);
+
+	gst_dp_init();
+
+	if(parser.isSet("trace"))
+		Stats::setTracing(true);
+
+	MemoryBudget budget(parser.value("memory-limit").toLongLong() * 1024 * 1024);
+
+	int res = 0;
+	if(parser.isSet("stats-json"))
+		res = statsJson(parser, budget);
+	else if(parser.isSet("quick-look"))
+		res = quickLook(parser, budget);
+	else if(parser.isSet("extract"))
+		res = extract(parser, budget);
+	else if(parser.isSet("replay"))
+		res = replay(parser, budget);
+	else if(parser.isSet("archive") || parser.isSet("unarchive"))
+		res = archive(parser, budget);
+	else if(parser.isSet("merge"))
+		res = merge(parser, budget);
+	else if(parser.isSet("export"))
+		res = exportIndex(parser, budget);
+	else if(parser.isSet("split"))
+		res = split(parser, budget);
+	else if(parser.isSet("monitor"))
+		res = monitor(app, parser);
+
+	if(parser.isSet("trace") && !Stats::writeTrace(parser.value("trace")))
+	{
+		QTextStream(stderr) << "Problem with writing trace to `" << parser.value("trace") << "`\n";
+		res = 1;
+	}
+
+	return res;
+}
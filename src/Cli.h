@@ -0,0 +1,17 @@
+#ifndef CLI_H_
+#define CLI_H_
+
+#include <QCommandLineParser>
+
+// Command line front end. Commands run without creating any window, so
+// isCommand() must be checked before the application object is created.
+class Cli
+{
+	public:
+		static bool isCommand(int argc, char **argv);
+		static void addOptions(QCommandLineParser &parser);
+		static int run(QCoreApplication &app);
+};
+
+
+#endif
@@ -0,0 +1,71 @@
+#include "ClockTime.h"
+
+#include <QStringList>
+
+#include <gst/gst.h>
+
+QString ClockTime::toString(guint64 time)
+{
+	if(!GST_CLOCK_TIME_IS_VALID(time))
+		return "not set";
+
+	guint64 seconds = time / GST_SECOND;
+
+	return QString("%1:%2:%3.%4")
+		.arg(seconds / 3600)
+		.arg((seconds / 60) % 60, 2, 10, QChar('0'))
+		.arg(seconds % 60, 2, 10, QChar('0'))
+		.arg(time % GST_SECOND, 9, 10, QChar('0'));
+}
+
+
+// accepts [[h:]m:]s[.fraction], with at most nine digits of fraction
+guint64 ClockTime::fromString(const QString &str, bool *pok)
+{
+	if(pok)
+		*pok = false;
+
+	QStringList parts = str.trimmed().split(':');
+	if(parts.size() > 3)
+		return GST_CLOCK_TIME_NONE;
+
+	QString last = parts.takeLast();
+	QString fraction;
+
+	int dot = last.indexOf('.');
+	if(dot >= 0)
+	{
+		fraction = last.mid(dot + 1);
+		last = last.left(dot);
+
+		if(fraction.isEmpty() || fraction.size() > 9)
+			return GST_CLOCK_TIME_NONE;
+	}
+
+	parts.append(last);
+
+	guint64 seconds = 0;
+	for(int i = 0; i < parts.size(); i++)
+	{
+		bool ok = false;
+		guint64 value = parts[i].toULongLong(&ok);
+		if(!ok)
+			return GST_CLOCK_TIME_NONE;
+
+		seconds = seconds * 60 + value;
+	}
+
+	guint64 nanoseconds = 0;
+	if(!fraction.isEmpty())
+	{
+		bool ok = false;
+		nanoseconds = fraction.leftJustified(9, '0').toULongLong(&ok);
+		if(!ok)
+			return GST_CLOCK_TIME_NONE;
+	}
+
+	if(pok)
+		*pok = true;
+
+	return seconds * GST_SECOND + nanoseconds;
+}
@@ -0,0 +1,18 @@
+#ifndef CLOCK_TIME_H_
+#define CLOCK_TIME_H_
+
+#include <QString>
+
+#include <glib.h>
+
+// Conversion of GstClockTime values to and from the h:mm:ss.nnnnnnnnn form
+// used by GST_TIME_FORMAT.
+class ClockTime
+{
+	public:
+		static QString toString(guint64 time);
+		static guint64 fromString(const QString &str, bool *pok = NULL);
+};
+
+
+#endif
@@ -0,0 +1,173 @@
+#include "DetailCache.h"
+#include "Stats.h"
+
+DetailCache::DetailCache(qint64 budget):
+	m_phead(NULL),
+	m_ptail(NULL),
+	m_budget(budget),
+	m_bytes(0),
+	m_hits(0),
+	m_misses(0)
+{
+}
+
+
+DetailCache::~DetailCache()
+{
+	clear();
+}
+
+
+void DetailCache::setBudget(qint64 bytes)
+{
+	m_budget = bytes;
+	trim();
+}
+
+
+qint64 DetailCache::budget() const
+{
+	return m_budget;
+}
+
+
+qint64 DetailCache::bytes() const
+{
+	return m_bytes;
+}
+
+
+int DetailCache::count() const
+{
+	return m_entries.size();
+}
+
+
+PacketDetails *DetailCache::details(qint64 row)
+{
+	Entry *pentry = lookup(row);
+
+	if(!pentry)
+	{
+		m_misses++;
+		Stats::add(Stats::CacheMisses);
+		return NULL;
+	}
+
+	m_hits++;
+	Stats::add(Stats::CacheHits);
+	return pentry -> pdetails;
+}
+
+
+GstMiniObject *DetailCache::object(qint64 row)
+{
+	Entry *pentry = lookup(row);
+	return pentry ? pentry -> pobject : NULL;
+}
+
+
+void DetailCache::insert(qint64 row, PacketDetails *pdetails, GstMiniObject *pobject, qint64 objectBytes)
+{
+	Entry *pentry = m_entries.value(row, NULL);
+	if(pentry)
+		remove(pentry);
+
+	pentry = new Entry;
+	pentry -> row = row;
+	pentry -> pdetails = pdetails;
+	pentry -> pobject = pobject;
+	pentry -> bytes = sizeof(Entry) + pdetails -> bytes() + objectBytes;
+	pentry -> pprev = NULL;
+	pentry -> pnext = NULL;
+
+	m_entries.insert(row, pentry);
+	pushFront(pentry);
+	m_bytes += pentry -> bytes;
+
+	trim();
+}
+
+
+void DetailCache::clear()
+{
+	while(m_ptail)
+		remove(m_ptail);
+}
+
+
+quint64 DetailCache::hits() const
+{
+	return m_hits;
+}
+
+
+quint64 DetailCache::misses() const
+{
+	return m_misses;
+}
+
+
+DetailCache::Entry *DetailCache::lookup(qint64 row)
+{
+	Entry *pentry = m_entries.value(row, NULL);
+
+	if(pentry && pentry != m_phead)
+	{
+		unlink(pentry);
+		pushFront(pentry);
+	}
+
+	return pentry;
+}
+
+
+void DetailCache::unlink(Entry *pentry)
+{
+	if(pentry -> pprev)
+		pentry -> pprev -> pnext = pentry -> pnext;
+	else
+		m_phead = pentry -> pnext;
+
+	if(pentry -> pnext)
+		pentry -> pnext -> pprev = pentry -> pprev;
+	else
+		m_ptail = pentry -> pprev;
+
+	pentry -> pprev = NULL;
+	pentry -> pnext = NULL;
+}
+
+
+void DetailCache::pushFront(Entry *pentry)
+{
+	pentry -> pprev = NULL;
+	pentry -> pnext = m_phead;
+
+	if(m_phead)
+		m_phead -> pprev = pentry;
+	m_phead = pentry;
+
+	if(!m_ptail)
+		m_ptail = pentry;
+}
+
+
+void DetailCache::remove(Entry *pentry)
+{
+	unlink(pentry);
+	m_entries.remove(pentry -> row);
+	m_bytes -= pentry -> bytes;
+
+	if(pentry -> pobject)
+		gst_mini_object_unref(pentry -> pobject);
+	delete pentry -> pdetails;
+	delete pentry;
+}
+
+
+void DetailCache::trim()
+{
+	while(m_bytes > m_budget && m_ptail && m_ptail != m_phead)
+		remove(m_ptail);
+}
@@ -0,0 +1,63 @@
+#ifndef DETAIL_CACHE_H_
+#define DETAIL_CACHE_H_
+
+#include <QHash>
+
+#include <gst/gstminiobject.h>
+
+#include "PacketDetails.h"
+
+// Least recently used cache of decoded packets keyed by packet row. An entry
+// owns the rendered detail rows and, for caps and events, a reference to the
+// decoded GstCaps/GstEvent. Entries are evicted once their estimated size
+// exceeds the byte budget; the most recently inserted one is always kept so
+// that pointers returned by lookups stay valid until the next insert.
+class DetailCache
+{
+	public:
+		explicit DetailCache(qint64 budget = 64 * 1024 * 1024);
+		~DetailCache();
+
+		void setBudget(qint64 bytes);
+		qint64 budget() const;
+		qint64 bytes() const;
+		int count() const;
+
+		PacketDetails *details(qint64 row);
+		GstMiniObject *object(qint64 row);
+		void insert(qint64 row, PacketDetails *pdetails, GstMiniObject *pobject, qint64 objectBytes);
+		void clear();
+
+		quint64 hits() const;
+		quint64 misses() const;
+
+	private:
+		Q_DISABLE_COPY(DetailCache)
+
+		struct Entry
+		{
+			qint64 row;
+			PacketDetails *pdetails;
+			GstMiniObject *pobject;
+			qint64 bytes;
+			Entry *pprev;
+			Entry *pnext;
+		};
+
+		Entry *lookup(qint64 row);
+		void unlink(Entry *pentry);
+		void pushFront(Entry *pentry);
+		void remove(Entry *pentry);
+		void trim();
+
+		QHash<qint64, Entry *> m_entries;
+		Entry *m_phead;
+		Entry *m_ptail;
+		qint64 m_budget;
+		qint64 m_bytes;
+		quint64 m_hits;
+		quint64 m_misses;
+};
+
+
+#endif
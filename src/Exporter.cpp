@@ -0,0 +1,784 @@
+#include "Exporter.h"
+#include "GdpFile.h"
+#include "dataprotocol.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QCryptographicHash>
+#include <QtEndian>
+
+#include <gst/gst.h>
+
+#include <cstring>
+
+// rows of an Arrow record batch, and of a write of CSV
+static const int BATCH_SIZE = 65536;
+
+// Arrow ids, from Schema.fbs and Message.fbs of the format
+static const quint8 ARROW_TYPE_INT = 2;
+static const quint8 ARROW_TYPE_UTF8 = 5;
+static const quint8 ARROW_TYPE_DURATION = 18;
+static const quint8 ARROW_HEADER_SCHEMA = 1;
+static const quint8 ARROW_HEADER_RECORD_BATCH = 3;
+static const qint16 ARROW_VERSION_V5 = 4;
+static const qint16 ARROW_NANOSECOND = 3;
+
+static const char ARROW_MAGIC[8] = {'A', 'R', 'R', 'O', 'W', '1', 0, 0};
+
+namespace
+{
+	enum Kind
+	{
+		KindInt,
+		KindDuration,
+		KindUtf8
+	};
+
+	struct ColumnInfo
+	{
+		const char *name;
+		Kind kind;
+		int bitWidth;
+		bool isSigned;
+	};
+
+	enum
+	{
+		ColumnRow,
+		ColumnFilePos,
+		ColumnType,
+		ColumnPayloadType,
+		ColumnSize,
+		ColumnPts,
+		ColumnDuration,
+		ColumnRunningTime,
+		ColumnStreamTime,
+		ColumnOffset,
+		ColumnOffsetEnd,
+		ColumnBufferFlags,
+		ColumnHeaderFlags,
+		ColumnSection,
+		ColumnEvent,
+		ColumnHash,
+		ColumnCount
+	};
+
+	// every column may have nulls, times and offsets are null where they
+	// are not set and for packets other than buffers
+	const ColumnInfo s_columns[ColumnCount] =
+	{
+		{"row", KindInt, 64, true},
+		{"file_pos", KindInt, 64, true},
+		{"type", KindUtf8, 0, false},
+		{"payload_type", KindInt, 16, false},
+		{"size", KindInt, 32, false},
+		{"pts", KindDuration, 64, true},
+		{"duration", KindDuration, 64, true},
+		{"running_time", KindDuration, 64, true},
+		{"stream_time", KindDuration, 64, true},
+		{"offset", KindInt, 64, false},
+		{"offset_end", KindInt, 64, false},
+		{"buffer_flags", KindInt, 16, false},
+		{"header_flags", KindInt, 8, false},
+		{"section", KindInt, 64, true},
+		{"event", KindUtf8, 0, false},
+		{"payload_hash", KindInt, 64, false}
+	};
+
+	// Flatbuffer builder for the Arrow metadata. As with the flatbuffers
+	// library, the buffer is written back to front, children before the
+	// tables that refer to them, and objects are known by their distance
+	// from the end. Scalars are written in host order, which limits the
+	// export to little-endian hosts like the format itself.
+	class FlatBuilder
+	{
+		public:
+			void startTable()
+			{
+				m_fields.clear();
+			}
+
+			template <typename T>
+			void add(int id, T value)
+			{
+				Field field;
+				field.id = id;
+				field.data = QByteArray((const char *) &value, sizeof(T));
+				field.target = 0;
+				m_fields.append(field);
+			}
+
+			void addOffset(int id, quint32 target)
+			{
+				Field field;
+				field.id = id;
+				field.target = target;
+				m_fields.append(field);
+			}
+
+			quint32 endTable()
+			{
+				const int start = m_buf.size();
+				QVector<int> positions(m_fields.size());
+
+				int maxId = -1;
+				for(int i = m_fields.size() - 1; i >= 0; i--)
+				{
+					const Field &field = m_fields[i];
+					if(field.data.isEmpty())
+						prependOffset(field.target);
+					else
+					{
+						prep(field.data.size(), field.data.size());
+						prepend(field.data.constData(), field.data.size());
+					}
+
+					positions[i] = m_buf.size();
+					maxId = qMax(maxId, field.id);
+				}
+
+				// the offset to the vtable is filled in once it is written
+				prep(4, 4);
+				qint32 soffset = 0;
+				prepend(&soffset, sizeof(soffset));
+				const quint32 table = m_buf.size();
+
+				QVector<quint16> vtable(2 + maxId + 1, 0);
+				vtable[0] = vtable.size() * sizeof(quint16);
+				vtable[1] = table - start;
+				for(int i = 0; i < m_fields.size(); i++)
+					vtable[2 + m_fields[i].id] = table - positions[i];
+
+				prepend(vtable.constData(), vtable.size() * sizeof(quint16));
+
+				soffset = m_buf.size() - table;
+				memcpy(m_buf.data() + m_buf.size() - table, &soffset, sizeof(soffset));
+
+				m_fields.clear();
+				return table;
+			}
+
+			quint32 createString(const QByteArray &str)
+			{
+				prep(4, str.size() + 1);
+				prepend("", 1);
+				prepend(str.constData(), str.size());
+
+				quint32 length = str.size();
+				prepend(&length, sizeof(length));
+				return m_buf.size();
+			}
+
+			// vector of scalars or structs
+			quint32 createVector(const void *data, int count, int elementSize, int alignment)
+			{
+				prep(qMax(4, alignment), count * elementSize);
+				prepend(data, count * elementSize);
+
+				quint32 length = count;
+				prepend(&length, sizeof(length));
+				return m_buf.size();
+			}
+
+			quint32 createOffsetVector(const QVector<quint32> &targets)
+			{
+				prep(4, targets.size() * 4);
+				for(int i = targets.size() - 1; i >= 0; i--)
+					prependOffset(targets[i]);
+
+				quint32 length = targets.size();
+				prepend(&length, sizeof(length));
+				return m_buf.size();
+			}
+
+			// the size of the result is a multiple of 8, which keeps the
+			// alignment of its objects where it is written at one
+			QByteArray finish(quint32 root)
+			{
+				prep(8, 4);
+				prependOffset(root);
+
+				QByteArray res = m_buf;
+				m_buf.clear();
+				return res;
+			}
+
+		private:
+			struct Field
+			{
+				int id;
+				QByteArray data;
+				quint32 target;
+			};
+
+			// pads so that the object of the given size written next starts
+			// aligned
+			void prep(int alignment, int size)
+			{
+				while((m_buf.size() + size) % alignment)
+					m_buf.prepend('\0');
+			}
+
+			void prepend(const void *data, int size)
+			{
+				m_buf.prepend(QByteArray((const char *) data, size));
+			}
+
+			void prependOffset(quint32 target)
+			{
+				prep(4, 4);
+				quint32 offset = m_buf.size() + 4 - target;
+				prepend(&offset, sizeof(offset));
+			}
+
+			QVector<Field> m_fields;
+			QByteArray m_buf;
+	};
+
+	// Schema table of the columns, in the builder it goes to
+	quint32 buildSchema(FlatBuilder &builder, int columns)
+	{
+		QVector<quint32> fields;
+		for(int i = 0; i < columns; i++)
+		{
+			const ColumnInfo &info = s_columns[i];
+
+			quint8 typeType;
+			builder.startTable();
+			if(info.kind == KindInt)
+			{
+				typeType = ARROW_TYPE_INT;
+				builder.add<qint32>(0, info.bitWidth);
+				builder.add<quint8>(1, info.isSigned);
+			}
+			else if(info.kind == KindDuration)
+			{
+				typeType = ARROW_TYPE_DURATION;
+				builder.add<qint16>(0, ARROW_NANOSECOND);
+			}
+			else
+				typeType = ARROW_TYPE_UTF8;
+			quint32 type = builder.endTable();
+
+			quint32 name = builder.createString(info.name);
+
+			// readers want the children even when there are none
+			quint32 children = builder.createOffsetVector(QVector<quint32>());
+
+			builder.startTable();
+			builder.addOffset(0, name);
+			builder.add<quint8>(1, 1);
+			builder.add<quint8>(2, typeType);
+			builder.addOffset(3, type);
+			builder.addOffset(5, children);
+			fields.append(builder.endTable());
+		}
+
+		quint32 vector = builder.createOffsetVector(fields);
+
+		builder.startTable();
+		builder.add<qint16>(0, 0);
+		builder.addOffset(1, vector);
+		return builder.endTable();
+	}
+
+	QByteArray buildMessage(FlatBuilder &builder, quint8 headerType, quint32 header, qint64 bodyLength)
+	{
+		builder.startTable();
+		builder.add<qint16>(0, ARROW_VERSION_V5);
+		builder.add<quint8>(1, headerType);
+		builder.addOffset(2, header);
+		builder.add<qint64>(3, bodyLength);
+		return builder.finish(builder.endTable());
+	}
+
+	QByteArray padded(const QByteArray &data)
+	{
+		QByteArray res = data;
+		while(res.size() % 8)
+			res.append('\0');
+		return res;
+	}
+
+	// the 0xFFFFFFFF continuation marker and the length before a message
+	QByteArray messagePrefix(qint32 length)
+	{
+		QByteArray res(8, '\0');
+		qint32 marker = -1;
+		memcpy(res.data(), &marker, 4);
+		memcpy(res.data() + 4, &length, 4);
+		return res;
+	}
+
+	QByteArray csvQuoted(const QByteArray &text)
+	{
+		QByteArray res = text;
+		res.replace('"', "\"\"");
+		return '"' + res + '"';
+	}
+}
+
+
+Exporter::Exporter(QObject *parent):
+	QObject(parent),
+	m_windowSize(64 * 1024 * 1024),
+	m_hashes(false),
+	m_cancel(0),
+	m_section(0),
+	m_rows(0),
+	m_bytes(0)
+{
+}
+
+
+void Exporter::setWindowSize(qint64 bytes)
+{
+	m_windowSize = bytes;
+}
+
+
+void Exporter::setHashes(bool hashes)
+{
+	m_hashes = hashes;
+}
+
+
+qint64 Exporter::rowCount() const
+{
+	return m_rows;
+}
+
+
+qint64 Exporter::bytesWritten() const
+{
+	return m_bytes;
+}
+
+
+QString Exporter::errorString() const
+{
+	return m_error;
+}
+
+
+void Exporter::cancel()
+{
+	m_cancel.store(1);
+}
+
+
+Exporter::Format Exporter::formatOf(const QString &output)
+{
+	return QFileInfo(output).suffix().toLower() == "csv" ? Csv : Arrow;
+}
+
+
+bool Exporter::run(const QString &fileName, PacketIndex *pindex, const Selection &selection, const QString &output, Format format)
+{
+	m_cancel.store(0);
+	m_error.clear();
+	m_section = 0;
+	m_blocks.clear();
+	m_rows = 0;
+	m_bytes = 0;
+	m_columns.resize(m_hashes ? ColumnCount : ColumnCount - 1);
+
+	GdpFile file;
+	if(!file.open(fileName))
+	{
+		m_error = "Problem with open file `" + fileName + "` for reading";
+		return false;
+	}
+	file.setWindowSize(m_windowSize);
+
+	QFile out(output);
+	if(!out.open(QIODevice::WriteOnly | QIODevice::Truncate))
+	{
+		m_error = "Problem with open file `" + output + "` for writing";
+		return false;
+	}
+
+	if(format == Arrow)
+	{
+		FlatBuilder builder;
+		QByteArray schema = buildMessage(builder, ARROW_HEADER_SCHEMA, buildSchema(builder, m_columns.size()), 0);
+
+		if(!write(out, QByteArray(ARROW_MAGIC, sizeof(ARROW_MAGIC))) || !write(out, messagePrefix(schema.size())) || !write(out, schema))
+			return false;
+	}
+	else
+	{
+		QByteArray header;
+		for(int i = 0; i < m_columns.size(); i++)
+			header += QByteArray(i ? "," : "") + s_columns[i].name;
+
+		if(!write(out, header + "\n"))
+			return false;
+	}
+
+	QVector<PacketRecord> records(BATCH_SIZE);
+	QVector<qint64> rows(BATCH_SIZE);
+	const qint64 size = pindex -> size();
+
+	for(qint64 first = 0; first < size; first += BATCH_SIZE)
+	{
+		if(m_cancel.load())
+		{
+			m_error = "Export cancelled";
+			return false;
+		}
+
+		int read = pindex -> read(first, BATCH_SIZE, records.data());
+
+		// the selected records are moved to the front of the batch
+		int count = 0;
+		for(int i = 0; i < read; i++)
+		{
+			if(!selection.isEmpty() && !selection.contains(first + i))
+				continue;
+
+			records[count] = records[i];
+			rows[count++] = first + i;
+		}
+
+		if(count && !fill(file, pindex, records.constData(), rows.constData(), count))
+			return false;
+
+		if(count && !(format == Arrow ? writeArrowBatch(out, count) : writeCsvBatch(out, count)))
+			return false;
+
+		m_rows += count;
+		emit progress(first + read, size);
+	}
+
+	if(format == Arrow)
+	{
+		// end of stream marker, then the footer with the schema again and
+		// where the batches are
+		QByteArray eos(8, '\0');
+		qint32 marker = -1;
+		memcpy(eos.data(), &marker, 4);
+		if(!write(out, eos))
+			return false;
+
+		FlatBuilder builder;
+		quint32 schema = buildSchema(builder, m_columns.size());
+		quint32 dictionaries = builder.createVector(NULL, 0, 24, 8);
+		quint32 batches = builder.createVector(m_blocks.constData(), m_blocks.size() / 24, 24, 8);
+
+		builder.startTable();
+		builder.add<qint16>(0, ARROW_VERSION_V5);
+		builder.addOffset(1, schema);
+		builder.addOffset(2, dictionaries);
+		builder.addOffset(3, batches);
+		QByteArray footer = builder.finish(builder.endTable());
+
+		qint32 footerSize = footer.size();
+		if(!write(out, footer) || !write(out, QByteArray((const char *) &footerSize, 4)) || !write(out, QByteArray(ARROW_MAGIC, 6)))
+			return false;
+	}
+
+	emit progress(size, size);
+	return true;
+}
+
+
+QByteArray Exporter::typeName(guint16 payloadType)
+{
+	QHash<guint16, QByteArray>::const_iterator it = m_typeNames.constFind(payloadType);
+	if(it != m_typeNames.constEnd())
+		return it.value();
+
+	QByteArray name;
+	if(payloadType == GST_DP_PAYLOAD_BUFFER)
+		name = "buffer";
+	else if(payloadType == GST_DP_PAYLOAD_CAPS)
+		name = "caps";
+	else
+		name = gst_event_type_get_name((GstEventType) (payloadType - GST_DP_PAYLOAD_EVENT_NONE));
+
+	m_typeNames.insert(payloadType, name);
+	return name;
+}
+
+
+// caps as a caps string, events as the string of their structure
+QByteArray Exporter::eventText(GdpFile &file, const PacketRecord &record) const
+{
+	const guint8 *header = file.data(record.filePos, GST_DP_HEADER_LENGTH + (qint64) record.payloadLength);
+	if(!header)
+		return QByteArray();
+
+	const guint8 *payload = record.payloadLength ? header + GST_DP_HEADER_LENGTH : NULL;
+	gchar *str = NULL;
+
+	if(record.payloadType == GST_DP_PAYLOAD_CAPS)
+	{
+		GstCaps *pcaps = payload ? gst_dp_caps_from_packet(GST_DP_HEADER_LENGTH, header, payload) : NULL;
+		if(pcaps)
+		{
+			str = gst_caps_to_string(pcaps);
+			gst_caps_unref(pcaps);
+		}
+	}
+	else
+	{
+		GstEvent *pevent = gst_dp_event_from_packet(GST_DP_HEADER_LENGTH, header, payload);
+		if(pevent)
+		{
+			const GstStructure *pstructure = gst_event_get_structure(pevent);
+			if(pstructure)
+				str = gst_structure_to_string(pstructure);
+			gst_event_unref(pevent);
+		}
+	}
+
+	QByteArray res(str ? str : "");
+	g_free(str);
+	return res;
+}
+
+
+bool Exporter::fill(GdpFile &file, const PacketIndex *pindex, const PacketRecord *records, const qint64 *rows, int count)
+{
+	for(int c = 0; c < m_columns.size(); c++)
+	{
+		Column &column = m_columns[c];
+		column.validity.fill('\0', (count + 7) / 8);
+		column.values.clear();
+		column.data.clear();
+		column.nullCount = 0;
+
+		const ColumnInfo &info = s_columns[c];
+		if(info.kind == KindUtf8)
+			column.values.resize((count + 1) * sizeof(qint32));
+		else
+			column.values.resize(count * (info.bitWidth / 8));
+	}
+
+	// each column is filled in a loop of its own
+	for(int c = 0; c < m_columns.size(); c++)
+	{
+		Column &column = m_columns[c];
+		uchar *validity = (uchar *) column.validity.data();
+		char *values = column.values.data();
+
+		for(int i = 0; i < count; i++)
+		{
+			const PacketRecord &record = records[i];
+			const bool buffer = record.payloadType == GST_DP_PAYLOAD_BUFFER;
+			bool valid = true;
+
+			switch(c)
+			{
+				case ColumnRow:
+					((qint64 *) values)[i] = rows[i];
+					break;
+				case ColumnFilePos:
+					((qint64 *) values)[i] = record.filePos;
+					break;
+				case ColumnPayloadType:
+					((quint16 *) values)[i] = record.payloadType;
+					break;
+				case ColumnSize:
+					((quint32 *) values)[i] = record.payloadLength;
+					break;
+				case ColumnPts:
+					valid = buffer && GST_CLOCK_TIME_IS_VALID(record.timestamp);
+					((qint64 *) values)[i] = valid ? record.timestamp : 0;
+					break;
+				case ColumnDuration:
+					valid = buffer && GST_CLOCK_TIME_IS_VALID(record.duration);
+					((qint64 *) values)[i] = valid ? record.duration : 0;
+					break;
+				case ColumnRunningTime:
+					valid = buffer && GST_CLOCK_TIME_IS_VALID(record.runningTime);
+					((qint64 *) values)[i] = valid ? record.runningTime : 0;
+					break;
+				case ColumnStreamTime:
+					valid = buffer && GST_CLOCK_TIME_IS_VALID(record.streamTime);
+					((qint64 *) values)[i] = valid ? record.streamTime : 0;
+					break;
+				case ColumnOffset:
+					valid = buffer && record.offset != GST_BUFFER_OFFSET_NONE;
+					((quint64 *) values)[i] = valid ? record.offset : 0;
+					break;
+				case ColumnOffsetEnd:
+					valid = buffer && record.offsetEnd != GST_BUFFER_OFFSET_NONE;
+					((quint64 *) values)[i] = valid ? record.offsetEnd : 0;
+					break;
+				case ColumnBufferFlags:
+					valid = buffer;
+					((quint16 *) values)[i] = valid ? record.bufferFlags : 0;
+					break;
+				case ColumnHeaderFlags:
+					((quint8 *) values)[i] = record.headerFlags;
+					break;
+				case ColumnSection:
+				{
+					// rows come in order, so the section only moves forward
+					qint64 row = rows[i];
+					while(m_section + 1 < pindex -> sectionCount() && pindex -> section(m_section + 1).firstRow <= row)
+						m_section++;
+					((qint64 *) values)[i] = m_section;
+					break;
+				}
+				case ColumnType:
+				case ColumnEvent:
+				{
+					valid = c == ColumnType || !buffer;
+					if(valid)
+						column.data += c == ColumnType ? typeName(record.payloadType) : eventText(file, record);
+					((qint32 *) values)[i + 1] = column.data.size();
+					break;
+				}
+				case ColumnHash:
+				{
+					valid = buffer;
+					quint64 hash = 0;
+					if(valid && record.payloadLength)
+					{
+						const guint8 *payload = file.data(record.filePos + GST_DP_HEADER_LENGTH, record.payloadLength);
+						if(!payload)
+						{
+							m_error = "Problem with reading `" + file.fileName() + "`";
+							return false;
+						}
+
+						QByteArray digest = QCryptographicHash::hash(QByteArray::fromRawData((const char *) payload, record.payloadLength),
+							QCryptographicHash::Sha1);
+						hash = qFromBigEndian<quint64>((const uchar *) digest.constData());
+					}
+					((quint64 *) values)[i] = hash;
+					break;
+				}
+			}
+
+			if(valid)
+				validity[i / 8] |= 1 << (i % 8);
+			else
+				column.nullCount++;
+		}
+
+		if(s_columns[c].kind == KindUtf8)
+			((qint32 *) values)[0] = 0;
+	}
+
+	return true;
+}
+
+
+bool Exporter::writeArrowBatch(QFile &out, int count)
+{
+	// body layout: validity, values and, for strings, data of each column,
+	// every buffer starting at a multiple of 8
+	QVector<qint64> nodes;
+	QVector<qint64> buffers;
+	QVector<const QByteArray *> parts;
+	qint64 bodyLength = 0;
+
+	for(int c = 0; c < m_columns.size(); c++)
+	{
+		const Column &column = m_columns[c];
+		nodes << count << column.nullCount;
+
+		parts << &column.validity << &column.values;
+		if(s_columns[c].kind == KindUtf8)
+			parts << &column.data;
+
+		for(int i = parts.size() - (s_columns[c].kind == KindUtf8 ? 3 : 2); i < parts.size(); i++)
+		{
+			// no validity buffer is needed without nulls
+			qint64 length = (parts[i] == &column.validity && !column.nullCount) ? 0 : parts[i] -> size();
+			buffers << bodyLength << length;
+			bodyLength += (length + 7) / 8 * 8;
+		}
+	}
+
+	FlatBuilder builder;
+	quint32 nodeVector = builder.createVector(nodes.constData(), nodes.size() / 2, 16, 8);
+	quint32 bufferVector = builder.createVector(buffers.constData(), buffers.size() / 2, 16, 8);
+
+	builder.startTable();
+	builder.add<qint64>(0, count);
+	builder.addOffset(1, nodeVector);
+	builder.addOffset(2, bufferVector);
+	QByteArray message = buildMessage(builder, ARROW_HEADER_RECORD_BATCH, builder.endTable(), bodyLength);
+
+	// Block of the footer: offset, metadata length with its prefix, padding,
+	// body length
+	char block[24];
+	memset(block, 0, sizeof(block));
+	qint64 offset = out.pos();
+	qint32 metadataLength = 8 + message.size();
+	memcpy(block, &offset, 8);
+	memcpy(block + 8, &metadataLength, 4);
+	memcpy(block + 16, &bodyLength, 8);
+	m_blocks.append(block, sizeof(block));
+
+	if(!write(out, messagePrefix(message.size())) || !write(out, message))
+		return false;
+
+	for(int i = 0; i < parts.size(); i++)
+	{
+		qint64 length = buffers[i * 2 + 1];
+		if(length && !write(out, padded(parts[i] -> left(length))))
+			return false;
+	}
+
+	return true;
+}
+
+
+bool Exporter::writeCsvBatch(QFile &out, int count)
+{
+	QByteArray text;
+
+	for(int i = 0; i < count; i++)
+	{
+		for(int c = 0; c < m_columns.size(); c++)
+		{
+			const Column &column = m_columns[c];
+			const ColumnInfo &info = s_columns[c];
+
+			if(c)
+				text += ',';
+
+			if(!(column.validity[i / 8] & (1 << (i % 8))))
+				continue;
+
+			const char *values = column.values.constData();
+			if(info.kind == KindUtf8)
+			{
+				qint32 begin = ((const qint32 *) values)[i];
+				QByteArray str = column.data.mid(begin, ((const qint32 *) values)[i + 1] - begin);
+				text += c == ColumnEvent ? csvQuoted(str) : str;
+			}
+			else if(info.bitWidth == 64)
+				text += info.isSigned ? QByteArray::number(((const qint64 *) values)[i]) : QByteArray::number(((const quint64 *) values)[i]);
+			else if(info.bitWidth == 32)
+				text += QByteArray::number(((const quint32 *) values)[i]);
+			else if(info.bitWidth == 16)
+				text += QByteArray::number(((const quint16 *) values)[i]);
+			else
+				text += QByteArray::number(((const quint8 *) values)[i]);
+		}
+
+		text += '\n';
+	}
+
+	return write(out, text);
+}
+
+
+bool Exporter::write(QFile &out, const QByteArray &data)
+{
+	if(out.write(data) != data.size())
+	{
+		m_error = "Problem with writing to `" + out.fileName() + "`";
+		return false;
+	}
+
+	m_bytes += data.size();
+	return true;
+}
@@ -0,0 +1,85 @@
+#ifndef EXPORTER_H_
+#define EXPORTER_H_
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include <QHash>
+#include <QAtomicInt>
+
+#include "PacketIndex.h"
+#include "Selection.h"
+
+class QFile;
+class GdpFile;
+
+// Writes the packet index of a dump as a table for other tools: an Arrow IPC
+// file (what pandas.read_feather, pyarrow and DuckDB read) or CSV. Records
+// are read from the index in batches and turned into one array per column,
+// which for Arrow are written as they are, so the cost per packet is a few
+// stores; only caps and events are decoded for their text, and buffer
+// payloads are read only when hashes are asked for.
+class Exporter: public QObject
+{
+	Q_OBJECT
+	public:
+		enum Format
+		{
+			Arrow,
+			Csv
+		};
+
+		explicit Exporter(QObject *parent = 0);
+
+		void setWindowSize(qint64 bytes);
+
+		// adds a column with the first 64 bits of the SHA-1 of buffer payloads
+		void setHashes(bool hashes);
+
+		// an empty selection takes every packet
+		bool run(const QString &fileName, PacketIndex *pindex, const Selection &selection, const QString &output, Format format);
+
+		qint64 rowCount() const;
+		qint64 bytesWritten() const;
+		QString errorString() const;
+
+		static Format formatOf(const QString &output);
+
+	public slots:
+		void cancel();
+
+	signals:
+		void progress(qint64 done, qint64 total);
+
+	private:
+		// one batch of rows, column by column
+		struct Column
+		{
+			QByteArray validity;
+			QByteArray values;
+			QByteArray data;
+			qint64 nullCount;
+		};
+
+		bool fill(GdpFile &file, const PacketIndex *pindex, const PacketRecord *records, const qint64 *rows, int count);
+		QByteArray typeName(guint16 payloadType);
+		QByteArray eventText(GdpFile &file, const PacketRecord &record) const;
+		bool writeArrowBatch(QFile &out, int count);
+		bool writeCsvBatch(QFile &out, int count);
+		bool write(QFile &out, const QByteArray &data);
+
+		qint64 m_windowSize;
+		bool m_hashes;
+		QAtomicInt m_cancel;
+		QVector<Column> m_columns;
+		QHash<guint16, QByteArray> m_typeNames;
+		qint64 m_section;
+		QByteArray m_blocks;
+		qint64 m_rows;
+		qint64 m_bytes;
+		QString m_error;
+};
+
+
+#endif
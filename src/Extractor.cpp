@@ -0,0 +1,183 @@
+#include "Extractor.h"
+#include "PacketIndex.h"
+#include "GdpFile.h"
+#include "GdpArchive.h"
+#include "KernelCopy.h"
+#include "dataprotocol.h"
+
+#include <QFile>
+#include <QDir>
+#include <QVector>
+
+static const int BATCH_SIZE = 4096;
+
+// bytes between two progress reports
+static const qint64 REPORT_BYTES = 64 * 1024 * 1024;
+
+static const qint64 COPY_CHUNK = 1024 * 1024;
+
+namespace
+{
+	// archives hold compressed payloads, which go through a decompressed window
+	bool writeFromArchive(GdpFile &file, int target, qint64 pos, qint64 length)
+	{
+		while(length > 0)
+		{
+			qint64 chunk = qMin(length, COPY_CHUNK);
+			const guint8 *data = file.data(pos, chunk);
+			if(!data || !KernelCopy::writeAll(target, (const char *) data, chunk))
+				return false;
+
+			pos += chunk;
+			length -= chunk;
+		}
+
+		return true;
+	}
+}
+
+
+Extractor::Extractor(QObject *parent):
+	QObject(parent),
+	m_cancel(0),
+	m_buffers(0),
+	m_bytes(0)
+{
+}
+
+
+void Extractor::cancel()
+{
+	m_cancel.store(1);
+}
+
+
+qint64 Extractor::bufferCount() const
+{
+	return m_buffers;
+}
+
+
+qint64 Extractor::bytesWritten() const
+{
+	return m_bytes;
+}
+
+
+QString Extractor::errorString() const
+{
+	return m_error;
+}
+
+
+bool Extractor::run(const QString &fileName, PacketIndex *pindex, const Selection &selection,
+	const QString &output, Mode mode)
+{
+	m_cancel.store(0);
+	m_copy.reset();
+	m_buffers = 0;
+	m_bytes = 0;
+	m_error.clear();
+
+	QFile source(fileName);
+	if(!source.open(QIODevice::ReadOnly))
+	{
+		m_error = "Problem with open file `" + fileName + "` for reading";
+		return false;
+	}
+
+	GdpFile archive;
+	if(GdpArchive::isArchive(fileName) && !archive.open(fileName))
+	{
+		m_error = "Problem with open archive `" + fileName + "`";
+		return false;
+	}
+
+	QFile target;
+	if(mode == Concatenate)
+	{
+		target.setFileName(output);
+		if(!target.open(QIODevice::WriteOnly | QIODevice::Truncate))
+		{
+			m_error = "Problem with open file `" + output + "` for writing";
+			return false;
+		}
+	}
+	else if(!QDir().mkpath(output))
+	{
+		m_error = "Problem with creating directory `" + output + "`";
+		return false;
+	}
+
+	qint64 total = 0;
+	QVector<PacketRecord> records(BATCH_SIZE);
+	const qint64 size = pindex -> size();
+
+	for(qint64 first = 0; first < size; first += BATCH_SIZE)
+	{
+		qint64 count = pindex -> read(first, BATCH_SIZE, records.data());
+		for(qint64 i = 0; i < count; i++)
+		{
+			if(records[i].payloadType == GST_DP_PAYLOAD_BUFFER && (selection.isEmpty() || selection.contains(first + i)))
+				total += records[i].payloadLength;
+		}
+	}
+
+	qint64 reported = 0;
+	emit progress(0, total);
+
+	for(qint64 first = 0; first < size; first += BATCH_SIZE)
+	{
+		qint64 count = pindex -> read(first, BATCH_SIZE, records.data());
+
+		for(qint64 i = 0; i < count; i++)
+		{
+			const PacketRecord &record = records[i];
+			const qint64 row = first + i;
+
+			if(record.payloadType != GST_DP_PAYLOAD_BUFFER || !record.payloadLength)
+				continue;
+			if(!selection.isEmpty() && !selection.contains(row))
+				continue;
+
+			if(m_cancel.load())
+			{
+				m_error = "Extraction cancelled";
+				return false;
+			}
+
+			if(mode == PerBuffer)
+			{
+				target.close();
+				target.setFileName(output + "/" + QString("%1.bin").arg(row, 10, 10, QChar('0')));
+				if(!target.open(QIODevice::WriteOnly | QIODevice::Truncate))
+				{
+					m_error = "Problem with open file `" + target.fileName() + "` for writing";
+					return false;
+				}
+			}
+
+			const qint64 pos = record.filePos + GST_DP_HEADER_LENGTH;
+			bool written = archive.isOpen() ? writeFromArchive(archive, target.handle(), pos, record.payloadLength)
+				: m_copy.copy(source.handle(), target.handle(), pos, record.payloadLength);
+
+			if(!written)
+			{
+				m_error = "Problem with writing to `" + target.fileName() + "`";
+				return false;
+			}
+
+			m_buffers++;
+			m_bytes += record.payloadLength;
+
+			if(m_bytes - reported >= REPORT_BYTES)
+			{
+				reported = m_bytes;
+				emit progress(m_bytes, total);
+			}
+		}
+	}
+
+	emit progress(total, total);
+	return true;
+}
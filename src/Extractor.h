@@ -0,0 +1,53 @@
+#ifndef EXTRACTOR_H_
+#define EXTRACTOR_H_
+
+#include <QObject>
+#include <QString>
+#include <QAtomicInt>
+
+#include "Selection.h"
+#include "KernelCopy.h"
+
+class PacketIndex;
+
+// Writes buffer payloads of a dump out of it, either one after the other in
+// a single file (an elementary stream for byte-stream formats) or each in its
+// own file of a directory. The data is copied by the kernel from the offsets
+// of the dump where it can be (see KernelCopy); payloads of gdp archives are
+// decompressed and written from memory.
+class Extractor: public QObject
+{
+	Q_OBJECT
+	public:
+		enum Mode
+		{
+			Concatenate,
+			PerBuffer
+		};
+
+		explicit Extractor(QObject *parent = 0);
+
+		// an empty selection extracts all buffers
+		bool run(const QString &fileName, PacketIndex *pindex, const Selection &selection,
+			const QString &output, Mode mode);
+
+		qint64 bufferCount() const;
+		qint64 bytesWritten() const;
+		QString errorString() const;
+
+	public slots:
+		void cancel();
+
+	signals:
+		void progress(qint64 done, qint64 total);
+
+	private:
+		QAtomicInt m_cancel;
+		KernelCopy m_copy;
+		qint64 m_buffers;
+		qint64 m_bytes;
+		QString m_error;
+};
+
+
+#endif
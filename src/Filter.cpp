@@ -0,0 +1,1028 @@
+#include "Filter.h"
+#include "PacketIndex.h"
+#include "PacketTableModel.h"
+#include "GdpFile.h"
+#include "ClockTime.h"
+#include "dataprotocol.h"
+
+#include <QVector>
+#include <QHash>
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QAtomicInt>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include <gst/gst.h>
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+// multiple of 64, so chunks never share a selection word
+static const int CHUNK = 65536;
+
+struct FilterNode
+{
+	enum Kind
+	{
+		Constant,
+		Column,
+		Symbol,
+		Field,
+		BitAnd,
+		Compare,
+		Between,
+		And,
+		Or,
+		Not
+	};
+
+	enum Op
+	{
+		Equal,
+		NotEqual,
+		Less,
+		LessEqual,
+		Greater,
+		GreaterEqual
+	};
+
+	explicit FilterNode(Kind k):
+		kind(k),
+		column(-1),
+		isDouble(false),
+		intValue(0),
+		doubleValue(0),
+		op(Equal)
+	{
+		pchildren[0] = pchildren[1] = pchildren[2] = NULL;
+	}
+
+	~FilterNode()
+	{
+		for(int i = 0; i < 3; i++)
+			delete pchildren[i];
+	}
+
+	Kind kind;
+	int column;
+	QByteArray name;
+	bool isDouble;
+	quint64 intValue;
+	double doubleValue;
+	Op op;
+	FilterNode *pchildren[3];
+};
+
+
+namespace
+{
+	struct Token
+	{
+		enum Type
+		{
+			End,
+			Number,
+			Identifier,
+			Operator,
+			LeftParen,
+			RightParen
+		};
+
+		Type type;
+		QString text;
+		int pos;
+	};
+
+	struct Values
+	{
+		bool isDouble;
+		QVector<quint64> ints;
+		QVector<double> doubles;
+	};
+
+	// records of one chunk and the packets decoded for structure fields
+	struct Chunk
+	{
+		const PacketRecord *precords;
+		int count;
+		GdpFile *pfile;
+		QHash<int, GstMiniObject *> objects;
+	};
+
+
+	class Parser
+	{
+		public:
+			Parser(const QString &text):
+				m_text(text),
+				m_pos(0)
+			{
+				next();
+			}
+
+			FilterNode *parse(QString *perror)
+			{
+				FilterNode *pnode = parseOr();
+				if(pnode && m_token.type != Token::End)
+				{
+					delete pnode;
+					pnode = NULL;
+					fail("unexpected `" + m_token.text + "`");
+				}
+
+				if(!pnode)
+					*perror = m_error;
+
+				return pnode;
+			}
+
+		private:
+			void next()
+			{
+				while(m_pos < m_text.size() && m_text[m_pos].isSpace())
+					m_pos++;
+
+				m_token.pos = m_pos;
+				m_token.text.clear();
+
+				if(m_pos >= m_text.size())
+				{
+					m_token.type = Token::End;
+					m_token.text = "end of expression";
+					return;
+				}
+
+				QChar c = m_text[m_pos];
+				static const char *operators[] = {"&&", "||", "==", "!=", "<=", ">=", "<", ">", "&", "!"};
+
+				if(c.isDigit())
+				{
+					while(m_pos < m_text.size() && (m_text[m_pos].isLetterOrNumber() || m_text[m_pos] == '.' || m_text[m_pos] == ':'))
+						m_pos++;
+					m_token.type = Token::Number;
+				}
+				else if(c.isLetter() || c == '_')
+				{
+					while(m_pos < m_text.size() && (m_text[m_pos].isLetterOrNumber() || m_text[m_pos] == '_' || m_text[m_pos] == '-'))
+						m_pos++;
+					m_token.type = Token::Identifier;
+				}
+				else if(c == '(' || c == ')')
+				{
+					m_pos++;
+					m_token.type = c == '(' ? Token::LeftParen : Token::RightParen;
+				}
+				else
+				{
+					m_token.type = Token::End;
+					for(unsigned i = 0; i < sizeof(operators) / sizeof(operators[0]); i++)
+					{
+						if(m_text.midRef(m_pos).startsWith(operators[i]))
+						{
+							m_pos += strlen(operators[i]);
+							m_token.type = Token::Operator;
+							break;
+						}
+					}
+
+					if(m_token.type == Token::End)
+					{
+						m_pos++;
+						m_token.type = Token::Operator;
+					}
+				}
+
+				m_token.text = m_text.mid(m_token.pos, m_pos - m_token.pos);
+			}
+
+			bool isOperator(const char *op) const
+			{
+				return m_token.type == Token::Operator && m_token.text == op;
+			}
+
+			bool isKeyword(const char *keyword) const
+			{
+				return m_token.type == Token::Identifier && m_token.text.compare(keyword, Qt::CaseInsensitive) == 0;
+			}
+
+			FilterNode *fail(const QString &message)
+			{
+				if(m_error.isEmpty())
+					m_error = message + " at position " + QString::number(m_token.pos + 1);
+				return NULL;
+			}
+
+			FilterNode *binary(FilterNode::Kind kind, FilterNode *pleft, FilterNode *pright)
+			{
+				if(!pright)
+				{
+					delete pleft;
+					return NULL;
+				}
+
+				FilterNode *pnode = new FilterNode(kind);
+				pnode -> pchildren[0] = pleft;
+				pnode -> pchildren[1] = pright;
+				return pnode;
+			}
+
+			FilterNode *parseOr()
+			{
+				FilterNode *pnode = parseAnd();
+				while(pnode && isOperator("||"))
+				{
+					next();
+					pnode = binary(FilterNode::Or, pnode, parseAnd());
+				}
+
+				return pnode;
+			}
+
+			FilterNode *parseAnd()
+			{
+				FilterNode *pnode = parseNot();
+				while(pnode && isOperator("&&"))
+				{
+					next();
+					pnode = binary(FilterNode::And, pnode, parseNot());
+				}
+
+				return pnode;
+			}
+
+			FilterNode *parseNot()
+			{
+				if(!isOperator("!"))
+					return parseCompare();
+
+				next();
+				FilterNode *pchild = parseNot();
+				if(!pchild)
+					return NULL;
+
+				FilterNode *pnode = new FilterNode(FilterNode::Not);
+				pnode -> pchildren[0] = pchild;
+				return pnode;
+			}
+
+			FilterNode *parseCompare()
+			{
+				FilterNode *pleft = parseBitAnd();
+				if(!pleft)
+					return NULL;
+
+				if(isKeyword("between"))
+				{
+					next();
+					FilterNode *plow = parseBitAnd();
+					if(!plow)
+					{
+						delete pleft;
+						return NULL;
+					}
+
+					if(!isKeyword("and"))
+					{
+						delete pleft;
+						delete plow;
+						return fail("expected `and`");
+					}
+
+					next();
+					FilterNode *pnode = binary(FilterNode::Between, pleft, plow);
+					if(!pnode)
+						return NULL;
+
+					pnode -> pchildren[2] = parseBitAnd();
+					if(!pnode -> pchildren[2])
+					{
+						delete pnode;
+						return NULL;
+					}
+
+					return pnode;
+				}
+
+				static const char *ops[] = {"==", "!=", "<", "<=", ">", ">="};
+				for(int i = 0; i < 6; i++)
+				{
+					if(isOperator(ops[i]))
+					{
+						next();
+						FilterNode *pnode = binary(FilterNode::Compare, pleft, parseBitAnd());
+						if(pnode)
+							pnode -> op = (FilterNode::Op) i;
+						return pnode;
+					}
+				}
+
+				return pleft;
+			}
+
+			FilterNode *parseBitAnd()
+			{
+				FilterNode *pnode = parsePrimary();
+				while(pnode && isOperator("&"))
+				{
+					next();
+					pnode = binary(FilterNode::BitAnd, pnode, parsePrimary());
+				}
+
+				return pnode;
+			}
+
+			FilterNode *parsePrimary()
+			{
+				if(m_token.type == Token::LeftParen)
+				{
+					next();
+					FilterNode *pnode = parseOr();
+					if(!pnode)
+						return NULL;
+
+					if(m_token.type != Token::RightParen)
+					{
+						delete pnode;
+						return fail("expected `)`");
+					}
+
+					next();
+					return pnode;
+				}
+				else if(m_token.type == Token::Number)
+				{
+					FilterNode *pnode = parseNumber(m_token.text);
+					if(!pnode)
+						return fail("`" + m_token.text + "` is not a number");
+
+					next();
+					return pnode;
+				}
+				else if(m_token.type == Token::Identifier)
+				{
+					FilterNode *pnode = new FilterNode(FilterNode::Symbol);
+					pnode -> name = m_token.text.toUtf8();
+					pnode -> column = columnOf(m_token.text.toLower());
+					if(pnode -> column >= 0)
+						pnode -> kind = FilterNode::Column;
+
+					next();
+					return pnode;
+				}
+
+				return fail("unexpected " + m_token.text);
+			}
+
+			static int columnOf(const QString &name)
+			{
+				if(name == "type" || name == "event")
+					return PacketTableModel::ColumnType;
+				else if(name == "pts")
+					return PacketTableModel::ColumnPts;
+				else if(name == "duration")
+					return PacketTableModel::ColumnDuration;
+				else if(name == "running_time")
+					return PacketTableModel::ColumnRunningTime;
+				else if(name == "stream_time")
+					return PacketTableModel::ColumnStreamTime;
+				else if(name == "size")
+					return PacketTableModel::ColumnSize;
+				else if(name == "offset")
+					return PacketTableModel::ColumnOffset;
+				else if(name == "offset_end")
+					return PacketTableModel::ColumnOffsetEnd;
+				else if(name == "flags")
+					return PacketTableModel::ColumnFlags;
+				else if(name == "pos")
+					return PacketTableModel::ColumnFilePos;
+
+				return -1;
+			}
+
+			// integers, decimals, times with a ns, us, ms or s unit and
+			// h:mm:ss.nnnnnnnnn clock times
+			static FilterNode *parseNumber(const QString &text)
+			{
+				FilterNode *pnode = new FilterNode(FilterNode::Constant);
+				bool ok = false;
+
+				if(text.contains(':'))
+				{
+					pnode -> intValue = ClockTime::fromString(text, &ok);
+				}
+				else
+				{
+					int unit = 0;
+					while(unit < text.size() && (text[unit].isDigit() || text[unit] == '.'))
+						unit++;
+
+					QString number = text.left(unit);
+					QString suffix = text.mid(unit).toLower();
+
+					double scale = 0;
+					if(suffix == "ns")
+						scale = 1;
+					else if(suffix == "us")
+						scale = GST_USECOND;
+					else if(suffix == "ms")
+						scale = GST_MSECOND;
+					else if(suffix == "s")
+						scale = GST_SECOND;
+					else if(!suffix.isEmpty())
+					{
+						delete pnode;
+						return NULL;
+					}
+
+					if(number.contains('.'))
+					{
+						double value = number.toDouble(&ok);
+						if(scale > 0)
+							pnode -> intValue = (quint64) (value * scale + 0.5);
+						else
+						{
+							pnode -> isDouble = true;
+							pnode -> doubleValue = value;
+						}
+					}
+					else
+						pnode -> intValue = number.toULongLong(&ok) * (quint64) (scale > 0 ? scale : 1);
+				}
+
+				if(!ok)
+				{
+					delete pnode;
+					return NULL;
+				}
+
+				if(!pnode -> isDouble)
+					pnode -> doubleValue = pnode -> intValue;
+
+				return pnode;
+			}
+
+			QString m_text;
+			int m_pos;
+			Token m_token;
+			QString m_error;
+	};
+
+
+	QByteArray nick(const QByteArray &name)
+	{
+		return name.toLower().replace('_', '-');
+	}
+
+
+	// Names next to the type column are packet types, next to the flags
+	// column buffer flags, anywhere else structure fields.
+	bool resolve(FilterNode *pnode, int context, QString *perror)
+	{
+		if(!pnode)
+			return true;
+
+		if(pnode -> kind == FilterNode::Symbol)
+		{
+			if(context == PacketTableModel::ColumnType)
+			{
+				QByteArray name = nick(pnode -> name);
+				if(name == "buffer")
+					pnode -> intValue = GST_DP_PAYLOAD_BUFFER;
+				else if(name == "caps")
+					pnode -> intValue = GST_DP_PAYLOAD_CAPS;
+				else
+				{
+					GEnumClass *pclass = (GEnumClass *) g_type_class_ref(GST_TYPE_EVENT_TYPE);
+					GEnumValue *pvalue = g_enum_get_value_by_nick(pclass, name.constData());
+					if(pvalue)
+						pnode -> intValue = GST_DP_PAYLOAD_EVENT_NONE + pvalue -> value;
+					g_type_class_unref(pclass);
+
+					if(!pvalue)
+					{
+						*perror = "unknown packet type `" + QString(pnode -> name) + "`";
+						return false;
+					}
+				}
+			}
+			else if(context == PacketTableModel::ColumnFlags)
+			{
+				GFlagsClass *pclass = (GFlagsClass *) g_type_class_ref(GST_TYPE_BUFFER_FLAGS);
+				GFlagsValue *pvalue = g_flags_get_value_by_nick(pclass, nick(pnode -> name).constData());
+				if(pvalue)
+					pnode -> intValue = pvalue -> value;
+				g_type_class_unref(pclass);
+
+				if(!pvalue)
+				{
+					*perror = "unknown buffer flag `" + QString(pnode -> name) + "`";
+					return false;
+				}
+			}
+			else
+			{
+				pnode -> kind = FilterNode::Field;
+				return true;
+			}
+
+			pnode -> kind = FilterNode::Constant;
+			pnode -> doubleValue = pnode -> intValue;
+			return true;
+		}
+
+		int childContext = -1;
+		if(pnode -> kind == FilterNode::Compare || pnode -> kind == FilterNode::Between || pnode -> kind == FilterNode::BitAnd)
+		{
+			for(int i = 0; i < 3; i++)
+			{
+				const FilterNode *pchild = pnode -> pchildren[i];
+
+				// the context of flags & X == 0 is found below the comparison
+				while(pchild && pchild -> kind == FilterNode::BitAnd)
+					pchild = pchild -> pchildren[0] -> kind == FilterNode::Column ? pchild -> pchildren[0] : pchild -> pchildren[1];
+
+				if(pchild && pchild -> kind == FilterNode::Column)
+					childContext = pchild -> column;
+			}
+		}
+
+		for(int i = 0; i < 3; i++)
+		{
+			if(!resolve(pnode -> pchildren[i], childContext, perror))
+				return false;
+		}
+
+		return true;
+	}
+
+
+	double fieldValue(const GstStructure *pstructure, const QByteArray &name)
+	{
+		const GValue *pvalue = gst_structure_get_value(pstructure, name.constData());
+		if(!pvalue)
+			pvalue = gst_structure_get_value(pstructure, nick(name).constData());
+		if(!pvalue)
+			return std::numeric_limits<double>::quiet_NaN();
+
+		if(G_VALUE_HOLDS_DOUBLE(pvalue))
+			return g_value_get_double(pvalue);
+		else if(G_VALUE_HOLDS_FLOAT(pvalue))
+			return g_value_get_float(pvalue);
+		else if(G_VALUE_HOLDS_INT(pvalue))
+			return g_value_get_int(pvalue);
+		else if(G_VALUE_HOLDS_UINT(pvalue))
+			return g_value_get_uint(pvalue);
+		else if(G_VALUE_HOLDS_INT64(pvalue))
+			return g_value_get_int64(pvalue);
+		else if(G_VALUE_HOLDS_UINT64(pvalue))
+			return g_value_get_uint64(pvalue);
+		else if(G_VALUE_HOLDS_BOOLEAN(pvalue))
+			return g_value_get_boolean(pvalue);
+		else if(G_VALUE_HOLDS_ENUM(pvalue))
+			return g_value_get_enum(pvalue);
+		else if(G_VALUE_HOLDS_FLAGS(pvalue))
+			return g_value_get_flags(pvalue);
+		else if(GST_VALUE_HOLDS_FRACTION(pvalue))
+			return (double) gst_value_get_fraction_numerator(pvalue) / gst_value_get_fraction_denominator(pvalue);
+
+		return std::numeric_limits<double>::quiet_NaN();
+	}
+
+
+	const GstStructure *structure(Chunk &chunk, int i)
+	{
+		const PacketRecord &record = chunk.precords[i];
+		if(record.payloadType == GST_DP_PAYLOAD_BUFFER)
+			return NULL;
+
+		GstMiniObject *pobject = chunk.objects.value(i);
+		if(!pobject && !chunk.objects.contains(i))
+		{
+			const guint8 *header = chunk.pfile -> data(record.filePos, GST_DP_HEADER_LENGTH + (qint64) record.payloadLength);
+			const guint8 *payload = (header && record.payloadLength) ? header + GST_DP_HEADER_LENGTH : NULL;
+
+			if(header && record.payloadType == GST_DP_PAYLOAD_CAPS && payload)
+				pobject = GST_MINI_OBJECT_CAST(gst_dp_caps_from_packet(GST_DP_HEADER_LENGTH, header, payload));
+			else if(header && record.payloadType >= GST_DP_PAYLOAD_EVENT_NONE)
+				pobject = GST_MINI_OBJECT_CAST(gst_dp_event_from_packet(GST_DP_HEADER_LENGTH, header, payload));
+
+			chunk.objects.insert(i, pobject);
+		}
+
+		if(!pobject)
+			return NULL;
+		else if(GST_IS_EVENT(pobject))
+			return gst_event_get_structure(GST_EVENT_CAST(pobject));
+		else if(gst_caps_get_size(GST_CAPS_CAST(pobject)) > 0)
+			return gst_caps_get_structure(GST_CAPS_CAST(pobject), 0);
+
+		return NULL;
+	}
+
+
+	void evalMask(const FilterNode *pnode, Chunk &chunk, const QVector<quint8> &active, QVector<quint8> &mask);
+
+
+	void evalValue(const FilterNode *pnode, Chunk &chunk, const QVector<quint8> &active, Values &values)
+	{
+		const int count = chunk.count;
+
+		switch(pnode -> kind)
+		{
+			case FilterNode::Constant:
+				values.isDouble = pnode -> isDouble;
+				if(values.isDouble)
+					values.doubles.fill(pnode -> doubleValue, count);
+				else
+					values.ints.fill(pnode -> intValue, count);
+				break;
+
+			case FilterNode::Column:
+			{
+				values.isDouble = false;
+				values.ints.resize(count);
+				quint64 *pints = values.ints.data();
+				for(int i = 0; i < count; i++)
+					pints[i] = PacketTableModel::key(chunk.precords[i], pnode -> column);
+				break;
+			}
+
+			case FilterNode::Field:
+				values.isDouble = true;
+				values.doubles.fill(std::numeric_limits<double>::quiet_NaN(), count);
+				for(int i = 0; i < count; i++)
+				{
+					if(!active[i])
+						continue;
+
+					const GstStructure *pstructure = structure(chunk, i);
+					if(pstructure)
+						values.doubles[i] = fieldValue(pstructure, pnode -> name);
+				}
+				break;
+
+			case FilterNode::BitAnd:
+			{
+				Values right;
+				evalValue(pnode -> pchildren[0], chunk, active, values);
+				evalValue(pnode -> pchildren[1], chunk, active, right);
+
+				if(values.isDouble)
+				{
+					values.ints.resize(count);
+					for(int i = 0; i < count; i++)
+						values.ints[i] = (quint64) values.doubles[i];
+					values.isDouble = false;
+				}
+
+				quint64 *pints = values.ints.data();
+				for(int i = 0; i < count; i++)
+					pints[i] &= right.isDouble ? (quint64) right.doubles[i] : right.ints[i];
+				break;
+			}
+
+			default:
+			{
+				// a condition used as a value is 0 or 1
+				QVector<quint8> mask;
+				evalMask(pnode, chunk, active, mask);
+
+				values.isDouble = false;
+				values.ints.resize(count);
+				for(int i = 0; i < count; i++)
+					values.ints[i] = mask[i];
+				break;
+			}
+		}
+	}
+
+
+	void toDouble(Values &values, int count)
+	{
+		if(values.isDouble)
+			return;
+
+		values.doubles.resize(count);
+		for(int i = 0; i < count; i++)
+			values.doubles[i] = values.ints[i];
+		values.isDouble = true;
+	}
+
+
+	template <typename T>
+	void compare(FilterNode::Op op, const T *pa, const T *pb, const quint8 *pactive, quint8 *pmask, int count)
+	{
+		switch(op)
+		{
+			case FilterNode::Equal:
+				for(int i = 0; i < count; i++)
+					pmask[i] = pactive[i] & (pa[i] == pb[i]);
+				break;
+			case FilterNode::NotEqual:
+				for(int i = 0; i < count; i++)
+					pmask[i] = pactive[i] & (pa[i] != pb[i]);
+				break;
+			case FilterNode::Less:
+				for(int i = 0; i < count; i++)
+					pmask[i] = pactive[i] & (pa[i] < pb[i]);
+				break;
+			case FilterNode::LessEqual:
+				for(int i = 0; i < count; i++)
+					pmask[i] = pactive[i] & (pa[i] <= pb[i]);
+				break;
+			case FilterNode::Greater:
+				for(int i = 0; i < count; i++)
+					pmask[i] = pactive[i] & (pa[i] > pb[i]);
+				break;
+			case FilterNode::GreaterEqual:
+				for(int i = 0; i < count; i++)
+					pmask[i] = pactive[i] & (pa[i] >= pb[i]);
+				break;
+		}
+	}
+
+
+	void compareValues(FilterNode::Op op, Values &a, Values &b, const QVector<quint8> &active, QVector<quint8> &mask, int count)
+	{
+		if(a.isDouble || b.isDouble)
+		{
+			toDouble(a, count);
+			toDouble(b, count);
+
+			// a missing value is NaN, which matches no comparison; != is
+			// taken as < or > so it does not match either
+			if(op == FilterNode::NotEqual)
+			{
+				const double *pa = a.doubles.constData();
+				const double *pb = b.doubles.constData();
+				for(int i = 0; i < count; i++)
+					mask[i] = active[i] & (pa[i] < pb[i] || pa[i] > pb[i]);
+			}
+			else
+				compare(op, a.doubles.constData(), b.doubles.constData(), active.constData(), mask.data(), count);
+		}
+		else
+			compare(op, a.ints.constData(), b.ints.constData(), active.constData(), mask.data(), count);
+	}
+
+
+	bool any(const QVector<quint8> &mask)
+	{
+		for(int i = 0; i < mask.size(); i++)
+		{
+			if(mask[i])
+				return true;
+		}
+
+		return false;
+	}
+
+
+	void evalMask(const FilterNode *pnode, Chunk &chunk, const QVector<quint8> &active, QVector<quint8> &mask)
+	{
+		const int count = chunk.count;
+		mask.resize(count);
+
+		switch(pnode -> kind)
+		{
+			case FilterNode::Compare:
+			{
+				Values a, b;
+				evalValue(pnode -> pchildren[0], chunk, active, a);
+				evalValue(pnode -> pchildren[1], chunk, active, b);
+				compareValues(pnode -> op, a, b, active, mask, count);
+				break;
+			}
+
+			case FilterNode::Between:
+			{
+				Values x, low, high;
+				evalValue(pnode -> pchildren[0], chunk, active, x);
+				evalValue(pnode -> pchildren[1], chunk, active, low);
+				evalValue(pnode -> pchildren[2], chunk, active, high);
+
+				QVector<quint8> upper(count);
+				Values y = x;
+				compareValues(FilterNode::GreaterEqual, x, low, active, mask, count);
+				compareValues(FilterNode::LessEqual, y, high, mask, upper, count);
+				mask = upper;
+				break;
+			}
+
+			case FilterNode::And:
+			{
+				// the right side only sees the rows the left side leaves in,
+				// which keeps structure fields from being decoded for others
+				evalMask(pnode -> pchildren[0], chunk, active, mask);
+				if(!any(mask))
+					break;
+
+				QVector<quint8> right;
+				evalMask(pnode -> pchildren[1], chunk, mask, right);
+				mask = right;
+				break;
+			}
+
+			case FilterNode::Or:
+			{
+				evalMask(pnode -> pchildren[0], chunk, active, mask);
+
+				QVector<quint8> rest(count);
+				for(int i = 0; i < count; i++)
+					rest[i] = active[i] & !mask[i];
+
+				if(!any(rest))
+					break;
+
+				QVector<quint8> right;
+				evalMask(pnode -> pchildren[1], chunk, rest, right);
+				for(int i = 0; i < count; i++)
+					mask[i] |= right[i];
+				break;
+			}
+
+			case FilterNode::Not:
+			{
+				QVector<quint8> child;
+				evalMask(pnode -> pchildren[0], chunk, active, child);
+				for(int i = 0; i < count; i++)
+					mask[i] = active[i] & !child[i];
+				break;
+			}
+
+			default:
+			{
+				// a value used as a condition is true when not zero
+				Values values;
+				evalValue(pnode, chunk, active, values);
+				for(int i = 0; i < count; i++)
+					mask[i] = active[i] & (values.isDouble ? values.doubles[i] != 0 && !std::isnan(values.doubles[i]) : values.ints[i] != 0);
+				break;
+			}
+		}
+	}
+
+
+	class FilterTask: public QRunnable
+	{
+		public:
+			FilterTask(const FilterNode *proot, PacketIndex *pindex, const QString &fileName, qint64 windowSize, QAtomicInt *pnext,
+				Selection *pselection, FilterTotals *ptotals, QMutex *pmutex):
+				m_proot(proot),
+				m_pindex(pindex),
+				m_fileName(fileName),
+				m_windowSize(windowSize),
+				m_pnext(pnext),
+				m_pselection(pselection),
+				m_ptotals(ptotals),
+				m_pmutex(pmutex)
+			{
+			}
+
+			virtual void run()
+			{
+				GdpFile file;
+				file.open(m_fileName);
+				file.setWindowSize(m_windowSize);
+
+				const qint64 size = m_pindex -> size();
+				QVector<PacketRecord> records(CHUNK);
+				QVector<quint8> active, mask;
+				quint64 *pwords = m_pselection -> words();
+				qint64 buffers = 0;
+				qint64 bytes = 0;
+
+				for(;;)
+				{
+					qint64 first = (qint64) m_pnext -> fetchAndAddRelaxed(1) * CHUNK;
+					if(first >= size)
+						break;
+
+					Chunk chunk;
+					chunk.precords = records.constData();
+					chunk.count = (int) m_pindex -> read(first, CHUNK, records.data());
+					chunk.pfile = &file;
+
+					active.fill(1, chunk.count);
+					evalMask(m_proot, chunk, active, mask);
+
+					for(int i = 0; i < chunk.count; i++)
+					{
+						if(!mask[i])
+							continue;
+
+						pwords[(first + i) / 64] |= (quint64) 1 << ((first + i) % 64);
+						if(records[i].payloadType == GST_DP_PAYLOAD_BUFFER)
+						{
+							buffers++;
+							bytes += records[i].payloadLength;
+						}
+					}
+
+					QHash<int, GstMiniObject *>::const_iterator it;
+					for(it = chunk.objects.constBegin(); it != chunk.objects.constEnd(); ++it)
+					{
+						if(it.value())
+							gst_mini_object_unref(it.value());
+					}
+				}
+
+				QMutexLocker lock(m_pmutex);
+				m_ptotals -> buffers += buffers;
+				m_ptotals -> bytes += bytes;
+			}
+
+		private:
+			const FilterNode *m_proot;
+			PacketIndex *m_pindex;
+			QString m_fileName;
+			qint64 m_windowSize;
+			QAtomicInt *m_pnext;
+			Selection *m_pselection;
+			FilterTotals *m_ptotals;
+			QMutex *m_pmutex;
+	};
+}
+
+
+Filter::Filter():
+	m_proot(NULL),
+	m_windowSize(64 * 1024 * 1024)
+{
+}
+
+
+Filter::~Filter()
+{
+	delete m_proot;
+}
+
+
+bool Filter::compile(const QString &expression)
+{
+	delete m_proot;
+	m_proot = NULL;
+	m_error.clear();
+
+	if(expression.trimmed().isEmpty())
+		return true;
+
+	Parser parser(expression);
+	m_proot = parser.parse(&m_error);
+
+	if(m_proot && !resolve(m_proot, -1, &m_error))
+	{
+		delete m_proot;
+		m_proot = NULL;
+	}
+
+	return m_proot != NULL;
+}
+
+
+bool Filter::isEmpty() const
+{
+	return m_proot == NULL;
+}
+
+
+QString Filter::errorString() const
+{
+	return m_error;
+}
+
+
+void Filter::setWindowSize(qint64 bytes)
+{
+	m_windowSize = bytes;
+}
+
+
+Selection Filter::run(PacketIndex *pindex, const QString &fileName, FilterTotals *ptotals) const
+{
+	FilterTotals totals;
+	totals.buffers = 0;
+	totals.bytes = 0;
+
+	Selection selection(pindex -> size());
+	if(m_proot)
+	{
+		QAtomicInt next(0);
+		QMutex mutex;
+
+		QThreadPool pool;
+		pool.setMaxThreadCount(QThread::idealThreadCount());
+
+		for(int i = 0; i < pool.maxThreadCount(); i++)
+			pool.start(new FilterTask(m_proot, pindex, fileName, m_windowSize / pool.maxThreadCount(), &next, &selection, &totals, &mutex));
+
+		pool.waitForDone();
+	}
+
+	if(ptotals)
+		*ptotals = totals;
+	return selection;
+}
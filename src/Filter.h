@@ -0,0 +1,56 @@
+#ifndef FILTER_H_
+#define FILTER_H_
+
+#include <QString>
+
+#include "Selection.h"
+
+class PacketIndex;
+struct FilterNode;
+
+// buffers among the packets a filter takes, and their payload bytes
+struct FilterTotals
+{
+	qint64 buffers;
+	qint64 bytes;
+};
+
+
+// Filter expressions over packets, such as
+//
+//   type == buffer && size > 100000 && flags & DELTA_UNIT == 0 && pts between 10s and 20s
+//   event == QOS && proportion < 0.8
+//
+// Names of index columns (type, event, pts, duration, running_time,
+// stream_time, size, offset, offset_end, flags, pos) are read from the
+// index, any other name is a field of the event or caps structure, decoded
+// from the dump only for packets the rest of the expression leaves in.
+//
+// An expression is compiled once into a tree evaluated a column at a time
+// over chunks of index records, the chunks being spread over a thread pool.
+class Filter
+{
+	public:
+		Filter();
+		~Filter();
+
+		bool compile(const QString &expression);
+		bool isEmpty() const;
+		QString errorString() const;
+
+		// mapping window shared by the threads of run()
+		void setWindowSize(qint64 bytes);
+
+		// <ptotals> are summed over the selection as it is taken
+		Selection run(PacketIndex *pindex, const QString &fileName, FilterTotals *ptotals = NULL) const;
+
+	private:
+		Q_DISABLE_COPY(Filter)
+
+		FilterNode *m_proot;
+		qint64 m_windowSize;
+		QString m_error;
+};
+
+
+#endif
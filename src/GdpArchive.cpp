@@ -0,0 +1,252 @@
+#include "GdpArchive.h"
+
+#include <cstring>
+
+#include <zstd.h>
+
+// decompressed frames kept by a reader
+static const int CACHED_BLOCKS = 4;
+
+const char GdpArchive::MAGIC[8] = "gdparch";
+
+GdpArchive::GdpArchive():
+	m_ptables(NULL),
+	m_ppackets(NULL),
+	m_ppayloads(NULL),
+	m_pblocks(NULL),
+	m_pcontext(NULL),
+	m_uses(0)
+{
+	memset(&m_header, 0, sizeof(m_header));
+}
+
+
+GdpArchive::~GdpArchive()
+{
+	close();
+}
+
+
+bool GdpArchive::isArchive(const QString &fileName)
+{
+	QFile file(fileName);
+	if(!file.open(QIODevice::ReadOnly))
+		return false;
+
+	char magic[sizeof(MAGIC)];
+	return file.read(magic, sizeof(magic)) == sizeof(magic) && !memcmp(magic, MAGIC, sizeof(magic));
+}
+
+
+bool GdpArchive::open(const QString &fileName)
+{
+	close();
+
+#if Q_BYTE_ORDER != Q_LITTLE_ENDIAN
+	// the tables are mapped as they are
+	return false;
+#endif
+
+	m_file.setFileName(fileName);
+	if(!m_file.open(QIODevice::ReadOnly))
+		return false;
+
+	if(m_file.read((char *) &m_header, sizeof(m_header)) != sizeof(m_header) || memcmp(m_header.magic, MAGIC, sizeof(MAGIC))
+		|| m_header.version != VERSION || m_header.tailLength >= GST_DP_HEADER_LENGTH)
+	{
+		close();
+		return false;
+	}
+
+	const qint64 tablesEnd = m_header.blockTablePos + m_header.blockCount * sizeof(ArchiveBlock);
+	if(m_header.packetTablePos + m_header.packetCount * sizeof(ArchivePacket) != m_header.payloadTablePos
+		|| m_header.payloadTablePos + m_header.payloadCount * sizeof(ArchivePayload) != m_header.blockTablePos
+		|| tablesEnd > m_file.size())
+	{
+		close();
+		return false;
+	}
+
+	if(tablesEnd > (qint64) m_header.packetTablePos)
+	{
+		m_ptables = m_file.map(m_header.packetTablePos, tablesEnd - m_header.packetTablePos);
+		if(!m_ptables)
+		{
+			close();
+			return false;
+		}
+	}
+
+	m_ppackets = (const ArchivePacket *) m_ptables;
+	m_ppayloads = (const ArchivePayload *) (m_ptables + (m_header.payloadTablePos - m_header.packetTablePos));
+	m_pblocks = (const ArchiveBlock *) (m_ptables + (m_header.blockTablePos - m_header.packetTablePos));
+
+	m_pcontext = ZSTD_createDCtx();
+	return true;
+}
+
+
+void GdpArchive::close()
+{
+	if(m_ptables)
+		m_file.unmap(m_ptables);
+	m_file.close();
+
+	if(m_pcontext)
+		ZSTD_freeDCtx((ZSTD_DCtx *) m_pcontext);
+
+	m_ptables = NULL;
+	m_ppackets = NULL;
+	m_ppayloads = NULL;
+	m_pblocks = NULL;
+	m_pcontext = NULL;
+	m_cache.clear();
+	memset(&m_header, 0, sizeof(m_header));
+}
+
+
+qint64 GdpArchive::gdpSize() const
+{
+	return m_header.gdpSize;
+}
+
+
+qint64 GdpArchive::packetCount() const
+{
+	return m_header.packetCount;
+}
+
+
+qint64 GdpArchive::packetPos(qint64 i) const
+{
+	return m_ppackets[i].gdpPos;
+}
+
+
+const guint8 *GdpArchive::packetHeader(qint64 i) const
+{
+	return m_ppackets[i].header;
+}
+
+
+qint64 GdpArchive::packetAt(qint64 pos) const
+{
+	qint64 first = 0, count = m_header.packetCount;
+	while(count > 0)
+	{
+		qint64 step = count / 2;
+		if((qint64) m_ppackets[first + step].gdpPos <= pos)
+		{
+			first += step + 1;
+			count -= step + 1;
+		}
+		else
+			count = step;
+	}
+
+	return first - 1;
+}
+
+
+bool GdpArchive::read(qint64 pos, qint64 length, guint8 *out)
+{
+	if(pos < 0 || length < 0 || length > (qint64) m_header.gdpSize - pos)
+		return false;
+
+	const qint64 tailPos = m_header.gdpSize - m_header.tailLength;
+	qint64 i = packetAt(pos);
+
+	while(length > 0)
+	{
+		qint64 count;
+		if(pos >= tailPos)
+		{
+			count = length;
+			memcpy(out, m_header.tail + (pos - tailPos), count);
+		}
+		else
+		{
+			const ArchivePacket &packet = m_ppackets[i];
+			const qint64 offset = pos - packet.gdpPos;
+			const qint64 packetLength = GST_DP_HEADER_LENGTH + (qint64) GST_DP_HEADER_PAYLOAD_LENGTH(packet.header);
+
+			if(offset < GST_DP_HEADER_LENGTH)
+			{
+				count = qMin<qint64>(length, GST_DP_HEADER_LENGTH - offset);
+				memcpy(out, packet.header + offset, count);
+			}
+			else
+			{
+				const guint8 *data = payload(packet.payload);
+				if(!data)
+					return false;
+
+				count = qMin(length, packetLength - offset);
+				memcpy(out, data + (offset - GST_DP_HEADER_LENGTH), count);
+			}
+
+			if(offset + count == packetLength)
+				i++;
+		}
+
+		pos += count;
+		out += count;
+		length -= count;
+	}
+
+	return true;
+}
+
+
+const guint8 *GdpArchive::payload(quint32 id)
+{
+	if(id >= m_header.payloadCount)
+		return NULL;
+
+	const ArchivePayload &payload = m_ppayloads[id];
+	if(payload.block >= m_header.blockCount)
+		return NULL;
+
+	m_uses++;
+
+	int oldest = 0;
+	for(int i = 0; i < m_cache.size(); i++)
+	{
+		if(m_cache[i].block == payload.block)
+		{
+			m_cache[i].used = m_uses;
+			return (const guint8 *) m_cache[i].data.constData() + payload.offset;
+		}
+
+		if(m_cache[i].used < m_cache[oldest].used)
+			oldest = i;
+	}
+
+	const ArchiveBlock &block = m_pblocks[payload.block];
+	if(payload.offset + (qint64) payload.length > block.size)
+		return NULL;
+
+	m_compressed.resize(block.compressedSize);
+	if(!m_file.seek(block.pos) || m_file.read(m_compressed.data(), block.compressedSize) != block.compressedSize)
+		return NULL;
+
+	if(m_cache.size() < CACHED_BLOCKS)
+	{
+		m_cache.append(CachedBlock());
+		oldest = m_cache.size() - 1;
+	}
+
+	CachedBlock &cached = m_cache[oldest];
+	cached.block = -1;
+	cached.data.resize(block.size);
+
+	size_t res = ZSTD_decompressDCtx((ZSTD_DCtx *) m_pcontext, cached.data.data(), block.size,
+		m_compressed.constData(), block.compressedSize);
+	if(ZSTD_isError(res) || res != block.size)
+		return NULL;
+
+	cached.block = payload.block;
+	cached.used = m_uses;
+
+	return (const guint8 *) cached.data.constData() + payload.offset;
+}
@@ -0,0 +1,127 @@
+#ifndef GDP_ARCHIVE_H_
+#define GDP_ARCHIVE_H_
+
+#include <QFile>
+#include <QString>
+#include <QVector>
+#include <QByteArray>
+
+#include <glib.h>
+
+#include "dataprotocol.h"
+
+// On-disk layout of a gdp archive, all integers little-endian:
+//
+//   ArchiveHeader
+//   zstd frames, each holding whole payloads one after the other
+//   ArchivePacket for every packet, in dump order
+//   ArchivePayload for every distinct payload
+//   ArchiveBlock for every zstd frame
+//
+// Packets keep their gdp header as it was, so the dump is rebuilt byte for
+// byte from the headers and the payloads they refer to. Identical payloads
+// are stored once while the converter remembers them, which it does for the
+// most recent ones. Buffer payloads and caps/event payloads go to separate
+// frames, so reading the events of a dump does not decompress its buffers.
+struct ArchiveHeader
+{
+	char magic[8];
+	quint32 version;
+	quint32 tailLength;
+	quint64 gdpSize;
+	quint64 packetCount;
+	quint64 payloadCount;
+	quint64 blockCount;
+	quint64 packetTablePos;
+	quint64 payloadTablePos;
+	quint64 blockTablePos;
+
+	// bytes after the last packet, too few to be one
+	guint8 tail[GST_DP_HEADER_LENGTH];
+	guint8 reserved[2];
+};
+
+struct ArchivePacket
+{
+	quint64 gdpPos;
+	quint32 payload;
+	quint32 reserved;
+	guint8 header[GST_DP_HEADER_LENGTH];
+	guint8 padding[2];
+};
+
+struct ArchivePayload
+{
+	quint32 block;
+	quint32 offset;
+	quint32 length;
+	quint32 reserved;
+};
+
+struct ArchiveBlock
+{
+	quint64 pos;
+	quint32 compressedSize;
+	quint32 size;
+};
+
+// Random access reader of a gdp archive. The tables are mapped, so any
+// packet header is found in O(1) and any position of the original dump by a
+// binary search; payloads are decompressed a frame at a time, keeping the
+// last few frames.
+class GdpArchive
+{
+	public:
+		enum
+		{
+			VERSION = 1,
+			NO_PAYLOAD = 0xffffffff
+		};
+
+		static const char MAGIC[8];
+
+		GdpArchive();
+		~GdpArchive();
+
+		static bool isArchive(const QString &fileName);
+
+		bool open(const QString &fileName);
+		void close();
+
+		qint64 gdpSize() const;
+		qint64 packetCount() const;
+		qint64 packetPos(qint64 i) const;
+		const guint8 *packetHeader(qint64 i) const;
+
+		// last packet starting at or before pos of the original dump
+		qint64 packetAt(qint64 pos) const;
+
+		// copies a range of the original dump
+		bool read(qint64 pos, qint64 length, guint8 *out);
+
+	private:
+		Q_DISABLE_COPY(GdpArchive)
+
+		struct CachedBlock
+		{
+			qint64 block;
+			QByteArray data;
+			qint64 used;
+		};
+
+		const guint8 *payload(quint32 id);
+
+		QFile m_file;
+		ArchiveHeader m_header;
+		uchar *m_ptables;
+		const ArchivePacket *m_ppackets;
+		const ArchivePayload *m_ppayloads;
+		const ArchiveBlock *m_pblocks;
+		void *m_pcontext;
+		QVector<CachedBlock> m_cache;
+		QByteArray m_compressed;
+		qint64 m_uses;
+};
+
+
+#endif
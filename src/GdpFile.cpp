@@ -0,0 +1,142 @@
+#include "GdpFile.h"
+#include "GdpArchive.h"
+
+// window of an archive, which is decompressed rather than mapped, so
+// random reads of single packets stay cheap
+static const qint64 ARCHIVE_WINDOW = 1024 * 1024;
+
+GdpFile::GdpFile():
+	m_size(0),
+	m_pwindow(NULL),
+	m_windowPos(0),
+	m_windowLength(0),
+	m_windowSize(64 * 1024 * 1024),
+	m_parchive(NULL)
+{
+}
+
+
+GdpFile::~GdpFile()
+{
+	close();
+}
+
+
+bool GdpFile::open(const QString &fileName)
+{
+	close();
+
+	if(GdpArchive::isArchive(fileName))
+	{
+		m_parchive = new GdpArchive();
+		if(!m_parchive -> open(fileName))
+		{
+			close();
+			return false;
+		}
+
+		m_file.setFileName(fileName);
+		m_size = m_parchive -> gdpSize();
+		return true;
+	}
+
+	m_file.setFileName(fileName);
+	if(!m_file.open(QIODevice::ReadOnly))
+		return false;
+
+	m_size = m_file.size();
+	return true;
+}
+
+
+void GdpFile::close()
+{
+	unmap();
+	m_file.close();
+	m_size = 0;
+
+	delete m_parchive;
+	m_parchive = NULL;
+	m_buffer.clear();
+}
+
+
+bool GdpFile::isOpen() const
+{
+	return m_file.isOpen() || m_parchive;
+}
+
+
+QString GdpFile::fileName() const
+{
+	return m_file.fileName();
+}
+
+
+qint64 GdpFile::size() const
+{
+	return m_size;
+}
+
+
+void GdpFile::setWindowSize(qint64 size)
+{
+	m_windowSize = qMax<qint64>(size, 1024 * 1024);
+}
+
+
+qint64 GdpFile::windowSize() const
+{
+	return m_windowSize;
+}
+
+
+const guint8 *GdpFile::data(qint64 pos, qint64 length)
+{
+	if(pos < 0 || length <= 0 || pos > m_size || length > m_size - pos)
+		return NULL;
+
+	if(m_pwindow && pos >= m_windowPos && pos + length <= m_windowPos + m_windowLength)
+		return m_pwindow + (pos - m_windowPos);
+
+	unmap();
+
+	if(m_parchive)
+	{
+		m_windowPos = pos;
+		m_windowLength = qMin(qMax(length, qMin(m_windowSize, ARCHIVE_WINDOW)), m_size - pos);
+		m_buffer.resize(m_windowLength);
+
+		if(!m_parchive -> read(m_windowPos, m_windowLength, (guint8 *) m_buffer.data()))
+			return NULL;
+
+		m_pwindow = (uchar *) m_buffer.data();
+		return m_pwindow;
+	}
+
+	m_windowPos = pos;
+	m_windowLength = qMin(qMax(length, m_windowSize), m_size - pos);
+	m_pwindow = m_file.map(m_windowPos, m_windowLength);
+
+	if(!m_pwindow)
+		return NULL;
+
+	return m_pwindow;
+}
+
+
+GdpArchive *GdpFile::archive() const
+{
+	return m_parchive;
+}
+
+
+void GdpFile::unmap()
+{
+	if(m_pwindow && !m_parchive)
+		m_file.unmap(m_pwindow);
+
+	m_pwindow = NULL;
+	m_windowPos = 0;
+	m_windowLength = 0;
+}
@@ -0,0 +1,52 @@
+#ifndef GDP_FILE_H_
+#define GDP_FILE_H_
+
+#include <QFile>
+#include <QString>
+#include <QByteArray>
+
+#include <glib.h>
+
+class GdpArchive;
+
+// Read-only access to a gdp dump through one sliding memory-mapped window.
+// Pointers returned by data() stay valid until the next call. A gdp archive
+// reads as the dump it was made from, its window being decompressed into a
+// buffer instead of mapped.
+class GdpFile
+{
+	public:
+		GdpFile();
+		~GdpFile();
+
+		bool open(const QString &fileName);
+		void close();
+		bool isOpen() const;
+
+		QString fileName() const;
+		qint64 size() const;
+
+		void setWindowSize(qint64 size);
+		qint64 windowSize() const;
+		const guint8 *data(qint64 pos, qint64 length);
+
+		// NULL for plain dumps
+		GdpArchive *archive() const;
+
+	private:
+		Q_DISABLE_COPY(GdpFile)
+
+		void unmap();
+
+		QFile m_file;
+		qint64 m_size;
+		uchar *m_pwindow;
+		qint64 m_windowPos;
+		qint64 m_windowLength;
+		qint64 m_windowSize;
+		GdpArchive *m_parchive;
+		QByteArray m_buffer;
+};
+
+
+#endif
@@ -0,0 +1,744 @@
+#include "Indexer.h"
+#include "GdpFile.h"
+#include "PacketIndex.h"
+#include "Stats.h"
+#include "SegmentTracker.h"
+#include "TextIndex.h"
+#include "GdpArchive.h"
+#include "ClockTime.h"
+#include "dataprotocol.h"
+#include "dp-private.h"
+
+#include <QElapsedTimer>
+#include <QVector>
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QDir>
+
+#include <cstring>
+
+static const int BATCH_SIZE = 4096;
+
+// ranges smaller than this are not worth a thread
+static const qint64 MIN_SHARD_SIZE = 64 * 1024 * 1024;
+
+// a shard index is only appended to and read once, two pages are enough
+static const qint64 SHARD_MAPPED_BYTES = 8 * 1024 * 1024;
+
+static const qint64 RESYNC_CHUNK = 1024 * 1024;
+
+// progress is reported about once a frame, which is how often the window
+// shows the rows appended since
+static const int PROGRESS_MS = 16;
+
+// start of a sharded dump indexed before the shards, for its first rows
+static const qint64 HEAD_BYTES = 4 * 1024 * 1024;
+
+class ShardTask: public QRunnable
+{
+	public:
+		ShardTask(Indexer *pindexer, Indexer::Shard *pshard):
+			m_pindexer(pindexer),
+			m_pshard(pshard)
+		{
+		}
+
+		virtual void run()
+		{
+			m_pindexer -> scanShard(m_pshard);
+		}
+
+	private:
+		Indexer *m_pindexer;
+		Indexer::Shard *m_pshard;
+};
+
+
+static bool isHeader(const guint8 *header)
+{
+	int major = GST_DP_HEADER_MAJOR_VERSION(header);
+	int minor = GST_DP_HEADER_MINOR_VERSION(header);
+
+	if(!((major == 1 && minor == 0) || (major == 0 && minor == 2)) || header[3] != 0)
+		return false;
+
+	if(!(GST_DP_HEADER_FLAGS(header) & GST_DP_HEADER_FLAG_CRC_HEADER))
+		return false;
+
+	int type = GST_DP_HEADER_PAYLOAD_TYPE(header);
+	if(type != GST_DP_PAYLOAD_BUFFER && type != GST_DP_PAYLOAD_CAPS && type < GST_DP_PAYLOAD_EVENT_NONE)
+		return false;
+
+	return gst_dp_validate_header(GST_DP_HEADER_LENGTH, header);
+}
+
+
+Indexer::Indexer(QObject *parent):
+	QObject(parent),
+	m_windowSize(64 * 1024 * 1024),
+	m_threads(QThread::idealThreadCount()),
+	m_ptext(NULL),
+	m_regions(0),
+	m_regionBytes(0),
+	m_cancel(0),
+	m_scanned(0)
+{
+}
+
+
+void Indexer::setWindowSize(qint64 bytes)
+{
+	m_windowSize = bytes;
+}
+
+
+void Indexer::setThreadCount(int threads)
+{
+	m_threads = threads;
+}
+
+
+void Indexer::setTextIndex(TextIndex *ptext)
+{
+	m_ptext = ptext;
+}
+
+
+QString Indexer::Estimate::toString() const
+{
+	QString res = QString("~%1 packets, ~%2 buffers, ~%3 MB of payload").arg(packets).arg(buffers)
+		.arg(bytes / (1024 * 1024));
+
+	if(GST_CLOCK_TIME_IS_VALID(duration))
+		res += ", ~" + ClockTime::toString(duration);
+	if(bitrate > 0)
+		res += QString(", ~%1 kbit/s").arg(bitrate / 1000, 0, 'f', 0);
+
+	return res + QString(" (from %1 MB sampled)").arg(sampledBytes / (1024 * 1024));
+}
+
+
+void Indexer::setSampling(int regions, qint64 regionBytes)
+{
+	m_regions = regions;
+	m_regionBytes = regionBytes;
+}
+
+
+QString Indexer::errorString() const
+{
+	return m_error;
+}
+
+
+Indexer::Estimate Indexer::estimate() const
+{
+	return m_estimate;
+}
+
+
+void Indexer::cancel()
+{
+	m_cancel.store(1);
+}
+
+
+Indexer::Result Indexer::run(const QString &fileName, PacketIndex *pindex)
+{
+	m_cancel.store(0);
+	m_scanned.store(0);
+	m_error.clear();
+	m_fileName = fileName;
+	memset(&m_estimate, 0, sizeof(m_estimate));
+
+	GdpFile file;
+	if(!file.open(fileName))
+	{
+		m_error = "Problem with open file `" + fileName + "`for reading";
+		return OpenError;
+	}
+	file.setWindowSize(m_windowSize);
+
+	const qint64 fileSize = file.size();
+
+	SegmentTracker tracker;
+
+	Result result;
+	if(file.archive())
+		result = scanArchive(file, pindex, &tracker);
+	else if(m_regions > 0 && fileSize > (m_regions + 2) * m_regionBytes)
+		result = runSampled(file, pindex);
+	else
+	{
+		int count = shardCount(file);
+		if(count > 1)
+			result = runSharded(file, count, pindex, &tracker);
+		else
+		{
+			qint64 next;
+			result = scan(file, 0, fileSize, pindex, &tracker, &next, &m_error, true);
+		}
+	}
+
+	if(result == Finished)
+		emit progress(fileSize, fileSize);
+
+	return result;
+}
+
+
+int Indexer::shardCount(GdpFile &file) const
+{
+	int count = (int) qMin<qint64>(m_threads, file.size() / MIN_SHARD_SIZE);
+	if(count < 2)
+		return 1;
+
+	// without header CRCs there is nothing to resynchronize on
+	const guint8 *header = file.data(0, GST_DP_HEADER_LENGTH);
+	if(!header || !(GST_DP_HEADER_FLAGS(header) & GST_DP_HEADER_FLAG_CRC_HEADER))
+		return 1;
+
+	return count;
+}
+
+
+QSharedPointer<PacketIndex> Indexer::createShardIndex() const
+{
+	QSharedPointer<PacketIndex> pindex(new PacketIndex);
+	if(!pindex -> open(QDir::tempPath()))
+		return QSharedPointer<PacketIndex>();
+
+	pindex -> setMaxMappedBytes(SHARD_MAPPED_BYTES);
+	return pindex;
+}
+
+
+Indexer::Result Indexer::runSharded(GdpFile &file, int count, PacketIndex *pindex, SegmentTracker *ptracker)
+{
+	const qint64 fileSize = file.size();
+
+	// the shards append nothing until they are all scanned, so the start of
+	// the dump goes first to have rows to show meanwhile
+	qint64 start;
+	Result result = scan(file, 0, qMin(HEAD_BYTES, fileSize), pindex, ptracker, &start, &m_error, true);
+	if(result != Finished)
+		return result;
+
+	emit progress(start, fileSize);
+
+	QVector<Shard> shards(count);
+	for(int i = 0; i < count; i++)
+	{
+		Shard &shard = shards[i];
+		shard.begin = start + (fileSize - start) * i / count;
+		shard.end = start + (fileSize - start) * (i + 1) / count;
+		shard.first = i == 0 ? start : -1;
+		shard.next = -1;
+		shard.windowSize = m_windowSize / count;
+		shard.result = Finished;
+		shard.pindex = createShardIndex();
+
+		if(!shard.pindex)
+		{
+			m_error = "Problem with writing packet index";
+			return IndexError;
+		}
+	}
+
+	QThreadPool pool;
+	pool.setMaxThreadCount(count);
+
+	for(int i = 0; i < count; i++)
+		pool.start(new ShardTask(this, &shards[i]));
+
+	while(!pool.waitForDone(PROGRESS_MS))
+		emit progress(m_scanned.load(), fileSize);
+
+	return stitch(file, shards, pindex, ptracker);
+}
+
+
+void Indexer::scanShard(Shard *pshard)
+{
+	GdpFile file;
+	if(!file.open(m_fileName))
+	{
+		pshard -> error = "Problem with open file `" + m_fileName + "`for reading";
+		pshard -> result = OpenError;
+		return;
+	}
+	file.setWindowSize(pshard -> windowSize);
+
+	if(pshard -> first < 0)
+		pshard -> first = resync(file, pshard -> begin, pshard -> end);
+
+	if(pshard -> first < 0)
+	{
+		pshard -> result = m_cancel.load() ? Cancelled : Finished;
+		return;
+	}
+
+	pshard -> result = scan(file, pshard -> first, pshard -> end, pshard -> pindex.data(), NULL, &pshard -> next, &pshard -> error, false);
+}
+
+
+Indexer::Result Indexer::stitch(GdpFile &file, QVector<Shard> &shards, PacketIndex *pindex, SegmentTracker *ptracker)
+{
+	QVector<PacketRecord> records(BATCH_SIZE);
+	qint64 expected = shards.isEmpty() ? 0 : shards[0].begin;
+
+	QElapsedTimer timer;
+	timer.start();
+
+	for(int i = 0; i < shards.size(); i++)
+	{
+		Shard &shard = shards[i];
+
+		if(m_cancel.load() || shard.result == Cancelled)
+			return Cancelled;
+
+		// a shard without packets is right only if the previous packet runs
+		// over all of it
+		bool joined = shard.first >= 0 ? shard.first == expected : expected >= shard.end;
+
+		if(!joined)
+		{
+			// the resynchronization locked on a false header or missed the
+			// real one, scan the shard again from where the previous one ended
+			shard.pindex = createShardIndex();
+			if(!shard.pindex)
+			{
+				m_error = "Problem with writing packet index";
+				return IndexError;
+			}
+
+			shard.first = expected;
+			shard.result = scan(file, expected, shard.end, shard.pindex.data(), NULL, &shard.next, &shard.error, false);
+		}
+
+		if(shard.first >= 0)
+		{
+			qint64 size = shard.pindex -> size();
+			for(qint64 row = 0; row < size; row += BATCH_SIZE)
+			{
+				qint64 read = shard.pindex -> read(row, BATCH_SIZE, records.data());
+
+				for(qint64 j = 0; j < read; j++)
+				{
+					ptracker -> update(records[j], file);
+					if(m_ptext)
+						m_ptext -> add(pindex -> size(), records[j], file);
+
+					Stats::Timer t(Stats::StageIndex);
+					if(!pindex -> append(records[j]))
+					{
+						m_error = "Problem with writing packet index";
+						return IndexError;
+					}
+				}
+
+				// the scan is done, this only lets the rows be shown
+				if(timer.elapsed() > PROGRESS_MS)
+				{
+					emit progress(m_scanned.load(), file.size());
+					timer.restart();
+				}
+			}
+
+			expected = shard.next;
+		}
+
+		shard.pindex.clear();
+
+		if(shard.result != Finished)
+		{
+			m_error = shard.error;
+			return shard.result;
+		}
+	}
+
+	return Finished;
+}
+
+
+Indexer::Result Indexer::scan(GdpFile &file, qint64 pos, qint64 end, PacketIndex *pindex, SegmentTracker *ptracker, qint64 *pnext, QString *perror, bool report)
+{
+	const qint64 fileSize = file.size();
+	const QString formatError = "File `" + m_fileName + "` is incorrect gdp file";
+
+	QElapsedTimer timer;
+	timer.start();
+
+	QVector<GstDPHeaderInfo> infos(BATCH_SIZE);
+	bool reported = false;
+
+	*pnext = pos;
+
+	while(pos < end && fileSize - pos >= GST_DP_HEADER_LENGTH)
+	{
+		if(m_cancel.load())
+			return Cancelled;
+
+		const qint64 length = qMin(fileSize - pos, file.windowSize());
+		const guint8 *region;
+		{
+			Stats::Timer t(Stats::StageRead);
+			region = file.data(pos, length);
+		}
+
+		guint count = 0;
+		gsize next = 0;
+		gboolean invalid = FALSE;
+		if(region)
+		{
+			Stats::Timer t(Stats::StageHeaderCrc);
+			count = gst_dp_scan_headers(region, length, infos.data(), infos.size(), &next, &invalid);
+		}
+
+		for(guint i = 0; i < count; i++)
+		{
+			const GstDPHeaderInfo &info = infos[i];
+			PacketRecord record = PacketIndex::recordFromInfo(pos, info);
+
+			// packets starting past the end belong to the next shard
+			if(record.filePos >= end)
+			{
+				*pnext = record.filePos;
+				return Finished;
+			}
+
+			*pnext = record.filePos;
+
+			if(record.payloadType == GST_DP_PAYLOAD_BUFFER)
+				Stats::add(Stats::BufferPackets);
+			else if(record.payloadType == GST_DP_PAYLOAD_CAPS)
+				Stats::add(Stats::CapsPackets);
+			else if(record.payloadType >= GST_DP_PAYLOAD_EVENT_NONE)
+				Stats::add(Stats::EventPackets);
+			else
+			{
+				*perror = formatError;
+				return FormatError;
+			}
+
+			if(fileSize - record.filePos < GST_DP_HEADER_LENGTH + (qint64) record.payloadLength)
+			{
+				*perror = formatError;
+				return FormatError;
+			}
+
+			if(record.payloadLength > 0 && (info.flags & GST_DP_HEADER_FLAG_CRC_PAYLOAD))
+			{
+				// the payload may run past the region, in which case the window
+				// moves, so region is not used past this point
+				const guint8 *packet;
+				{
+					Stats::Timer t(Stats::StageRead);
+					packet = file.data(record.filePos, GST_DP_HEADER_LENGTH + (qint64) record.payloadLength);
+				}
+
+				bool valid;
+				{
+					Stats::Timer t(Stats::StagePayloadCrc);
+					valid = packet && gst_dp_crc(packet + GST_DP_HEADER_LENGTH, record.payloadLength) == info.crc_payload;
+				}
+
+				if(!valid)
+				{
+					*perror = formatError;
+					return FormatError;
+				}
+			}
+
+			// shards are scanned without tracker, their records are
+			// followed when stitched
+			if(ptracker)
+			{
+				ptracker -> update(record, file);
+				if(m_ptext)
+					m_ptext -> add(pindex -> size(), record, file);
+			}
+
+			bool appended;
+			{
+				Stats::Timer t(Stats::StageIndex);
+				appended = pindex -> append(record);
+			}
+
+			if(!appended)
+			{
+				*perror = "Problem with writing packet index";
+				return IndexError;
+			}
+
+			Stats::add(Stats::BytesRead, GST_DP_HEADER_LENGTH + (qint64) record.payloadLength);
+			m_scanned.fetchAndAddRelaxed(GST_DP_HEADER_LENGTH + (qint64) record.payloadLength);
+		}
+
+		if(invalid || count == 0)
+		{
+			*perror = formatError;
+			return FormatError;
+		}
+
+		pos += next;
+		*pnext = pos;
+
+		// the first batch is reported at once, for the first rows
+		if(report && (!reported || timer.elapsed() > PROGRESS_MS))
+		{
+			emit progress(pos, fileSize);
+			timer.restart();
+			reported = true;
+		}
+	}
+
+	return Finished;
+}
+
+
+Indexer::Result Indexer::scanArchive(GdpFile &file, PacketIndex *pindex, SegmentTracker *ptracker)
+{
+	GdpArchive *parchive = file.archive();
+	const QString formatError = "File `" + m_fileName + "` is incorrect gdp archive";
+
+	QElapsedTimer timer;
+	timer.start();
+
+	const qint64 count = parchive -> packetCount();
+	for(qint64 i = 0; i < count; i++)
+	{
+		if(m_cancel.load())
+			return Cancelled;
+
+		PacketRecord record = PacketIndex::recordFromHeader(parchive -> packetPos(i), parchive -> packetHeader(i));
+
+		if(record.payloadType == GST_DP_PAYLOAD_BUFFER)
+			Stats::add(Stats::BufferPackets);
+		else if(record.payloadType == GST_DP_PAYLOAD_CAPS)
+			Stats::add(Stats::CapsPackets);
+		else if(record.payloadType >= GST_DP_PAYLOAD_EVENT_NONE)
+			Stats::add(Stats::EventPackets);
+		else
+		{
+			m_error = formatError;
+			return FormatError;
+		}
+
+		// headers were validated when the archive was written, payloads are
+		// checked by zstd when decompressed
+		ptracker -> update(record, file);
+		if(m_ptext)
+			m_ptext -> add(pindex -> size(), record, file);
+
+		bool appended;
+		{
+			Stats::Timer t(Stats::StageIndex);
+			appended = pindex -> append(record);
+		}
+
+		if(!appended)
+		{
+			m_error = "Problem with writing packet index";
+			return IndexError;
+		}
+
+		if(timer.elapsed() > PROGRESS_MS || i + 1 == BATCH_SIZE)
+		{
+			emit progress(record.filePos, file.size());
+			timer.restart();
+		}
+	}
+
+	return Finished;
+}
+
+
+Indexer::Result Indexer::runSampled(GdpFile &file, PacketIndex *pindex)
+{
+	const qint64 fileSize = file.size();
+	const int count = m_regions + 2;
+
+	// rows where each scanned region starts, and the end of the last one
+	QVector<qint64> regionRows;
+	qint64 scanned = 0;
+
+	// packet after the ones scanned so far, -1 when a region ended in a
+	// broken packet, and where scanning may start again
+	qint64 resume = 0;
+	qint64 floor = 0;
+
+	SegmentTracker tracker;
+
+	for(int i = 0; i < count; i++)
+	{
+		qint64 begin = i == count - 1 ? fileSize - m_regionBytes : (fileSize - m_regionBytes) * i / (count - 1);
+		qint64 end = begin + m_regionBytes;
+
+		// a region reached by the previous one goes on from it
+		bool adjacent = resume >= 0 && begin <= resume;
+		qint64 first = adjacent ? resume : resync(file, qMax(begin, floor), end);
+		if(first < 0 || first >= end)
+		{
+			if(m_cancel.load())
+				return Cancelled;
+			continue;
+		}
+
+		regionRows.append(pindex -> size());
+
+		// the segment before a region is unknown, so times start over with
+		// the first one inside it
+		if(!adjacent)
+		{
+			tracker = SegmentTracker();
+			if(pindex -> size())
+				pindex -> breakSection();
+		}
+
+		qint64 next = first;
+		QString error;
+		Result result = scan(file, first, end, pindex, &tracker, &next, &error, false);
+		resume = result == Finished ? next : -1;
+		floor = result == Finished ? next : end;
+
+		// a broken packet ends the region, unless nothing could be read at all
+		if(result == FormatError && i == 0 && pindex -> size() == 0)
+		{
+			m_error = error;
+			return FormatError;
+		}
+		else if(result == Cancelled || result == IndexError)
+		{
+			m_error = error;
+			return result;
+		}
+
+		scanned += m_regionBytes;
+		emit progress(scanned, count * m_regionBytes);
+	}
+
+	regionRows.append(pindex -> size());
+
+	if(pindex -> size() == 0)
+	{
+		m_error = "File `" + m_fileName + "` is incorrect gdp file";
+		return FormatError;
+	}
+
+	estimateTotals(pindex, regionRows, fileSize);
+	return Finished;
+}
+
+
+void Indexer::estimateTotals(const PacketIndex *pindex, const QVector<qint64> &regionRows, qint64 fileSize)
+{
+	Estimate &estimate = m_estimate;
+	estimate.sampled = true;
+
+	qint64 buffers = 0, bytes = 0;
+	guint64 first = GST_CLOCK_TIME_NONE, last = GST_CLOCK_TIME_NONE;
+
+	// bitrate over the time spans of the regions, gaps between them left out
+	qint64 spanBytes = 0;
+	guint64 span = 0;
+
+	QVector<PacketRecord> records(BATCH_SIZE);
+	for(int i = 0; i + 1 < regionRows.size(); i++)
+	{
+		guint64 regionFirst = GST_CLOCK_TIME_NONE, regionLast = GST_CLOCK_TIME_NONE;
+		qint64 regionBytes = 0;
+
+		for(qint64 row = regionRows[i]; row < regionRows[i + 1]; row += BATCH_SIZE)
+		{
+			qint64 read = pindex -> read(row, qMin<qint64>(BATCH_SIZE, regionRows[i + 1] - row), records.data());
+			for(qint64 j = 0; j < read; j++)
+			{
+				const PacketRecord &record = records[j];
+				estimate.sampledBytes += GST_DP_HEADER_LENGTH + (qint64) record.payloadLength;
+
+				if(record.payloadType != GST_DP_PAYLOAD_BUFFER)
+					continue;
+
+				buffers++;
+				bytes += record.payloadLength;
+
+				if(!GST_CLOCK_TIME_IS_VALID(record.timestamp))
+					continue;
+
+				regionBytes += record.payloadLength;
+				if(!GST_CLOCK_TIME_IS_VALID(regionFirst) || record.timestamp < regionFirst)
+					regionFirst = record.timestamp;
+				if(!GST_CLOCK_TIME_IS_VALID(regionLast) || record.timestamp > regionLast)
+					regionLast = record.timestamp;
+			}
+		}
+
+		if(GST_CLOCK_TIME_IS_VALID(regionFirst) && regionLast > regionFirst)
+		{
+			span += regionLast - regionFirst;
+			spanBytes += regionBytes;
+
+			if(!GST_CLOCK_TIME_IS_VALID(first))
+				first = regionFirst;
+			last = regionLast;
+		}
+	}
+
+	double scale = estimate.sampledBytes ? (double) fileSize / estimate.sampledBytes : 0;
+
+	estimate.packets = pindex -> size() * scale;
+	estimate.buffers = buffers * scale;
+	estimate.bytes = bytes * scale;
+	estimate.duration = GST_CLOCK_TIME_IS_VALID(first) && last > first ? last - first : GST_CLOCK_TIME_NONE;
+	estimate.bitrate = span ? spanBytes * 8.0 * GST_SECOND / span : 0;
+}
+
+
+qint64 Indexer::resync(GdpFile &file, qint64 from, qint64 end)
+{
+	const qint64 fileSize = file.size();
+
+	for(qint64 base = from; base < end && fileSize - base >= GST_DP_HEADER_LENGTH;)
+	{
+		if(m_cancel.load())
+			return -1;
+
+		const qint64 length = qMin(fileSize - base, RESYNC_CHUNK + GST_DP_HEADER_LENGTH);
+		const qint64 count = qMin(length - GST_DP_HEADER_LENGTH + 1, end - base);
+
+		const guint8 *region = file.data(base, length);
+		if(!region)
+			return -1;
+
+		for(qint64 i = 0; i < count; i++)
+		{
+			if(!isHeader(region + i))
+				continue;
+
+			qint64 pos = base + i;
+			qint64 next = pos + GST_DP_HEADER_LENGTH + (qint64) GST_DP_HEADER_PAYLOAD_LENGTH(region + i);
+
+			if(next == fileSize)
+				return pos;
+
+			// a header CRC matches by chance once in 65536 positions, so the
+			// packet that follows has to start with a header as well
+			if(fileSize - next >= GST_DP_HEADER_LENGTH)
+			{
+				const guint8 *header = file.data(next, GST_DP_HEADER_LENGTH);
+				if(header && isHeader(header))
+					return pos;
+
+				region = file.data(base, length);
+				if(!region)
+					return -1;
+			}
+		}
+
+		base += count;
+	}
+
+	return -1;
+}
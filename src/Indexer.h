@@ -0,0 +1,130 @@
+#ifndef INDEXER_H_
+#define INDEXER_H_
+
+#include <QObject>
+#include <QString>
+#include <QAtomicInt>
+#include <QAtomicInteger>
+#include <QSharedPointer>
+#include <QVector>
+
+#include <glib.h>
+
+class PacketIndex;
+class GdpFile;
+class SegmentTracker;
+class TextIndex;
+
+// Walks a gdp dump, validates every packet and appends its record to a
+// PacketIndex. Used both by the main window and by the command line mode.
+//
+// Large dumps are split into byte ranges scanned in parallel. Every worker
+// finds the first packet of its range by looking for a header with a valid
+// CRC followed by another one, and the ranges are checked to join up
+// before their records are appended; a range that does not is scanned
+// again from where the previous one ended. Running and stream times depend
+// on the segment events before a buffer, so they are filled in when the
+// records are appended in order, as is the text of caps and events when a
+// TextIndex is given. Gdp archives carry their packet headers in a table,
+// so they are indexed from it without reading the payloads of buffers.
+//
+// Progress is reported about once a frame and right after the first batch
+// of packets, so a window can show the rows appended so far; a sharded dump
+// has its first megabytes indexed before the shards are started for this.
+//
+// With sampling set, only the start, the end and evenly spaced regions of a
+// plain dump are indexed, each from the first packet found in it, and the
+// totals of the whole dump are estimated from them.
+class Indexer: public QObject
+{
+	Q_OBJECT
+	public:
+		enum Result
+		{
+			Finished,
+			OpenError,
+			IndexError,
+			FormatError,
+			Cancelled
+		};
+
+		// totals of a sampled dump, extrapolated from the sampled packets
+		struct Estimate
+		{
+			bool sampled;
+			qint64 sampledBytes;
+			qint64 packets;
+			qint64 buffers;
+			qint64 bytes;
+			guint64 duration;
+			double bitrate;
+
+			QString toString() const;
+		};
+
+		// sampling of a quick look at a dump
+		enum
+		{
+			QUICK_LOOK_REGIONS = 64,
+			QUICK_LOOK_REGION_BYTES = 1024 * 1024
+		};
+
+		explicit Indexer(QObject *parent = 0);
+
+		void setWindowSize(qint64 bytes);
+		void setThreadCount(int threads);
+		void setTextIndex(TextIndex *ptext);
+
+		// regions besides the start and the end; 0 indexes the whole dump
+		void setSampling(int regions, qint64 regionBytes);
+
+		Result run(const QString &fileName, PacketIndex *pindex);
+		QString errorString() const;
+		Estimate estimate() const;
+
+	public slots:
+		void cancel();
+
+	signals:
+		void progress(qint64 pos, qint64 size);
+
+	private:
+		friend class ShardTask;
+
+		struct Shard
+		{
+			qint64 begin;
+			qint64 end;
+			qint64 first;
+			qint64 next;
+			qint64 windowSize;
+			Result result;
+			QString error;
+			QSharedPointer<PacketIndex> pindex;
+		};
+
+		int shardCount(GdpFile &file) const;
+		Result runSharded(GdpFile &file, int count, PacketIndex *pindex, SegmentTracker *ptracker);
+		void scanShard(Shard *pshard);
+		Result stitch(GdpFile &file, QVector<Shard> &shards, PacketIndex *pindex, SegmentTracker *ptracker);
+		Result scan(GdpFile &file, qint64 pos, qint64 end, PacketIndex *pindex, SegmentTracker *ptracker, qint64 *pnext, QString *perror, bool report);
+		qint64 resync(GdpFile &file, qint64 from, qint64 end);
+		Result scanArchive(GdpFile &file, PacketIndex *pindex, SegmentTracker *ptracker);
+		Result runSampled(GdpFile &file, PacketIndex *pindex);
+		void estimateTotals(const PacketIndex *pindex, const QVector<qint64> &regionRows, qint64 fileSize);
+		QSharedPointer<PacketIndex> createShardIndex() const;
+
+		qint64 m_windowSize;
+		int m_threads;
+		TextIndex *m_ptext;
+		int m_regions;
+		qint64 m_regionBytes;
+		Estimate m_estimate;
+		QAtomicInt m_cancel;
+		QAtomicInteger<qint64> m_scanned;
+		QString m_fileName;
+		QString m_error;
+};
+
+
+#endif
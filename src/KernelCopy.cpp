@@ -0,0 +1,113 @@
+#include "KernelCopy.h"
+
+#include <QVector>
+
+#include <cerrno>
+
+#include <unistd.h>
+
+#ifdef Q_OS_LINUX
+#include <sys/syscall.h>
+#include <sys/sendfile.h>
+#endif
+
+static const qint64 COPY_CHUNK = 1024 * 1024;
+
+namespace
+{
+	bool readWrite(int source, int target, qint64 pos, qint64 length)
+	{
+		QVector<char> buffer(COPY_CHUNK);
+
+		while(length > 0)
+		{
+			ssize_t chunk = pread(source, buffer.data(), qMin<qint64>(length, buffer.size()), pos);
+			if(chunk <= 0 || !KernelCopy::writeAll(target, buffer.data(), chunk))
+				return false;
+
+			pos += chunk;
+			length -= chunk;
+		}
+
+		return true;
+	}
+}
+
+
+KernelCopy::KernelCopy():
+	m_method(CopyFileRange)
+{
+}
+
+
+void KernelCopy::reset()
+{
+	m_method = CopyFileRange;
+}
+
+
+bool KernelCopy::writeAll(int target, const char *data, qint64 length)
+{
+	for(qint64 written = 0; written < length;)
+	{
+		ssize_t res = write(target, data + written, length - written);
+		if(res < 0 && errno != EINTR)
+			return false;
+		written += qMax<ssize_t>(res, 0);
+	}
+
+	return true;
+}
+
+
+bool KernelCopy::copy(int source, int target, qint64 pos, qint64 length)
+{
+#ifdef Q_OS_LINUX
+	// the target offset is the file position, which moves with each call
+	while(length > 0 && m_method != ReadWrite)
+	{
+		ssize_t res;
+		if(m_method == CopyFileRange)
+		{
+#ifdef SYS_copy_file_range
+			loff_t offset = pos;
+			res = syscall(SYS_copy_file_range, source, &offset, target, NULL, (size_t) length, 0);
+#else
+			res = -1;
+			errno = ENOSYS;
+#endif
+		}
+		else
+		{
+			off_t offset = pos;
+			res = sendfile(target, source, &offset, (size_t) length);
+		}
+
+		if(res < 0)
+		{
+			if(errno == EINTR)
+				continue;
+
+			// not supported for these files, try the next method
+			if(errno == ENOSYS || errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP || errno == EBADF)
+			{
+				m_method = m_method == CopyFileRange ? SendFile : ReadWrite;
+				continue;
+			}
+
+			return false;
+		}
+
+		if(res == 0)
+			return false;
+
+		pos += res;
+		length -= res;
+	}
+
+	if(length == 0)
+		return true;
+#endif
+
+	return readWrite(source, target, pos, length);
+}
@@ -0,0 +1,35 @@
+#ifndef KERNEL_COPY_H_
+#define KERNEL_COPY_H_
+
+#include <QtGlobal>
+
+// Copies ranges of one file to the position of another. On Linux the kernel
+// moves the data with copy_file_range() or sendfile(), elsewhere or when
+// both are refused it goes through a read/write loop.
+class KernelCopy
+{
+	public:
+		KernelCopy();
+
+		// takes copy_file_range() again after a method was refused
+		void reset();
+
+		bool copy(int source, int target, qint64 pos, qint64 length);
+
+		static bool writeAll(int target, const char *data, qint64 length);
+
+	private:
+		// kernel copy methods, dropped for the rest of a run the first time
+		// they are refused
+		enum Method
+		{
+			CopyFileRange,
+			SendFile,
+			ReadWrite
+		};
+
+		Method m_method;
+};
+
+
+#endif
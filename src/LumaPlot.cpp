@@ -0,0 +1,120 @@
+#include "LumaPlot.h"
+#include "VideoAnalytics.h"
+
+#include <QPainter>
+#include <QMouseEvent>
+#include <QVector>
+
+// height of the strip of markers under the curves
+static const int MARKS_HEIGHT = 12;
+
+// frame differences from this value on are drawn at the top
+static const float MAX_DIFFERENCE = 64;
+
+// frames read from the analytics at a time
+static const int READ_FRAMES = 4096;
+
+LumaPlot::LumaPlot(QWidget *parent):
+	QWidget(parent),
+	m_panalytics(NULL)
+{
+	setMinimumHeight(60);
+}
+
+
+void LumaPlot::setAnalytics(VideoAnalytics *panalytics)
+{
+	m_panalytics = panalytics;
+	if(m_panalytics)
+		connect(m_panalytics, SIGNAL(finished()), SLOT(update()));
+
+	update();
+}
+
+
+QSize LumaPlot::sizeHint() const
+{
+	return QSize(600, 120);
+}
+
+
+void LumaPlot::paintEvent(QPaintEvent *)
+{
+	QPainter painter(this);
+	painter.fillRect(rect(), palette().base());
+
+	if(!m_panalytics || !m_panalytics -> isReady())
+	{
+		painter.drawText(rect(), Qt::AlignCenter, m_panalytics ? "Measuring frames..." : QString());
+		return;
+	}
+
+	const qint64 frames = m_panalytics -> frameCount();
+	if(!frames)
+	{
+		painter.drawText(rect(), Qt::AlignCenter, "No raw video in this dump");
+		return;
+	}
+
+	const int plotHeight = height() - MARKS_HEIGHT;
+	const QColor meanColor = palette().text().color();
+	const QColor differenceColor = palette().highlight().color();
+	QVector<VideoAnalytics::Frame> batch(READ_FRAMES);
+
+	for(int x = 0; x < width(); x++)
+	{
+		qint64 first = frames * x / width();
+		qint64 last = qMax(first + 1, frames * (x + 1) / width());
+		if(first >= frames)
+			break;
+
+		float minMean = 255, maxMean = 0, maxDifference = 0;
+		int flags = 0;
+
+		for(qint64 i = first; i < last && i < frames; i += batch.size())
+		{
+			qint64 count = m_panalytics -> readFrames(i, qMin<qint64>(batch.size(), last - i), batch.data());
+			for(qint64 j = 0; j < count; j++)
+			{
+				const VideoAnalytics::Frame &frame = batch[j];
+				minMean = qMin(minMean, frame.mean);
+				maxMean = qMax(maxMean, frame.mean);
+				maxDifference = qMax(maxDifference, frame.difference);
+				flags |= frame.flags;
+			}
+		}
+
+		int difference = qRound(qMin(maxDifference, MAX_DIFFERENCE) / MAX_DIFFERENCE * plotHeight);
+		painter.setPen(differenceColor);
+		painter.drawLine(x, plotHeight, x, plotHeight - difference);
+
+		painter.setPen(meanColor);
+		painter.drawLine(x, plotHeight - qRound(minMean / 255 * plotHeight), x, plotHeight - qRound(maxMean / 255 * plotHeight));
+
+		const int mark = MARKS_HEIGHT / 3;
+		if(flags & VideoAnalytics::Black)
+			painter.fillRect(x, plotHeight, 1, mark, Qt::black);
+		if(flags & VideoAnalytics::Frozen)
+			painter.fillRect(x, plotHeight + mark, 1, mark, Qt::blue);
+		if(flags & VideoAnalytics::Jump)
+			painter.fillRect(x, plotHeight + 2 * mark, 1, mark, QColor(255, 128, 0));
+	}
+
+	painter.setPen(palette().text().color());
+	painter.drawText(rect().adjusted(4, 2, -4, -2), Qt::AlignLeft | Qt::AlignTop,
+		QString("%1 frames, %2 black, %3 frozen, %4 jumps").arg(frames)
+			.arg(m_panalytics -> count(VideoAnalytics::Black))
+			.arg(m_panalytics -> count(VideoAnalytics::Frozen))
+			.arg(m_panalytics -> count(VideoAnalytics::Jump)));
+}
+
+
+void LumaPlot::mouseDoubleClickEvent(QMouseEvent *pevent)
+{
+	if(!m_panalytics || !m_panalytics -> frameCount() || width() <= 0)
+		return;
+
+	qint64 frames = m_panalytics -> frameCount();
+	qint64 frame = qBound<qint64>(0, frames * pevent -> x() / width(), frames - 1);
+	emit packetActivated(m_panalytics -> frame(frame).row);
+}
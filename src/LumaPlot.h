@@ -0,0 +1,35 @@
+#ifndef LUMA_PLOT_H_
+#define LUMA_PLOT_H_
+
+#include <QWidget>
+#include <QPointer>
+
+class VideoAnalytics;
+
+// Luma mean and frame difference of all raw video frames of a dump, one
+// pixel column per range of frames, with black, frozen and jump frames
+// marked below the curves. A double click activates the frame under the
+// cursor.
+class LumaPlot: public QWidget
+{
+	Q_OBJECT
+	public:
+		LumaPlot(QWidget *parent = 0);
+
+		void setAnalytics(VideoAnalytics *panalytics);
+
+		virtual QSize sizeHint() const;
+
+	signals:
+		void packetActivated(qint64 row);
+
+	protected:
+		virtual void paintEvent(QPaintEvent *);
+		virtual void mouseDoubleClickEvent(QMouseEvent *);
+
+	private:
+		QPointer<VideoAnalytics> m_panalytics;
+};
+
+
+#endif
@@ -7,7 +7,6 @@
 #include <QIcon>
 #include <QFileDialog>
 #include <QMessageBox>
-#include <QScopedArrayPointer>
 #include <QProgressBar>
 #include <QCoreApplication>
 #include <QDebug>
@@ -16,12 +15,67 @@
 #include <QSettings>
 #include <QMenu>
 #include <QMenuBar>
-#include <QTreeWidget>
-#include <QTreeWidgetItem>
+#include <QTreeView>
 #include <QHeaderView>
+#include <QInputDialog>
+#include <QLineEdit>
+#include <QDir>
+#include <QDockWidget>
+#include <QStatusBar>
+#include <QTimer>
+#include <QScrollBar>
+#include <QTableView>
+#include <QStackedWidget>
+
+#include <climits>
+#include <algorithm>
+
+#include "PacketIndex.h"
+#include "PacketModel.h"
+#include "PacketTableModel.h"
+#include "MemoryBudget.h"
+#include "Indexer.h"
+#include "Stats.h"
+#include "StatsPanel.h"
+#include "ThumbnailProvider.h"
+#include "ThumbnailStrip.h"
+#include "ClockTime.h"
+#include "Filter.h"
+#include "TextIndex.h"
+#include "TextSearch.h"
+#include "NalAnalyzer.h"
+#include "AudioOverview.h"
+#include "WaveformView.h"
+#include "VideoAnalytics.h"
+#include "LumaPlot.h"
+#include "Extractor.h"
+#include "Exporter.h"
+#include "Replayer.h"
+#include "BackgroundIndexer.h"
+#include "TimelineMerger.h"
+#include "MergedTableModel.h"
+
+// background analyzers started by startAnalysis()
+static const int ANALYZERS = 4;
 
 MainWindow::MainWindow(QWidget *parent, Qt::WindowFlags flags):
-	QMainWindow(parent, flags)
+	QMainWindow(parent, flags),
+	m_break(false),
+	m_pprogressBar(NULL),
+	m_pindexer(NULL),
+	m_pextractor(NULL),
+	m_pexporter(NULL),
+	m_pmerger(NULL),
+	m_indexingShown(false),
+	m_fullIndexEnabled(false),
+	m_ptreeView(NULL),
+	m_ptableView(NULL),
+	m_pviews(NULL),
+	m_psearch(NULL),
+	m_pnal(NULL),
+	m_searchShown(false),
+	m_pthumbnails(NULL),
+	m_memoryLimit(0)
 {
 	gst_dp_init();
 
@@ -30,16 +84,110 @@ MainWindow::MainWindow(QWidget *parent, Qt::WindowFlags flags):
 	QAction *pactOpen = ptb -> addAction("Open...");
 	pactOpen -> setShortcut(QKeySequence("Ctrl+O"));
 	connect(pactOpen, SIGNAL(triggered()), SLOT(slotOpen()));
+	m_indexingActions.append(pactOpen);
+
+	QAction *pactGoToTime = ptb -> addAction("Go to time...");
+	pactGoToTime -> setShortcut(QKeySequence("Ctrl+G"));
+	connect(pactGoToTime, SIGNAL(triggered()), SLOT(slotGoToTime()));
+	m_indexingActions.append(pactGoToTime);
+
+	ptb -> addSeparator();
+	m_pfilterEdit = new QLineEdit();
+	m_pfilterEdit -> setPlaceholderText("Filter, e.g. type == buffer && size > 100000");
+	m_pfilterEdit -> setClearButtonEnabled(true);
+	ptb -> addWidget(m_pfilterEdit);
+	connect(m_pfilterEdit, SIGNAL(returnPressed()), SLOT(slotFilter()));
+
+	ptb -> addSeparator();
+	m_psearchEdit = new QLineEdit();
+	m_psearchEdit -> setPlaceholderText("Search caps, tags and events");
+	m_psearchEdit -> setClearButtonEnabled(true);
+	ptb -> addWidget(m_psearchEdit);
+	connect(m_psearchEdit, SIGNAL(textChanged(const QString &)), SLOT(slotSearch(const QString &)));
+	connect(m_psearchEdit, SIGNAL(returnPressed()), SLOT(slotFindNext()));
+
+	QAction *pactFindPrevious = ptb -> addAction("Previous");
+	pactFindPrevious -> setShortcut(QKeySequence("Shift+F3"));
+	connect(pactFindPrevious, SIGNAL(triggered()), SLOT(slotFindPrevious()));
+
+	QAction *pactFindNext = ptb -> addAction("Next");
+	pactFindNext -> setShortcut(QKeySequence("F3"));
+	connect(pactFindNext, SIGNAL(triggered()), SLOT(slotFindNext()));
 
 	QMenu *pmenu = menuBar() -> addMenu("&File");
 	pmenu -> addAction(pactOpen);
 	addAction (pactOpen);
+	m_indexingActions.append(pmenu -> addAction("Quick look...", this, SLOT(slotQuickLook())));
+	m_indexingActions.append(pmenu -> addAction("Merge dumps...", this, SLOT(slotMerge())));
+	m_pactFullIndex = pmenu -> addAction("Index fully", this, SLOT(slotFullIndex()));
+	m_pactFullIndex -> setEnabled(false);
+
+	m_indexingActions.append(pmenu -> addAction("Extract payloads...", this, SLOT(slotExtract())));
+	m_indexingActions.append(pmenu -> addAction("Export index...", this, SLOT(slotExport())));
+	m_indexingActions.append(pmenu -> addAction("Replay...", this, SLOT(slotReplay())));
+	pmenu -> addAction("Stop replay", this, SLOT(slotStopReplay()));
 
 	pmenu -> addSeparator();
+	pmenu -> addAction("Memory limit...", this, SLOT(slotMemoryLimit()));
 
 	pmenu -> addSeparator();
 	pmenu -> addAction("Exit", this, SLOT(close()));
 
+	QDockWidget *pdock = new QDockWidget("Statistics", this);
+	pdock -> setObjectName("StatisticsDock");
+	pdock -> setWidget(new StatsPanel());
+	pdock -> hide();
+	addDockWidget(Qt::BottomDockWidgetArea, pdock);
+
+	m_pthumbnailStrip = new ThumbnailStrip();
+	connect(m_pthumbnailStrip, SIGNAL(packetActivated(qint64)), SLOT(slotPacketActivated(qint64)));
+
+	QDockWidget *pthumbnailDock = new QDockWidget("Thumbnails", this);
+	pthumbnailDock -> setObjectName("ThumbnailsDock");
+	pthumbnailDock -> setWidget(m_pthumbnailStrip);
+	addDockWidget(Qt::TopDockWidgetArea, pthumbnailDock);
+
+	m_pwaveform = new WaveformView();
+	connect(m_pwaveform, SIGNAL(packetActivated(qint64)), SLOT(slotPacketActivated(qint64)));
+
+	QDockWidget *pwaveformDock = new QDockWidget("Waveform", this);
+	pwaveformDock -> setObjectName("WaveformDock");
+	pwaveformDock -> setWidget(m_pwaveform);
+	pwaveformDock -> hide();
+	addDockWidget(Qt::BottomDockWidgetArea, pwaveformDock);
+
+	m_plumaPlot = new LumaPlot();
+	connect(m_plumaPlot, SIGNAL(packetActivated(qint64)), SLOT(slotPacketActivated(qint64)));
+
+	QDockWidget *plumaDock = new QDockWidget("Luma", this);
+	plumaDock -> setObjectName("LumaDock");
+	plumaDock -> setWidget(m_plumaPlot);
+	plumaDock -> hide();
+	addDockWidget(Qt::BottomDockWidgetArea, plumaDock);
+
+	pmenu = menuBar() -> addMenu("&View");
+	pmenu -> addAction(pactGoToTime);
+	pmenu -> addAction(pactFindNext);
+	pmenu -> addAction(pactFindPrevious);
+	pmenu -> addSeparator();
+
+	m_pactTableMode = pmenu -> addAction("Table mode");
+	m_pactTableMode -> setCheckable(true);
+	m_pactTableMode -> setShortcut(QKeySequence("Ctrl+T"));
+	connect(m_pactTableMode, SIGNAL(toggled(bool)), SLOT(slotTableMode(bool)));
+	pmenu -> addSeparator();
+	pmenu -> addAction(pthumbnailDock -> toggleViewAction());
+	pmenu -> addAction(pwaveformDock -> toggleViewAction());
+	pmenu -> addAction(plumaDock -> toggleViewAction());
+	pmenu -> addAction(pdock -> toggleViewAction());
+
+	m_pstatusLabel = new QLabel();
+	statusBar() -> addWidget(m_pstatusLabel);
+
+	QTimer *ptimer = new QTimer(this);
+	connect(ptimer, SIGNAL(timeout()), SLOT(slotUpdateStatus()));
+	ptimer -> start(1000);
+
 	pmenu = menuBar() -> addMenu("&Help");
 	pmenu -> addAction ("About gdpviewer...", this, SLOT(slotAbout()));
 
@@ -74,665 +222,1074 @@ void MainWindow::readCustomData()
 }
 
 
-bool MainWindow::process(const QString &fileName)
+bool MainWindow::process(const QString &fileName, bool quickLook)
 {
 	m_break = false;
-	QFile file(fileName);
 
+	MemoryBudget budget(memoryLimit());
 
-	if(!file.open(QIODevice::ReadOnly))
+	QSharedPointer<PacketIndex> pindex(new PacketIndex());
+	if(!pindex -> open(QDir::tempPath()))
 	{
-		QMessageBox::critical(this, "File opening problem", "Problem with open file `" + fileName + "`for reading");
+		QMessageBox::critical(this, "Index creation problem", "Problem with creating packet index in `" + QDir::tempPath() + "`");
+		return false;
+	}
+	pindex -> setMaxMappedBytes(budget.indexBytes);
+
+	QSharedPointer<TextIndex> ptext(new TextIndex(budget.textBytes));
+	if(!ptext -> open(QDir::tempPath()))
+	{
+		QMessageBox::critical(this, "Index creation problem", "Problem with creating text index in `" + QDir::tempPath() + "`");
 		return false;
 	}
 
 	QProgressBar *pprogressBar = new QProgressBar(NULL);
 	pprogressBar -> setWindowTitle("Opening...");
 	pprogressBar -> setMinimum(0);
-	pprogressBar -> setMaximum(file.size() / 1024);
+	pprogressBar -> setMaximum(0);
 	pprogressBar -> setValue(0);
 
-	Qt::WindowFlags flags = pprogressBar -> windowFlags();
-
 	pprogressBar -> show();
 
-	QTreeWidget *ptreeWidget= new QTreeWidget();
+	Indexer indexer;
+	indexer.setWindowSize(budget.windowBytes);
+	indexer.setTextIndex(ptext.data());
+	if(quickLook)
+		indexer.setSampling(Indexer::QUICK_LOOK_REGIONS, Indexer::QUICK_LOOK_REGION_BYTES);
+
+	m_pprogressBar = pprogressBar;
+	m_pindexer = &indexer;
+	connect(&indexer, SIGNAL(progress(qint64, qint64)), SLOT(slotProgress(qint64, qint64)));
 
-	ptreeWidget -> header() -> close();
+	// the views are shown with the first rows, slotProgress() adds the rest
+	m_pindexing = pindex;
+	m_pindexingText = ptext;
+	m_indexingFile = fileName;
+	m_indexingShown = false;
+	setIndexing(true);
+
+	Indexer::Result result = indexer.run(fileName, pindex.data());
+
+	bool shown = m_indexingShown;
+	m_pindexing.clear();
+	m_pindexingText.clear();
+	m_pprogressBar = NULL;
+	m_pindexer = NULL;
+	setIndexing(false);
 
 	bool res = true;
-	for(;file.bytesAvailable() >= GST_DP_HEADER_LENGTH;)
+	if(result == Indexer::OpenError)
 	{
-		if(m_break)
-		{
-			res = false;
-			break;
-		}
+		QMessageBox::critical(this, "File opening problem", indexer.errorString());
+		res = false;
+	}
+	else if(result == Indexer::FormatError)
+		QMessageBox::critical(this, "Incorrect file", indexer.errorString());
+	else if(result == Indexer::IndexError)
+		QMessageBox::critical(this, "Index creation problem", indexer.errorString());
+	else if(result == Indexer::Cancelled)
+	{
+		// the rows already shown stay
+		res = shown;
+		if(shown)
+			statusBar() -> showMessage(QString("Indexing cancelled after %1 packets").arg(pindex -> size()));
+	}
 
-		guint8 header[GST_DP_HEADER_LENGTH];
-		qint64 readed = file.read((char *) header, GST_DP_HEADER_LENGTH);
-		if(readed != GST_DP_HEADER_LENGTH || !gst_dp_validate_header (GST_DP_HEADER_LENGTH, header))
-		{
-			QMessageBox::critical(this, "Incorrect file", "File `" + fileName + "` is incorrect gdp file");
-			break;
-		}
+	if(res)
+	{
+		if(!shown)
+			showIndex(fileName, pindex, ptext);
+		publishRows();
+		startAnalysis();
+
+		// a sampled index stays until the full one replaces it
+		Indexer::Estimate estimate = indexer.estimate();
+		m_pactFullIndex -> setEnabled(estimate.sampled);
+		if(estimate.sampled)
+			statusBar() -> showMessage("Quick look: " + estimate.toString());
+	}
 
-		qint64 payloadLength = gst_dp_header_payload_length(header);
-		QScopedArrayPointer<guint8> payload;
-		if(payloadLength > 0)
-		{
-			payload.reset(new guint8[payloadLength]);
-			if(file.read((char *) payload.data(), payloadLength) != payloadLength)
-			{
-				QMessageBox::critical(this, "Incorrect file", "File `" + fileName + "` is incorrect gdp file");
-				break;
-			}
+	pprogressBar -> close();
+	delete pprogressBar;
 
-		}
+	return res;
+}
 
-		QTreeWidgetItem *pitem = NULL;
 
-		GstDPPayloadType payloadType = gst_dp_header_payload_type(header);
-		if(payloadType == GST_DP_PAYLOAD_BUFFER)
-		{
-			GstBuffer *buff = gst_dp_buffer_from_header(GST_DP_HEADER_LENGTH, header);
+void MainWindow::showIndex(const QString &fileName, QSharedPointer<PacketIndex> pindex, QSharedPointer<TextIndex> ptext)
+{
+	MemoryBudget budget(memoryLimit());
+
+	PacketModel *pmodel = new PacketModel(pindex, fileName);
+	pmodel -> setWindowSize(budget.windowBytes);
+	pmodel -> setCacheSize(budget.cacheBytes);
+
+	ThumbnailProvider *pthumbnails = new ThumbnailProvider(pindex, fileName);
+	pthumbnails -> setCacheSize(budget.thumbnailBytes);
+	pmodel -> setThumbnailProvider(pthumbnails);
+
+	QTreeView *ptreeView = new QTreeView();
+	ptreeView -> setUniformRowHeights(true);
+	ptreeView -> setSelectionMode(QAbstractItemView::ExtendedSelection);
+	ptreeView -> setIconSize(QSize(32, 18));
+	ptreeView -> header() -> close();
+	ptreeView -> setModel(pmodel);
+	pmodel -> setParent(ptreeView);
+	pthumbnails -> setParent(ptreeView);
+
+	QAction *pactThumbnail = new QAction("Decode thumbnail", ptreeView);
+	connect(pactThumbnail, SIGNAL(triggered()), SLOT(slotDecodeThumbnail()));
+	ptreeView -> addAction(pactThumbnail);
+	ptreeView -> setContextMenuPolicy(Qt::ActionsContextMenu);
+
+	connect(ptreeView -> verticalScrollBar(), SIGNAL(valueChanged(int)), SLOT(slotTreeScrolled()));
+
+	NalAnalyzer *pnal = new NalAnalyzer(pindex, fileName, ptreeView);
+	pmodel -> setNalAnalyzer(pnal);
+	connect(pnal, SIGNAL(finished()), SLOT(slotNalFinished()));
+
+	AudioOverview *paudio = new AudioOverview(pindex, fileName, ptreeView);
+	VideoAnalytics *pvideo = new VideoAnalytics(pindex, fileName, ptreeView);
+
+	QTableView *ptableView = new QTableView();
+	PacketTableModel *ptableModel = new PacketTableModel(pindex, ptableView);
+	ptableModel -> setNalAnalyzer(pnal);
+	ptableModel -> setVideoAnalytics(pvideo);
+	ptableModel -> setSortMemory(budget.sortBytes);
+	connect(ptableModel, SIGNAL(sortFailed(const QString &)), SLOT(slotSortFailed(const QString &)));
+	ptableView -> setModel(ptableModel);
+	ptableView -> verticalHeader() -> hide();
+	ptableView -> verticalHeader() -> setSectionResizeMode(QHeaderView::Fixed);
+	ptableView -> setSelectionBehavior(QAbstractItemView::SelectRows);
+	ptableView -> setWordWrap(false);
+	ptableView -> horizontalHeader() -> setSortIndicator(-1, Qt::AscendingOrder);
+	ptableView -> setSortingEnabled(true);
+
+	QStackedWidget *pviews = new QStackedWidget();
+	pviews -> addWidget(ptreeView);
+	pviews -> addWidget(ptableView);
+	pviews -> setCurrentWidget(m_pactTableMode -> isChecked() ? (QWidget *) ptableView : ptreeView);
+
+	TextSearch *psearch = new TextSearch(ptext, ptreeView);
+	connect(psearch, SIGNAL(matchesFound(qint64)), SLOT(slotSearchMatches(qint64)));
+	connect(psearch, SIGNAL(finished()), SLOT(slotSearchFinished()));
+
+	m_pthumbnailStrip -> setProvider(pthumbnails);
+	m_pwaveform -> setOverview(paudio);
+	m_plumaPlot -> setAnalytics(pvideo);
+	m_pthumbnails = pthumbnails;
+	m_ptreeView = ptreeView;
+	m_ptableView = ptableView;
+	m_pviews = pviews;
+	m_psearch = psearch;
+	m_pnal = pnal;
+	m_paudio = paudio;
+	m_pvideo = pvideo;
+
+	setCentralWidget(pviews);
+}
 
-			if(!buff)
-			{
-				QMessageBox::critical(this, "Incorrect file", "File `" + fileName + "` is incorrect gdp file");
-				break;				
-			}
 
-			if(payloadLength > 0)
-			{
-				if(!gst_dp_validate_payload(GST_DP_HEADER_LENGTH, header, payload.data()))
-				{
-					QMessageBox::critical(this, "Incorrect file", "File `" + fileName + "` is incorrect gdp file");
-					break;
-				}
+// the analyzers read the whole index, so they wait until it is complete
+void MainWindow::startAnalysis()
+{
+	if(!m_ptreeView)
+		return;
+
+	// the analyzers run at the same time and share the mapping window
+	qint64 window = MemoryBudget(memoryLimit()).windowBytes / ANALYZERS;
+	m_pthumbnails -> setWindowSize(window);
+	m_pnal -> setWindowSize(window);
+	m_paudio -> setWindowSize(window);
+	m_pvideo -> setWindowSize(window);
+
+	m_pthumbnails -> start();
+
+	// one pass over the index serves the three analyzers
+	QList<Analyzer *> analyzers;
+	analyzers << m_pnal << m_paudio << m_pvideo;
+	Analyzer::start(analyzers);
+	slotSearch(m_psearchEdit -> text());
+}
 
-				GstMapInfo map;
-				gst_buffer_map(buff, &map, GST_MAP_WRITE);
 
-				memcpy(map.data, payload.data(), payloadLength);
-				gst_buffer_unmap(buff, &map);
-			}
+void MainWindow::publishRows()
+{
+	if(!m_ptreeView)
+		return;
 
-			pitem = onBuffer(buff);
-			gst_buffer_unref(buff);
+	qobject_cast<PacketModel *>(m_ptreeView -> model()) -> update();
+	qobject_cast<PacketTableModel *>(m_ptableView -> model()) -> update();
+}
 
-		}
-		else if(payloadType == GST_DP_PAYLOAD_CAPS)
-		{
-			GstCaps *caps = gst_dp_caps_from_packet(GST_DP_HEADER_LENGTH, header, payload.data());
 
-			if(!caps)
-			{
-				QMessageBox::critical(this, "Incorrect file", "File `" + fileName + "` is incorrect gdp file");
-				break;				
-			}
+// the views are live while a file is indexed, the actions that take the
+// progress bar or work on the whole index wait for the end
+void MainWindow::setIndexing(bool indexing)
+{
+	for(int i = 0; i < m_indexingActions.size(); i++)
+		m_indexingActions[i] -> setEnabled(!indexing);
+	m_pfilterEdit -> setEnabled(!indexing);
 
-			pitem = onCaps(caps);
-	        gst_caps_unref(caps);
-		}
-		else if(payloadType >= GST_DP_PAYLOAD_EVENT_NONE)
-		{
-			GstEvent *event = gst_dp_event_from_packet(GST_DP_HEADER_LENGTH, header, payload.data());
+	if(indexing)
+	{
+		m_fullIndexEnabled = m_pactFullIndex -> isEnabled();
+		m_pactFullIndex -> setEnabled(false);
+	}
+	else
+		m_pactFullIndex -> setEnabled(m_fullIndexEnabled && !m_pfullIndexer);
+}
 
-			pitem = onEvent(event);
-			gst_event_unref(event);
-		}
-		else
-		{
-			QMessageBox::critical(this, "Incorrect file", "File `" + fileName + "` is incorrect gdp file");
-			break;
-		}
 
-		std::size_t position = file.pos();
-		pprogressBar -> setValue(position / 1024);
-		QCoreApplication::processEvents();
+void MainWindow::slotProgress(qint64 pos, qint64 size)
+{
+	if(!m_pprogressBar || !m_pindexer)
+		return;
+
+	// the progress bar works with int, so scale 64-bit file positions down
+	int shift = 0;
+	while((size >> shift) > INT_MAX)
+		shift++;
 
-		if(!pprogressBar -> isVisible())
+	m_pprogressBar -> setMaximum(size >> shift);
+	m_pprogressBar -> setValue(pos >> shift);
+
+	{
+		Stats::Timer t(Stats::StageProcessEvents);
+
+		// progress comes about once a frame, the rows appended since the
+		// last time go into the views in one insertion
+		if(m_pindexing && m_pindexing -> size() > 0)
 		{
-			return false;
+			if(!m_indexingShown)
+			{
+				showIndex(m_indexingFile, m_pindexing, m_pindexingText);
+				m_indexingShown = true;
+			}
+
+			publishRows();
 		}
 
-		if(pitem)
-			ptreeWidget -> addTopLevelItem(pitem);
+		QCoreApplication::processEvents();
 	}
 
-	if(res)
-		setCentralWidget(ptreeWidget);
+	// a nested event may have ended the run
+	if(!m_pprogressBar || !m_pindexer)
+		return;
 
+	if(m_break || !m_pprogressBar -> isVisible())
+		m_pindexer -> cancel();
+}
 
-	pprogressBar -> close();
-	delete pprogressBar;
 
-	return res;
+void MainWindow::slotTreeScrolled()
+{
+	if(m_pthumbnails)
+		m_pthumbnails -> dropRequests(ThumbnailProvider::Visible);
 }
 
 
-void MainWindow::slotOpen()
+void MainWindow::slotDecodeThumbnail()
 {
-	QString dir = QDir::currentPath();
-	QSettings settings("virinext", "gdpviewer");
+	if(!m_ptreeView || !m_pthumbnails)
+		return;
 
-	if(settings.value("MainWindow/PrevDir").toString().length())
-		dir = settings.value("MainWindow/PrevDir").toString();
+	PacketModel *pmodel = qobject_cast<PacketModel *>(m_ptreeView -> model());
+	qint64 row = pmodel -> packetRow(m_ptreeView -> currentIndex());
 
-	QString fileName = QFileDialog::getOpenFileName(this, "GDP File", dir);
-	bool res = false;
-	if(!fileName.isEmpty())
-		res = process(fileName);
+	if(row >= 0)
+		m_pthumbnails -> request(row, ThumbnailProvider::OnDemand);
+}
 
-	if(res)
-	{
-		QFileInfo info(fileName);
-		settings.setValue("MainWindow/PrevDir", info.absoluteDir().absolutePath());
 
-		setWindowTitle(info.fileName());
+void MainWindow::slotPacketActivated(qint64 row)
+{
+	if(!m_ptreeView || row < 0)
+		return;
+
+	if(m_pviews -> currentWidget() == m_ptableView.data())
+	{
+		PacketTableModel *pmodel = qobject_cast<PacketTableModel *>(m_ptableView -> model());
+		QModelIndex index = pmodel -> index(pmodel -> rowOfPacket(row), 0);
+		m_ptableView -> setCurrentIndex(index);
+		m_ptableView -> scrollTo(index, QAbstractItemView::PositionAtCenter);
+		return;
 	}
+
+	PacketModel *pmodel = qobject_cast<PacketModel *>(m_ptreeView -> model());
+	QModelIndex index = pmodel -> indexOfPacket(row);
+	m_ptreeView -> setCurrentIndex(index);
+	m_ptreeView -> scrollTo(index, QAbstractItemView::PositionAtCenter);
 }
 
 
-void MainWindow::slotAbout()
+void MainWindow::slotGoToTime()
 {
-  QString message;
-  message = "<center><b>gdpviewer</b></center>";
-  message += "<center>virinext@gmail.com</center>";
-  message += QString("<center>Version: ") + VERSION_STR + "</center>";
-  message += "<center>GUI Based on Qt</center>";
-  QMessageBox::about(this, "About", message);
-}
+	if(!m_ptreeView || m_pindexing)
+		return;
 
+	PacketModel *pmodel = qobject_cast<PacketModel *>(m_ptreeView -> model());
+	QSharedPointer<PacketIndex> pindex = pmodel -> packetIndex();
 
-QTreeWidgetItem *MainWindow::onBuffer(const GstBuffer *buff)
-{
-	QString timestamp = GST_BUFFER_PTS_IS_VALID(buff) ? QString::number(GST_BUFFER_PTS(buff)) : "not set";
-	QString duration = GST_BUFFER_DURATION_IS_VALID(buff) ? QString::number(GST_BUFFER_DURATION(buff)) : "not set";
-	QString offset = GST_BUFFER_OFFSET_IS_VALID(buff) ? QString::number(GST_BUFFER_OFFSET(buff)) : "not set";
-	QString offset_end = GST_BUFFER_OFFSET_END_IS_VALID(buff) ? QString::number(GST_BUFFER_OFFSET_END(buff)) : "not set";
-	QString size = QString::number(gst_buffer_get_size((GstBuffer *)buff));
+	QString current;
+	qint64 row = currentPacket();
+	if(row >= 0 && GST_CLOCK_TIME_IS_VALID(pindex -> at(row).timestamp))
+		current = ClockTime::toString(pindex -> at(row).timestamp);
 
-	bool none = true;
-	QString flags = "(";
-	if(GST_BUFFER_FLAG_IS_SET(buff, GST_BUFFER_FLAG_LIVE))
-	{
-		if(!none)
-			flags += ", ";
-		flags += "GST_BUFFER_FLAG_LIVE";
-		none = false;
-	}
+	bool ok = false;
+	QString str = QInputDialog::getText(this, "Go to time", "Buffer timestamp (h:mm:ss.nnnnnnnnn):",
+		QLineEdit::Normal, current, &ok);
 
-	if(GST_BUFFER_FLAG_IS_SET(buff, GST_BUFFER_FLAG_DECODE_ONLY))
-	{
-		if(!none)
-			flags += ", ";
-		flags += "GST_BUFFER_FLAG_DECODE_ONLY";
-		none = false;
-	}
+	if(!ok)
+		return;
 
-	if(GST_BUFFER_FLAG_IS_SET(buff, GST_BUFFER_FLAG_DISCONT))
+	guint64 timestamp = ClockTime::fromString(str, &ok);
+	if(!ok)
 	{
-		if(!none)
-			flags += ", ";
-		flags += "GST_BUFFER_FLAG_DISCONT";
-		none = false;
-	}
-		if(GST_BUFFER_FLAG_IS_SET(buff, GST_BUFFER_FLAG_RESYNC))
-	{
-		if(!none)
-			flags += ", ";
-		flags += "GST_BUFFER_FLAG_RESYNC";
-		none = false;
+		QMessageBox::warning(this, "Go to time", "`" + str + "` is not a time");
+		return;
 	}
 
-	if(GST_BUFFER_FLAG_IS_SET(buff, GST_BUFFER_FLAG_CORRUPTED))
+	row = pindex -> findTimestamp(timestamp);
+	if(row < 0)
 	{
-		if(!none)
-			flags += ", ";
-		flags += "GST_BUFFER_FLAG_CORRUPTED";
-		none = false;
+		QMessageBox::information(this, "Go to time", "No buffer has a timestamp");
+		return;
 	}
 
-	if(GST_BUFFER_FLAG_IS_SET(buff, GST_BUFFER_FLAG_MARKER))
-	{
-		if(!none)
-			flags += ", ";
-		flags += "GST_BUFFER_FLAG_MARKER";
-		none = false;
-	}
+	slotPacketActivated(row);
+}
 
-	if(GST_BUFFER_FLAG_IS_SET(buff, GST_BUFFER_FLAG_HEADER))
-	{
-		if(!none)
-			flags += ", ";
-		flags += "GST_BUFFER_FLAG_HEADER";
-		none = false;
-	}
 
-	if(GST_BUFFER_FLAG_IS_SET(buff, GST_BUFFER_FLAG_GAP))
+void MainWindow::slotTableMode(bool table)
+{
+	if(!m_pviews)
+		return;
+
+	// keep the current packet when switching
+	qint64 row = currentPacket();
+	m_pviews -> setCurrentWidget(table ? (QWidget *) m_ptableView.data() : m_ptreeView.data());
+	slotPacketActivated(row);
+}
+
+
+void MainWindow::slotFilter()
+{
+	if(!m_ptableView || m_pindexing)
+		return;
+
+	PacketTableModel *ptableModel = qobject_cast<PacketTableModel *>(m_ptableView -> model());
+	PacketModel *pmodel = qobject_cast<PacketModel *>(m_ptreeView -> model());
+
+	Filter filter;
+	filter.setWindowSize(MemoryBudget(memoryLimit()).windowBytes);
+	if(!filter.compile(m_pfilterEdit -> text()))
 	{
-		if(!none)
-			flags += ", ";
-		flags += "GST_BUFFER_FLAG_GAP";
-		none = false;
+		QMessageBox::warning(this, "Filter", filter.errorString());
+		return;
 	}
 
-	if(GST_BUFFER_FLAG_IS_SET(buff, GST_BUFFER_FLAG_DROPPABLE))
+	if(filter.isEmpty())
 	{
-		if(!none)
-			flags += ", ";
-		flags += "GST_BUFFER_FLAG_DROPPABLE";
-		none = false;
+		ptableModel -> setSelection(Selection());
+		statusBar() -> clearMessage();
+		return;
 	}
 
-	if(GST_BUFFER_FLAG_IS_SET(buff, GST_BUFFER_FLAG_DELTA_UNIT))
+	QSharedPointer<PacketIndex> pindex = pmodel -> packetIndex();
+	FilterTotals totals;
+	Selection selection = filter.run(pindex.data(), pmodel -> fileName(), &totals);
+
+	ptableModel -> setSelection(selection);
+	m_pactTableMode -> setChecked(true);
+
+	statusBar() -> showMessage(QString("%1 of %2 packets match, %3 buffers of %4 bytes")
+		.arg(selection.count()).arg(pindex -> size()).arg(totals.buffers).arg(totals.bytes));
+}
+
+
+void MainWindow::slotExtract()
+{
+	if(!m_ptableView || m_pindexing)
+		return;
+
+	PacketTableModel *ptableModel = qobject_cast<PacketTableModel *>(m_ptableView -> model());
+	PacketModel *pmodel = qobject_cast<PacketModel *>(m_ptreeView -> model());
+
+	QStringList modes;
+	modes << "Concatenated payloads" << "One file per buffer";
+
+	bool ok = false;
+	QString mode = QInputDialog::getItem(this, "Extract payloads", "Write the buffers of the current filter as:",
+		modes, 0, false, &ok);
+	if(!ok)
+		return;
+
+	QString output;
+	if(mode == modes[0])
+		output = QFileDialog::getSaveFileName(this, "Output file", QDir::currentPath());
+	else
+		output = QFileDialog::getExistingDirectory(this, "Output directory", QDir::currentPath());
+
+	if(output.isEmpty())
+		return;
+
+	QProgressBar *pprogressBar = new QProgressBar(NULL);
+	pprogressBar -> setWindowTitle("Extracting...");
+	pprogressBar -> setMinimum(0);
+	pprogressBar -> setMaximum(0);
+	pprogressBar -> setValue(0);
+	pprogressBar -> show();
+
+	Extractor extractor;
+	m_pprogressBar = pprogressBar;
+	m_pextractor = &extractor;
+	connect(&extractor, SIGNAL(progress(qint64, qint64)), SLOT(slotExtractProgress(qint64, qint64)));
+
+	// the selection of the table is empty when no filter is applied
+	bool res = extractor.run(pmodel -> fileName(), pmodel -> packetIndex().data(), ptableModel -> selection(),
+		output, mode == modes[0] ? Extractor::Concatenate : Extractor::PerBuffer);
+
+	m_pprogressBar = NULL;
+	m_pextractor = NULL;
+
+	pprogressBar -> close();
+	delete pprogressBar;
+
+	if(!res)
+		QMessageBox::critical(this, "Extraction problem", extractor.errorString());
+	else
+		statusBar() -> showMessage(QString("%1 buffers, %2 bytes written").arg(extractor.bufferCount()).arg(extractor.bytesWritten()));
+}
+
+
+void MainWindow::slotExtractProgress(qint64 done, qint64 total)
+{
+	if(!m_pprogressBar || !m_pextractor)
+		return;
+
+	int shift = 0;
+	while((total >> shift) > INT_MAX)
+		shift++;
+
+	m_pprogressBar -> setMaximum(total >> shift);
+	m_pprogressBar -> setValue(done >> shift);
+
+	QCoreApplication::processEvents();
+
+	if(!m_pprogressBar || !m_pextractor)
+		return;
+
+	if(m_break || !m_pprogressBar -> isVisible())
+		m_pextractor -> cancel();
+}
+
+
+void MainWindow::slotExport()
+{
+	// the index is still growing while the file is indexed
+	if(!m_ptreeView || m_pindexing)
+		return;
+
+	PacketModel *pmodel = qobject_cast<PacketModel *>(m_ptreeView -> model());
+	PacketTableModel *ptableModel = qobject_cast<PacketTableModel *>(m_ptableView -> model());
+
+	QString output = QFileDialog::getSaveFileName(this, "Export index", QDir::currentPath(),
+		"Arrow IPC (*.arrow *.feather);;CSV (*.csv)");
+	if(output.isEmpty())
+		return;
+
+	QProgressBar *pprogressBar = new QProgressBar(NULL);
+	pprogressBar -> setWindowTitle("Exporting...");
+	pprogressBar -> setMinimum(0);
+	pprogressBar -> setMaximum(0);
+	pprogressBar -> setValue(0);
+	pprogressBar -> show();
+
+	Exporter exporter;
+	m_pprogressBar = pprogressBar;
+	m_pexporter = &exporter;
+	connect(&exporter, SIGNAL(progress(qint64, qint64)), SLOT(slotExportProgress(qint64, qint64)));
+
+	// the selection of the table is empty when no filter is applied
+	bool res = exporter.run(pmodel -> fileName(), pmodel -> packetIndex().data(), ptableModel -> selection(),
+		output, Exporter::formatOf(output));
+
+	m_pprogressBar = NULL;
+	m_pexporter = NULL;
+
+	pprogressBar -> close();
+	delete pprogressBar;
+
+	if(!res)
+		QMessageBox::critical(this, "Export problem", exporter.errorString());
+	else
+		statusBar() -> showMessage(QString("%1 rows, %2 bytes written").arg(exporter.rowCount()).arg(exporter.bytesWritten()));
+}
+
+
+void MainWindow::slotExportProgress(qint64 done, qint64 total)
+{
+	if(!m_pprogressBar || !m_pexporter)
+		return;
+
+	int shift = 0;
+	while((total >> shift) > INT_MAX)
+		shift++;
+
+	m_pprogressBar -> setMaximum(total >> shift);
+	m_pprogressBar -> setValue(done >> shift);
+
+	QCoreApplication::processEvents();
+
+	if(!m_pprogressBar || !m_pexporter)
+		return;
+
+	if(m_break || !m_pprogressBar -> isVisible())
+		m_pexporter -> cancel();
+}
+
+
+void MainWindow::slotReplay()
+{
+	if(!m_ptreeView || m_pindexing)
+		return;
+
+	PacketModel *pmodel = qobject_cast<PacketModel *>(m_ptreeView -> model());
+	QSettings settings("virinext", "gdpviewer");
+
+	bool ok = false;
+	QString pipeline = QInputDialog::getText(this, "Replay", "Pipeline after appsrc:", QLineEdit::Normal,
+		settings.value("MainWindow/ReplayPipeline", "decodebin ! autovideosink").toString(), &ok);
+	if(!ok || pipeline.isEmpty())
+		return;
+
+	QStringList pacings;
+	pacings << "As fast as possible" << "Original pacing" << "N times speed";
+
+	QString pacing = QInputDialog::getItem(this, "Replay", "Pacing:", pacings, 1, false, &ok);
+	if(!ok)
+		return;
+
+	double speed = 1.0;
+	if(pacing == pacings[2])
 	{
-		if(!none)
-			flags += ", ";
-		flags += "GST_BUFFER_FLAG_DELTA_UNIT";
-		none = false;
+		speed = QInputDialog::getDouble(this, "Replay", "Speed factor:", 2.0, 0.01, 1000.0, 2, &ok);
+		if(!ok)
+			return;
 	}
 
-	if(GST_BUFFER_FLAG_IS_SET(buff, GST_BUFFER_FLAG_LAST))
+	settings.setValue("MainWindow/ReplayPipeline", pipeline);
+
+	// a selection of several packets replays just them, otherwise the whole dump
+	qint64 first = 0, last = -1;
+	selectedRange(&first, &last);
+
+	if(m_preplayer)
+		delete m_preplayer;
+
+	Replayer *preplayer = new Replayer(pmodel -> packetIndex(), pmodel -> fileName(), m_ptreeView);
+	preplayer -> setWindowSize(MemoryBudget(memoryLimit()).windowBytes);
+	preplayer -> setPacing(pacing == pacings[0] ? Replayer::AsFastAsPossible :
+		pacing == pacings[1] ? Replayer::OriginalPacing : Replayer::Speed, speed);
+	connect(preplayer, SIGNAL(finished()), SLOT(slotReplayFinished()));
+
+	if(!preplayer -> start(pipeline, first, last))
 	{
-		if(!none)
-			flags += ", ";
-		flags += "GST_BUFFER_FLAG_LAST";
-		none = false;
+		QMessageBox::critical(this, "Replay problem", preplayer -> errorString());
+		delete preplayer;
+		return;
 	}
 
-	if(none)
-		flags += "none)";
-	else
-		flags += ")";
+	m_preplayer = preplayer;
+	statusBar() -> showMessage("Replaying...");
+}
 
 
-	QTreeWidgetItem *pitem = new QTreeWidgetItem(QStringList("Buffer: pts = " + timestamp));
+void MainWindow::slotStopReplay()
+{
+	if(m_preplayer)
+		m_preplayer -> stop();
+}
+
+
+void MainWindow::slotReplayFinished()
+{
+	if(!m_preplayer)
+		return;
+
+	Replayer::Report report = m_preplayer -> report();
+	QString message = QString("Replayed %1 buffers, %2 bytes in %3, %4 MB/s")
+		.arg(report.buffers).arg(report.bytes).arg(ClockTime::toString(report.elapsed))
+		.arg(report.throughput() / (1024 * 1024), 0, 'f', 1);
 
-	pitem -> addChild(new QTreeWidgetItem(QStringList("timestamp = " + timestamp)));
-	pitem -> addChild(new QTreeWidgetItem(QStringList("duration = " + duration)));
-	pitem -> addChild(new QTreeWidgetItem(QStringList("size = " + size)));
-	pitem -> addChild(new QTreeWidgetItem(QStringList("offset = " + offset)));
-	pitem -> addChild(new QTreeWidgetItem(QStringList("offset_end = " + offset_end)));
-	pitem -> addChild(new QTreeWidgetItem(QStringList("offset_end = " + offset_end)));
+	if(report.maxJitter)
+		message += QString(", jitter mean %1 us, max %2 us").arg(report.meanJitter / 1000).arg(report.maxJitter / 1000);
 
-	return pitem;
+	statusBar() -> showMessage(message);
+
+	if(!m_preplayer -> errorString().isEmpty())
+		QMessageBox::warning(this, "Replay problem", m_preplayer -> errorString());
 }
 
 
-QTreeWidgetItem *MainWindow::onEvent(GstEvent *event)
+void MainWindow::slotMerge()
 {
-	QString timestamp = GST_EVENT_TIMESTAMP(event) != GST_CLOCK_TIME_NONE ? QString::number(GST_EVENT_TIMESTAMP(event)) : "not set";
-	QString type = GST_EVENT_TYPE_NAME(event);
+	if(m_pindexing)
+		return;
 
-	QTreeWidgetItem *pitem = new QTreeWidgetItem(QStringList("Event: " + type));
+	QString dir = QDir::currentPath();
+	QSettings settings("virinext", "gdpviewer");
 
-	pitem -> addChild(new QTreeWidgetItem(QStringList("timestamp = " + timestamp)));
+	if(settings.value("MainWindow/PrevDir").toString().length())
+		dir = settings.value("MainWindow/PrevDir").toString();
 
+	QStringList fileNames = QFileDialog::getOpenFileNames(this, "GDP files of one pipeline", dir);
+	if(fileNames.isEmpty())
+		return;
 
-	if(GST_EVENT_TYPE(event) == GST_EVENT_FLUSH_STOP)
-	{
-		gboolean resetTime;
-		gst_event_parse_flush_stop(event, &resetTime);
+	QStringList keys;
+	keys << "Running time" << "PTS";
 
-		pitem -> addChild(new QTreeWidgetItem(QStringList("reset_time = " + QString::number(resetTime))));
-	}
-	else if(GST_EVENT_TYPE(event) == GST_EVENT_GAP)
+	bool ok = false;
+	QString key = QInputDialog::getItem(this, "Merge dumps", "Interleave the packets by:", keys, 0, false, &ok);
+	if(!ok)
+		return;
+
+	m_break = false;
+
+	// the indexes and the merged timeline share the index memory
+	MemoryBudget budget(memoryLimit());
+	qint64 indexBytes = budget.indexBytes / (fileNames.size() + 1);
+
+	QSharedPointer<TimelineMerger> pmerger(new TimelineMerger());
+	pmerger -> setKey(key == keys[0] ? TimelineMerger::RunningTime : TimelineMerger::Pts);
+	pmerger -> setMaxMappedBytes(indexBytes);
+
+	QProgressBar *pprogressBar = new QProgressBar(NULL);
+	pprogressBar -> setMinimum(0);
+	pprogressBar -> setMaximum(0);
+	pprogressBar -> setValue(0);
+	pprogressBar -> show();
+
+	bool res = true;
+	for(int i = 0; res && i < fileNames.size(); i++)
 	{
-		GstClockTime timestamp, duration;
-		gst_event_parse_gap(event, &timestamp, &duration);
+		pprogressBar -> setWindowTitle(QString("Indexing %1 of %2...").arg(i + 1).arg(fileNames.size()));
+
+		QSharedPointer<PacketIndex> pindex(new PacketIndex());
+		if(!pindex -> open(QDir::tempPath()))
+		{
+			QMessageBox::critical(this, "Index creation problem", "Problem with creating packet index in `" + QDir::tempPath() + "`");
+			res = false;
+			break;
+		}
+		pindex -> setMaxMappedBytes(indexBytes);
+
+		Indexer indexer;
+		indexer.setWindowSize(budget.windowBytes);
+
+		m_pprogressBar = pprogressBar;
+		m_pindexer = &indexer;
+		connect(&indexer, SIGNAL(progress(qint64, qint64)), SLOT(slotProgress(qint64, qint64)));
+
+		Indexer::Result result = indexer.run(fileNames[i], pindex.data());
 
-		pitem -> addChild(new QTreeWidgetItem(QStringList("timestamp = " + QString::number(timestamp))));
-		pitem -> addChild(new QTreeWidgetItem(QStringList("duration = " + QString::number(duration))));
+		m_pprogressBar = NULL;
+		m_pindexer = NULL;
 
+		if(result != Indexer::Finished)
+		{
+			if(result != Indexer::Cancelled)
+				QMessageBox::critical(this, "Indexing problem", indexer.errorString());
+			res = false;
+			break;
+		}
+
+		pmerger -> addSource(fileNames[i], pindex);
 	}
-	else if(GST_EVENT_TYPE(event) == GST_EVENT_STREAM_START)
+
+	if(res)
 	{
-		const gchar *streamId;
-		gst_event_parse_stream_start(event, &streamId);
-		pitem -> addChild(new QTreeWidgetItem(QStringList("stream_id = " + QString(streamId))));
+		pprogressBar -> setWindowTitle("Merging...");
 
+		m_pprogressBar = pprogressBar;
+		m_pmerger = pmerger.data();
+		connect(pmerger.data(), SIGNAL(progress(qint64, qint64)), SLOT(slotMergeProgress(qint64, qint64)));
+
+		res = pmerger -> run();
+
+		m_pprogressBar = NULL;
+		m_pmerger = NULL;
+
+		if(!res && !m_break && pprogressBar -> isVisible())
+			QMessageBox::critical(this, "Merge problem", pmerger -> errorString());
 	}
-	else if(GST_EVENT_TYPE(event) == GST_EVENT_SEGMENT)
-	{
-		const GstSegment *segment;
-		gst_event_parse_segment(event, &segment);
-		QString str = "flags = ";
 
-		bool none = true;
+	pprogressBar -> close();
+	delete pprogressBar;
+
+	if(!res)
+		return;
+
+	settings.setValue("MainWindow/PrevDir", QFileInfo(fileNames.first()).absoluteDir().absolutePath());
+
+	// the timeline gets a window of its own, the dump shown here stays
+	QTableView *pview = new QTableView(this);
+	pview -> setWindowFlags(Qt::Window);
+	pview -> setAttribute(Qt::WA_DeleteOnClose);
+	pview -> setWindowTitle(QString("Merged timeline of %1 dumps by %2").arg(fileNames.size()).arg(key.toLower()));
+	pview -> setModel(new MergedTableModel(pmerger, pview));
+	pview -> verticalHeader() -> hide();
+	pview -> verticalHeader() -> setSectionResizeMode(QHeaderView::Fixed);
+	pview -> setSelectionBehavior(QAbstractItemView::SelectRows);
+	pview -> setWordWrap(false);
+	pview -> resize(size());
+	pview -> show();
+
+	statusBar() -> showMessage(QString("%1 packets from %2 dumps merged").arg(pmerger -> size()).arg(fileNames.size()));
+}
 
-		if(segment -> flags == GST_SEGMENT_FLAG_NONE)
-			str += "GST_SEGMENT_FLAG_NONE";
-		else
-		{
-			if(segment -> flags & GST_SEGMENT_FLAG_RESET)
-			{
-				str += "GST_SEGMENT_FLAG_RESET";
-				none = false;
-			}
 
-			if(segment -> flags & GST_SEGMENT_FLAG_SKIP)
-			{
-				if(!none)
-					str += " , ";
-				str += "GST_SEGMENT_FLAG_SKIP";
-				none = false;
-			}
+void MainWindow::slotMergeProgress(qint64 done, qint64 total)
+{
+	if(!m_pprogressBar || !m_pmerger)
+		return;
 
-			if(segment -> flags & GST_SEGMENT_FLAG_SEGMENT)
-			{
-				if(!none)
-					str += " , ";
-				str += "GST_SEGMENT_FLAG_SEGMENT";
-				none = false;
-			}
-		}
+	int shift = 0;
+	while((total >> shift) > INT_MAX)
+		shift++;
 
-		pitem -> addChild(new QTreeWidgetItem(QStringList(str)));
-		pitem -> addChild(new QTreeWidgetItem(QStringList("rate = " + QString::number(segment -> rate))));
-		pitem -> addChild(new QTreeWidgetItem(QStringList("applied_rate = " + QString::number(segment -> applied_rate))));
-
-
-		str = "format = ";
-
-		if(segment -> format == GST_FORMAT_UNDEFINED)
-			str += "GST_FORMAT_UNDEFINED";
-		else if(segment -> format == GST_FORMAT_DEFAULT)
-			str += "GST_FORMAT_DEFAULT";
-		else if(segment -> format == GST_FORMAT_BYTES)
-			str += "GST_FORMAT_BYTES";
-		else if(segment -> format == GST_FORMAT_TIME)
-			str += "GST_FORMAT_TIME";
-		else if(segment -> format == GST_FORMAT_BUFFERS)
-			str += "GST_FORMAT_BUFFERS";
-		else if(segment -> format == GST_FORMAT_PERCENT)
-			str += "GST_FORMAT_PERCENT";
-
-		pitem -> addChild(new QTreeWidgetItem(QStringList(str)));
-		pitem -> addChild(new QTreeWidgetItem(QStringList("base = " + QString::number(segment -> base))));
-		pitem -> addChild(new QTreeWidgetItem(QStringList("offset = " + QString::number(segment -> offset))));
-		pitem -> addChild(new QTreeWidgetItem(QStringList("start = " + QString::number(segment -> start))));
-		pitem -> addChild(new QTreeWidgetItem(QStringList("stop = " + QString::number(segment -> stop))));
-		pitem -> addChild(new QTreeWidgetItem(QStringList("time = " + QString::number(segment -> time))));
-		pitem -> addChild(new QTreeWidgetItem(QStringList("position = " + QString::number(segment -> position))));
-		pitem -> addChild(new QTreeWidgetItem(QStringList("duration = " + QString::number(segment -> duration))));
-	}
-	else if(GST_EVENT_TYPE(event) == GST_EVENT_TAG)
+	m_pprogressBar -> setMaximum(total >> shift);
+	m_pprogressBar -> setValue(done >> shift);
+
+	QCoreApplication::processEvents();
+
+	if(!m_pprogressBar || !m_pmerger)
+		return;
+
+	if(m_break || !m_pprogressBar -> isVisible())
+		m_pmerger -> cancel();
+}
+
+
+void MainWindow::slotSearch(const QString &text)
+{
+	// the text index is still being written, startAnalysis() searches
+	if(!m_psearch || m_pindexing)
+		return;
+
+	m_searchShown = false;
+	m_psearch -> start(text);
+}
+
+
+void MainWindow::slotSearchMatches(qint64 count)
+{
+	if(!m_psearch)
+		return;
+
+	statusBar() -> showMessage(QString("%1 matches, searching...").arg(count));
+
+	// go to the first match after the current packet as soon as there is
+	// one, signals of a previous search may still come with none
+	if(!m_searchShown && !m_psearch -> matches().isEmpty())
 	{
-		GstTagList *tags;
-		gst_event_parse_tag(event, &tags);
-		gchar *str = gst_tag_list_to_string(tags);
-		pitem -> addChild(new QTreeWidgetItem(QStringList("tags = " + (QString)str)));
-		g_free(str);
+		m_searchShown = true;
+		slotFindNext();
 	}
-	else if(GST_EVENT_TYPE(event) == GST_EVENT_BUFFERSIZE)
+}
+
+
+void MainWindow::slotSearchFinished()
+{
+	if(!m_psearch || m_psearchEdit -> text().isEmpty())
+		return;
+
+	qint64 count = m_psearch -> matches().size();
+	statusBar() -> showMessage(count ? QString("%1 matches").arg(count) : QString("No matches"));
+}
+
+
+void MainWindow::slotSortFailed(const QString &message)
+{
+	QMessageBox::warning(this, "Sort", message);
+}
+
+
+void MainWindow::slotNalFinished()
+{
+	if(m_pnal && m_pnal -> mismatchCount() > 0)
+		statusBar() -> showMessage(QString("%1 buffers have a DELTA_UNIT flag that does not match their frame type")
+			.arg(m_pnal -> mismatchCount()));
+}
+
+
+void MainWindow::slotFindNext()
+{
+	if(!m_psearch)
+		return;
+
+	QVector<qint64> matches = m_psearch -> matches();
+	if(matches.isEmpty())
+		return;
+
+	QVector<qint64>::const_iterator it = std::upper_bound(matches.constBegin(), matches.constEnd(), currentPacket());
+	slotPacketActivated(it != matches.constEnd() ? *it : matches.first());
+}
+
+
+void MainWindow::slotFindPrevious()
+{
+	if(!m_psearch)
+		return;
+
+	QVector<qint64> matches = m_psearch -> matches();
+	if(matches.isEmpty())
+		return;
+
+	QVector<qint64>::const_iterator it = std::lower_bound(matches.constBegin(), matches.constEnd(), currentPacket());
+	slotPacketActivated(it != matches.constBegin() ? *(it - 1) : matches.last());
+}
+
+
+qint64 MainWindow::currentPacket() const
+{
+	if(!m_pviews)
+		return -1;
+
+	if(m_pviews -> currentWidget() == m_ptableView.data())
 	{
-		GstFormat format;
-		gint64 minsize, maxsize;
-		gboolean async;
-
-		gst_event_parse_buffer_size(event, &format, &minsize, &maxsize, &async);
-		QString str = "format = ";
-
-		if(format == GST_FORMAT_UNDEFINED)
-			str += QString("GST_FORMAT_UNDEFINED");
-		else if(format == GST_FORMAT_DEFAULT)
-			str += QString("GST_FORMAT_DEFAULT");
-		else if(format == GST_FORMAT_BYTES)
-			str += QString("GST_FORMAT_BYTES");
-		else if(format == GST_FORMAT_TIME)
-			str += QString("GST_FORMAT_TIME");
-		else if(format == GST_FORMAT_BUFFERS)
-			str += QString("GST_FORMAT_BUFFERS");
-		else if(format == GST_FORMAT_PERCENT)
-			str += QString("GST_FORMAT_PERCENT");
-		
-		pitem -> addChild(new QTreeWidgetItem(QStringList(str)));
-		pitem -> addChild(new QTreeWidgetItem(QStringList("minsize = " + QString::number(minsize))));
-		pitem -> addChild(new QTreeWidgetItem(QStringList("maxsize = " + QString::number(maxsize))));
-		pitem -> addChild(new QTreeWidgetItem(QStringList("async = " + (QString)(async ? "true" : "false"))));
+		PacketTableModel *pmodel = qobject_cast<PacketTableModel *>(m_ptableView -> model());
+		return pmodel -> packetRow(m_ptableView -> currentIndex().row());
 	}
-	else if(GST_EVENT_TYPE(event) == GST_EVENT_QOS)
+
+	PacketModel *pmodel = qobject_cast<PacketModel *>(m_ptreeView -> model());
+	return pmodel -> packetRow(m_ptreeView -> currentIndex());
+}
+
+
+bool MainWindow::selectedRange(qint64 *pfirst, qint64 *plast) const
+{
+	if(!m_pviews)
+		return false;
+
+	qint64 first = -1, last = -1;
+	if(m_pviews -> currentWidget() == m_ptableView.data())
 	{
-		GstQOSType type;
-		gdouble proportion;
-		GstClockTimeDiff diff;
-		GstClockTime timestamp;
-
-		gst_event_parse_qos(event, &type, &proportion, &diff, &timestamp);
-
-		QString str = "type = ";
-		if(type == GST_QOS_TYPE_OVERFLOW)
-			str += "GST_QOS_TYPE_OVERFLOW";
-		else if(type == GST_QOS_TYPE_UNDERFLOW)
-			str += "GST_QOS_TYPE_UNDERFLOW";
-		else if(type == GST_QOS_TYPE_THROTTLE)
-			str += "GST_QOS_TYPE_THROTTLE";
-
-		pitem -> addChild(new QTreeWidgetItem(QStringList(str)));
-		pitem -> addChild(new QTreeWidgetItem(QStringList("proportion = " + QString::number(proportion))));
-		pitem -> addChild(new QTreeWidgetItem(QStringList("diff = " + QString::number(diff))));
-		pitem -> addChild(new QTreeWidgetItem(QStringList("timestamp = " + QString::number(timestamp))));
+		PacketTableModel *pmodel = qobject_cast<PacketTableModel *>(m_ptableView -> model());
+		QModelIndexList rows = m_ptableView -> selectionModel() -> selectedRows();
+		for(int i = 0; i < rows.size(); i++)
+		{
+			qint64 row = pmodel -> packetRow(rows[i].row());
+			first = first < 0 ? row : qMin(first, row);
+			last = qMax(last, row);
+		}
 	}
-	else if(GST_EVENT_TYPE(event) == GST_EVENT_SEEK)
+	else
 	{
-		gdouble rate;
-		GstFormat format;
-		GstSeekFlags flags;
-		GstSeekType start_type;
-		gint64 start, stop;
-		GstSeekType stop_type;
-
-		gst_event_parse_seek(event, &rate, &format, &flags, &start_type, &start, &stop_type, &stop);
-
-		QString str = "format = ";
-		if(format == GST_FORMAT_UNDEFINED)
-			str += "GST_FORMAT_UNDEFINED";
-		else if(format == GST_FORMAT_DEFAULT)
-			str += "GST_FORMAT_DEFAULT";
-		else if(format == GST_FORMAT_BYTES)
-			str += "GST_FORMAT_BYTES";
-		else if(format == GST_FORMAT_TIME)
-			str += "GST_FORMAT_TIME";
-		else if(format == GST_FORMAT_BUFFERS)
-			str += "GST_FORMAT_BUFFERS";
-		else if(format == GST_FORMAT_PERCENT)
-			str += "GST_FORMAT_PERCENT";
-
-		pitem -> addChild(new QTreeWidgetItem(QStringList("rate = " + QString::number(rate))));
-		pitem -> addChild(new QTreeWidgetItem(QStringList(str)));
-
-		str = "flags = ";
-
-		if(flags == GST_SEEK_FLAG_NONE)
-			str += "GST_SEEK_FLAG_NONE";
-		else
+		PacketModel *pmodel = qobject_cast<PacketModel *>(m_ptreeView -> model());
+		QModelIndexList rows = m_ptreeView -> selectionModel() -> selectedRows();
+		for(int i = 0; i < rows.size(); i++)
 		{
-			bool none = true;
+			qint64 row = pmodel -> packetRow(rows[i]);
+			if(row < 0)
+				continue;
+			first = first < 0 ? row : qMin(first, row);
+			last = qMax(last, row);
+		}
+	}
 
-			if(flags & GST_SEEK_FLAG_FLUSH)
-			{
-				str += "GST_SEEK_FLAG_FLUSH";
-				none = false;
-			}
+	if(first < 0 || first == last)
+		return false;
 
-			if(flags & GST_SEEK_FLAG_ACCURATE)
-			{
-				if(!none)
-					str += ", ";
-				str += "GST_SEEK_FLAG_ACCURATE";
-				none = false;
-			}
+	*pfirst = first;
+	*plast = last;
+	return true;
+}
 
-			if(flags & GST_SEEK_FLAG_KEY_UNIT)
-			{
-				if(!none)
-					str += ", ";
-				str += "GST_SEEK_FLAG_KEY_UNIT";
-				none = false;
-			}
 
-			if(flags & GST_SEEK_FLAG_SEGMENT)
-			{
-				if(!none)
-					str += ", ";
-				str += "GST_SEEK_FLAG_SEGMENT";
-				none = false;
-			}
+void MainWindow::slotUpdateStatus()
+{
+	m_pstatusLabel -> setText(Stats::summary());
+}
 
-			if(flags & GST_SEEK_FLAG_SKIP)
-			{
-				if(!none)
-					str += ", ";
-				str += "GST_SEEK_FLAG_SKIP";
-				none = false;
-			}
 
-			if(flags & GST_SEEK_FLAG_SNAP_BEFORE)
-			{
-				if(!none)
-					str += ", ";
-				str += "GST_SEEK_FLAG_SNAP_BEFORE";
-				none = false;
-			}
+bool MainWindow::openFile(const QString &fileName, bool quickLook)
+{
+	if(m_pindexing)
+		return false;
 
-			if(flags & GST_SEEK_FLAG_SNAP_AFTER)
-			{
-				if(!none)
-					str += ", ";
-				str += "GST_SEEK_FLAG_SNAP_AFTER";
-				none = false;
-			}
-		}
+	bool res = process(fileName, quickLook);
+
+	if(res)
+	{
+		QFileInfo info(fileName);
+		setWindowTitle(info.fileName() + (m_pactFullIndex -> isEnabled() ? " (quick look)" : ""));
+	}
 
-		pitem -> addChild(new QTreeWidgetItem(QStringList(str)));
+	return res;
+}
 
-		str = "start_type = ";
-		if(start_type == GST_SEEK_TYPE_NONE)
-			str += "GST_SEEK_TYPE_NONE";
-		else if(start_type == GST_SEEK_TYPE_SET)
-			str += "GST_SEEK_TYPE_SET";
-		else if(start_type == GST_SEEK_TYPE_END)
-			str += "GST_SEEK_TYPE_END";
 
-		pitem -> addChild(new QTreeWidgetItem(QStringList(str)));
-		pitem -> addChild(new QTreeWidgetItem(QStringList("start = " + QString::number(start))));
+void MainWindow::slotOpen()
+{
+	openDialog(false);
+}
 
-		str = "stop_type = ";
-		if(stop_type == GST_SEEK_TYPE_NONE)
-			str += "GST_SEEK_TYPE_NONE";
-		else if(stop_type == GST_SEEK_TYPE_SET)
-			str += "GST_SEEK_TYPE_SET";
-		else if(stop_type == GST_SEEK_TYPE_END)
-			str += "GST_SEEK_TYPE_END";
 
-		pitem -> addChild(new QTreeWidgetItem(QStringList(str)));
+void MainWindow::slotQuickLook()
+{
+	openDialog(true);
+}
 
-		pitem -> addChild(new QTreeWidgetItem(QStringList("stop = " + QString::number(stop))));
-	}
-	else if(GST_EVENT_TYPE(event) == GST_EVENT_LATENCY)
-	{
-		GstClockTime latency;
-		gst_event_parse_latency(event, &latency);
 
-		pitem -> addChild(new QTreeWidgetItem(QStringList("latency = " + QString::number(latency))));	
-	}
-	else if(GST_EVENT_TYPE(event) == GST_EVENT_STEP)
+void MainWindow::openDialog(bool quickLook)
+{
+	if(m_pindexing)
+		return;
+
+	QString dir = QDir::currentPath();
+	QSettings settings("virinext", "gdpviewer");
+
+	if(settings.value("MainWindow/PrevDir").toString().length())
+		dir = settings.value("MainWindow/PrevDir").toString();
+
+	QString fileName = QFileDialog::getOpenFileName(this, "GDP File", dir);
+	bool res = false;
+	if(!fileName.isEmpty())
+		res = openFile(fileName, quickLook);
+
+	if(res)
 	{
-		GstFormat format;
-		guint64 amount;
-		gdouble rate;
-		gboolean flush, intermediate;
-
-		gst_event_parse_step(event, &format, &amount, &rate, &flush, &intermediate);
-
-		QString str = "format = ";
-
-		if(format == GST_FORMAT_UNDEFINED)
-			str += "GST_FORMAT_UNDEFINED";
-		else if(format == GST_FORMAT_DEFAULT)
-			str += "GST_FORMAT_DEFAULT";
-		else if(format == GST_FORMAT_BYTES)
-			str += "GST_FORMAT_BYTES";
-		else if(format == GST_FORMAT_TIME)
-			str += "GST_FORMAT_TIME";
-		else if(format == GST_FORMAT_BUFFERS)
-			str += "GST_FORMAT_BUFFERS";
-		else if(format == GST_FORMAT_PERCENT)
-			str += "GST_FORMAT_PERCENT";
-
-		pitem -> addChild(new QTreeWidgetItem(QStringList(str)));
-		pitem -> addChild(new QTreeWidgetItem(QStringList("amount = " + QString::number(amount))));
-		pitem -> addChild(new QTreeWidgetItem(QStringList("rate = " + QString::number(rate))));
-		pitem -> addChild(new QTreeWidgetItem(QStringList("flush = " + (QString)(flush ? "true" : "false"))));
-		pitem -> addChild(new QTreeWidgetItem(QStringList("intermediate = " + (QString)(intermediate ? "true" : "false"))));
+		QFileInfo info(fileName);
+		settings.setValue("MainWindow/PrevDir", info.absoluteDir().absolutePath());
 	}
-	else if(GST_EVENT_TYPE(event) == GST_EVENT_SINK_MESSAGE)
-	{
-		GstMessage *msg;
-		gst_event_parse_sink_message(event, &msg);
-		pitem -> addChild(new QTreeWidgetItem(QStringList("message_type = " + (QString)GST_MESSAGE_TYPE_NAME(msg))));
-		gst_message_unref(msg);
+}
+
 
-		
+void MainWindow::slotFullIndex()
+{
+	if(!m_ptreeView || m_pfullIndexer || m_pindexing)
+		return;
+
+	PacketModel *pmodel = qobject_cast<PacketModel *>(m_ptreeView -> model());
+	MemoryBudget budget(memoryLimit());
+
+	BackgroundIndexer *pindexer = new BackgroundIndexer(pmodel -> fileName(), budget.windowBytes, budget.indexBytes, budget.textBytes, m_ptreeView);
+	connect(pindexer, SIGNAL(progress(qint64, qint64)), SLOT(slotFullIndexProgress(qint64, qint64)));
+	connect(pindexer, SIGNAL(finished()), SLOT(slotFullIndexFinished()));
+
+	if(!pindexer -> start())
+	{
+		QMessageBox::critical(this, "Index creation problem", pindexer -> errorString());
+		delete pindexer;
+		return;
 	}
-	else if(GST_EVENT_TYPE(event) == GST_EVENT_CAPS)
+
+	m_pfullIndexer = pindexer;
+	m_pactFullIndex -> setEnabled(false);
+}
+
+
+void MainWindow::slotFullIndexProgress(qint64 pos, qint64 size)
+{
+	if(m_pfullIndexer && size > 0)
+		statusBar() -> showMessage(QString("Indexing the whole dump: %1%").arg(pos * 100 / size));
+}
+
+
+void MainWindow::slotFullIndexFinished()
+{
+	BackgroundIndexer *pindexer = m_pfullIndexer;
+	if(!pindexer)
+		return;
+
+	PacketModel *pmodel = qobject_cast<PacketModel *>(m_ptreeView -> model());
+	QString fileName = pmodel -> fileName();
+
+	if(pindexer -> result() != Indexer::Finished)
 	{
-		GstCaps *caps;
-		gst_event_parse_caps(event, &caps);
-		gchar *str = gst_caps_to_string(caps);;
-		pitem -> addChild(new QTreeWidgetItem(QStringList("caps = " + (QString)str)));
-		g_free(str);
+		if(pindexer -> result() != Indexer::Cancelled)
+			QMessageBox::critical(this, "Indexing problem", pindexer -> errorString());
 
+		m_pactFullIndex -> setEnabled(true);
+		delete pindexer;
+		return;
 	}
-	else if(GST_EVENT_TYPE(event) == GST_EVENT_TOC_SELECT)
-	{
-		gchar *uid;
-		gst_event_parse_toc_select(event, &uid);
 
-		pitem -> addChild(new QTreeWidgetItem(QStringList("uid = " + (QString)uid)));
-		g_free(uid);
+	// the sampled views go, and the indexer with them
+	qint64 row = currentPacket();
+	PacketRecord current = row >= 0 ? pmodel -> packetIndex() -> at(row) : PacketRecord();
 
-	}	
-	else if(GST_EVENT_TYPE(event) == GST_EVENT_SEGMENT_DONE)
+	showIndex(fileName, pindexer -> packetIndex(), pindexer -> textIndex());
+	startAnalysis();
+
+	QFileInfo info(fileName);
+	setWindowTitle(info.fileName());
+	statusBar() -> showMessage("Indexed the whole dump");
+
+	if(row >= 0)
 	{
-		GstFormat format;
-		gint64 position;
+		// the same packet is found by its position in the dump
+		QSharedPointer<PacketIndex> pindex = qobject_cast<PacketModel *>(m_ptreeView -> model()) -> packetIndex();
+		qint64 first = 0, count = pindex -> size();
+		while(count > 0)
+		{
+			qint64 step = count / 2;
+			if(pindex -> at(first + step).filePos < current.filePos)
+			{
+				first += step + 1;
+				count -= step + 1;
+			}
+			else
+				count = step;
+		}
 
-		gst_event_parse_segment_done(event, &format, &position);
-		
-		QString str = "format = ";
-		if(format == GST_FORMAT_UNDEFINED)
-			str += "GST_FORMAT_UNDEFINED";
-		else if(format == GST_FORMAT_DEFAULT)
-			str += "GST_FORMAT_DEFAULT";
-		else if(format == GST_FORMAT_BYTES)
-			str += "GST_FORMAT_BYTES";
-		else if(format == GST_FORMAT_TIME)
-			str += "GST_FORMAT_TIME";
-		else if(format == GST_FORMAT_BUFFERS)
-			str += "GST_FORMAT_BUFFERS";
-		else if(format == GST_FORMAT_PERCENT)
-			str += "GST_FORMAT_PERCENT";
+		if(first < pindex -> size())
+			slotPacketActivated(first);
+	}
+}
 
-		pitem -> addChild(new QTreeWidgetItem(QStringList(str)));
-		pitem -> addChild(new QTreeWidgetItem(QStringList("position = " + QString::number(position))));
-	}	
 
-	return pitem;
+void MainWindow::slotAbout()
+{
+  QString message;
+  message = "<center><b>gdpviewer</b></center>";
+  message += "<center>virinext@gmail.com</center>";
+  message += QString("<center>Version: ") + VERSION_STR + "</center>";
+  message += "<center>GUI Based on Qt</center>";
+  QMessageBox::about(this, "About", message);
 }
 
-QTreeWidgetItem *MainWindow::onCaps(const GstCaps *caps)
+
+void MainWindow::slotMemoryLimit()
 {
-	QTreeWidgetItem *pitem = new QTreeWidgetItem(QStringList("Caps"));
+	QSettings settings("virinext", "gdpviewer");
+
+	bool ok = false;
+	int limit = QInputDialog::getInt(this, "Memory limit", "Memory limit for opened dumps (MB):",
+		memoryLimit() / (1024 * 1024), 64, 1024 * 1024, 64, &ok);
+
+	if(ok)
+	{
+		settings.setValue("MainWindow/MemoryLimit", limit);
+		m_memoryLimit = 0;
+	}
+}
+
 
-	gchar *str = gst_caps_to_string(caps);
+void MainWindow::setMemoryLimit(qint64 bytes)
+{
+	m_memoryLimit = bytes;
+}
 
-	pitem -> addChild(new QTreeWidgetItem(QStringList(str)));
 
-	g_free (str);
+qint64 MainWindow::memoryLimit() const
+{
+	if(m_memoryLimit > 0)
+		return m_memoryLimit;
 
-	return pitem;
+	QSettings settings("virinext", "gdpviewer");
+	return settings.value("MainWindow/MemoryLimit", 512).toLongLong() * 1024 * 1024;
 }
@@ -3,12 +3,34 @@
 
 #include <QMainWindow>
 #include <QVBoxLayout>
-#include <QTreeWidgetItem>
 #include <QCloseEvent>
+#include <QProgressBar>
+#include <QLabel>
 
-#include <gst/gstbuffer.h>
-#include <gst/gstevent.h>
-#include <gst/gstcaps.h>
+#include <QTreeView>
+#include <QTableView>
+#include <QStackedWidget>
+#include <QAction>
+#include <QPointer>
+#include <QLineEdit>
+#include <QSharedPointer>
+
+class Indexer;
+class Extractor;
+class Exporter;
+class ThumbnailProvider;
+class ThumbnailStrip;
+class TextSearch;
+class NalAnalyzer;
+class WaveformView;
+class LumaPlot;
+class Replayer;
+class BackgroundIndexer;
+class PacketIndex;
+class TextIndex;
+class TimelineMerger;
+class AudioOverview;
+class VideoAnalytics;
 
 class MainWindow: public QMainWindow
 {
@@ -16,9 +38,43 @@ class MainWindow: public QMainWindow
 	public:
 		MainWindow(QWidget *parent = 0, Qt::WindowFlags flags = 0);
 
+		bool openFile(const QString &fileName, bool quickLook = false);
+
+		// limit of this session over the one in the settings, 0 for none
+		void setMemoryLimit(qint64 bytes);
+
 	public slots:
 		void slotOpen();
+		void slotQuickLook();
+		void slotFullIndex();
+		void slotFullIndexProgress(qint64 pos, qint64 size);
+		void slotFullIndexFinished();
 		void slotAbout();
+		void slotMemoryLimit();
+		void slotProgress(qint64 pos, qint64 size);
+		void slotUpdateStatus();
+		void slotTreeScrolled();
+		void slotDecodeThumbnail();
+		void slotPacketActivated(qint64 row);
+		void slotGoToTime();
+		void slotTableMode(bool table);
+		void slotFilter();
+		void slotSearch(const QString &text);
+		void slotSearchMatches(qint64 count);
+		void slotSearchFinished();
+		void slotFindNext();
+		void slotFindPrevious();
+		void slotSortFailed(const QString &message);
+		void slotNalFinished();
+		void slotExtract();
+		void slotExtractProgress(qint64 done, qint64 total);
+		void slotExport();
+		void slotExportProgress(qint64 done, qint64 total);
+		void slotReplay();
+		void slotStopReplay();
+		void slotReplayFinished();
+		void slotMerge();
+		void slotMergeProgress(qint64 done, qint64 total);
 
 
 	protected:
@@ -28,12 +84,48 @@ class MainWindow: public QMainWindow
 
 
 	private:
-		bool process(const QString &fileName);
-		QTreeWidgetItem *onBuffer(const GstBuffer *);
-		QTreeWidgetItem *onEvent(GstEvent *);
-		QTreeWidgetItem *onCaps(const GstCaps *);
+		void openDialog(bool quickLook);
+		bool process(const QString &fileName, bool quickLook);
+		void showIndex(const QString &fileName, QSharedPointer<PacketIndex> pindex, QSharedPointer<TextIndex> ptext);
+		void startAnalysis();
+		void publishRows();
+		void setIndexing(bool indexing);
+		qint64 memoryLimit() const;
+		qint64 currentPacket() const;
+		bool selectedRange(qint64 *pfirst, qint64 *plast) const;
 
 		bool m_break;
+		QProgressBar *m_pprogressBar;
+		Indexer *m_pindexer;
+		Extractor *m_pextractor;
+		Exporter *m_pexporter;
+		TimelineMerger *m_pmerger;
+		QSharedPointer<PacketIndex> m_pindexing;
+		QSharedPointer<TextIndex> m_pindexingText;
+		QString m_indexingFile;
+		bool m_indexingShown;
+		bool m_fullIndexEnabled;
+		QList<QAction *> m_indexingActions;
+		QLabel *m_pstatusLabel;
+		QPointer<QTreeView> m_ptreeView;
+		QPointer<QTableView> m_ptableView;
+		QPointer<QStackedWidget> m_pviews;
+		QAction *m_pactTableMode;
+		QAction *m_pactFullIndex;
+		QLineEdit *m_pfilterEdit;
+		QLineEdit *m_psearchEdit;
+		QPointer<TextSearch> m_psearch;
+		QPointer<NalAnalyzer> m_pnal;
+		QPointer<AudioOverview> m_paudio;
+		QPointer<VideoAnalytics> m_pvideo;
+		QPointer<Replayer> m_preplayer;
+		QPointer<BackgroundIndexer> m_pfullIndexer;
+		bool m_searchShown;
+		QPointer<ThumbnailProvider> m_pthumbnails;
+		qint64 m_memoryLimit;
+		ThumbnailStrip *m_pthumbnailStrip;
+		WaveformView *m_pwaveform;
+		LumaPlot *m_plumaPlot;
 };
 
 
@@ -0,0 +1,32 @@
+#ifndef MEMORY_BUDGET_H_
+#define MEMORY_BUDGET_H_
+
+#include <QtGlobal>
+
+// Split of the configured memory limit between the parts of the viewer that
+// grow with the size of the dump.
+struct MemoryBudget
+{
+	explicit MemoryBudget(qint64 limit):
+		indexBytes(limit / 4),
+		windowBytes(limit / 8),
+		cacheBytes(limit * 3 / 8),
+		thumbnailBytes(limit / 8),
+		textBytes(limit / 16),
+		sortBytes(limit * 3 / 4)
+	{
+	}
+
+	qint64 indexBytes;
+	qint64 windowBytes;
+	qint64 cacheBytes;
+	qint64 thumbnailBytes;
+	qint64 textBytes;
+
+	// keys of a table sort, held only while it runs, so it may overlap the
+	// shares above
+	qint64 sortBytes;
+};
+
+
+#endif
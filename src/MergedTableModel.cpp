@@ -0,0 +1,136 @@
+#include "MergedTableModel.h"
+#include "PacketTableModel.h"
+#include "PacketIndex.h"
+#include "ClockTime.h"
+
+#include <QColor>
+#include <QFileInfo>
+
+#include <gst/gst.h>
+
+#include <climits>
+
+// hue step between the tints of consecutive dumps
+static const int HUE_STEP = 67;
+
+static QString signedTime(gint64 time)
+{
+	return time < 0 ? "-" + ClockTime::toString(-time) : ClockTime::toString(time);
+}
+
+
+MergedTableModel::MergedTableModel(QSharedPointer<TimelineMerger> pmerger, QObject *parent):
+	QAbstractTableModel(parent),
+	m_pmerger(pmerger)
+{
+}
+
+
+QSharedPointer<TimelineMerger> MergedTableModel::merger() const
+{
+	return m_pmerger;
+}
+
+
+int MergedTableModel::rowCount(const QModelIndex &parent) const
+{
+	if(parent.isValid())
+		return 0;
+
+	return qMin<qint64>(m_pmerger -> size(), INT_MAX);
+}
+
+
+int MergedTableModel::columnCount(const QModelIndex &parent) const
+{
+	if(parent.isValid())
+		return 0;
+
+	return ColumnCount;
+}
+
+
+QVariant MergedTableModel::data(const QModelIndex &index, int role) const
+{
+	if(!index.isValid())
+		return QVariant();
+
+	if(role == Qt::TextAlignmentRole && index.column() != ColumnSource && index.column() != ColumnType && index.column() != ColumnFlags)
+		return QVariant(Qt::AlignRight | Qt::AlignVCenter);
+
+	if(role != Qt::DisplayRole && role != Qt::BackgroundRole)
+		return QVariant();
+
+	MergedRecord merged = m_pmerger -> at(index.row());
+
+	if(role == Qt::BackgroundRole)
+		return QColor::fromHsv((merged.source * HUE_STEP) % 360, 24, 255);
+
+	return text(*m_pmerger, merged, index.column());
+}
+
+
+QVariant MergedTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+	if(orientation != Qt::Horizontal || role != Qt::DisplayRole)
+		return QAbstractTableModel::headerData(section, orientation, role);
+
+	return columnName(section);
+}
+
+
+QString MergedTableModel::columnName(int column)
+{
+	switch(column)
+	{
+		case ColumnSource: return "Source";
+		case ColumnType: return "Type";
+		case ColumnTime: return "Time";
+		case ColumnPts: return "PTS";
+		case ColumnDuration: return "Duration";
+		case ColumnSize: return "Size";
+		case ColumnFlags: return "Flags";
+		case ColumnGap: return "Gap";
+		case ColumnLead: return "Lead";
+		case ColumnFilePos: return "File offset";
+	}
+
+	return QString();
+}
+
+
+QString MergedTableModel::text(const TimelineMerger &merger, const MergedRecord &merged, int column)
+{
+	switch(column)
+	{
+		case ColumnSource:
+			return QFileInfo(merger.sourceName(merged.source)).fileName();
+		case ColumnTime:
+			return ClockTime::toString(merged.time);
+		case ColumnGap:
+			return merged.gap != TimelineMerger::NO_GAP ? signedTime(merged.gap) : QString();
+		case ColumnLead:
+			return GST_CLOCK_TIME_IS_VALID(merged.lead) ? ClockTime::toString(merged.lead) : QString();
+	}
+
+	// the rest are columns of the packet in its own dump
+	static const int packetColumns[ColumnCount] =
+	{
+		-1,
+		PacketTableModel::ColumnType,
+		-1,
+		PacketTableModel::ColumnPts,
+		PacketTableModel::ColumnDuration,
+		PacketTableModel::ColumnSize,
+		PacketTableModel::ColumnFlags,
+		-1,
+		-1,
+		PacketTableModel::ColumnFilePos
+	};
+
+	if(column < 0 || column >= ColumnCount || packetColumns[column] < 0)
+		return QString();
+
+	PacketRecord record = merger.packetIndex(merged.source) -> at(merged.row);
+	return PacketTableModel::text(record, packetColumns[column]);
+}
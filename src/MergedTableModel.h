@@ -0,0 +1,48 @@
+#ifndef MERGED_TABLE_MODEL_H_
+#define MERGED_TABLE_MODEL_H_
+
+#include <QAbstractTableModel>
+#include <QSharedPointer>
+
+#include "TimelineMerger.h"
+
+// Table of the merged timeline of several dumps, with the dump of each
+// packet in the first column and its rows tinted by dump, so that runs of
+// one stream and gaps between streams stand out.
+class MergedTableModel: public QAbstractTableModel
+{
+	Q_OBJECT
+	public:
+		enum Column
+		{
+			ColumnSource,
+			ColumnType,
+			ColumnTime,
+			ColumnPts,
+			ColumnDuration,
+			ColumnSize,
+			ColumnFlags,
+			ColumnGap,
+			ColumnLead,
+			ColumnFilePos,
+			ColumnCount
+		};
+
+		MergedTableModel(QSharedPointer<TimelineMerger> pmerger, QObject *parent = 0);
+
+		QSharedPointer<TimelineMerger> merger() const;
+
+		virtual int rowCount(const QModelIndex &parent = QModelIndex()) const;
+		virtual int columnCount(const QModelIndex &parent = QModelIndex()) const;
+		virtual QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+		virtual QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+
+		static QString columnName(int column);
+		static QString text(const TimelineMerger &merger, const MergedRecord &merged, int column);
+
+	private:
+		QSharedPointer<TimelineMerger> m_pmerger;
+};
+
+
+#endif
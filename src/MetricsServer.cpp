@@ -0,0 +1,214 @@
+#include "MetricsServer.h"
+#include "StreamMonitor.h"
+
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QHostAddress>
+#include <QStringList>
+#include <QTextStream>
+
+#include <gst/gst.h>
+
+// requests longer than this are not http clients we want to talk to
+static const int MAX_REQUEST = 8192;
+
+// caps strings can be long, the info label is cut at this
+static const int MAX_CAPS_LABEL = 256;
+
+static QString escape(const QString &value)
+{
+	QString res = value;
+	res.replace("\\", "\\\\");
+	res.replace("\"", "\\\"");
+	res.replace("\n", "\\n");
+	return res;
+}
+
+static QString seconds(guint64 time)
+{
+	return QString::number(time / (double) GST_SECOND, 'f', 6);
+}
+
+
+MetricsServer::MetricsServer(QObject *parent):
+	QObject(parent),
+	m_phttp(NULL),
+	m_plocal(NULL)
+{
+}
+
+
+void MetricsServer::addMonitor(StreamMonitor *pmonitor)
+{
+	m_monitors.append(pmonitor);
+}
+
+
+QString MetricsServer::errorString() const
+{
+	return m_error;
+}
+
+
+bool MetricsServer::listen(quint16 port)
+{
+	m_phttp = new QTcpServer(this);
+	connect(m_phttp, SIGNAL(newConnection()), SLOT(slotHttpConnection()));
+
+	if(!m_phttp -> listen(QHostAddress::LocalHost, port))
+	{
+		m_error = "Problem with listening on port " + QString::number(port) + ": " + m_phttp -> errorString();
+		return false;
+	}
+
+	return true;
+}
+
+
+bool MetricsServer::listenLocal(const QString &path)
+{
+	m_plocal = new QLocalServer(this);
+	connect(m_plocal, SIGNAL(newConnection()), SLOT(slotLocalConnection()));
+
+	// a socket file left by a previous run would make listen fail
+	QLocalServer::removeServer(path);
+	if(!m_plocal -> listen(path))
+	{
+		m_error = "Problem with listening on `" + path + "`: " + m_plocal -> errorString();
+		return false;
+	}
+
+	return true;
+}
+
+
+QString MetricsServer::metrics() const
+{
+	QList<StreamStats> stats;
+	QStringList labels;
+	for(int i = 0; i < m_monitors.size(); i++)
+	{
+		stats.append(m_monitors[i] -> stats());
+		labels.append("stream=\"" + escape(m_monitors[i] -> source()) + "\"");
+	}
+
+	QString res;
+	QTextStream out(&res);
+
+	// each metric is written once with the values of all streams under it,
+	// as the format wants them grouped
+	#define METRIC(name, type, help, value) \
+		out << "# HELP " << name << " " << help << "\n# TYPE " << name << " " << type << "\n"; \
+		for(int i = 0; i < stats.size(); i++) \
+			out << name << "{" << labels[i] << "} " << (value) << "\n";
+
+	METRIC("gdp_source_up", "gauge", "Whether the source is open or connected.", (stats[i].up ? 1 : 0))
+	METRIC("gdp_packets_total", "counter", "Packets received.", stats[i].packets)
+	METRIC("gdp_buffers_total", "counter", "Buffer packets received.", stats[i].buffers)
+	METRIC("gdp_bytes_total", "counter", "Buffer payload bytes received.", stats[i].bytes)
+	METRIC("gdp_caps_changes_total", "counter", "Times the caps of the stream changed.", stats[i].capsChanges)
+	METRIC("gdp_timestamp_gaps_total", "counter", "Buffers starting later than the gap threshold after the previous end.", stats[i].gaps)
+	METRIC("gdp_timestamp_backwards_total", "counter", "Buffers starting earlier than the gap threshold before the previous one.", stats[i].backwards)
+	METRIC("gdp_resyncs_total", "counter", "Times the parser lost the packet boundary and searched for the next header.", stats[i].resyncs)
+	METRIC("gdp_skipped_bytes_total", "counter", "Bytes skipped while searching for a header.", stats[i].skippedBytes)
+	METRIC("gdp_timestamp_gap_max_seconds", "gauge", "Longest timestamp gap seen.", seconds(stats[i].maxGap))
+	METRIC("gdp_timestamp_gap_last_seconds", "gauge", "Last timestamp gap seen.", seconds(stats[i].lastGap))
+	METRIC("gdp_last_pts_seconds", "gauge", "Timestamp of the last buffer.",
+		(GST_CLOCK_TIME_IS_VALID(stats[i].lastPts) ? seconds(stats[i].lastPts) : QString("NaN")))
+	METRIC("gdp_bitrate_bits_per_second", "gauge", "Buffer payload bitrate over the last seconds.", QString::number(stats[i].bitrate, 'f', 0))
+	METRIC("gdp_seconds_since_last_data", "gauge", "Seconds since data last came from the source.",
+		(stats[i].secondsSinceData < 0 ? QString("NaN") : QString::number(stats[i].secondsSinceData, 'f', 3)))
+
+	#undef METRIC
+
+	out << "# HELP gdp_events_total Event packets received, by event type.\n# TYPE gdp_events_total counter\n";
+	for(int i = 0; i < stats.size(); i++)
+	{
+		for(QMap<QString, qint64>::const_iterator it = stats[i].events.constBegin(); it != stats[i].events.constEnd(); ++it)
+			out << "gdp_events_total{" << labels[i] << ",type=\"" << escape(it.key()) << "\"} " << it.value() << "\n";
+	}
+
+	out << "# HELP gdp_caps_info Current caps of the stream.\n# TYPE gdp_caps_info gauge\n";
+	for(int i = 0; i < stats.size(); i++)
+	{
+		if(!stats[i].caps.isEmpty())
+			out << "gdp_caps_info{" << labels[i] << ",caps=\"" << escape(stats[i].caps.left(MAX_CAPS_LABEL)) << "\"} 1\n";
+	}
+
+	out.flush();
+	return res;
+}
+
+
+void MetricsServer::slotHttpConnection()
+{
+	while(m_phttp -> hasPendingConnections())
+	{
+		QTcpSocket *psocket = m_phttp -> nextPendingConnection();
+		connect(psocket, SIGNAL(readyRead()), SLOT(slotHttpReadyRead()));
+		connect(psocket, SIGNAL(disconnected()), psocket, SLOT(deleteLater()));
+	}
+}
+
+
+void MetricsServer::slotHttpReadyRead()
+{
+	QTcpSocket *psocket = qobject_cast<QTcpSocket *>(sender());
+	if(!psocket)
+		return;
+
+	// the request is answered once its headers are complete, a body is ignored
+	QByteArray request = psocket -> peek(MAX_REQUEST);
+	if(!request.contains("\r\n\r\n"))
+	{
+		if(request.size() >= MAX_REQUEST)
+			psocket -> abort();
+		return;
+	}
+	psocket -> readAll();
+
+	disconnect(psocket, SIGNAL(readyRead()), this, SLOT(slotHttpReadyRead()));
+
+	QList<QByteArray> line = request.left(request.indexOf("\r\n")).split(' ');
+	QByteArray path = line.size() > 1 ? line[1] : QByteArray();
+	if(path.contains('?'))
+		path = path.left(path.indexOf('?'));
+
+	QByteArray status;
+	QByteArray body;
+	QByteArray type = "text/plain; charset=utf-8";
+
+	if(line[0] != "GET" && line[0] != "HEAD")
+		status = "405 Method Not Allowed";
+	else if(path == "/metrics" || path == "/")
+	{
+		status = "200 OK";
+		body = metrics().toUtf8();
+		type = "text/plain; version=0.0.4; charset=utf-8";
+	}
+	else
+		status = "404 Not Found";
+
+	QByteArray response = "HTTP/1.0 " + status + "\r\nContent-Type: " + type + "\r\nContent-Length: "
+		+ QByteArray::number(body.size()) + "\r\nConnection: close\r\n\r\n";
+	if(line[0] != "HEAD")
+		response += body;
+
+	psocket -> write(response);
+	psocket -> disconnectFromHost();
+}
+
+
+void MetricsServer::slotLocalConnection()
+{
+	while(m_plocal -> hasPendingConnections())
+	{
+		QLocalSocket *psocket = m_plocal -> nextPendingConnection();
+		connect(psocket, SIGNAL(disconnected()), psocket, SLOT(deleteLater()));
+
+		psocket -> write(metrics().toUtf8());
+		psocket -> disconnectFromServer();
+	}
+}
@@ -0,0 +1,44 @@
+#ifndef METRICS_SERVER_H_
+#define METRICS_SERVER_H_
+
+#include <QObject>
+#include <QList>
+#include <QString>
+
+class QTcpServer;
+class QLocalServer;
+class QIODevice;
+class StreamMonitor;
+
+// Serves the stats of the monitors in the Prometheus text format, over HTTP
+// on a local port and, if a path is given, to anyone connecting to a unix
+// socket. Answers are made from the current stats on each request, there is
+// no history kept.
+class MetricsServer: public QObject
+{
+	Q_OBJECT
+	public:
+		explicit MetricsServer(QObject *parent = 0);
+
+		void addMonitor(StreamMonitor *pmonitor);
+
+		bool listen(quint16 port);
+		bool listenLocal(const QString &path);
+
+		QString metrics() const;
+		QString errorString() const;
+
+	private slots:
+		void slotHttpConnection();
+		void slotHttpReadyRead();
+		void slotLocalConnection();
+
+	private:
+		QList<StreamMonitor *> m_monitors;
+		QTcpServer *m_phttp;
+		QLocalServer *m_plocal;
+		QString m_error;
+};
+
+
+#endif
@@ -0,0 +1,125 @@
+#include "NalAnalyzer.h"
+#include "GdpFile.h"
+#include "PacketCaps.h"
+#include "dataprotocol.h"
+
+#include <QDir>
+
+#include <algorithm>
+#include <cstring>
+
+// packets handed to a worker at a time
+static const int CHUNK = 4096;
+
+NalAnalyzer::NalAnalyzer(QSharedPointer<PacketIndex> pindex, const QString &fileName, QObject *parent):
+	Analyzer(pindex, fileName, CHUNK, parent),
+	m_found(false),
+	m_configured(0),
+	m_mismatches(0)
+{
+	m_records.setMaxMappedBytes(16 * 1024 * 1024);
+}
+
+
+NalAnalyzer::~NalAnalyzer()
+{
+	stop();
+}
+
+
+bool NalAnalyzer::isConfigured() const
+{
+	return m_configured.loadAcquire();
+}
+
+
+NalConfig NalAnalyzer::config(qint64 row) const
+{
+	if(!isConfigured())
+		return NalConfig();
+
+	// the caps in effect are the last ones before the row
+	QVector<qint64>::const_iterator it = std::upper_bound(m_configRows.begin(), m_configRows.end(), row);
+	if(it == m_configRows.begin())
+		return NalConfig();
+
+	return m_configs[it - m_configRows.begin() - 1];
+}
+
+
+NalRecord NalAnalyzer::record(qint64 row) const
+{
+	if(!isReady())
+	{
+		NalRecord record;
+		memset(&record, 0, sizeof(record));
+		return record;
+	}
+
+	return m_records.at(row);
+}
+
+
+qint64 NalAnalyzer::mismatchCount() const
+{
+	return m_mismatches.load();
+}
+
+
+bool NalAnalyzer::scanPacket(qint64 row, const PacketRecord &, GstCaps *pcaps)
+{
+	if(pcaps)
+	{
+		m_configRows.append(row);
+		m_configs.append(NalParser::configFromCaps(pcaps));
+		m_found = m_found || m_configs.last().codec != NalConfig::None;
+	}
+
+	return true;
+}
+
+
+// every packet gets an empty record, filled in by the workers for buffers
+qint64 NalAnalyzer::prepare()
+{
+	bool ok = m_records.open(QDir::tempPath()) && m_records.extend(m_pindex -> size());
+	m_configured.storeRelease(1);
+
+	return ok && m_found ? m_pindex -> size() : 0;
+}
+
+
+void NalAnalyzer::process(GdpFile &file, qint64 first, qint64 last)
+{
+	QVector<PacketRecord> chunk(last - first);
+	qint64 count = m_pindex -> read(first, chunk.size(), chunk.data());
+	NalConfig config = NalAnalyzer::config(first);
+	qint64 mismatches = 0;
+
+	for(qint64 i = 0; i < count; i++)
+	{
+		const PacketRecord &record = chunk[i];
+
+		if(record.payloadType != GST_DP_PAYLOAD_BUFFER)
+		{
+			if(isCapsPacket(record))
+				config = NalAnalyzer::config(first + i);
+			continue;
+		}
+
+		if(config.codec == NalConfig::None || !record.payloadLength)
+			continue;
+
+		const guint8 *payload = file.data(record.filePos + GST_DP_HEADER_LENGTH, record.payloadLength);
+		if(!payload)
+			continue;
+
+		NalRecord nal = NalParser::parse(config, payload, record.payloadLength);
+		m_records.set(first + i, nal);
+
+		if(NalParser::isDeltaMismatch(nal, record.bufferFlags))
+			mismatches++;
+	}
+
+	m_mismatches.fetchAndAddRelaxed(mismatches);
+}
@@ -0,0 +1,46 @@
+#ifndef NAL_ANALYZER_H_
+#define NAL_ANALYZER_H_
+
+#include <QVector>
+#include <QAtomicInt>
+#include <QAtomicInteger>
+
+#include "Analyzer.h"
+#include "PagedArray.h"
+#include "NalParser.h"
+
+// Parses the H.264 and H.265 buffers of a dump into NAL units in the
+// background. The pass over the index takes the stream settings from the
+// caps, then the workers parse chunks of packets straight from the mapped
+// dump and store one NalRecord per packet, so the dump is parsed only once.
+// Buffers whose DELTA_UNIT flag does not match their frame type are counted.
+class NalAnalyzer: public Analyzer
+{
+	Q_OBJECT
+	public:
+		NalAnalyzer(QSharedPointer<PacketIndex> pindex, const QString &fileName, QObject *parent = 0);
+		~NalAnalyzer();
+
+		bool isConfigured() const;
+
+		NalConfig config(qint64 row) const;
+		NalRecord record(qint64 row) const;
+		qint64 mismatchCount() const;
+
+	protected:
+		virtual bool scanPacket(qint64 row, const PacketRecord &record, GstCaps *pcaps);
+		virtual qint64 prepare();
+		virtual void process(GdpFile &file, qint64 first, qint64 last);
+
+	private:
+		PagedArray<NalRecord> m_records;
+		QVector<qint64> m_configRows;
+		QVector<NalConfig> m_configs;
+		bool m_found;
+
+		QAtomicInt m_configured;
+		QAtomicInteger<qint64> m_mismatches;
+};
+
+
+#endif
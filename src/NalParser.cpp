@@ -0,0 +1,428 @@
+#include "NalParser.h"
+
+#include <QtAlgorithms>
+
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	// Reads the first bytes of a NAL unit with emulation prevention bytes
+	// removed, which is all the slice and PPS headers need.
+	class BitReader
+	{
+		public:
+			BitReader(const guint8 *data, gsize size):
+				m_size(0),
+				m_bit(0)
+			{
+				int zeros = 0;
+				for(gsize i = 0; i < size && m_size < (int) sizeof(m_data); i++)
+				{
+					if(zeros >= 2 && data[i] == 3)
+					{
+						zeros = 0;
+						continue;
+					}
+
+					zeros = data[i] ? 0 : zeros + 1;
+					m_data[m_size++] = data[i];
+				}
+			}
+
+			bool bits(int count, guint *pvalue)
+			{
+				if(m_bit + count > m_size * 8)
+					return false;
+
+				guint value = 0;
+				for(int i = 0; i < count; i++, m_bit++)
+					value = (value << 1) | ((m_data[m_bit / 8] >> (7 - m_bit % 8)) & 1);
+
+				*pvalue = value;
+				return true;
+			}
+
+			bool ue(guint *pvalue)
+			{
+				int zeros = 0;
+				guint bit = 0;
+
+				while(bits(1, &bit) && !bit)
+				{
+					if(++zeros > 31)
+						return false;
+				}
+
+				guint value;
+				if(!bit || !bits(zeros, &value))
+					return false;
+
+				*pvalue = (1u << zeros) - 1 + value;
+				return true;
+			}
+
+		private:
+			guint8 m_data[64];
+			int m_size;
+			int m_bit;
+	};
+
+
+	int extraSliceHeaderBits(const guint8 *pps, gsize size, int fallback)
+	{
+		BitReader reader(pps + 2, size - 2);
+		guint value;
+
+		// pps_pic_parameter_set_id, pps_seq_parameter_set_id,
+		// dependent_slice_segments_enabled_flag, output_flag_present_flag
+		if(!reader.ue(&value) || !reader.ue(&value) || !reader.bits(2, &value) || !reader.bits(3, &value))
+			return fallback;
+
+		return value;
+	}
+
+
+	bool isH265Irap(int type)
+	{
+		return type >= 16 && type <= 23;
+	}
+
+
+	int sliceType(const NalConfig &config, int type, const guint8 *nal, gsize size, int extraBits, bool *pfirst)
+	{
+		guint value;
+
+		if(config.codec == NalConfig::H264)
+		{
+			BitReader reader(nal + 1, size - 1);
+			guint firstMb;
+			if(!reader.ue(&firstMb) || !reader.ue(&value))
+				return -1;
+
+			*pfirst = firstMb == 0;
+
+			// P, B, I, SP, SI, and again +5 for all slices of the picture
+			static const int types[] = {NalRecord::SliceP, NalRecord::SliceB, NalRecord::SliceI, NalRecord::SliceP, NalRecord::SliceI};
+			return types[value % 5];
+		}
+
+		BitReader reader(nal + 2, size - 2);
+		if(!reader.bits(1, &value))
+			return -1;
+
+		// later slice segments need the SPS to be parsed to find their type
+		*pfirst = value;
+		if(!value)
+			return 0;
+
+		// no_output_of_prior_pics_flag, slice_pic_parameter_set_id,
+		// slice_reserved_flag[]
+		if((isH265Irap(type) && !reader.bits(1, &value)) || !reader.ue(&value) || !reader.bits(extraBits, &value) || !reader.ue(&value))
+			return -1;
+
+		static const int types[] = {NalRecord::SliceB, NalRecord::SliceP, NalRecord::SliceI};
+		return value < 3 ? types[value] : -1;
+	}
+}
+
+
+NalConfig NalParser::configFromCaps(const GstCaps *caps)
+{
+	NalConfig config;
+
+	if(!caps || gst_caps_get_size(caps) == 0)
+		return config;
+
+	const GstStructure *pstructure = gst_caps_get_structure(caps, 0);
+	if(gst_structure_has_name(pstructure, "video/x-h264"))
+		config.codec = NalConfig::H264;
+	else if(gst_structure_has_name(pstructure, "video/x-h265"))
+		config.codec = NalConfig::H265;
+	else
+		return config;
+
+	const gchar *format = gst_structure_get_string(pstructure, "stream-format");
+	const GValue *pcodecData = gst_structure_get_value(pstructure, "codec_data");
+
+	if((format && !strcmp(format, "byte-stream")) || !pcodecData || !GST_VALUE_HOLDS_BUFFER(pcodecData))
+		return config;
+
+	GstMapInfo map;
+	GstBuffer *buff = gst_value_get_buffer(pcodecData);
+	if(!gst_buffer_map(buff, &map, GST_MAP_READ))
+		return config;
+
+	if(config.codec == NalConfig::H264 && map.size >= 7)
+		config.nalLengthSize = (map.data[4] & 3) + 1;
+	else if(config.codec == NalConfig::H265 && map.size >= 23)
+	{
+		config.nalLengthSize = (map.data[21] & 3) + 1;
+
+		// arrays of parameter sets follow the fixed part of hvcC
+		gsize pos = 23;
+		for(int array = 0; array < map.data[22] && pos + 3 <= map.size; array++)
+		{
+			int type = map.data[pos] & 0x3f;
+			int count = GST_READ_UINT16_BE(map.data + pos + 1);
+			pos += 3;
+
+			for(int i = 0; i < count && pos + 2 <= map.size; i++)
+			{
+				gsize length = GST_READ_UINT16_BE(map.data + pos);
+				pos += 2;
+
+				if(pos + length > map.size)
+					break;
+
+				if(type == 34 && length > 2)
+					config.extraSliceHeaderBits = extraSliceHeaderBits(map.data + pos, length, config.extraSliceHeaderBits);
+
+				pos += length;
+			}
+		}
+	}
+
+	gst_buffer_unmap(buff, &map);
+	return config;
+}
+
+
+NalRecord NalParser::parse(const NalConfig &config, const guint8 *data, gsize size, QVector<NalUnit> *punits)
+{
+	NalRecord record;
+	memset(&record, 0, sizeof(record));
+
+	if(config.codec == NalConfig::None)
+		return record;
+
+	record.flags = NalRecord::Analyzed;
+
+	const int headerSize = config.codec == NalConfig::H264 ? 1 : 2;
+	const guint8 *end = data + size;
+	const guint8 *p = config.nalLengthSize ? data : findStartCode(data, end);
+
+	if(p == end && size > 0)
+		record.flags |= NalRecord::Corrupt;
+
+	int extraBits = config.extraSliceHeaderBits;
+
+	// set after a NAL unit that may only come at the start of an access
+	// unit, until the first slice of the picture
+	bool prefixed = false;
+
+	while(p < end)
+	{
+		const guint8 *nal;
+		const guint8 *nalEnd;
+
+		if(config.nalLengthSize)
+		{
+			if(end - p < config.nalLengthSize)
+			{
+				record.flags |= NalRecord::Corrupt;
+				break;
+			}
+
+			quint64 length = 0;
+			for(int i = 0; i < config.nalLengthSize; i++)
+				length = (length << 8) | p[i];
+
+			nal = p + config.nalLengthSize;
+			if(length > (quint64) (end - nal))
+			{
+				record.flags |= NalRecord::Corrupt;
+				break;
+			}
+
+			nalEnd = nal + length;
+			p = nalEnd;
+		}
+		else
+		{
+			nal = p + 3;
+			p = findStartCode(nal, end);
+
+			// trailing zeros, including the first byte of a 4-byte start code
+			nalEnd = p;
+			while(nalEnd > nal && !nalEnd[-1])
+				nalEnd--;
+		}
+
+		const gsize nalSize = nalEnd - nal;
+		if(nalSize < (gsize) headerSize)
+			continue;
+
+		if(nal[0] & 0x80)
+			record.flags |= NalRecord::Corrupt;
+
+		int type;
+		bool vcl, slice, prefix, aud;
+
+		if(config.codec == NalConfig::H264)
+		{
+			type = nal[0] & 0x1f;
+			vcl = type >= 1 && type <= 5;
+			slice = type == 1 || type == 2 || type == 5;
+			prefix = (type >= 6 && type <= 9) || (type >= 14 && type <= 18);
+			aud = type == 9;
+
+			if(type == 5)
+				record.flags |= NalRecord::Keyframe;
+		}
+		else
+		{
+			type = (nal[0] >> 1) & 0x3f;
+			vcl = type < 32;
+			slice = type <= 9 || (type >= 16 && type <= 21);
+			prefix = (type >= 32 && type <= 35) || type == 39 || (type >= 41 && type <= 44);
+			aud = type == 35;
+
+			if(isH265Irap(type))
+				record.flags |= NalRecord::Keyframe;
+			else if(type == 34)
+				extraBits = extraSliceHeaderBits(nal, nalSize, extraBits);
+		}
+
+		int unitSliceType = 0;
+
+		if(aud || (prefix && !prefixed))
+		{
+			record.accessUnits += record.accessUnits < 255;
+			prefixed = true;
+		}
+		else if(vcl)
+		{
+			bool first = false;
+			if(slice)
+			{
+				unitSliceType = sliceType(config, type, nal, nalSize, extraBits, &first);
+				if(unitSliceType < 0)
+				{
+					record.flags |= NalRecord::Corrupt;
+					unitSliceType = 0;
+				}
+			}
+
+			if(first && !prefixed)
+				record.accessUnits += record.accessUnits < 255;
+
+			prefixed = false;
+			record.sliceTypes |= unitSliceType;
+		}
+
+		record.nalTypes |= (quint64) 1 << type;
+		record.nalCount += record.nalCount < 65535;
+
+		if(punits)
+		{
+			NalUnit unit;
+			unit.offset = (int) (nal - data);
+			unit.size = (int) nalSize;
+			unit.type = type;
+			unit.sliceType = unitSliceType;
+			punits -> append(unit);
+		}
+	}
+
+	return record;
+}
+
+
+const guint8 *NalParser::findStartCode(const guint8 *p, const guint8 *end)
+{
+#ifdef __SSE2__
+	// pairs of zero bytes are found 16 positions at a time, only those are
+	// checked for the 1 that completes a start code
+	const __m128i zero = _mm_setzero_si128();
+
+	while(end - p >= 18)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i *) p);
+		__m128i b = _mm_loadu_si128((const __m128i *) (p + 1));
+		unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, zero), _mm_cmpeq_epi8(b, zero)));
+
+		while(mask)
+		{
+			int i = qCountTrailingZeroBits(mask);
+			if(p[i + 2] == 1)
+				return p + i;
+
+			mask &= mask - 1;
+		}
+
+		p += 16;
+	}
+#endif
+
+	for(; end - p >= 3; p++)
+	{
+		if(!p[0] && !p[1] && p[2] == 1)
+			return p;
+	}
+
+	return end;
+}
+
+
+bool NalParser::isDeltaMismatch(const NalRecord &record, guint16 bufferFlags)
+{
+	if(!(record.flags & NalRecord::Analyzed))
+		return false;
+
+	// buffers of I slices only may be marked either way
+	bool delta = bufferFlags & GST_BUFFER_FLAG_DELTA_UNIT;
+	if(delta)
+		return record.flags & NalRecord::Keyframe;
+
+	return record.sliceTypes & (NalRecord::SliceP | NalRecord::SliceB);
+}
+
+
+QString NalParser::frameType(const NalRecord &record)
+{
+	QString res;
+
+	if(record.sliceTypes & NalRecord::SliceI)
+		res += "I";
+	if(record.sliceTypes & NalRecord::SliceP)
+		res += res.isEmpty() ? "P" : "/P";
+	if(record.sliceTypes & NalRecord::SliceB)
+		res += res.isEmpty() ? "B" : "/B";
+
+	if(record.flags & NalRecord::Keyframe)
+		res += res.isEmpty() ? "key" : " key";
+
+	return res;
+}
+
+
+QString NalParser::nalTypeName(NalConfig::Codec codec, int type)
+{
+	static const char *h264Names[] =
+	{
+		NULL, "slice", "slice A", "slice B", "slice C", "IDR", "SEI", "SPS", "PPS", "AUD",
+		"end of sequence", "end of stream", "filler", "SPS extension", "prefix", "subset SPS",
+		NULL, NULL, NULL, "auxiliary slice", "slice extension"
+	};
+
+	static const char *h265Names[] =
+	{
+		"TRAIL_N", "TRAIL_R", "TSA_N", "TSA_R", "STSA_N", "STSA_R", "RADL_N", "RADL_R", "RASL_N", "RASL_R",
+		NULL, NULL, NULL, NULL, NULL, NULL,
+		"BLA_W_LP", "BLA_W_RADL", "BLA_N_LP", "IDR_W_RADL", "IDR_N_LP", "CRA",
+		NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+		"VPS", "SPS", "PPS", "AUD", "EOS", "EOB", "FD", "prefix SEI", "suffix SEI"
+	};
+
+	const char *name = NULL;
+	if(codec == NalConfig::H264 && type < (int) (sizeof(h264Names) / sizeof(h264Names[0])))
+		name = h264Names[type];
+	else if(codec == NalConfig::H265 && type < (int) (sizeof(h265Names) / sizeof(h265Names[0])))
+		name = h265Names[type];
+
+	return name ? QString(name) : "type " + QString::number(type);
+}
@@ -0,0 +1,88 @@
+#ifndef NAL_PARSER_H_
+#define NAL_PARSER_H_
+
+#include <QString>
+#include <QVector>
+
+#include <gst/gst.h>
+
+// Stream settings of an H.264 or H.265 stream, taken from its caps.
+struct NalConfig
+{
+	enum Codec
+	{
+		None,
+		H264,
+		H265
+	};
+
+	NalConfig():
+		codec(None),
+		nalLengthSize(0),
+		extraSliceHeaderBits(0)
+	{
+	}
+
+	Codec codec;
+
+	// 0 for byte-stream, otherwise size of the length in front of each NAL
+	// unit of avc and hvc streams
+	int nalLengthSize;
+
+	// num_extra_slice_header_bits of the H.265 PPS found in codec_data,
+	// needed to get to the slice type
+	int extraSliceHeaderBits;
+};
+
+// Summary of the NAL units of one buffer, small enough to be kept for every
+// packet of a dump.
+struct NalRecord
+{
+	enum Flags
+	{
+		Analyzed = 1,
+		Keyframe = 2,
+		Corrupt = 4
+	};
+
+	enum SliceTypes
+	{
+		SliceI = 1,
+		SliceP = 2,
+		SliceB = 4
+	};
+
+	quint64 nalTypes;
+	quint16 nalCount;
+	quint8 sliceTypes;
+	quint8 accessUnits;
+	quint8 flags;
+};
+
+struct NalUnit
+{
+	int offset;
+	int size;
+	int type;
+	int sliceType;
+};
+
+// Splits buffer payloads into NAL units and reads the few header fields
+// needed to tell frame types and access unit boundaries apart. Everything
+// else is left to the real parsers.
+class NalParser
+{
+	public:
+		static NalConfig configFromCaps(const GstCaps *caps);
+
+		static NalRecord parse(const NalConfig &config, const guint8 *data, gsize size, QVector<NalUnit> *punits = NULL);
+		static const guint8 *findStartCode(const guint8 *p, const guint8 *end);
+
+		static bool isDeltaMismatch(const NalRecord &record, guint16 bufferFlags);
+
+		static QString frameType(const NalRecord &record);
+		static QString nalTypeName(NalConfig::Codec codec, int type);
+};
+
+
+#endif
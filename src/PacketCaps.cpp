@@ -0,0 +1,38 @@
+#include "PacketCaps.h"
+#include "GdpFile.h"
+#include "dataprotocol.h"
+
+bool isCapsPacket(const PacketRecord &record)
+{
+	return record.payloadType == GST_DP_PAYLOAD_CAPS ||
+		record.payloadType == GST_DP_PAYLOAD_EVENT_NONE + GST_EVENT_CAPS;
+}
+
+
+GstCaps *packetCaps(GdpFile &file, const PacketRecord &record)
+{
+	if(!isCapsPacket(record) || !record.payloadLength)
+		return NULL;
+
+	const guint8 *header = file.data(record.filePos, GST_DP_HEADER_LENGTH + (qint64) record.payloadLength);
+	if(!header)
+		return NULL;
+
+	const guint8 *payload = header + GST_DP_HEADER_LENGTH;
+
+	if(record.payloadType == GST_DP_PAYLOAD_CAPS)
+		return gst_dp_caps_from_packet(GST_DP_HEADER_LENGTH, header, payload);
+
+	GstCaps *caps = NULL;
+	GstEvent *event = gst_dp_event_from_packet(GST_DP_HEADER_LENGTH, header, payload);
+	if(event)
+	{
+		GstCaps *eventCaps = NULL;
+		gst_event_parse_caps(event, &eventCaps);
+		if(eventCaps)
+			caps = gst_caps_ref(eventCaps);
+		gst_event_unref(event);
+	}
+
+	return caps;
+}
@@ -0,0 +1,16 @@
+#ifndef PACKET_CAPS_H_
+#define PACKET_CAPS_H_
+
+#include <gst/gst.h>
+
+#include "PacketIndex.h"
+
+class GdpFile;
+
+// Caps carried by a caps packet or a CAPS event, NULL for any other packet.
+// The caller owns the returned reference.
+bool isCapsPacket(const PacketRecord &record);
+GstCaps *packetCaps(GdpFile &file, const PacketRecord &record);
+
+
+#endif
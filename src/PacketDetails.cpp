@@ -0,0 +1,572 @@
+#include "PacketDetails.h"
+#include "ClockTime.h"
+
+#include <gst/gst.h>
+
+#include <cstddef>
+#include <cstring>
+
+enum SegmentFieldType
+{
+	SegmentFlags,
+	SegmentDouble,
+	SegmentFormat,
+	SegmentUInt64
+};
+
+struct SegmentFieldInfo
+{
+	const char *name;
+	size_t offset;
+	SegmentFieldType type;
+};
+
+static const SegmentFieldInfo s_segmentFields[] =
+{
+	{"flags", offsetof(GstSegment, flags), SegmentFlags},
+	{"rate", offsetof(GstSegment, rate), SegmentDouble},
+	{"applied_rate", offsetof(GstSegment, applied_rate), SegmentDouble},
+	{"format", offsetof(GstSegment, format), SegmentFormat},
+	{"base", offsetof(GstSegment, base), SegmentUInt64},
+	{"offset", offsetof(GstSegment, offset), SegmentUInt64},
+	{"start", offsetof(GstSegment, start), SegmentUInt64},
+	{"stop", offsetof(GstSegment, stop), SegmentUInt64},
+	{"time", offsetof(GstSegment, time), SegmentUInt64},
+	{"position", offsetof(GstSegment, position), SegmentUInt64},
+	{"duration", offsetof(GstSegment, duration), SegmentUInt64}
+};
+
+static const int SEGMENT_FIELDS = sizeof(s_segmentFields) / sizeof(s_segmentFields[0]);
+
+// guint64 structure fields holding a GstClockTime
+static const char *s_timeFields[] =
+{
+	"timestamp",
+	"duration",
+	"running-time",
+	"latency",
+	"min-latency",
+	"max-latency"
+};
+
+static const int TIME_FIELDS = sizeof(s_timeFields) / sizeof(s_timeFields[0]);
+
+
+static bool isTimeField(const char *name)
+{
+	for(int i = 0; name && i < TIME_FIELDS; i++)
+	{
+		if(!strcmp(name, s_timeFields[i]))
+			return true;
+	}
+
+	return false;
+}
+
+
+static QString enumName(GType type, gint value)
+{
+	GEnumClass *pclass = (GEnumClass *) g_type_class_ref(type);
+	GEnumValue *pvalue = g_enum_get_value(pclass, value);
+
+	QString res = pvalue ? QString(pvalue -> value_name) : QString::number(value);
+
+	g_type_class_unref(pclass);
+	return res;
+}
+
+
+static QString flagsNames(GType type, guint value)
+{
+	GFlagsClass *pclass = (GFlagsClass *) g_type_class_ref(type);
+	QString res;
+
+	if(value == 0)
+	{
+		GFlagsValue *pvalue = g_flags_get_first_value(pclass, 0);
+		res = (pvalue && pvalue -> value == 0) ? QString(pvalue -> value_name) : QString("none");
+	}
+
+	while(value)
+	{
+		GFlagsValue *pvalue = g_flags_get_first_value(pclass, value);
+		if(!pvalue || !pvalue -> value)
+		{
+			res += (res.isEmpty() ? "0x" : ", 0x") + QString::number(value, 16);
+			break;
+		}
+
+		res += (res.isEmpty() ? "" : ", ") + QString(pvalue -> value_name);
+		value &= ~pvalue -> value;
+	}
+
+	g_type_class_unref(pclass);
+	return res;
+}
+
+
+static QString valueString(const char *name, const GValue *pvalue)
+{
+	GType type = G_VALUE_TYPE(pvalue);
+
+	if(G_VALUE_HOLDS_UINT64(pvalue) && isTimeField(name))
+		return ClockTime::toString(g_value_get_uint64(pvalue));
+	else if(G_VALUE_HOLDS_ENUM(pvalue))
+		return enumName(type, g_value_get_enum(pvalue));
+	else if(G_VALUE_HOLDS_FLAGS(pvalue))
+		return flagsNames(type, g_value_get_flags(pvalue));
+	else if(G_VALUE_HOLDS_STRING(pvalue))
+	{
+		const gchar *str = g_value_get_string(pvalue);
+		return str ? QString::fromUtf8(str) : QString("NULL");
+	}
+	else if(G_VALUE_HOLDS_BOOLEAN(pvalue))
+		return g_value_get_boolean(pvalue) ? "true" : "false";
+	else if(type == GST_TYPE_CAPS)
+	{
+		const GstCaps *caps = gst_value_get_caps(pvalue);
+		if(!caps)
+			return "NULL";
+
+		gchar *str = gst_caps_to_string(caps);
+		QString res(str);
+		g_free(str);
+		return res;
+	}
+	else if(type == GST_TYPE_STRUCTURE)
+	{
+		const GstStructure *structure = gst_value_get_structure(pvalue);
+		return structure ? QString(gst_structure_get_name(structure)) : QString("NULL");
+	}
+	else if(type == GST_TYPE_BUFFER)
+	{
+		GstBuffer *buff = gst_value_get_buffer(pvalue);
+		return buff ? QString::number(gst_buffer_get_size(buff)) + " bytes" : QString("NULL");
+	}
+	else if(type == GST_TYPE_TAG_LIST)
+	{
+		const GstTagList *tags = (const GstTagList *) g_value_get_boxed(pvalue);
+		return tags ? QString::number(gst_tag_list_n_tags(tags)) + " tags" : QString("NULL");
+	}
+	else if(GST_VALUE_HOLDS_ARRAY(pvalue))
+		return QString::number(gst_value_array_get_size(pvalue)) + " values";
+	else if(GST_VALUE_HOLDS_LIST(pvalue))
+		return QString::number(gst_value_list_get_size(pvalue)) + " values";
+	else if(type == GST_TYPE_SEGMENT || type == GST_TYPE_MESSAGE)
+		return g_type_name(type);
+
+	gchar *str = gst_value_serialize(pvalue);
+	if(!str)
+		str = g_strdup_value_contents(pvalue);
+
+	QString res(str);
+	g_free(str);
+	return res;
+}
+
+
+static QString segmentFieldString(const GstSegment *psegment, int field)
+{
+	const SegmentFieldInfo &info = s_segmentFields[field];
+	const char *p = (const char *) psegment + info.offset;
+
+	switch(info.type)
+	{
+		case SegmentFlags:
+			return flagsNames(GST_TYPE_SEGMENT_FLAGS, *(const GstSegmentFlags *) p);
+		case SegmentDouble:
+			return QString::number(*(const gdouble *) p);
+		case SegmentFormat:
+			return enumName(GST_TYPE_FORMAT, *(const GstFormat *) p);
+		case SegmentUInt64:
+			if(psegment -> format == GST_FORMAT_TIME)
+				return ClockTime::toString(*(const guint64 *) p);
+			return QString::number(*(const guint64 *) p);
+	}
+
+	return QString();
+}
+
+
+PacketDetails::PacketDetails(const QString &title)
+{
+	Node root;
+	root.source.kind = Text;
+	root.source.name = NULL;
+	root.source.pvalue = NULL;
+	root.source.pstructure = NULL;
+	root.source.psegment = NULL;
+	root.source.field = -1;
+	root.source.text = title;
+	root.parent = -1;
+	root.row = 0;
+	root.expanded = true;
+
+	m_nodes.append(root);
+}
+
+
+void PacketDetails::addText(const QString &text)
+{
+	Source source;
+	source.kind = Text;
+	source.name = NULL;
+	source.pvalue = NULL;
+	source.pstructure = NULL;
+	source.psegment = NULL;
+	source.field = -1;
+	source.text = text;
+
+	addSource(source);
+}
+
+
+void PacketDetails::addField(const char *name, const GValue *pvalue)
+{
+	Source source;
+	source.kind = Value;
+	source.name = name;
+	source.pvalue = pvalue;
+	source.pstructure = NULL;
+	source.psegment = NULL;
+	source.field = -1;
+
+	addSource(source);
+}
+
+
+void PacketDetails::addFields(const GstStructure *pstructure)
+{
+	int fields = gst_structure_n_fields(pstructure);
+	for(int i = 0; i < fields; i++)
+	{
+		const gchar *name = gst_structure_nth_field_name(pstructure, i);
+		addField(name, gst_structure_get_value(pstructure, name));
+	}
+}
+
+
+void PacketDetails::addStructure(const GstStructure *pstructure)
+{
+	Source source;
+	source.kind = Structure;
+	source.name = NULL;
+	source.pvalue = NULL;
+	source.pstructure = pstructure;
+	source.psegment = NULL;
+	source.field = -1;
+
+	addSource(source);
+}
+
+
+void PacketDetails::addSource(const Source &source)
+{
+	if(m_nodes.size() >= MAX_NODES)
+		return;
+
+	Node node;
+	node.source = source;
+	node.parent = 0;
+	node.row = m_nodes[0].children.size();
+	node.expanded = false;
+
+	m_nodes[0].children.append(m_nodes.size());
+	m_nodes.append(node);
+}
+
+
+int PacketDetails::childCount(int id)
+{
+	if(!node(id).expanded)
+		expand(id);
+
+	return node(id).children.size();
+}
+
+
+int PacketDetails::child(int id, int row)
+{
+	if(row < 0 || row >= childCount(id))
+		return -1;
+
+	return node(id).children[row];
+}
+
+
+bool PacketDetails::hasChildren(int id)
+{
+	const Node &n = node(id);
+	if(n.expanded)
+		return !n.children.isEmpty();
+
+	// only the level below is looked at, without making nodes for it
+	return !children(n.source).isEmpty();
+}
+
+
+int PacketDetails::parent(int id)
+{
+	return node(id).parent;
+}
+
+
+int PacketDetails::row(int id)
+{
+	return node(id).row;
+}
+
+
+QString PacketDetails::text(int id)
+{
+	return format(node(id).source);
+}
+
+
+int PacketDetails::count() const
+{
+	return m_nodes.size();
+}
+
+
+qint64 PacketDetails::bytes() const
+{
+	return sizeof(PacketDetails) + (qint64) m_nodes.size() * (sizeof(Node) + 64);
+}
+
+
+QVector<int> PacketDetails::expansions() const
+{
+	return m_expansions;
+}
+
+
+void PacketDetails::replay(const QVector<int> &expansions)
+{
+	for(int i = 0; i < expansions.size(); i++)
+	{
+		int id = expansions[i];
+		if(id >= 0 && id < m_nodes.size() && !m_nodes[id].expanded)
+			expand(id);
+	}
+}
+
+
+PacketDetails::Node &PacketDetails::node(int id)
+{
+	// ids of nodes not made yet, which a replay would have made, fall back
+	// to the packet
+	if(id < 0 || id >= m_nodes.size())
+		return m_nodes[0];
+
+	return m_nodes[id];
+}
+
+
+void PacketDetails::expand(int id)
+{
+	QVector<Source> sources = children(m_nodes[id].source);
+	QVector<int> ids;
+
+	int count = qMin(sources.size(), MAX_NODES - m_nodes.size());
+	for(int i = 0; i < count; i++)
+	{
+		Node node;
+		node.source = sources[i];
+		node.parent = id;
+		node.row = i;
+		node.expanded = false;
+
+		ids.append(m_nodes.size());
+		m_nodes.append(node);
+	}
+
+	Node &n = m_nodes[id];
+	n.children = ids;
+	n.expanded = true;
+	m_expansions.append(id);
+}
+
+
+QVector<PacketDetails::Source> PacketDetails::children(const Source &source)
+{
+	QVector<Source> res;
+
+	Source child;
+	child.kind = Value;
+	child.name = NULL;
+	child.pvalue = NULL;
+	child.pstructure = NULL;
+	child.psegment = NULL;
+	child.field = -1;
+
+	const GstStructure *pfields = NULL;
+
+	if(source.kind == Structure)
+		pfields = source.pstructure;
+	else if(source.kind == Value)
+	{
+		const GValue *pvalue = source.pvalue;
+		GType type = G_VALUE_TYPE(pvalue);
+
+		if(type == GST_TYPE_STRUCTURE)
+			pfields = gst_value_get_structure(pvalue);
+		else if(type == GST_TYPE_MESSAGE)
+		{
+			GstMessage *msg = GST_MESSAGE(g_value_get_boxed(pvalue));
+			pfields = msg ? gst_message_get_structure(msg) : NULL;
+		}
+		else if(type == GST_TYPE_CAPS)
+		{
+			const GstCaps *caps = gst_value_get_caps(pvalue);
+			int structures = caps ? gst_caps_get_size(caps) : 0;
+
+			child.kind = Structure;
+			for(int i = 0; i < structures; i++)
+			{
+				child.pstructure = gst_caps_get_structure(caps, i);
+				res.append(child);
+			}
+		}
+		else if(type == GST_TYPE_SEGMENT)
+		{
+			child.kind = SegmentField;
+			child.psegment = (const GstSegment *) g_value_get_boxed(pvalue);
+			for(int i = 0; child.psegment && i < SEGMENT_FIELDS; i++)
+			{
+				child.name = s_segmentFields[i].name;
+				child.field = i;
+				res.append(child);
+			}
+		}
+		else if(type == GST_TYPE_TAG_LIST)
+		{
+			const GstTagList *tags = (const GstTagList *) g_value_get_boxed(pvalue);
+			int ntags = tags ? gst_tag_list_n_tags(tags) : 0;
+
+			for(int i = 0; i < ntags; i++)
+			{
+				child.name = gst_tag_list_nth_tag_name(tags, i);
+				guint values = gst_tag_list_get_tag_size(tags, child.name);
+				for(guint j = 0; j < values; j++)
+				{
+					child.pvalue = gst_tag_list_get_value_index(tags, child.name, j);
+					res.append(child);
+				}
+			}
+		}
+		else if(GST_VALUE_HOLDS_ARRAY(pvalue))
+		{
+			guint values = gst_value_array_get_size(pvalue);
+			for(guint i = 0; i < values; i++)
+			{
+				child.field = i;
+				child.pvalue = gst_value_array_get_value(pvalue, i);
+				res.append(child);
+			}
+		}
+		else if(GST_VALUE_HOLDS_LIST(pvalue))
+		{
+			guint values = gst_value_list_get_size(pvalue);
+			for(guint i = 0; i < values; i++)
+			{
+				child.field = i;
+				child.pvalue = gst_value_list_get_value(pvalue, i);
+				res.append(child);
+			}
+		}
+	}
+
+	if(pfields)
+	{
+		int fields = gst_structure_n_fields(pfields);
+		for(int i = 0; i < fields; i++)
+		{
+			child.name = gst_structure_nth_field_name(pfields, i);
+			child.pvalue = gst_structure_get_value(pfields, child.name);
+			res.append(child);
+		}
+	}
+
+	return res;
+}
+
+
+QString PacketDetails::format(const Source &source)
+{
+	switch(source.kind)
+	{
+		case Text:
+			return source.text;
+		case Value:
+		{
+			QString name = source.name ? QString(source.name) : "[" + QString::number(source.field) + "]";
+			return name + " = " + valueString(source.name, source.pvalue);
+		}
+		case Structure:
+			return gst_structure_get_name(source.pstructure);
+		case SegmentField:
+			return QString(source.name) + " = " + segmentFieldString(source.psegment, source.field);
+	}
+
+	return QString();
+}
+
+
+PacketDetails *PacketDetails::fromBuffer(const GstBuffer *buff)
+{
+	QString timestamp = ClockTime::toString(GST_BUFFER_PTS(buff));
+	QString duration = ClockTime::toString(GST_BUFFER_DURATION(buff));
+	QString offset = GST_BUFFER_OFFSET_IS_VALID(buff) ? QString::number(GST_BUFFER_OFFSET(buff)) : "not set";
+	QString offset_end = GST_BUFFER_OFFSET_END_IS_VALID(buff) ? QString::number(GST_BUFFER_OFFSET_END(buff)) : "not set";
+	QString size = QString::number(gst_buffer_get_size((GstBuffer *)buff));
+
+	guint bufferFlags = GST_BUFFER_FLAGS(buff);
+	QString flags = "(" + (bufferFlags ? flagsNames(GST_TYPE_BUFFER_FLAGS, bufferFlags) : QString("none")) + ")";
+
+	PacketDetails *pdetails = new PacketDetails("Buffer: pts = " + timestamp);
+
+	pdetails -> addText("timestamp = " + timestamp);
+	pdetails -> addText("duration = " + duration);
+	pdetails -> addText("size = " + size);
+	pdetails -> addText("offset = " + offset);
+	pdetails -> addText("offset_end = " + offset_end);
+	pdetails -> addText("flags = " + flags);
+
+	return pdetails;
+}
+
+
+PacketDetails *PacketDetails::fromEvent(GstEvent *event)
+{
+	QString timestamp = ClockTime::toString(GST_EVENT_TIMESTAMP(event));
+	QString type = GST_EVENT_TYPE_NAME(event);
+
+	PacketDetails *pdetails = new PacketDetails("Event: " + type);
+
+	pdetails -> addText("timestamp = " + timestamp);
+
+	// every event type keeps its arguments in its structure, whose fields
+	// carry their own GTypes, so no per-type code is needed
+	const GstStructure *pstructure = gst_event_get_structure(event);
+	if(pstructure)
+		pdetails -> addFields(pstructure);
+
+	return pdetails;
+}
+
+
+PacketDetails *PacketDetails::fromCaps(const GstCaps *caps)
+{
+	PacketDetails *pdetails = new PacketDetails("Caps");
+
+	if(gst_caps_is_any(caps))
+		pdetails -> addText("ANY");
+	else if(gst_caps_is_empty(caps))
+		pdetails -> addText("EMPTY");
+
+	for(guint i = 0; i < gst_caps_get_size(caps); i++)
+		pdetails -> addStructure(gst_caps_get_structure(caps, i));
+
+	return pdetails;
+}
@@ -0,0 +1,94 @@
+#ifndef PACKET_DETAILS_H_
+#define PACKET_DETAILS_H_
+
+#include <QString>
+#include <QVector>
+
+#include <gst/gstbuffer.h>
+#include <gst/gstevent.h>
+#include <gst/gstcaps.h>
+
+// Decoded description of one packet as a tree of rows, node 0 being the
+// packet itself. Rows of events and caps are not built as text: they point
+// into the GstStructure of the decoded object, which must outlive the
+// details, and are formatted only when displayed. The children of a row are
+// created when the row is first expanded.
+//
+// Node ids are given in the order nodes are made: the top rows first, then
+// the children of each row as it is expanded. The ids of the expanded rows
+// are kept in that order, and replaying them on a new decode of the packet
+// gives every node its id again. A packet has at most MAX_NODES nodes; the
+// rows that would go past it are left out.
+class PacketDetails
+{
+	public:
+		// nodes past this are not made, so ids fit the node bits of the
+		// model ids
+		static const int MAX_NODES = (1 << 24) - 1;
+
+		explicit PacketDetails(const QString &title);
+
+		void addText(const QString &text);
+		void addField(const char *name, const GValue *pvalue);
+		void addFields(const GstStructure *pstructure);
+		void addStructure(const GstStructure *pstructure);
+
+		int childCount(int id);
+		int child(int id, int row);
+		bool hasChildren(int id);
+		int parent(int id);
+		int row(int id);
+		QString text(int id);
+
+		int count() const;
+		qint64 bytes() const;
+
+		QVector<int> expansions() const;
+		void replay(const QVector<int> &expansions);
+
+		static PacketDetails *fromBuffer(const GstBuffer *);
+		static PacketDetails *fromEvent(GstEvent *);
+		static PacketDetails *fromCaps(const GstCaps *);
+
+	private:
+		enum Kind
+		{
+			Text,
+			Value,
+			Structure,
+			SegmentField
+		};
+
+		struct Source
+		{
+			Kind kind;
+			const char *name;
+			const GValue *pvalue;
+			const GstStructure *pstructure;
+			const GstSegment *psegment;
+			int field;
+			QString text;
+		};
+
+		struct Node
+		{
+			Source source;
+			int parent;
+			int row;
+			bool expanded;
+			QVector<int> children;
+		};
+
+		void addSource(const Source &source);
+		Node &node(int id);
+		void expand(int id);
+
+		static QVector<Source> children(const Source &source);
+		static QString format(const Source &source);
+
+		QVector<Node> m_nodes;
+		QVector<int> m_expansions;
+};
+
+
+#endif
@@ -0,0 +1,289 @@
+#include "PacketIndex.h"
+#include <gst/gst.h>
+#include "dp-private.h"
+
+#include <QPair>
+
+#include <algorithm>
+
+static const qint64 TIME_CHUNK = 4096;
+
+PacketIndex::PacketIndex():
+	m_timeSorted(true),
+	m_lastTimestamp(0),
+	m_sectionBreak(false)
+{
+}
+
+
+bool PacketIndex::open(const QString &dir)
+{
+	return m_records.open(dir);
+}
+
+
+void PacketIndex::setMaxMappedBytes(qint64 bytes)
+{
+	m_records.setMaxMappedBytes(bytes);
+}
+
+
+qint64 PacketIndex::size() const
+{
+	return m_records.size();
+}
+
+
+PacketRecord PacketIndex::at(qint64 row) const
+{
+	return m_records.at(row);
+}
+
+
+qint64 PacketIndex::read(qint64 first, qint64 count, PacketRecord *out) const
+{
+	return m_records.read(first, count, out);
+}
+
+
+bool PacketIndex::append(const PacketRecord &record)
+{
+	addToSection(record);
+
+	if(record.payloadType == GST_DP_PAYLOAD_BUFFER && GST_CLOCK_TIME_IS_VALID(record.timestamp))
+	{
+		qint64 chunk = m_records.size() / TIME_CHUNK;
+
+		if(m_timeChunks.isEmpty() || m_timeChunks.last().chunk != chunk)
+		{
+			TimeChunk timeChunk;
+			timeChunk.chunk = chunk;
+			timeChunk.min = record.timestamp;
+			timeChunk.max = record.timestamp;
+			m_timeChunks.append(timeChunk);
+		}
+
+		TimeChunk &timeChunk = m_timeChunks.last();
+		timeChunk.min = qMin(timeChunk.min, record.timestamp);
+		timeChunk.max = qMax(timeChunk.max, record.timestamp);
+
+		if(record.timestamp < m_lastTimestamp)
+			m_timeSorted = false;
+		m_lastTimestamp = record.timestamp;
+	}
+
+	return m_records.append(record);
+}
+
+
+void PacketIndex::breakSection()
+{
+	m_sectionBreak = true;
+}
+
+
+qint64 PacketIndex::sectionCount() const
+{
+	return m_sections.size();
+}
+
+
+const PacketSection &PacketIndex::section(qint64 i) const
+{
+	return m_sections[i];
+}
+
+
+qint64 PacketIndex::sectionOf(qint64 row) const
+{
+	int first = 0, last = m_sections.size();
+	while(last - first > 1)
+	{
+		int middle = first + (last - first) / 2;
+		if(m_sections[middle].firstRow <= row)
+			first = middle;
+		else
+			last = middle;
+	}
+
+	return first;
+}
+
+
+void PacketIndex::addToSection(const PacketRecord &record)
+{
+	bool boundary = record.payloadType == GST_DP_PAYLOAD_CAPS;
+	if(record.payloadType >= GST_DP_PAYLOAD_EVENT_NONE)
+	{
+		GstEventType type = (GstEventType) (record.payloadType - GST_DP_PAYLOAD_EVENT_NONE);
+		boundary = type == GST_EVENT_STREAM_START || type == GST_EVENT_CAPS || type == GST_EVENT_SEGMENT;
+	}
+
+	// STREAM_START, CAPS and SEGMENT usually come together, they open one
+	// section as long as no buffer came in between
+	if(m_sections.isEmpty() || m_sectionBreak || (boundary && m_sections.last().buffers > 0))
+	{
+		m_sectionBreak = false;
+
+		PacketSection section;
+		section.firstRow = m_records.size();
+		section.rows = 0;
+		section.buffers = 0;
+		section.bytes = 0;
+		section.start = GST_CLOCK_TIME_NONE;
+		section.end = GST_CLOCK_TIME_NONE;
+		section.payloadType = record.payloadType;
+		m_sections.append(section);
+	}
+
+	PacketSection &section = m_sections.last();
+	section.rows++;
+	section.bytes += GST_DP_HEADER_LENGTH + (qint64) record.payloadLength;
+
+	if(record.payloadType != GST_DP_PAYLOAD_BUFFER)
+		return;
+
+	section.buffers++;
+
+	if(GST_CLOCK_TIME_IS_VALID(record.timestamp))
+	{
+		guint64 end = record.timestamp + (GST_CLOCK_TIME_IS_VALID(record.duration) ? record.duration : 0);
+
+		if(!GST_CLOCK_TIME_IS_VALID(section.start) || record.timestamp < section.start)
+			section.start = record.timestamp;
+		if(!GST_CLOCK_TIME_IS_VALID(section.end) || end > section.end)
+			section.end = end;
+	}
+}
+
+
+bool PacketIndex::isTimeSorted() const
+{
+	return m_timeSorted;
+}
+
+
+// Returns the row of the buffer whose timestamp is the nearest to timestamp,
+// or -1 if no buffer has a timestamp.
+qint64 PacketIndex::findTimestamp(guint64 timestamp) const
+{
+	// candidates ordered by the least distance any buffer of the chunk can have
+	QVector<QPair<guint64, int> > candidates;
+
+	if(m_timeSorted)
+	{
+		// chunk ranges follow each other, so the nearest buffer is in the
+		// first chunk ending at or after the timestamp or in the one before
+		int first = 0, last = m_timeChunks.size();
+		while(first < last)
+		{
+			int middle = first + (last - first) / 2;
+			if(m_timeChunks[middle].max < timestamp)
+				first = middle + 1;
+			else
+				last = middle;
+		}
+
+		for(int i = qMax(first - 1, 0); i <= first && i < m_timeChunks.size(); i++)
+			candidates.append(qMakePair<guint64, int>(0, i));
+	}
+	else
+	{
+		for(int i = 0; i < m_timeChunks.size(); i++)
+		{
+			const TimeChunk &timeChunk = m_timeChunks[i];
+			guint64 bound = 0;
+			if(timestamp < timeChunk.min)
+				bound = timeChunk.min - timestamp;
+			else if(timestamp > timeChunk.max)
+				bound = timestamp - timeChunk.max;
+
+			candidates.append(qMakePair(bound, i));
+		}
+
+		std::sort(candidates.begin(), candidates.end());
+	}
+
+	qint64 res = -1;
+	guint64 best = G_MAXUINT64;
+
+	for(int i = 0; i < candidates.size() && candidates[i].first < best; i++)
+	{
+		guint64 distance;
+		qint64 row = nearestInChunk(m_timeChunks[candidates[i].second].chunk, timestamp, &distance);
+
+		if(row >= 0 && (res < 0 || distance < best))
+		{
+			res = row;
+			best = distance;
+		}
+	}
+
+	return res;
+}
+
+
+qint64 PacketIndex::nearestInChunk(qint64 chunk, guint64 timestamp, guint64 *pdistance) const
+{
+	QVector<PacketRecord> records(TIME_CHUNK);
+	qint64 count = m_records.read(chunk * TIME_CHUNK, TIME_CHUNK, records.data());
+
+	qint64 res = -1;
+	*pdistance = G_MAXUINT64;
+
+	for(qint64 i = 0; i < count; i++)
+	{
+		const PacketRecord &record = records[i];
+		if(record.payloadType != GST_DP_PAYLOAD_BUFFER || !GST_CLOCK_TIME_IS_VALID(record.timestamp))
+			continue;
+
+		guint64 distance = record.timestamp > timestamp ? record.timestamp - timestamp : timestamp - record.timestamp;
+		if(distance < *pdistance)
+		{
+			*pdistance = distance;
+			res = chunk * TIME_CHUNK + i;
+		}
+	}
+
+	return res;
+}
+
+
+PacketRecord PacketIndex::recordFromHeader(qint64 filePos, const guint8 *header)
+{
+	PacketRecord record;
+
+	record.filePos = filePos;
+	record.timestamp = GST_DP_HEADER_TIMESTAMP(header);
+	record.duration = GST_DP_HEADER_DURATION(header);
+	record.offset = GST_DP_HEADER_OFFSET(header);
+	record.offsetEnd = GST_DP_HEADER_OFFSET_END(header);
+	record.payloadLength = GST_DP_HEADER_PAYLOAD_LENGTH(header);
+	record.payloadType = GST_DP_HEADER_PAYLOAD_TYPE(header);
+	record.bufferFlags = GST_DP_HEADER_BUFFER_FLAGS(header);
+	record.headerFlags = GST_DP_HEADER_FLAGS(header);
+	record.runningTime = GST_CLOCK_TIME_NONE;
+	record.streamTime = GST_CLOCK_TIME_NONE;
+
+	return record;
+}
+
+
+PacketRecord PacketIndex::recordFromInfo(qint64 regionPos, const GstDPHeaderInfo &info)
+{
+	PacketRecord record;
+
+	record.filePos = regionPos + (qint64) info.offset;
+	record.timestamp = info.timestamp;
+	record.duration = info.duration;
+	record.offset = info.buffer_offset;
+	record.offsetEnd = info.buffer_offset_end;
+	record.payloadLength = info.payload_length;
+	record.payloadType = info.payload_type;
+	record.bufferFlags = info.buffer_flags;
+	record.headerFlags = info.flags;
+	record.runningTime = GST_CLOCK_TIME_NONE;
+	record.streamTime = GST_CLOCK_TIME_NONE;
+
+	return record;
+}
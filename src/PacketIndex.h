@@ -0,0 +1,90 @@
+#ifndef PACKET_INDEX_H_
+#define PACKET_INDEX_H_
+
+#include "PagedArray.h"
+#include "dataprotocol.h"
+
+#include <QVector>
+
+#include <glib.h>
+
+struct PacketRecord
+{
+	qint64 filePos;
+	guint64 timestamp;
+	guint64 duration;
+	guint64 offset;
+	guint64 offsetEnd;
+	guint32 payloadLength;
+	guint16 payloadType;
+	guint16 bufferFlags;
+	guint64 runningTime;
+	guint64 streamTime;
+	guint8 headerFlags;
+};
+
+// Run of packets between two STREAM_START, CAPS or SEGMENT boundaries, with
+// aggregates collected while indexing.
+struct PacketSection
+{
+	qint64 firstRow;
+	qint64 rows;
+	qint64 buffers;
+	qint64 bytes;
+	guint64 start;
+	guint64 end;
+	guint16 payloadType;
+};
+
+class PacketIndex
+{
+	public:
+		PacketIndex();
+
+		bool open(const QString &dir);
+		void setMaxMappedBytes(qint64 bytes);
+
+		qint64 size() const;
+		PacketRecord at(qint64 row) const;
+		qint64 read(qint64 first, qint64 count, PacketRecord *out) const;
+		bool append(const PacketRecord &record);
+
+		// makes the next record open a section, for records that do not
+		// follow the previous ones in the dump
+		void breakSection();
+
+		qint64 sectionCount() const;
+		const PacketSection &section(qint64 i) const;
+		qint64 sectionOf(qint64 row) const;
+
+		bool isTimeSorted() const;
+		qint64 findTimestamp(guint64 timestamp) const;
+
+		static PacketRecord recordFromHeader(qint64 filePos, const guint8 *header);
+		static PacketRecord recordFromInfo(qint64 regionPos, const GstDPHeaderInfo &info);
+
+	private:
+		Q_DISABLE_COPY(PacketIndex)
+
+		// range of the buffer timestamps in a chunk of TIME_CHUNK records,
+		// only kept for chunks that have buffers with a timestamp
+		struct TimeChunk
+		{
+			qint64 chunk;
+			guint64 min;
+			guint64 max;
+		};
+
+		qint64 nearestInChunk(qint64 chunk, guint64 timestamp, guint64 *pdistance) const;
+		void addToSection(const PacketRecord &record);
+
+		PagedArray<PacketRecord> m_records;
+		QVector<PacketSection> m_sections;
+		QVector<TimeChunk> m_timeChunks;
+		bool m_timeSorted;
+		guint64 m_lastTimestamp;
+		bool m_sectionBreak;
+};
+
+
+#endif
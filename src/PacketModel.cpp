@@ -0,0 +1,472 @@
+#include "PacketModel.h"
+#include "dataprotocol.h"
+#include "Stats.h"
+#include "ThumbnailProvider.h"
+#include "ClockTime.h"
+#include "NalAnalyzer.h"
+
+#include <climits>
+
+// model ids hold the row above NODE_BITS bits of node id, so only 64-bit
+// builds are supported
+Q_STATIC_ASSERT_X(sizeof(quintptr) == 8, "gdpviewer is built for 64-bit targets only");
+
+static const int NODE_BITS = 24;
+
+// node part of the ids of section rows, whose row part is the section number
+static const int SECTION_NODE = (1 << NODE_BITS) - 1;
+
+Q_STATIC_ASSERT_X(PacketDetails::MAX_NODES <= SECTION_NODE, "detail node ids must not reach SECTION_NODE");
+
+PacketModel::PacketModel(QSharedPointer<PacketIndex> pindex, const QString &fileName, QObject *parent):
+	QAbstractItemModel(parent),
+	m_pindex(pindex),
+	m_sections(qMin<qint64>(pindex -> sectionCount(), INT_MAX)),
+	m_lastSectionRows(m_sections ? pindex -> section(m_sections - 1).rows : 0),
+	m_pthumbnails(NULL),
+	m_pnal(NULL)
+{
+	m_file.open(fileName);
+	setCacheSize(64 * 1024 * 1024);
+}
+
+
+QSharedPointer<PacketIndex> PacketModel::packetIndex() const
+{
+	return m_pindex;
+}
+
+
+QString PacketModel::fileName() const
+{
+	return m_file.fileName();
+}
+
+
+void PacketModel::setWindowSize(qint64 bytes)
+{
+	m_file.setWindowSize(bytes);
+}
+
+
+void PacketModel::setCacheSize(qint64 bytes)
+{
+	m_cache.setBudget(bytes);
+}
+
+
+void PacketModel::setThumbnailProvider(ThumbnailProvider *pprovider)
+{
+	m_pthumbnails = pprovider;
+	connect(pprovider, SIGNAL(thumbnailReady(qint64)), SLOT(slotThumbnailReady(qint64)));
+}
+
+
+void PacketModel::setNalAnalyzer(NalAnalyzer *panalyzer)
+{
+	m_pnal = panalyzer;
+}
+
+
+void PacketModel::update()
+{
+	if(m_sections > 0)
+	{
+		// only the last section can have grown
+		qint64 last = m_sections - 1;
+		qint64 rows = m_pindex -> section(last).rows;
+		QModelIndex parent = createIndex(last, 0, makeId(last, SECTION_NODE));
+
+		if(rows > m_lastSectionRows && m_lastSectionRows < INT_MAX)
+		{
+			beginInsertRows(parent, m_lastSectionRows, qMin<qint64>(rows, INT_MAX) - 1);
+			m_lastSectionRows = rows;
+			endInsertRows();
+		}
+
+		// its title has the packet and byte counts
+		emit dataChanged(parent, parent);
+	}
+
+	qint64 sections = qMin<qint64>(m_pindex -> sectionCount(), INT_MAX);
+	if(sections > m_sections)
+	{
+		beginInsertRows(QModelIndex(), m_sections, sections - 1);
+		m_sections = sections;
+		m_lastSectionRows = m_pindex -> section(sections - 1).rows;
+		endInsertRows();
+	}
+}
+
+
+qint64 PacketModel::sectionRows(qint64 section) const
+{
+	return section == m_sections - 1 ? m_lastSectionRows : m_pindex -> section(section).rows;
+}
+
+
+qint64 PacketModel::packetRow(const QModelIndex &index) const
+{
+	if(!index.isValid() || nodeFromId(index.internalId()) == SECTION_NODE)
+		return -1;
+
+	return rowFromId(index.internalId());
+}
+
+
+QModelIndex PacketModel::indexOfPacket(qint64 row) const
+{
+	if(row < 0 || m_sections == 0 || row >= m_pindex -> section(m_sections - 1).firstRow + m_lastSectionRows)
+		return QModelIndex();
+
+	const PacketSection &section = m_pindex -> section(m_pindex -> sectionOf(row));
+	return createIndex(row - section.firstRow, 0, makeId(row, 0));
+}
+
+
+QModelIndex PacketModel::index(int row, int column, const QModelIndex &parent) const
+{
+	if(row < 0 || column != 0)
+		return QModelIndex();
+
+	if(!parent.isValid())
+	{
+		if(row >= m_sections)
+			return QModelIndex();
+
+		return createIndex(row, column, makeId(row, SECTION_NODE));
+	}
+
+	if(nodeFromId(parent.internalId()) == SECTION_NODE)
+	{
+		qint64 number = rowFromId(parent.internalId());
+		const PacketSection &section = m_pindex -> section(number);
+		if(row >= sectionRows(number))
+			return QModelIndex();
+
+		return createIndex(row, column, makeId(section.firstRow + row, 0));
+	}
+
+	qint64 packet = rowFromId(parent.internalId());
+	PacketDetails *pdetails = details(packet);
+	int id = pdetails -> child(nodeFromId(parent.internalId()), row);
+	keepExpansions(packet, pdetails);
+
+	if(id < 0)
+		return QModelIndex();
+
+	return createIndex(row, column, makeId(packet, id));
+}
+
+
+QModelIndex PacketModel::parent(const QModelIndex &index) const
+{
+	if(!index.isValid())
+		return QModelIndex();
+
+	qint64 packet = rowFromId(index.internalId());
+	int id = nodeFromId(index.internalId());
+
+	if(id == SECTION_NODE)
+		return QModelIndex();
+
+	if(id == 0)
+	{
+		qint64 section = m_pindex -> sectionOf(packet);
+		return createIndex(section, 0, makeId(section, SECTION_NODE));
+	}
+
+	PacketDetails *pdetails = details(packet);
+	int parentId = pdetails -> parent(id);
+
+	if(parentId == 0)
+		return indexOfPacket(packet);
+
+	return createIndex(pdetails -> row(parentId), 0, makeId(packet, parentId));
+}
+
+
+int PacketModel::rowCount(const QModelIndex &parent) const
+{
+	if(!parent.isValid())
+		return (int) m_sections;
+
+	if(parent.column() != 0)
+		return 0;
+
+	if(nodeFromId(parent.internalId()) == SECTION_NODE)
+		return qMin<qint64>(sectionRows(rowFromId(parent.internalId())), INT_MAX);
+
+	// expands the node, creating its child rows
+	qint64 packet = rowFromId(parent.internalId());
+	PacketDetails *pdetails = details(packet);
+	int count = pdetails -> childCount(nodeFromId(parent.internalId()));
+	keepExpansions(packet, pdetails);
+
+	return count;
+}
+
+
+int PacketModel::columnCount(const QModelIndex &) const
+{
+	return 1;
+}
+
+
+bool PacketModel::hasChildren(const QModelIndex &parent) const
+{
+	if(!parent.isValid())
+		return m_sections > 0;
+
+	int id = nodeFromId(parent.internalId());
+
+	// sections are never empty and every packet has at least its timestamp row
+	if(id == SECTION_NODE || id == 0)
+		return true;
+
+	return details(rowFromId(parent.internalId())) -> hasChildren(id);
+}
+
+
+QVariant PacketModel::data(const QModelIndex &index, int role) const
+{
+	if(!index.isValid())
+		return QVariant();
+
+	qint64 packet = rowFromId(index.internalId());
+	int id = nodeFromId(index.internalId());
+
+	if(id == SECTION_NODE)
+	{
+		if(role == Qt::DisplayRole)
+			return sectionTitle(m_pindex -> section(packet));
+
+		return QVariant();
+	}
+
+	if(role == Qt::DecorationRole && id == 0 && m_pthumbnails)
+	{
+		// asked only for rows in view, which is what drives thumbnail decoding
+		if(m_pthumbnails -> hasThumbnail(packet, m_pindex -> at(packet)))
+		{
+			QImage image = m_pthumbnails -> thumbnail(packet, ThumbnailProvider::Visible);
+			if(!image.isNull())
+				return image;
+		}
+
+		return QVariant();
+	}
+
+	if(role != Qt::DisplayRole)
+		return QVariant();
+
+	if(id == 0)
+		return title(m_pindex -> at(packet));
+
+	return details(packet) -> text(id);
+}
+
+
+QString PacketModel::sectionTitle(const PacketSection &section)
+{
+	QString res = "start";
+	if(section.payloadType == GST_DP_PAYLOAD_CAPS)
+		res = "caps";
+	else if(section.payloadType >= GST_DP_PAYLOAD_EVENT_NONE)
+		res = gst_event_type_get_name((GstEventType) (section.payloadType - GST_DP_PAYLOAD_EVENT_NONE));
+
+	res += ": " + QString::number(section.rows) + " packets, " + QString::number(section.buffers) + " buffers, "
+		+ QString::number(section.bytes) + " bytes";
+
+	if(GST_CLOCK_TIME_IS_VALID(section.start))
+	{
+		res += ", " + ClockTime::toString(section.start) + " - " + ClockTime::toString(section.end)
+			+ " (" + ClockTime::toString(section.end - section.start) + ")";
+	}
+
+	return res;
+}
+
+
+QString PacketModel::title(const PacketRecord &record)
+{
+	if(record.payloadType == GST_DP_PAYLOAD_BUFFER)
+		return "Buffer: pts = " + ClockTime::toString(record.timestamp);
+	else if(record.payloadType == GST_DP_PAYLOAD_CAPS)
+		return "Caps";
+
+	GstEventType type = (GstEventType) (record.payloadType - GST_DP_PAYLOAD_EVENT_NONE);
+	return "Event: " + QString(gst_event_type_get_name(type));
+}
+
+
+PacketDetails *PacketModel::details(qint64 row) const
+{
+	PacketDetails *pdetails = m_cache.details(row);
+	if(!pdetails)
+		pdetails = decode(row);
+
+	return pdetails;
+}
+
+
+// node ids are given as nodes are expanded, so the expansions of a packet
+// are kept for when its details are evicted and decoded again
+void PacketModel::keepExpansions(qint64 row, PacketDetails *pdetails) const
+{
+	QVector<int> expansions = pdetails -> expansions();
+	if(expansions.size() != m_expansions.value(row).size())
+		m_expansions.insert(row, expansions);
+}
+
+
+GstMiniObject *PacketModel::object(qint64 row) const
+{
+	details(row);
+	return m_cache.object(row);
+}
+
+
+void PacketModel::addNalUnits(PacketDetails *pdetails, qint64 row, const PacketRecord &record, const guint8 *payload) const
+{
+	NalConfig config = m_pnal ? m_pnal -> config(row) : NalConfig();
+	if(config.codec == NalConfig::None || !payload)
+		return;
+
+	QVector<NalUnit> units;
+	NalRecord nal = NalParser::parse(config, payload, record.payloadLength, &units);
+
+	QString frame = NalParser::frameType(nal);
+	if(NalParser::isDeltaMismatch(nal, record.bufferFlags))
+		frame += record.bufferFlags & GST_BUFFER_FLAG_DELTA_UNIT ? ", but DELTA_UNIT is set" : ", but DELTA_UNIT is not set";
+
+	pdetails -> addText("frame = " + frame);
+	pdetails -> addText("access units = " + QString::number(nal.accessUnits));
+
+	for(int i = 0; i < units.size(); i++)
+	{
+		const NalUnit &unit = units[i];
+		QString text = "nal = " + NalParser::nalTypeName(config.codec, unit.type);
+
+		if(unit.sliceType == NalRecord::SliceI)
+			text += " (I)";
+		else if(unit.sliceType == NalRecord::SliceP)
+			text += " (P)";
+		else if(unit.sliceType == NalRecord::SliceB)
+			text += " (B)";
+
+		pdetails -> addText(text + ", " + QString::number(unit.size) + " bytes at " + QString::number(unit.offset));
+	}
+
+	if(nal.flags & NalRecord::Corrupt)
+		pdetails -> addText("payload is not a valid " + QString(config.codec == NalConfig::H264 ? "H.264" : "H.265") +
+			(config.nalLengthSize ? " stream" : " byte-stream"));
+}
+
+
+const DetailCache &PacketModel::cache() const
+{
+	return m_cache;
+}
+
+
+PacketDetails *PacketModel::decode(qint64 row) const
+{
+	PacketRecord record = m_pindex -> at(row);
+	PacketDetails *pdetails = NULL;
+	GstMiniObject *pobject = NULL;
+
+	const guint8 *header = m_file.data(record.filePos, GST_DP_HEADER_LENGTH + (qint64) record.payloadLength);
+	const guint8 *payload = (header && record.payloadLength) ? header + GST_DP_HEADER_LENGTH : NULL;
+
+	if(!header)
+		pdetails = NULL;
+	else if(record.payloadType == GST_DP_PAYLOAD_BUFFER)
+	{
+		GstBuffer *buff = gst_dp_buffer_from_header(GST_DP_HEADER_LENGTH, header);
+		if(buff)
+		{
+			Stats::Timer t(Stats::StageItemCreation);
+			pdetails = PacketDetails::fromBuffer(buff);
+			pdetails -> addText("running_time = " + ClockTime::toString(record.runningTime));
+			pdetails -> addText("stream_time = " + ClockTime::toString(record.streamTime));
+			addNalUnits(pdetails, row, record, payload);
+			gst_buffer_unref(buff);
+		}
+	}
+	else if(record.payloadType == GST_DP_PAYLOAD_CAPS)
+	{
+		GstCaps *caps = NULL;
+		if(payload)
+		{
+			Stats::Timer t(Stats::StageCapsParse);
+			caps = gst_dp_caps_from_packet(GST_DP_HEADER_LENGTH, header, payload);
+		}
+
+		if(caps)
+		{
+			Stats::Timer t(Stats::StageItemCreation);
+			pdetails = PacketDetails::fromCaps(caps);
+			pobject = GST_MINI_OBJECT_CAST(caps);
+		}
+	}
+	else if(record.payloadType >= GST_DP_PAYLOAD_EVENT_NONE)
+	{
+		GstEvent *event;
+		{
+			Stats::Timer t(Stats::StageStructureParse);
+			event = gst_dp_event_from_packet(GST_DP_HEADER_LENGTH, header, payload);
+		}
+
+		if(event)
+		{
+			Stats::Timer t(Stats::StageItemCreation);
+			pdetails = PacketDetails::fromEvent(event);
+			pobject = GST_MINI_OBJECT_CAST(event);
+		}
+	}
+
+	if(!pdetails)
+	{
+		pdetails = new PacketDetails(title(record));
+		pdetails -> addText("unable to decode packet");
+	}
+
+	QHash<qint64, QVector<int> >::const_iterator expansions = m_expansions.constFind(row);
+	if(expansions != m_expansions.constEnd())
+		pdetails -> replay(expansions.value());
+
+	Stats::add(Stats::Allocations, pdetails -> count() + (pobject ? 1 : 0));
+
+	// parsed caps and structures take roughly twice their serialized size
+	qint64 objectBytes = pobject ? 256 + 2 * (qint64) record.payloadLength : 0;
+	m_cache.insert(row, pdetails, pobject, objectBytes);
+
+	return pdetails;
+}
+
+
+void PacketModel::slotThumbnailReady(qint64 row)
+{
+	QModelIndex idx = indexOfPacket(row);
+	if(idx.isValid())
+		emit dataChanged(idx, idx);
+}
+
+
+quintptr PacketModel::makeId(qint64 row, int node)
+{
+	return ((quintptr) (row + 1) << NODE_BITS) | (quintptr) node;
+}
+
+
+qint64 PacketModel::rowFromId(quintptr id)
+{
+	return (qint64) (id >> NODE_BITS) - 1;
+}
+
+
+int PacketModel::nodeFromId(quintptr id)
+{
+	return (int) (id & ((1 << NODE_BITS) - 1));
+}
@@ -0,0 +1,82 @@
+#ifndef PACKET_MODEL_H_
+#define PACKET_MODEL_H_
+
+#include <QAbstractItemModel>
+#include <QSharedPointer>
+#include <QHash>
+#include <QVector>
+
+#include "PacketIndex.h"
+#include "PacketDetails.h"
+#include "GdpFile.h"
+#include "DetailCache.h"
+
+class ThumbnailProvider;
+class NalAnalyzer;
+
+// Lazy tree model over a PacketIndex. Top-level rows are the sections of the
+// index and their children the packets, both built from the index alone;
+// packet details are decoded from the dump when a row is expanded and kept
+// in a DetailCache.
+//
+// The index may still be growing: the model only shows the sections and
+// packets there were at construction or at the last update(), which adds
+// the rest in one insertion per section.
+class PacketModel: public QAbstractItemModel
+{
+	Q_OBJECT
+	public:
+		PacketModel(QSharedPointer<PacketIndex> pindex, const QString &fileName, QObject *parent = 0);
+
+		QSharedPointer<PacketIndex> packetIndex() const;
+		QString fileName() const;
+
+		void setWindowSize(qint64 bytes);
+		void setCacheSize(qint64 bytes);
+		void setThumbnailProvider(ThumbnailProvider *pprovider);
+		void setNalAnalyzer(NalAnalyzer *panalyzer);
+		void update();
+
+		qint64 packetRow(const QModelIndex &index) const;
+		QModelIndex indexOfPacket(qint64 row) const;
+
+		virtual QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const;
+		virtual QModelIndex parent(const QModelIndex &index) const;
+		virtual int rowCount(const QModelIndex &parent = QModelIndex()) const;
+		virtual int columnCount(const QModelIndex &parent = QModelIndex()) const;
+		virtual bool hasChildren(const QModelIndex &parent = QModelIndex()) const;
+		virtual QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+
+		GstMiniObject *object(qint64 row) const;
+		const DetailCache &cache() const;
+
+		static QString title(const PacketRecord &record);
+		static QString sectionTitle(const PacketSection &section);
+
+	private slots:
+		void slotThumbnailReady(qint64 row);
+
+	private:
+		PacketDetails *details(qint64 row) const;
+		PacketDetails *decode(qint64 row) const;
+		void keepExpansions(qint64 row, PacketDetails *pdetails) const;
+		void addNalUnits(PacketDetails *pdetails, qint64 row, const PacketRecord &record, const guint8 *payload) const;
+
+		static quintptr makeId(qint64 row, int node);
+		static qint64 rowFromId(quintptr id);
+		static int nodeFromId(quintptr id);
+
+		qint64 sectionRows(qint64 section) const;
+
+		QSharedPointer<PacketIndex> m_pindex;
+		qint64 m_sections;
+		qint64 m_lastSectionRows;
+		mutable GdpFile m_file;
+		mutable DetailCache m_cache;
+		mutable QHash<qint64, QVector<int> > m_expansions;
+		ThumbnailProvider *m_pthumbnails;
+		NalAnalyzer *m_pnal;
+};
+
+
+#endif
@@ -0,0 +1,830 @@
+#include "PacketTableModel.h"
+#include "ParallelSort.h"
+#include "ClockTime.h"
+#include "NalAnalyzer.h"
+#include "VideoAnalytics.h"
+#include "dataprotocol.h"
+
+#include <gst/gst.h>
+
+#include <QStringList>
+#include <QDir>
+
+#include <climits>
+#include <algorithm>
+#include <vector>
+
+static const int READ_CHUNK = 65536;
+
+// memory for sorting until setSortMemory() is called; tables with more keys
+// than fit are sorted in runs merged from disk
+static const qint64 SORT_MEMORY = 32 * 1024 * 1024;
+
+// keys read from each run at a time while merging
+static const int MERGE_CHUNK = 4096;
+
+// bits of the key taken by each pass of the radix sort; the counts of a pass
+// stay in the first level cache
+static const int RADIX_BITS = 11;
+
+namespace
+{
+	typedef PacketSortKey SortKey;
+
+	// equal keys keep the packet order in both directions
+	struct SortKeyOrder
+	{
+		bool descending;
+
+		bool operator()(const SortKey &a, const SortKey &b) const
+		{
+			if(a.key != b.key)
+				return descending ? a.key > b.key : a.key < b.key;
+			return a.row < b.row;
+		}
+	};
+
+	struct RunCursor
+	{
+		QVector<SortKey> keys;
+		int pos;
+		int count;
+		qint64 next;
+		qint64 end;
+	};
+
+	struct RunHeapGreater
+	{
+		SortKeyOrder order;
+		const QVector<RunCursor> *pcursors;
+
+		bool operator()(int a, int b) const
+		{
+			const RunCursor &ca = (*pcursors)[a];
+			const RunCursor &cb = (*pcursors)[b];
+			return order(cb.keys[cb.pos], ca.keys[ca.pos]);
+		}
+	};
+
+	// External merge sort of keys: they are added in any order, sorted in
+	// memory by runs of <runKeys> written to a paged array, and taken back
+	// in order with next(), merged from the runs. Keys that fit in one run
+	// never go to disk.
+	class RunSorter
+	{
+		public:
+			RunSorter(bool descending, int runKeys):
+				m_runKeys(runKeys)
+			{
+				m_order.descending = descending;
+			}
+
+			bool add(const SortKey *pkeys, int count)
+			{
+				for(int i = 0; i < count; i++)
+				{
+					m_buffer.append(pkeys[i]);
+					if(m_buffer.size() >= m_runKeys && !flush())
+						return false;
+				}
+
+				return true;
+			}
+
+			bool start()
+			{
+				if(m_starts.isEmpty())
+				{
+					parallelSort(m_buffer.data(), m_buffer.data() + m_buffer.size(), m_order);
+					m_pos = 0;
+					return true;
+				}
+
+				if(!m_buffer.isEmpty() && !flush())
+					return false;
+				m_buffer = QVector<SortKey>();
+
+				m_cursors.resize(m_starts.size());
+				for(int i = 0; i < m_starts.size(); i++)
+				{
+					RunCursor &cursor = m_cursors[i];
+					cursor.keys.resize(MERGE_CHUNK);
+					cursor.next = m_starts[i];
+					cursor.end = i + 1 < m_starts.size() ? m_starts[i + 1] : m_runs.size();
+					if(fill(cursor))
+						m_heap.push_back(i);
+				}
+
+				std::make_heap(m_heap.begin(), m_heap.end(), heapGreater());
+				return true;
+			}
+
+			bool next(SortKey *pkey)
+			{
+				if(m_starts.isEmpty())
+				{
+					if(m_pos >= m_buffer.size())
+						return false;
+					*pkey = m_buffer[m_pos++];
+					return true;
+				}
+
+				if(m_heap.empty())
+					return false;
+
+				RunHeapGreater greater = heapGreater();
+				std::pop_heap(m_heap.begin(), m_heap.end(), greater);
+				int run = m_heap.back();
+				m_heap.pop_back();
+
+				RunCursor &cursor = m_cursors[run];
+				*pkey = cursor.keys[cursor.pos++];
+
+				if(cursor.pos < cursor.count || fill(cursor))
+				{
+					m_heap.push_back(run);
+					std::push_heap(m_heap.begin(), m_heap.end(), greater);
+				}
+
+				return true;
+			}
+
+		private:
+			bool flush()
+			{
+				if(m_starts.isEmpty() && !m_runs.open())
+					return false;
+
+				parallelSort(m_buffer.data(), m_buffer.data() + m_buffer.size(), m_order);
+
+				m_starts.append(m_runs.size());
+				if(!m_runs.append(m_buffer.constData(), m_buffer.size()))
+					return false;
+
+				m_buffer.clear();
+				return true;
+			}
+
+			bool fill(RunCursor &cursor)
+			{
+				cursor.pos = 0;
+				cursor.count = m_runs.read(cursor.next, qMin<qint64>(MERGE_CHUNK, cursor.end - cursor.next), cursor.keys.data());
+				cursor.next += cursor.count;
+				return cursor.count > 0;
+			}
+
+			RunHeapGreater heapGreater() const
+			{
+				RunHeapGreater greater;
+				greater.order = m_order;
+				greater.pcursors = &m_cursors;
+				return greater;
+			}
+
+			SortKeyOrder m_order;
+			int m_runKeys;
+			QVector<SortKey> m_buffer;
+			int m_pos;
+			PagedArray<SortKey> m_runs;
+			QVector<qint64> m_starts;
+			QVector<RunCursor> m_cursors;
+			std::vector<int> m_heap;
+	};
+
+	// Stable LSD radix sort of keys already offset to start at zero, one
+	// digit per pass over the bits that <range> uses. Passes where all keys
+	// share the digit are skipped. Returns whichever of <pkeys> and
+	// <pscratch> holds the result.
+	SortKey *radixSort(SortKey *pkeys, SortKey *pscratch, qint64 size, quint64 range)
+	{
+		const int digits = 1 << RADIX_BITS;
+		const quint64 mask = digits - 1;
+		QVector<qint64> counts(digits + 1);
+
+		for(int shift = 0; shift < 64 && (range >> shift); shift += RADIX_BITS)
+		{
+			counts.fill(0);
+			qint64 *pcounts = counts.data();
+			for(qint64 i = 0; i < size; i++)
+				pcounts[((pkeys[i].key >> shift) & mask) + 1]++;
+
+			if(pcounts[((pkeys[0].key >> shift) & mask) + 1] == size)
+				continue;
+
+			for(int i = 0; i < digits; i++)
+				pcounts[i + 1] += pcounts[i];
+
+			for(qint64 i = 0; i < size; i++)
+				pscratch[pcounts[(pkeys[i].key >> shift) & mask]++] = pkeys[i];
+
+			qSwap(pkeys, pscratch);
+		}
+
+		return pkeys;
+	}
+
+	// first element of the sorted array that is not less than value
+	template <typename T, typename Key>
+	qint64 lowerBound(const PagedArray<T> &array, qint64 value, Key key)
+	{
+		qint64 first = 0;
+		qint64 count = array.size();
+
+		while(count > 0)
+		{
+			qint64 step = count / 2;
+			if(key(array.at(first + step)) < value)
+			{
+				first += step + 1;
+				count -= step + 1;
+			}
+			else
+				count = step;
+		}
+
+		return first;
+	}
+
+	qint64 packetOfOrder(qint64 packet)
+	{
+		return packet;
+	}
+
+	qint64 packetOfInverse(const SortKey &pair)
+	{
+		return (qint64) pair.key;
+	}
+}
+
+
+static QString bufferFlags(guint flags)
+{
+	if(!flags)
+		return QString();
+
+	GFlagsClass *pclass = (GFlagsClass *) g_type_class_ref(GST_TYPE_BUFFER_FLAGS);
+	QString res;
+
+	while(flags)
+	{
+		GFlagsValue *pvalue = g_flags_get_first_value(pclass, flags);
+		if(!pvalue || !pvalue -> value)
+		{
+			res += (res.isEmpty() ? "0x" : " | 0x") + QString::number(flags, 16);
+			break;
+		}
+
+		res += (res.isEmpty() ? "" : " | ") + QString(pvalue -> value_nick);
+		flags &= ~pvalue -> value;
+	}
+
+	g_type_class_unref(pclass);
+	return res;
+}
+
+
+PacketTableModel::PacketTableModel(QSharedPointer<PacketIndex> pindex, QObject *parent):
+	QAbstractTableModel(parent),
+	m_pindex(pindex),
+	m_rows(qMin<qint64>(pindex -> size(), INT_MAX)),
+	m_pnal(NULL),
+	m_pvideo(NULL),
+	m_permuted(false),
+	m_sortColumn(-1),
+	m_sortOrder(Qt::AscendingOrder),
+	m_sortMemory(SORT_MEMORY)
+{
+}
+
+
+void PacketTableModel::update()
+{
+	qint64 rows = qMin<qint64>(m_pindex -> size(), INT_MAX);
+	if(rows <= m_rows)
+		return;
+
+	if(m_permuted)
+	{
+		m_rows = rows;
+		return;
+	}
+
+	beginInsertRows(QModelIndex(), m_rows, rows - 1);
+	m_rows = rows;
+	endInsertRows();
+}
+
+
+qint64 PacketTableModel::packetRow(int row) const
+{
+	if(row < 0 || row >= rowCount())
+		return -1;
+
+	return m_permuted ? m_order.at(row) : row;
+}
+
+
+int PacketTableModel::rowOfPacket(qint64 packet) const
+{
+	if(!m_permuted)
+		return packet < rowCount() ? (int) packet : -1;
+
+	// a table that is only filtered keeps the packet order
+	if(m_sortColumn < 0 || m_sortColumn >= ColumnCount)
+	{
+		qint64 row = lowerBound(m_order, packet, packetOfOrder);
+		return row < m_order.size() && m_order.at(row) == packet ? (int) row : -1;
+	}
+
+	qint64 i = lowerBound(m_inverse, packet, packetOfInverse);
+	if(i >= m_inverse.size())
+		return -1;
+
+	SortKey pair = m_inverse.at(i);
+	return (qint64) pair.key == packet ? (int) pair.row : -1;
+}
+
+
+void PacketTableModel::setSelection(const Selection &selection)
+{
+	m_selection = selection;
+	sort(m_sortColumn, m_sortOrder);
+}
+
+
+Selection PacketTableModel::selection() const
+{
+	return m_selection;
+}
+
+
+void PacketTableModel::setNalAnalyzer(NalAnalyzer *panalyzer)
+{
+	m_pnal = panalyzer;
+	connect(m_pnal, SIGNAL(finished()), SLOT(slotNalFinished()));
+}
+
+
+void PacketTableModel::slotNalFinished()
+{
+	if(rowCount() > 0)
+		emit dataChanged(index(0, ColumnFrame), index(rowCount() - 1, ColumnFrame));
+}
+
+
+void PacketTableModel::setVideoAnalytics(VideoAnalytics *panalytics)
+{
+	m_pvideo = panalytics;
+	connect(m_pvideo, SIGNAL(finished()), SLOT(slotVideoFinished()));
+}
+
+
+void PacketTableModel::slotVideoFinished()
+{
+	if(rowCount() > 0)
+		emit dataChanged(index(0, ColumnLuma), index(rowCount() - 1, ColumnDifference));
+}
+
+
+quint64 PacketTableModel::frameKey(qint64 packet, const PacketRecord &record) const
+{
+	if(!m_pnal || record.payloadType != GST_DP_PAYLOAD_BUFFER)
+		return 0;
+
+	// keyframes first, then by slice types
+	NalRecord nal = m_pnal -> record(packet);
+	return (nal.flags & NalRecord::Keyframe ? 0 : 8) + nal.sliceTypes;
+}
+
+
+QString PacketTableModel::frameText(qint64 packet, const PacketRecord &record) const
+{
+	if(!m_pnal || record.payloadType != GST_DP_PAYLOAD_BUFFER)
+		return QString();
+
+	NalRecord nal = m_pnal -> record(packet);
+	QString res = NalParser::frameType(nal);
+
+	if(NalParser::isDeltaMismatch(nal, record.bufferFlags))
+		res += record.bufferFlags & GST_BUFFER_FLAG_DELTA_UNIT ? " (DELTA_UNIT set)" : " (DELTA_UNIT not set)";
+	if(nal.flags & NalRecord::Corrupt)
+		res += " (corrupt)";
+
+	return res;
+}
+
+
+quint64 PacketTableModel::videoKey(qint64 packet, int column) const
+{
+	qint64 frame = m_pvideo ? m_pvideo -> frameOfPacket(packet) : -1;
+	if(frame < 0)
+		return 0;
+
+	// thousandths keep the order of the float values
+	const VideoAnalytics::Frame &stats = m_pvideo -> frame(frame);
+	float value = column == ColumnLuma ? stats.mean : (column == ColumnLumaVariance ? stats.variance : stats.difference);
+	return value > 0 ? (quint64) (value * 1000) + 1 : 0;
+}
+
+
+QString PacketTableModel::videoText(qint64 packet, int column) const
+{
+	qint64 frame = m_pvideo ? m_pvideo -> frameOfPacket(packet) : -1;
+	if(frame < 0)
+		return QString();
+
+	const VideoAnalytics::Frame &stats = m_pvideo -> frame(frame);
+
+	if(column == ColumnLuma)
+	{
+		QString res = QString::number(stats.mean, 'f', 1);
+		if(stats.flags & VideoAnalytics::Black)
+			res += " black";
+		if(stats.flags & VideoAnalytics::Jump)
+			res += " jump";
+		return res;
+	}
+	else if(column == ColumnLumaVariance)
+		return QString::number(stats.variance, 'f', 1);
+	else if(stats.difference < 0)
+		return QString();
+
+	QString res = QString::number(stats.difference, 'f', 2);
+	if(stats.flags & VideoAnalytics::Frozen)
+		res += " frozen";
+	return res;
+}
+
+
+int PacketTableModel::rowCount(const QModelIndex &parent) const
+{
+	if(parent.isValid())
+		return 0;
+
+	if(m_permuted)
+		return (int) m_order.size();
+
+	return (int) m_rows;
+}
+
+
+int PacketTableModel::columnCount(const QModelIndex &parent) const
+{
+	if(parent.isValid())
+		return 0;
+
+	return ColumnCount;
+}
+
+
+QVariant PacketTableModel::data(const QModelIndex &index, int role) const
+{
+	if(!index.isValid())
+		return QVariant();
+
+	if(role == Qt::TextAlignmentRole && index.column() != ColumnType && index.column() != ColumnFlags && index.column() != ColumnFrame)
+		return QVariant(Qt::AlignRight | Qt::AlignVCenter);
+
+	if(role != Qt::DisplayRole)
+		return QVariant();
+
+	qint64 packet = packetRow(index.row());
+	if(packet < 0)
+		return QVariant();
+
+	if(index.column() == ColumnFrame)
+		return frameText(packet, m_pindex -> at(packet));
+	else if(index.column() >= ColumnLuma && index.column() <= ColumnDifference)
+		return videoText(packet, index.column());
+
+	return text(m_pindex -> at(packet), index.column());
+}
+
+
+QVariant PacketTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+	if(orientation != Qt::Horizontal || role != Qt::DisplayRole)
+		return QAbstractTableModel::headerData(section, orientation, role);
+
+	switch(section)
+	{
+		case ColumnType: return "Type";
+		case ColumnPts: return "PTS";
+		case ColumnDuration: return "Duration";
+		case ColumnRunningTime: return "Running time";
+		case ColumnStreamTime: return "Stream time";
+		case ColumnSize: return "Size";
+		case ColumnOffset: return "Offset";
+		case ColumnOffsetEnd: return "Offset end";
+		case ColumnFlags: return "Flags";
+		case ColumnFrame: return "Frame";
+		case ColumnLuma: return "Luma";
+		case ColumnLumaVariance: return "Luma variance";
+		case ColumnDifference: return "Difference";
+		case ColumnFilePos: return "File offset";
+		case ColumnCrc: return "CRC";
+	}
+
+	return QVariant();
+}
+
+
+void PacketTableModel::sort(int column, Qt::SortOrder order)
+{
+	beginResetModel();
+
+	m_sortColumn = column;
+	m_sortOrder = order;
+	m_order.close();
+	m_inverse.close();
+
+	const bool sorted = column >= 0 && column < ColumnCount;
+	const bool filtered = !m_selection.isEmpty();
+	const bool descending = order == Qt::DescendingOrder;
+	QString error;
+
+	if(sorted || filtered)
+	{
+		const qint64 keys = filtered ? m_selection.count() : m_rows;
+
+		// keys and the scratch of the radix sort, and for a filtered table
+		// the packet of each rank
+		const qint64 keyBytes = 2 * sizeof(SortKey) + (filtered ? sizeof(qint64) : 0);
+
+		bool res;
+		if(!m_order.open() || (sorted && !m_inverse.open()))
+			res = false;
+		else if(!sorted)
+			res = filterRows();
+		else if(keys * keyBytes <= m_sortMemory && keys <= INT_MAX / (qint64) sizeof(SortKey))
+			res = sortInMemory(column, descending);
+		else
+			res = sortOnDisk(column, descending);
+
+		if(!res)
+		{
+			error = "Problem with writing the table order to `" + QDir::tempPath() + "`, the rows are shown unsorted";
+			m_order.close();
+			m_inverse.close();
+		}
+	}
+
+	m_permuted = (sorted || filtered) && error.isEmpty();
+
+	endResetModel();
+
+	if(!error.isEmpty())
+		emit sortFailed(error);
+}
+
+
+void PacketTableModel::setSortMemory(qint64 bytes)
+{
+	m_sortMemory = bytes;
+}
+
+
+// the rows come in index order, which is the order wanted when only
+// filtering
+bool PacketTableModel::filterRows()
+{
+	QVector<qint64> rows;
+	rows.reserve(READ_CHUNK);
+
+	for(qint64 first = 0; first < m_rows; first += READ_CHUNK)
+	{
+		qint64 last = qMin<qint64>(m_rows, first + READ_CHUNK);
+		for(qint64 row = first; row < last; row++)
+		{
+			if(m_selection.contains(row))
+				rows.append(row);
+		}
+
+		if(!m_order.append(rows.constData(), rows.size()))
+			return false;
+		rows.clear();
+	}
+
+	return true;
+}
+
+
+// keys of the selected rows among the READ_CHUNK rows from <first>, with the
+// packet in .row
+int PacketTableModel::chunkKeys(qint64 first, int column, PacketRecord *precords, PacketSortKey *pkeys) const
+{
+	const bool filtered = !m_selection.isEmpty();
+	qint64 count = m_pindex -> read(first, qMin<qint64>(READ_CHUNK, m_rows - first), precords);
+	int keys = 0;
+
+	for(int i = 0; i < count; i++)
+	{
+		if(filtered && !m_selection.contains(first + i))
+			continue;
+
+		SortKey &sortKey = pkeys[keys++];
+		if(column == ColumnFrame)
+			sortKey.key = frameKey(first + i, precords[i]);
+		else if(column >= ColumnLuma && column <= ColumnDifference)
+			sortKey.key = videoKey(first + i, column);
+		else
+			sortKey.key = key(precords[i], column);
+		sortKey.row = first + i;
+	}
+
+	return keys;
+}
+
+
+// Keys carry the rank of their row among the selected rows and are radix
+// sorted, which keeps equal keys in packet order. The scratch half of the
+// sort then takes the inverse, each entry scattered to the slot of its rank.
+bool PacketTableModel::sortInMemory(int column, bool descending)
+{
+	const bool filtered = !m_selection.isEmpty();
+	const qint64 size = filtered ? m_selection.count() : m_rows;
+
+	QVector<SortKey> keys(size);
+	QVector<SortKey> scratch(size);
+	QVector<qint64> packets(filtered ? size : 0);
+
+	QVector<PacketRecord> records(READ_CHUNK);
+	SortKey *pkeys = keys.data();
+	qint64 *ppackets = packets.data();
+	qint64 count = 0;
+	quint64 low = ~Q_UINT64_C(0);
+	quint64 high = 0;
+
+	for(qint64 first = 0; first < m_rows && count < size; first += READ_CHUNK)
+	{
+		int n = chunkKeys(first, column, records.data(), pkeys + count);
+		for(int i = 0; i < n; i++)
+		{
+			SortKey &sortKey = pkeys[count + i];
+			low = qMin(low, sortKey.key);
+			high = qMax(high, sortKey.key);
+			if(filtered)
+			{
+				ppackets[count + i] = sortKey.row;
+				sortKey.row = count + i;
+			}
+		}
+		count += n;
+	}
+
+	if(!count)
+		return true;
+
+	// descending keys are flipped, so both directions sort up
+	for(qint64 i = 0; i < count; i++)
+		pkeys[i].key = descending ? high - pkeys[i].key : pkeys[i].key - low;
+
+	SortKey *psorted = radixSort(pkeys, scratch.data(), count, high - low);
+	SortKey *pinverse = psorted == pkeys ? scratch.data() : pkeys;
+	QVector<qint64> rows(READ_CHUNK);
+
+	for(qint64 first = 0; first < count; first += READ_CHUNK)
+	{
+		int n = (int) qMin<qint64>(READ_CHUNK, count - first);
+		for(int i = 0; i < n; i++)
+		{
+			qint64 rank = psorted[first + i].row;
+			rows[i] = filtered ? ppackets[rank] : rank;
+			pinverse[rank].key = rows[i];
+			pinverse[rank].row = first + i;
+		}
+
+		if(!m_order.append(rows.constData(), n))
+			return false;
+	}
+
+	return m_inverse.append(pinverse, count);
+}
+
+
+bool PacketTableModel::sortOnDisk(int column, bool descending)
+{
+	const int runKeys = (int) qBound<qint64>(READ_CHUNK, m_sortMemory / sizeof(SortKey), INT_MAX / sizeof(SortKey));
+	RunSorter sorter(descending, runKeys);
+
+	QVector<PacketRecord> records(READ_CHUNK);
+	QVector<SortKey> chunk(READ_CHUNK);
+
+	for(qint64 first = 0; first < m_rows; first += READ_CHUNK)
+	{
+		int count = chunkKeys(first, column, records.data(), chunk.data());
+		if(!sorter.add(chunk.constData(), count))
+			return false;
+	}
+
+	if(!sorter.start())
+		return false;
+
+	// the inverse is sorted the same way, by packet
+	RunSorter inverse(false, runKeys);
+	QVector<qint64> rows(READ_CHUNK);
+	SortKey sortKey;
+	qint64 row = 0;
+	int count = 0;
+
+	for(bool more = true; more;)
+	{
+		more = sorter.next(&sortKey);
+		if(more)
+		{
+			chunk[count].key = sortKey.row;
+			chunk[count].row = row++;
+			rows[count++] = sortKey.row;
+		}
+
+		if(count == READ_CHUNK || (!more && count))
+		{
+			if(!m_order.append(rows.constData(), count) || !inverse.add(chunk.constData(), count))
+				return false;
+			count = 0;
+		}
+	}
+
+	if(!inverse.start())
+		return false;
+
+	while(inverse.next(&sortKey))
+	{
+		chunk[count++] = sortKey;
+		if(count == READ_CHUNK)
+		{
+			if(!m_inverse.append(chunk.constData(), count))
+				return false;
+			count = 0;
+		}
+	}
+
+	return m_inverse.append(chunk.constData(), count);
+}
+
+
+quint64 PacketTableModel::key(const PacketRecord &record, int column)
+{
+	switch(column)
+	{
+		case ColumnType: return record.payloadType;
+		case ColumnPts: return record.timestamp;
+		case ColumnDuration: return record.duration;
+		case ColumnRunningTime: return record.runningTime;
+		case ColumnStreamTime: return record.streamTime;
+		case ColumnSize: return record.payloadLength;
+		case ColumnOffset: return record.offset;
+		case ColumnOffsetEnd: return record.offsetEnd;
+		case ColumnFlags: return record.bufferFlags;
+		case ColumnFilePos: return record.filePos;
+		case ColumnCrc: return record.headerFlags & GST_DP_HEADER_FLAG_CRC;
+	}
+
+	return 0;
+}
+
+
+QString PacketTableModel::text(const PacketRecord &record, int column)
+{
+	bool buffer = record.payloadType == GST_DP_PAYLOAD_BUFFER;
+
+	switch(column)
+	{
+		case ColumnType:
+			if(buffer)
+				return "buffer";
+			else if(record.payloadType == GST_DP_PAYLOAD_CAPS)
+				return "caps";
+			return gst_event_type_get_name((GstEventType) (record.payloadType - GST_DP_PAYLOAD_EVENT_NONE));
+		case ColumnPts:
+			return buffer ? ClockTime::toString(record.timestamp) : QString();
+		case ColumnDuration:
+			return buffer ? ClockTime::toString(record.duration) : QString();
+		case ColumnRunningTime:
+			return buffer ? ClockTime::toString(record.runningTime) : QString();
+		case ColumnStreamTime:
+			return buffer ? ClockTime::toString(record.streamTime) : QString();
+		case ColumnSize:
+			return QString::number(record.payloadLength);
+		case ColumnOffset:
+			return buffer && record.offset != GST_BUFFER_OFFSET_NONE ? QString::number(record.offset) : QString();
+		case ColumnOffsetEnd:
+			return buffer && record.offsetEnd != GST_BUFFER_OFFSET_NONE ? QString::number(record.offsetEnd) : QString();
+		case ColumnFlags:
+			return buffer ? bufferFlags(record.bufferFlags) : QString();
+		case ColumnFilePos:
+			return QString::number(record.filePos);
+		case ColumnCrc:
+		{
+			// packets whose CRCs do not match are not indexed
+			QStringList checked;
+			if(record.headerFlags & GST_DP_HEADER_FLAG_CRC_HEADER)
+				checked << "header";
+			if(record.headerFlags & GST_DP_HEADER_FLAG_CRC_PAYLOAD)
+				checked << "payload";
+			return checked.isEmpty() ? QString("none") : "ok (" + checked.join(", ") + ")";
+		}
+	}
+
+	return QString();
+}
@@ -0,0 +1,110 @@
+#ifndef PACKET_TABLE_MODEL_H_
+#define PACKET_TABLE_MODEL_H_
+
+#include <QAbstractTableModel>
+#include <QSharedPointer>
+#include <QVector>
+
+#include "PacketIndex.h"
+#include "PagedArray.h"
+#include "Selection.h"
+
+class NalAnalyzer;
+class VideoAnalytics;
+
+struct PacketSortKey
+{
+	quint64 key;
+	qint64 row;
+};
+
+// Flat table of the packets of a PacketIndex, one typed column per record
+// field. Sorting builds a permutation of the rows from the raw column values,
+// radix sorted in memory when the keys fit the sort memory and otherwise in
+// runs sorted with parallelSort() and merged from disk, and keeps it with its
+// inverse in paged arrays; rows are read from the index through it. When the permutation can
+// not be written, the rows are shown unsorted and sortFailed() is emitted.
+// A selection set by a filter limits the table to its rows. Packets appended
+// to the index later are shown on update(), or with the next sort when the
+// rows are permuted.
+class PacketTableModel: public QAbstractTableModel
+{
+	Q_OBJECT
+	public:
+		enum Column
+		{
+			ColumnType,
+			ColumnPts,
+			ColumnDuration,
+			ColumnRunningTime,
+			ColumnStreamTime,
+			ColumnSize,
+			ColumnOffset,
+			ColumnOffsetEnd,
+			ColumnFlags,
+			ColumnFrame,
+			ColumnLuma,
+			ColumnLumaVariance,
+			ColumnDifference,
+			ColumnFilePos,
+			ColumnCrc,
+			ColumnCount
+		};
+
+		PacketTableModel(QSharedPointer<PacketIndex> pindex, QObject *parent = 0);
+
+		qint64 packetRow(int row) const;
+		int rowOfPacket(qint64 packet) const;
+
+		void setSelection(const Selection &selection);
+		Selection selection() const;
+
+		void setNalAnalyzer(NalAnalyzer *panalyzer);
+		void setVideoAnalytics(VideoAnalytics *panalytics);
+		void setSortMemory(qint64 bytes);
+		void update();
+
+		virtual int rowCount(const QModelIndex &parent = QModelIndex()) const;
+		virtual int columnCount(const QModelIndex &parent = QModelIndex()) const;
+		virtual QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+		virtual QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+		virtual void sort(int column, Qt::SortOrder order = Qt::AscendingOrder);
+
+		static quint64 key(const PacketRecord &record, int column);
+		static QString text(const PacketRecord &record, int column);
+
+	signals:
+		void sortFailed(const QString &message);
+
+	private slots:
+		void slotNalFinished();
+		void slotVideoFinished();
+
+	private:
+		bool filterRows();
+		int chunkKeys(qint64 first, int column, PacketRecord *precords, PacketSortKey *pkeys) const;
+		bool sortInMemory(int column, bool descending);
+		bool sortOnDisk(int column, bool descending);
+
+		quint64 frameKey(qint64 packet, const PacketRecord &record) const;
+		QString frameText(qint64 packet, const PacketRecord &record) const;
+		quint64 videoKey(qint64 packet, int column) const;
+		QString videoText(qint64 packet, int column) const;
+
+		QSharedPointer<PacketIndex> m_pindex;
+		qint64 m_rows;
+		NalAnalyzer *m_pnal;
+		VideoAnalytics *m_pvideo;
+		Selection m_selection;
+		// table row to packet, and for sorted tables packet to table row
+		// pairs ordered by packet
+		PagedArray<qint64> m_order;
+		PagedArray<PacketSortKey> m_inverse;
+		bool m_permuted;
+		int m_sortColumn;
+		Qt::SortOrder m_sortOrder;
+		qint64 m_sortMemory;
+};
+
+
+#endif
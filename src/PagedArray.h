@@ -0,0 +1,347 @@
+#ifndef PAGED_ARRAY_H_
+#define PAGED_ARRAY_H_
+
+#include <QTemporaryFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QVector>
+#include <QString>
+#include <QDir>
+
+#include <cstring>
+
+// Array of fixed-size records stored in a temporary file and accessed through
+// a bounded set of memory-mapped pages, so that its resident size does not
+// depend on the number of records.
+template <typename T>
+class PagedArray
+{
+	public:
+		explicit PagedArray(qint64 recordsPerPage = 65536);
+		~PagedArray();
+
+		bool open(const QString &dir = QDir::tempPath());
+		void close();
+		bool isOpen() const;
+
+		qint64 size() const;
+		qint64 pageBytes() const;
+		void setMaxMappedBytes(qint64 bytes);
+
+		bool append(const T &value);
+		bool append(const T *values, qint64 count);
+		bool extend(qint64 count);
+		T at(qint64 i) const;
+		void set(qint64 i, const T &value);
+		qint64 read(qint64 first, qint64 count, T *out) const;
+		qint64 write(qint64 first, qint64 count, const T *values);
+
+	private:
+		Q_DISABLE_COPY(PagedArray)
+
+		struct Page
+		{
+			qint64 number;
+			uchar *data;
+			quint64 lastUse;
+		};
+
+		uchar *page(qint64 number) const;
+		void unmapAll();
+
+		mutable QMutex m_mutex;
+		mutable QTemporaryFile m_file;
+		mutable QVector<Page> m_pages;
+		mutable quint64 m_useCounter;
+		qint64 m_recordsPerPage;
+		qint64 m_size;
+		qint64 m_capacity;
+		int m_maxPages;
+};
+
+
+template <typename T>
+PagedArray<T>::PagedArray(qint64 recordsPerPage):
+	m_useCounter(0),
+	m_recordsPerPage(recordsPerPage),
+	m_size(0),
+	m_capacity(0),
+	m_maxPages(16)
+{
+}
+
+
+template <typename T>
+PagedArray<T>::~PagedArray()
+{
+	close();
+}
+
+
+template <typename T>
+bool PagedArray<T>::open(const QString &dir)
+{
+	QMutexLocker locker(&m_mutex);
+
+	unmapAll();
+	m_file.close();
+	m_size = 0;
+	m_capacity = 0;
+
+	m_file.setFileTemplate(dir + "/gdpviewer-XXXXXX.idx");
+	return m_file.open();
+}
+
+
+template <typename T>
+void PagedArray<T>::close()
+{
+	QMutexLocker locker(&m_mutex);
+
+	unmapAll();
+	m_file.close();
+	m_size = 0;
+	m_capacity = 0;
+}
+
+
+template <typename T>
+bool PagedArray<T>::isOpen() const
+{
+	return m_file.isOpen();
+}
+
+
+template <typename T>
+qint64 PagedArray<T>::size() const
+{
+	QMutexLocker locker(&m_mutex);
+	return m_size;
+}
+
+
+template <typename T>
+qint64 PagedArray<T>::pageBytes() const
+{
+	return m_recordsPerPage * (qint64) sizeof(T);
+}
+
+
+template <typename T>
+void PagedArray<T>::setMaxMappedBytes(qint64 bytes)
+{
+	QMutexLocker locker(&m_mutex);
+
+	m_maxPages = qMax<qint64>(2, bytes / pageBytes());
+
+	while(m_pages.size() > m_maxPages)
+	{
+		m_file.unmap(m_pages.last().data);
+		m_pages.pop_back();
+	}
+}
+
+
+template <typename T>
+bool PagedArray<T>::append(const T &value)
+{
+	QMutexLocker locker(&m_mutex);
+
+	if(m_size == m_capacity)
+	{
+		if(!m_file.resize((m_capacity + m_recordsPerPage) * sizeof(T)))
+			return false;
+		m_capacity += m_recordsPerPage;
+	}
+
+	uchar *pdata = page(m_size / m_recordsPerPage);
+	if(!pdata)
+		return false;
+
+	memcpy(pdata + (m_size % m_recordsPerPage) * sizeof(T), &value, sizeof(T));
+	m_size++;
+
+	return true;
+}
+
+
+template <typename T>
+bool PagedArray<T>::append(const T *values, qint64 count)
+{
+	QMutexLocker locker(&m_mutex);
+
+	if(m_size + count > m_capacity)
+	{
+		qint64 capacity = (m_size + count + m_recordsPerPage - 1) / m_recordsPerPage * m_recordsPerPage;
+		if(!m_file.resize(capacity * sizeof(T)))
+			return false;
+		m_capacity = capacity;
+	}
+
+	qint64 done = 0;
+	while(done < count)
+	{
+		qint64 i = m_size + done;
+		qint64 inPage = i % m_recordsPerPage;
+		qint64 n = qMin(count - done, m_recordsPerPage - inPage);
+
+		uchar *pdata = page(i / m_recordsPerPage);
+		if(!pdata)
+			return false;
+
+		memcpy(pdata + inPage * sizeof(T), values + done, n * sizeof(T));
+		done += n;
+	}
+
+	m_size += count;
+	return true;
+}
+
+
+// adds <count> zeroed records, without writing them
+template <typename T>
+bool PagedArray<T>::extend(qint64 count)
+{
+	QMutexLocker locker(&m_mutex);
+
+	if(m_size + count > m_capacity)
+	{
+		qint64 capacity = (m_size + count + m_recordsPerPage - 1) / m_recordsPerPage * m_recordsPerPage;
+		if(!m_file.resize(capacity * sizeof(T)))
+			return false;
+		m_capacity = capacity;
+	}
+
+	m_size += count;
+	return true;
+}
+
+
+template <typename T>
+T PagedArray<T>::at(qint64 i) const
+{
+	T value;
+	memset(&value, 0, sizeof(T));
+	read(i, 1, &value);
+
+	return value;
+}
+
+
+template <typename T>
+void PagedArray<T>::set(qint64 i, const T &value)
+{
+	QMutexLocker locker(&m_mutex);
+
+	if(i < 0 || i >= m_size)
+		return;
+
+	uchar *pdata = page(i / m_recordsPerPage);
+	if(pdata)
+		memcpy(pdata + (i % m_recordsPerPage) * sizeof(T), &value, sizeof(T));
+}
+
+
+template <typename T>
+qint64 PagedArray<T>::read(qint64 first, qint64 count, T *out) const
+{
+	QMutexLocker locker(&m_mutex);
+
+	if(first < 0 || first >= m_size)
+		return 0;
+
+	count = qMin(count, m_size - first);
+
+	qint64 done = 0;
+	while(done < count)
+	{
+		qint64 i = first + done;
+		qint64 inPage = i % m_recordsPerPage;
+		qint64 n = qMin(count - done, m_recordsPerPage - inPage);
+
+		uchar *pdata = page(i / m_recordsPerPage);
+		if(!pdata)
+			break;
+
+		memcpy(out + done, pdata + inPage * sizeof(T), n * sizeof(T));
+		done += n;
+	}
+
+	return done;
+}
+
+
+template <typename T>
+qint64 PagedArray<T>::write(qint64 first, qint64 count, const T *values)
+{
+	QMutexLocker locker(&m_mutex);
+
+	if(first < 0 || first >= m_size)
+		return 0;
+
+	count = qMin(count, m_size - first);
+
+	qint64 done = 0;
+	while(done < count)
+	{
+		qint64 i = first + done;
+		qint64 inPage = i % m_recordsPerPage;
+		qint64 n = qMin(count - done, m_recordsPerPage - inPage);
+
+		uchar *pdata = page(i / m_recordsPerPage);
+		if(!pdata)
+			break;
+
+		memcpy(pdata + inPage * sizeof(T), values + done, n * sizeof(T));
+		done += n;
+	}
+
+	return done;
+}
+
+
+template <typename T>
+uchar *PagedArray<T>::page(qint64 number) const
+{
+	int lru = -1;
+	for(int i = 0; i < m_pages.size(); i++)
+	{
+		if(m_pages[i].number == number)
+		{
+			m_pages[i].lastUse = ++m_useCounter;
+			return m_pages[i].data;
+		}
+
+		if(lru < 0 || m_pages[i].lastUse < m_pages[lru].lastUse)
+			lru = i;
+	}
+
+	if(m_pages.size() >= m_maxPages && lru >= 0)
+	{
+		m_file.unmap(m_pages[lru].data);
+		m_pages.remove(lru);
+	}
+
+	Page p;
+	p.number = number;
+	p.data = m_file.map(number * pageBytes(), pageBytes());
+	p.lastUse = ++m_useCounter;
+
+	if(!p.data)
+		return NULL;
+
+	m_pages.append(p);
+	return p.data;
+}
+
+
+template <typename T>
+void PagedArray<T>::unmapAll()
+{
+	for(int i = 0; i < m_pages.size(); i++)
+		m_file.unmap(m_pages[i].data);
+	m_pages.clear();
+}
+
+
+#endif
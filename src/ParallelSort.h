@@ -0,0 +1,79 @@
+#ifndef PARALLEL_SORT_H_
+#define PARALLEL_SORT_H_
+
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include <QVector>
+
+#include <algorithm>
+
+template <typename T, typename Less>
+class SortTask: public QRunnable
+{
+	public:
+		SortTask(T *pfirst, T *pmiddle, T *plast, Less less):
+			m_pfirst(pfirst),
+			m_pmiddle(pmiddle),
+			m_plast(plast),
+			m_less(less)
+		{
+		}
+
+		virtual void run()
+		{
+			if(m_pmiddle)
+				std::inplace_merge(m_pfirst, m_pmiddle, m_plast, m_less);
+			else
+				std::sort(m_pfirst, m_plast, m_less);
+		}
+
+	private:
+		T *m_pfirst;
+		T *m_pmiddle;
+		T *m_plast;
+		Less m_less;
+};
+
+
+// Sorts [pfirst, plast) by sorting one part per thread and merging the parts
+// pairwise, the merges of a round running in parallel as well. Not stable.
+template <typename T, typename Less>
+void parallelSort(T *pfirst, T *plast, Less less)
+{
+	// parts smaller than this sort faster than a thread starts
+	const qint64 MIN_PART = 64 * 1024;
+
+	const qint64 size = plast - pfirst;
+
+	int parts = 1;
+	while(parts * 2 <= QThread::idealThreadCount() && size / (parts * 2) >= MIN_PART)
+		parts *= 2;
+
+	if(parts == 1)
+	{
+		std::sort(pfirst, plast, less);
+		return;
+	}
+
+	QVector<T *> bounds(parts + 1);
+	for(int i = 0; i <= parts; i++)
+		bounds[i] = pfirst + size * i / parts;
+
+	QThreadPool pool;
+	pool.setMaxThreadCount(parts);
+
+	for(int i = 0; i < parts; i++)
+		pool.start(new SortTask<T, Less>(bounds[i], NULL, bounds[i + 1], less));
+	pool.waitForDone();
+
+	for(int width = 1; width < parts; width *= 2)
+	{
+		for(int i = 0; i + width < parts; i += 2 * width)
+			pool.start(new SortTask<T, Less>(bounds[i], bounds[i + width], bounds[qMin(i + 2 * width, parts)], less));
+		pool.waitForDone();
+	}
+}
+
+
+#endif
@@ -0,0 +1,585 @@
+#include "Replayer.h"
+#include "PacketIndex.h"
+#include "GdpFile.h"
+#include "GdpArchive.h"
+#include "dataprotocol.h"
+
+#include <QRunnable>
+#include <QMutexLocker>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QFile>
+#include <QVector>
+
+#include <gst/app/gstappsrc.h>
+
+#include <cstring>
+
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// records read from the index at a time
+static const int BATCH_SIZE = 4096;
+
+// bytes of buffers queued in appsrc before pushing blocks
+static const guint64 QUEUE_BYTES = 16 * 1024 * 1024;
+
+// longest sleep while waiting for a buffer's time, so stop() is seen quickly
+static const qint64 MAX_SLEEP = 10 * 1000 * 1000;
+
+namespace
+{
+	// Mapping of a part of the dump, referenced by the replay thread while it
+	// reads from it and by every pushed buffer wrapping its memory.
+	struct Window
+	{
+		QAtomicInt refs;
+		uchar *pdata;
+		qint64 pos;
+		qint64 length;
+	};
+
+	void releaseWindow(gpointer data)
+	{
+		Window *pwindow = (Window *) data;
+		if(!pwindow -> refs.deref())
+		{
+			munmap(pwindow -> pdata, pwindow -> length);
+			delete pwindow;
+		}
+	}
+
+	class WindowMapper
+	{
+		public:
+			WindowMapper(int fd, qint64 fileSize, qint64 windowSize):
+				m_fd(fd),
+				m_fileSize(fileSize),
+				m_windowSize(windowSize),
+				m_pwindow(NULL)
+			{
+			}
+
+			~WindowMapper()
+			{
+				if(m_pwindow)
+					releaseWindow(m_pwindow);
+			}
+
+			Window *window() const
+			{
+				return m_pwindow;
+			}
+
+			const guint8 *data(qint64 pos, qint64 length)
+			{
+				if(pos < 0 || length < 0 || pos + length > m_fileSize)
+					return NULL;
+
+				if(!m_pwindow || pos < m_pwindow -> pos || pos + length > m_pwindow -> pos + m_pwindow -> length)
+				{
+					if(m_pwindow)
+						releaseWindow(m_pwindow);
+					m_pwindow = NULL;
+
+					qint64 page = sysconf(_SC_PAGESIZE);
+					qint64 start = pos - pos % page;
+					qint64 size = qMin(qMax(m_windowSize, pos + length - start), m_fileSize - start);
+
+					void *pdata = mmap(NULL, size, PROT_READ, MAP_SHARED, m_fd, start);
+					if(pdata == MAP_FAILED)
+						return NULL;
+
+					// the window is read front to back, and the next one right after
+					madvise(pdata, size, MADV_SEQUENTIAL);
+					madvise(pdata, size, MADV_WILLNEED);
+#ifdef POSIX_FADV_WILLNEED
+					posix_fadvise(m_fd, start + size, m_windowSize, POSIX_FADV_WILLNEED);
+#endif
+
+					m_pwindow = new Window;
+					m_pwindow -> refs.store(1);
+					m_pwindow -> pdata = (uchar *) pdata;
+					m_pwindow -> pos = start;
+					m_pwindow -> length = size;
+				}
+
+				return m_pwindow -> pdata + (pos - m_pwindow -> pos);
+			}
+
+		private:
+			int m_fd;
+			qint64 m_fileSize;
+			qint64 m_windowSize;
+			Window *m_pwindow;
+	};
+}
+
+
+class ReplayTask: public QRunnable
+{
+	public:
+		ReplayTask(Replayer *preplayer, GstElement *ppipeline, qint64 first, qint64 last):
+			m_preplayer(preplayer),
+			m_ppipeline(ppipeline),
+			m_first(first),
+			m_last(last)
+		{
+		}
+
+		virtual void run()
+		{
+			m_preplayer -> replay(m_ppipeline, m_first, m_last);
+		}
+
+	private:
+		Replayer *m_preplayer;
+		GstElement *m_ppipeline;
+		qint64 m_first;
+		qint64 m_last;
+};
+
+
+double Replayer::Report::throughput() const
+{
+	return elapsed > 0 ? bytes * 1e9 / elapsed : 0;
+}
+
+
+Replayer::Replayer(QSharedPointer<PacketIndex> pindex, const QString &fileName, QObject *parent):
+	QObject(parent),
+	m_pindex(pindex),
+	m_fileName(fileName),
+	m_windowSize(64 * 1024 * 1024),
+	m_pacing(AsFastAsPossible),
+	m_speed(1.0),
+	m_stopping(0),
+	m_running(0),
+	m_ppipeline(NULL),
+	m_failed(0),
+	m_eos(false),
+	m_basePts(GST_CLOCK_TIME_NONE),
+	m_baseTime(0),
+	m_lastPts(GST_CLOCK_TIME_NONE)
+{
+	memset(&m_report, 0, sizeof(m_report));
+	m_pool.setMaxThreadCount(1);
+}
+
+
+Replayer::~Replayer()
+{
+	stop();
+	wait();
+}
+
+
+void Replayer::setWindowSize(qint64 bytes)
+{
+	m_windowSize = bytes;
+}
+
+
+void Replayer::setPacing(Pacing pacing, double speed)
+{
+	m_pacing = pacing;
+	m_speed = pacing == Speed && speed > 0 ? speed : 1.0;
+}
+
+
+bool Replayer::start(const QString &pipeline, qint64 first, qint64 last)
+{
+	stop();
+	wait();
+
+	m_error.clear();
+	memset(&m_report, 0, sizeof(m_report));
+
+	if(last < 0 || last >= m_pindex -> size())
+		last = m_pindex -> size() - 1;
+
+	if(first < 0 || first > last)
+	{
+		m_error = "Nothing to replay";
+		return false;
+	}
+
+	QByteArray description = "appsrc name=replaysrc format=time ! " + pipeline.toUtf8();
+
+	GError *perror = NULL;
+	GstElement *ppipeline = gst_parse_launch(description.constData(), &perror);
+	if(perror)
+	{
+		m_error = QString::fromUtf8(perror -> message);
+		g_error_free(perror);
+		if(ppipeline)
+			gst_object_unref(ppipeline);
+		return false;
+	}
+
+	if(!ppipeline)
+	{
+		m_error = "Problem with creating pipeline `" + pipeline + "`";
+		return false;
+	}
+
+	m_stopping.store(0);
+	m_running.store(1);
+	m_failed.store(0);
+
+	{
+		QMutexLocker lock(&m_mutex);
+		m_ppipeline = ppipeline;
+		m_busError.clear();
+		m_eos = false;
+	}
+
+	m_pool.start(new ReplayTask(this, ppipeline, first, last));
+
+	return true;
+}
+
+
+void Replayer::stop()
+{
+	m_stopping.store(1);
+
+	// appsrc blocks pushes while its queue is full, until the pipeline
+	// takes data or flushes
+	GstElement *ppipeline = NULL;
+	{
+		QMutexLocker lock(&m_mutex);
+		if(m_ppipeline)
+			ppipeline = (GstElement *) gst_object_ref(m_ppipeline);
+		m_busDone.wakeAll();
+	}
+
+	if(ppipeline)
+	{
+		gst_element_set_state(ppipeline, GST_STATE_NULL);
+		gst_object_unref(ppipeline);
+	}
+}
+
+
+void Replayer::wait()
+{
+	m_pool.waitForDone();
+}
+
+
+bool Replayer::isRunning() const
+{
+	return m_running.load();
+}
+
+
+Replayer::Report Replayer::report() const
+{
+	QMutexLocker lock(&m_mutex);
+	return m_report;
+}
+
+
+QString Replayer::errorString() const
+{
+	QMutexLocker lock(&m_mutex);
+	return m_error;
+}
+
+
+GstBusSyncReply Replayer::busMessage(GstBus *pbus, GstMessage *pmsg, gpointer data)
+{
+	Q_UNUSED(pbus);
+	Replayer *preplayer = (Replayer *) data;
+
+	if(GST_MESSAGE_TYPE(pmsg) == GST_MESSAGE_ERROR || GST_MESSAGE_TYPE(pmsg) == GST_MESSAGE_EOS)
+	{
+		QMutexLocker lock(&preplayer -> m_mutex);
+		if(GST_MESSAGE_TYPE(pmsg) == GST_MESSAGE_ERROR)
+		{
+			GError *perror = NULL;
+			gst_message_parse_error(pmsg, &perror, NULL);
+			if(preplayer -> m_busError.isEmpty())
+				preplayer -> m_busError = QString::fromUtf8(perror -> message);
+			g_error_free(perror);
+			preplayer -> m_failed.store(1);
+		}
+		else
+			preplayer -> m_eos = true;
+
+		preplayer -> m_busDone.wakeAll();
+	}
+
+	// nobody pops the bus, so the bus drops the messages instead of keeping
+	// them
+	return GST_BUS_DROP;
+}
+
+
+qint64 Replayer::pace(guint64 timestamp, const QElapsedTimer &timer)
+{
+	if(m_pacing == AsFastAsPossible || !GST_CLOCK_TIME_IS_VALID(timestamp))
+		return -1;
+
+	if(!GST_CLOCK_TIME_IS_VALID(m_basePts))
+	{
+		m_basePts = timestamp;
+		m_lastPts = timestamp;
+		m_baseTime = timer.nsecsElapsed();
+		return -1;
+	}
+
+	// reordered frames go out with the frame before them
+	if(timestamp <= m_lastPts)
+		return -1;
+	m_lastPts = timestamp;
+
+	qint64 target = m_baseTime + (qint64) ((timestamp - m_basePts) / m_speed);
+	for(qint64 wait = target - timer.nsecsElapsed(); wait > 0 && !m_stopping.load(); wait = target - timer.nsecsElapsed())
+		QThread::usleep(qMin(wait, MAX_SLEEP) / 1000);
+
+	return target;
+}
+
+
+void Replayer::replay(GstElement *ppipeline, qint64 first, qint64 last)
+{
+	GstElement *psrc = gst_bin_get_by_name(GST_BIN(ppipeline), "replaysrc");
+	GstBus *pbus = gst_element_get_bus(ppipeline);
+	QString error;
+
+	g_object_set(psrc, "max-bytes", QUEUE_BYTES, "block", TRUE, NULL);
+
+	// without it appsrc ignores the segments of pushed samples
+	bool segments = g_object_class_find_property(G_OBJECT_GET_CLASS(psrc), "handle-segment-change");
+	if(segments)
+		g_object_set(psrc, "handle-segment-change", TRUE, NULL);
+
+	QFile file(m_fileName);
+	if(!file.open(QIODevice::ReadOnly))
+		error = "Problem with open file `" + m_fileName + "` for reading";
+
+	WindowMapper mapper(file.handle(), file.size(), m_windowSize);
+
+	// archives are decompressed into a window of their own, so their
+	// payloads are copied
+	GdpFile archive;
+	if(GdpArchive::isArchive(m_fileName) && !archive.open(m_fileName))
+		error = "Problem with open archive `" + m_fileName + "`";
+	archive.setWindowSize(m_windowSize);
+
+	GstSegment segment;
+	gst_segment_init(&segment, GST_FORMAT_TIME);
+	bool haveSegment = false;
+
+	m_basePts = GST_CLOCK_TIME_NONE;
+	m_lastPts = GST_CLOCK_TIME_NONE;
+
+	Report report;
+	memset(&report, 0, sizeof(report));
+	qint64 jitterSum = 0;
+	qint64 paced = 0;
+	bool done = false;
+
+	QElapsedTimer timer;
+	timer.start();
+
+	gst_bus_set_sync_handler(pbus, busMessage, this, NULL);
+
+	if(error.isEmpty() && gst_element_set_state(ppipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE)
+		error = "Problem with starting the pipeline";
+
+	QVector<PacketRecord> records(BATCH_SIZE);
+	for(qint64 row = first; error.isEmpty() && !done && row <= last && !m_stopping.load() && !m_failed.load(); row += BATCH_SIZE)
+	{
+		qint64 count = m_pindex -> read(row, qMin<qint64>(BATCH_SIZE, last - row + 1), records.data());
+
+		for(qint64 i = 0; i < count && error.isEmpty() && !done && !m_stopping.load() && !m_failed.load(); i++)
+		{
+			const PacketRecord &record = records[i];
+			const qint64 length = GST_DP_HEADER_LENGTH + (qint64) record.payloadLength;
+			const guint8 *header = archive.isOpen() ? archive.data(record.filePos, length) : mapper.data(record.filePos, length);
+			if(!header)
+			{
+				error = "Problem with reading packet " + QString::number(row + i);
+				break;
+			}
+
+			const guint8 *payload = record.payloadLength ? header + GST_DP_HEADER_LENGTH : NULL;
+			report.packets++;
+
+			if(record.payloadType == GST_DP_PAYLOAD_BUFFER)
+			{
+				qint64 target = pace(record.timestamp, timer);
+
+				GstBuffer *pbuffer;
+				if(payload && archive.isOpen())
+				{
+					pbuffer = gst_buffer_new_allocate(NULL, record.payloadLength, NULL);
+					gst_buffer_fill(pbuffer, 0, payload, record.payloadLength);
+				}
+				else
+				{
+					pbuffer = gst_buffer_new();
+					if(payload)
+					{
+						Window *pwindow = mapper.window();
+						pwindow -> refs.ref();
+						gst_buffer_append_memory(pbuffer, gst_memory_new_wrapped(GST_MEMORY_FLAG_READONLY, (gpointer) payload,
+							record.payloadLength, 0, record.payloadLength, pwindow, releaseWindow));
+					}
+				}
+
+				GST_BUFFER_PTS(pbuffer) = record.timestamp;
+				GST_BUFFER_DURATION(pbuffer) = record.duration;
+				GST_BUFFER_OFFSET(pbuffer) = record.offset;
+				GST_BUFFER_OFFSET_END(pbuffer) = record.offsetEnd;
+				GST_BUFFER_FLAGS(pbuffer) = record.bufferFlags;
+
+				GstFlowReturn res;
+				if(segments && haveSegment)
+				{
+					GstSample *psample = gst_sample_new(pbuffer, NULL, &segment, NULL);
+					res = gst_app_src_push_sample(GST_APP_SRC(psrc), psample);
+					gst_sample_unref(psample);
+					gst_buffer_unref(pbuffer);
+				}
+				else
+					res = gst_app_src_push_buffer(GST_APP_SRC(psrc), pbuffer);
+
+				// flushing or not linked, the pipeline has stopped taking data
+				if(res != GST_FLOW_OK)
+				{
+					done = true;
+					break;
+				}
+
+				if(target >= 0)
+				{
+					qint64 jitter = qAbs(timer.nsecsElapsed() - target);
+					jitterSum += jitter;
+					report.maxJitter = qMax(report.maxJitter, jitter);
+					paced++;
+				}
+
+				report.buffers++;
+				report.bytes += record.payloadLength;
+			}
+			else if(record.payloadType == GST_DP_PAYLOAD_CAPS)
+			{
+				GstCaps *pcaps = payload ? gst_dp_caps_from_packet(GST_DP_HEADER_LENGTH, header, payload) : NULL;
+				if(pcaps)
+				{
+					gst_app_src_set_caps(GST_APP_SRC(psrc), pcaps);
+					gst_caps_unref(pcaps);
+				}
+			}
+			else if(record.payloadType >= GST_DP_PAYLOAD_EVENT_NONE)
+			{
+				GstEvent *pevent = gst_dp_event_from_packet(GST_DP_HEADER_LENGTH, header, payload);
+				if(!pevent)
+				{
+					report.skippedEvents++;
+					continue;
+				}
+
+				switch(GST_EVENT_TYPE(pevent))
+				{
+					case GST_EVENT_CAPS:
+					{
+						GstCaps *pcaps = NULL;
+						gst_event_parse_caps(pevent, &pcaps);
+						if(pcaps)
+							gst_app_src_set_caps(GST_APP_SRC(psrc), pcaps);
+						gst_event_unref(pevent);
+						break;
+					}
+
+					case GST_EVENT_SEGMENT:
+						gst_event_copy_segment(pevent, &segment);
+						haveSegment = true;
+						if(!segments)
+							report.skippedEvents++;
+
+						// pacing starts over with the new timeline
+						m_basePts = GST_CLOCK_TIME_NONE;
+						m_lastPts = GST_CLOCK_TIME_NONE;
+						gst_event_unref(pevent);
+						break;
+
+					case GST_EVENT_EOS:
+						done = true;
+						gst_event_unref(pevent);
+						break;
+
+					case GST_EVENT_STREAM_START:
+						// appsrc starts its stream by itself
+						gst_event_unref(pevent);
+						break;
+
+					default:
+						// serialized events sent to a source go out between the buffers
+						if(GST_EVENT_IS_DOWNSTREAM(pevent) && GST_EVENT_IS_SERIALIZED(pevent))
+						{
+							if(!gst_element_send_event(psrc, pevent))
+								report.skippedEvents++;
+						}
+						else
+						{
+							report.skippedEvents++;
+							gst_event_unref(pevent);
+						}
+						break;
+				}
+			}
+		}
+
+		report.elapsed = timer.nsecsElapsed();
+		report.meanJitter = paced ? jitterSum / paced : 0;
+
+		{
+			QMutexLocker lock(&m_mutex);
+			m_report = report;
+		}
+
+		emit progress(qMin(row + BATCH_SIZE, last + 1) - 1);
+	}
+
+	// lets the pipeline drain what was pushed
+	if(error.isEmpty())
+		gst_app_src_end_of_stream(GST_APP_SRC(psrc));
+
+	{
+		QMutexLocker lock(&m_mutex);
+		while(error.isEmpty() && !m_failed.load() && !m_eos && !m_stopping.load())
+			m_busDone.wait(&m_mutex);
+
+		if(error.isEmpty())
+			error = m_busError;
+	}
+
+	report.elapsed = timer.nsecsElapsed();
+	report.meanJitter = paced ? jitterSum / paced : 0;
+
+	{
+		QMutexLocker lock(&m_mutex);
+		m_ppipeline = NULL;
+	}
+
+	gst_element_set_state(ppipeline, GST_STATE_NULL);
+	gst_bus_set_sync_handler(pbus, NULL, NULL, NULL);
+	gst_object_unref(pbus);
+	gst_object_unref(psrc);
+	gst_object_unref(ppipeline);
+
+	{
+		QMutexLocker lock(&m_mutex);
+		m_report = report;
+		m_error = error;
+	}
+
+	m_running.store(0);
+	emit finished();
+}
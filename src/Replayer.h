@@ -0,0 +1,111 @@
+#ifndef REPLAYER_H_
+#define REPLAYER_H_
+
+#include <QObject>
+#include <QSharedPointer>
+#include <QThreadPool>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+#include <QString>
+#include <QElapsedTimer>
+
+#include <gst/gst.h>
+
+class PacketIndex;
+
+// Pushes a range of a dump into a pipeline through appsrc: caps, events and
+// buffers in their recorded order, with the recorded timestamps and flags.
+// The packets are read on a dedicated thread from read-ahead mappings of the
+// dump which the pushed buffers wrap instead of copying, so a mapping stays
+// alive until the last buffer in it is released downstream. Gdp archives
+// are decompressed, so their payloads are copied into the buffers. Errors
+// and the end of the stream are taken from the bus as they are posted, and
+// stop() shuts the pipeline down so a blocked push returns.
+class Replayer: public QObject
+{
+	Q_OBJECT
+	public:
+		enum Pacing
+		{
+			AsFastAsPossible,
+			OriginalPacing,
+			Speed
+		};
+
+		struct Report
+		{
+			qint64 packets;
+			qint64 buffers;
+			qint64 bytes;
+			qint64 skippedEvents;
+			qint64 elapsed;
+
+			// lateness of paced buffers against their schedule, in nanoseconds
+			qint64 meanJitter;
+			qint64 maxJitter;
+
+			double throughput() const;
+		};
+
+		Replayer(QSharedPointer<PacketIndex> pindex, const QString &fileName, QObject *parent = 0);
+		~Replayer();
+
+		void setWindowSize(qint64 bytes);
+		void setPacing(Pacing pacing, double speed = 1.0);
+
+		// the pipeline description is linked after the appsrc; last < 0 means
+		// to the end of the dump
+		bool start(const QString &pipeline, qint64 first = 0, qint64 last = -1);
+		void stop();
+		void wait();
+
+		bool isRunning() const;
+		Report report() const;
+		QString errorString() const;
+
+	signals:
+		void progress(qint64 row);
+		void finished();
+
+	private:
+		friend class ReplayTask;
+
+		// runs on the streaming threads, which post the messages
+		static GstBusSyncReply busMessage(GstBus *pbus, GstMessage *pmsg, gpointer data);
+
+		void replay(GstElement *ppipeline, qint64 first, qint64 last);
+		qint64 pace(guint64 timestamp, const QElapsedTimer &timer);
+
+		QSharedPointer<PacketIndex> m_pindex;
+		QString m_fileName;
+		QThreadPool m_pool;
+		qint64 m_windowSize;
+		Pacing m_pacing;
+		double m_speed;
+
+		QAtomicInt m_stopping;
+		QAtomicInt m_running;
+
+		mutable QMutex m_mutex;
+		Report m_report;
+		QString m_error;
+
+		// pipeline of the running replay, set to NULL by stop() so a push
+		// blocked on a full appsrc returns
+		GstElement *m_ppipeline;
+
+		// set from the bus, and woken on them or on stop()
+		QString m_busError;
+		QAtomicInt m_failed;
+		bool m_eos;
+		QWaitCondition m_busDone;
+
+		// pacing state of the replay thread
+		guint64 m_basePts;
+		qint64 m_baseTime;
+		guint64 m_lastPts;
+};
+
+
+#endif
@@ -0,0 +1,60 @@
+#include "SegmentTracker.h"
+#include "GdpFile.h"
+#include "dataprotocol.h"
+
+SegmentTracker::SegmentTracker():
+	m_valid(false)
+{
+	gst_segment_init(&m_segment, GST_FORMAT_UNDEFINED);
+}
+
+
+void SegmentTracker::update(PacketRecord &record, GdpFile &file)
+{
+	if(record.payloadType == GST_DP_PAYLOAD_BUFFER)
+	{
+		if(m_valid && m_segment.format == GST_FORMAT_TIME && GST_CLOCK_TIME_IS_VALID(record.timestamp))
+		{
+			record.runningTime = gst_segment_to_running_time(&m_segment, GST_FORMAT_TIME, record.timestamp);
+			record.streamTime = gst_segment_to_stream_time(&m_segment, GST_FORMAT_TIME, record.timestamp);
+		}
+
+		return;
+	}
+
+	if(record.payloadType < GST_DP_PAYLOAD_EVENT_NONE)
+		return;
+
+	GstEventType type = (GstEventType) (record.payloadType - GST_DP_PAYLOAD_EVENT_NONE);
+	if(type != GST_EVENT_SEGMENT && type != GST_EVENT_FLUSH_STOP)
+		return;
+
+	const guint8 *header = file.data(record.filePos, GST_DP_HEADER_LENGTH + (qint64) record.payloadLength);
+	if(!header)
+		return;
+
+	GstEvent *event = gst_dp_event_from_packet(GST_DP_HEADER_LENGTH, header,
+		record.payloadLength ? header + GST_DP_HEADER_LENGTH : NULL);
+	if(!event)
+		return;
+
+	if(type == GST_EVENT_SEGMENT)
+	{
+		gst_event_copy_segment(event, &m_segment);
+		m_valid = true;
+	}
+	else
+	{
+		// like a sink, forget the segment until the next one comes
+		gboolean resetTime = FALSE;
+		gst_event_parse_flush_stop(event, &resetTime);
+
+		if(resetTime)
+		{
+			gst_segment_init(&m_segment, GST_FORMAT_UNDEFINED);
+			m_valid = false;
+		}
+	}
+
+	gst_event_unref(event);
+}
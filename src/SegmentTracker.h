@@ -0,0 +1,27 @@
+#ifndef SEGMENT_TRACKER_H_
+#define SEGMENT_TRACKER_H_
+
+#include <gst/gst.h>
+
+#include "PacketIndex.h"
+
+class GdpFile;
+
+// Follows the segment of a stream while its packets are indexed in order
+// and fills in the running time and stream time of buffers the way a sink
+// computes them. Only SEGMENT and FLUSH_STOP events are parsed, every other
+// packet costs a few comparisons.
+class SegmentTracker
+{
+	public:
+		SegmentTracker();
+
+		void update(PacketRecord &record, GdpFile &file);
+
+	private:
+		GstSegment m_segment;
+		bool m_valid;
+};
+
+
+#endif
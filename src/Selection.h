@@ -0,0 +1,58 @@
+#ifndef SELECTION_H_
+#define SELECTION_H_
+
+#include <QVector>
+#include <QtAlgorithms>
+
+// Set of index rows as one bit per row. An empty selection (size 0) stands
+// for no selection at all.
+class Selection
+{
+	public:
+		explicit Selection(qint64 size = 0):
+			m_size(size),
+			m_words((size + 63) / 64, 0)
+		{
+		}
+
+		qint64 size() const
+		{
+			return m_size;
+		}
+
+		bool isEmpty() const
+		{
+			return m_size == 0;
+		}
+
+		bool contains(qint64 row) const
+		{
+			return row >= 0 && row < m_size && (m_words[row / 64] >> (row % 64)) & 1;
+		}
+
+		void set(qint64 row)
+		{
+			m_words[row / 64] |= (quint64) 1 << (row % 64);
+		}
+
+		qint64 count() const
+		{
+			qint64 res = 0;
+			for(int i = 0; i < m_words.size(); i++)
+				res += qPopulationCount(m_words[i]);
+
+			return res;
+		}
+
+		quint64 *words()
+		{
+			return m_words.data();
+		}
+
+	private:
+		qint64 m_size;
+		QVector<quint64> m_words;
+};
+
+
+#endif
@@ -0,0 +1,363 @@
+#include "Splitter.h"
+#include "PacketIndex.h"
+#include "GdpFile.h"
+#include "GdpArchive.h"
+#include "dataprotocol.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QVector>
+
+#include <gst/gst.h>
+
+static const int BATCH_SIZE = 4096;
+
+// bytes between two progress reports
+static const qint64 REPORT_BYTES = 64 * 1024 * 1024;
+
+static const qint64 COPY_CHUNK = 1024 * 1024;
+
+namespace
+{
+	// sticky packets written again at the start of each chunk, in the order
+	// a pipeline sends them
+	enum State
+	{
+		StateStreamStart,
+		StateCaps,
+		StateSegment,
+		StateCount
+	};
+
+	int stateOf(guint16 payloadType)
+	{
+		if(payloadType == GST_DP_PAYLOAD_CAPS || payloadType == GST_DP_PAYLOAD_EVENT_NONE + GST_EVENT_CAPS)
+			return StateCaps;
+		if(payloadType == GST_DP_PAYLOAD_EVENT_NONE + GST_EVENT_STREAM_START)
+			return StateStreamStart;
+		if(payloadType == GST_DP_PAYLOAD_EVENT_NONE + GST_EVENT_SEGMENT)
+			return StateSegment;
+
+		return -1;
+	}
+}
+
+
+Splitter::Splitter(QObject *parent):
+	QObject(parent),
+	m_maxDuration(0),
+	m_maxBytes(0),
+	m_windowSize(64 * 1024 * 1024),
+	m_cancel(0),
+	m_ptarget(NULL),
+	m_runStart(0),
+	m_runEnd(0),
+	m_bytes(0)
+{
+}
+
+
+void Splitter::setMaxDuration(guint64 duration)
+{
+	m_maxDuration = duration;
+}
+
+
+void Splitter::setMaxBytes(qint64 bytes)
+{
+	m_maxBytes = bytes;
+}
+
+
+void Splitter::setWindowSize(qint64 bytes)
+{
+	m_windowSize = bytes;
+}
+
+
+QStringList Splitter::chunks() const
+{
+	return m_chunks;
+}
+
+
+qint64 Splitter::bytesWritten() const
+{
+	return m_bytes;
+}
+
+
+QString Splitter::errorString() const
+{
+	return m_error;
+}
+
+
+void Splitter::cancel()
+{
+	m_cancel.store(1);
+}
+
+
+bool Splitter::run(const QString &fileName, PacketIndex *pindex, const QString &output)
+{
+	m_cancel.store(0);
+	m_copy.reset();
+	m_runStart = m_runEnd = 0;
+	m_chunks.clear();
+	m_bytes = 0;
+	m_error.clear();
+
+	GdpFile file;
+	if(!file.open(fileName))
+	{
+		m_error = "Problem with open file `" + fileName + "` for reading";
+		return false;
+	}
+	file.setWindowSize(m_windowSize);
+
+	// archives hold compressed payloads, which can not be copied as they are
+	const bool archive = GdpArchive::isArchive(fileName);
+
+	QFile source(fileName);
+	if(!archive && !source.open(QIODevice::ReadOnly))
+	{
+		m_error = "Problem with open file `" + fileName + "` for reading";
+		return false;
+	}
+
+	if(!QDir().mkpath(output))
+	{
+		m_error = "Problem with creating directory `" + output + "`";
+		return false;
+	}
+	m_baseName = output + "/" + QFileInfo(fileName).completeBaseName();
+
+	QFile target;
+	m_ptarget = &target;
+	if(!startChunk())
+	{
+		m_ptarget = NULL;
+		return false;
+	}
+
+	const qint64 size = pindex -> size();
+	const int handle = archive ? -1 : source.handle();
+
+	qint64 total = 0;
+	if(size > 0)
+	{
+		PacketRecord last = pindex -> at(size - 1);
+		total = last.filePos + GST_DP_HEADER_LENGTH + last.payloadLength;
+	}
+
+	PacketRecord state[StateCount];
+	bool hasState[StateCount] = {false, false, false};
+
+	qint64 chunkBytes = 0;
+	qint64 chunkBuffers = 0;
+	guint64 chunkStart = GST_CLOCK_TIME_NONE;
+
+	qint64 reported = 0;
+	emit progress(0, total);
+
+	QVector<PacketRecord> records(BATCH_SIZE);
+	for(qint64 first = 0; first < size; first += BATCH_SIZE)
+	{
+		if(m_cancel.load())
+		{
+			m_error = "Split cancelled";
+			m_ptarget = NULL;
+			return false;
+		}
+
+		qint64 count = pindex -> read(first, BATCH_SIZE, records.data());
+		for(qint64 i = 0; i < count; i++)
+		{
+			const PacketRecord &record = records[i];
+			const qint64 length = GST_DP_HEADER_LENGTH + (qint64) record.payloadLength;
+
+			if(record.payloadType == GST_DP_PAYLOAD_BUFFER)
+			{
+				guint64 time = GST_CLOCK_TIME_IS_VALID(record.runningTime) ? record.runningTime : record.timestamp;
+
+				bool full = (m_maxBytes > 0 && chunkBytes >= m_maxBytes)
+					|| (m_maxDuration > 0 && GST_CLOCK_TIME_IS_VALID(chunkStart) && GST_CLOCK_TIME_IS_VALID(time)
+						&& time >= chunkStart + m_maxDuration);
+
+				if(full && chunkBuffers > 0 && !(record.bufferFlags & GST_BUFFER_FLAG_DELTA_UNIT))
+				{
+					if(!flush(file, handle) || !startChunk())
+					{
+						m_ptarget = NULL;
+						return false;
+					}
+
+					for(int s = 0; s < StateCount; s++)
+					{
+						if(hasState[s] && !writeState(file, state[s]))
+						{
+							m_ptarget = NULL;
+							return false;
+						}
+					}
+
+					chunkBytes = 0;
+					chunkBuffers = 0;
+					chunkStart = GST_CLOCK_TIME_NONE;
+				}
+
+				if(!GST_CLOCK_TIME_IS_VALID(chunkStart))
+					chunkStart = time;
+				chunkBuffers++;
+			}
+			else
+			{
+				int s = stateOf(record.payloadType);
+				if(s >= 0)
+				{
+					state[s] = record;
+					hasState[s] = true;
+				}
+			}
+
+			// packets next to each other in the dump go in one copy
+			if(record.filePos != m_runEnd && !flush(file, handle))
+			{
+				m_ptarget = NULL;
+				return false;
+			}
+
+			if(m_runStart == m_runEnd)
+				m_runStart = record.filePos;
+			m_runEnd = record.filePos + length;
+
+			chunkBytes += length;
+
+			if(record.filePos - reported >= REPORT_BYTES)
+			{
+				reported = record.filePos;
+				emit progress(reported, total);
+			}
+		}
+	}
+
+	bool res = flush(file, handle);
+	target.close();
+	m_ptarget = NULL;
+
+	emit progress(total, total);
+	return res;
+}
+
+
+bool Splitter::startChunk()
+{
+	m_ptarget -> close();
+	m_ptarget -> setFileName(m_baseName + QString(".%1.gdp").arg(m_chunks.size(), 5, 10, QChar('0')));
+	if(!m_ptarget -> open(QIODevice::WriteOnly | QIODevice::Truncate))
+	{
+		m_error = "Problem with open file `" + m_ptarget -> fileName() + "` for writing";
+		return false;
+	}
+
+	m_chunks.append(m_ptarget -> fileName());
+	return true;
+}
+
+
+// the packet is decoded and packetized again rather than copied, so a
+// chunk only starts with state that depayloaders can read back
+bool Splitter::writeState(GdpFile &file, const PacketRecord &record)
+{
+	const guint8 *header = file.data(record.filePos, GST_DP_HEADER_LENGTH + (qint64) record.payloadLength);
+	if(!header)
+	{
+		m_error = "Problem with reading `" + file.fileName() + "`";
+		return false;
+	}
+
+	const guint8 *payload = record.payloadLength ? header + GST_DP_HEADER_LENGTH : NULL;
+	GstDPHeaderFlag flags = (GstDPHeaderFlag) record.headerFlags;
+
+	GstDPPacketizer *ppacketizer = gst_dp_packetizer_new(GST_DP_VERSION_1_0);
+	guint length = 0;
+	guint8 *packetHeader = NULL;
+	guint8 *packetPayload = NULL;
+	gboolean packetized = FALSE;
+
+	if(record.payloadType == GST_DP_PAYLOAD_CAPS)
+	{
+		GstCaps *pcaps = payload ? gst_dp_caps_from_packet(GST_DP_HEADER_LENGTH, header, payload) : NULL;
+		if(pcaps)
+		{
+			packetized = ppacketizer -> packet_from_caps(pcaps, flags, &length, &packetHeader, &packetPayload);
+			gst_caps_unref(pcaps);
+		}
+	}
+	else
+	{
+		GstEvent *pevent = gst_dp_event_from_packet(GST_DP_HEADER_LENGTH, header, payload);
+		if(pevent)
+		{
+			packetized = ppacketizer -> packet_from_event(pevent, flags, &length, &packetHeader, &packetPayload);
+			gst_event_unref(pevent);
+		}
+	}
+
+	gst_dp_packetizer_free(ppacketizer);
+
+	bool res = packetized;
+	if(packetized)
+	{
+		guint32 payloadLength = gst_dp_header_payload_length(packetHeader);
+		res = KernelCopy::writeAll(m_ptarget -> handle(), (const char *) packetHeader, length)
+			&& KernelCopy::writeAll(m_ptarget -> handle(), (const char *) packetPayload, payloadLength);
+		if(res)
+			m_bytes += length + payloadLength;
+	}
+
+	g_free(packetHeader);
+	g_free(packetPayload);
+
+	if(!res)
+		m_error = packetized ? "Problem with writing to `" + m_ptarget -> fileName() + "`"
+			: QString("Problem with packetizing the packet at %1 of `%2`").arg(record.filePos).arg(file.fileName());
+	return res;
+}
+
+
+// writes the run of packets taken since the last flush
+bool Splitter::flush(GdpFile &file, int source)
+{
+	qint64 pos = m_runStart;
+	qint64 length = m_runEnd - m_runStart;
+	m_runStart = m_runEnd;
+
+	if(!length)
+		return true;
+
+	bool written = true;
+	if(source >= 0)
+		written = m_copy.copy(source, m_ptarget -> handle(), pos, length);
+	else
+	{
+		for(qint64 done = 0; written && done < length;)
+		{
+			qint64 chunk = qMin(length - done, COPY_CHUNK);
+			const guint8 *data = file.data(pos + done, chunk);
+			written = data && KernelCopy::writeAll(m_ptarget -> handle(), (const char *) data, chunk);
+			done += chunk;
+		}
+	}
+
+	if(!written)
+	{
+		m_error = "Problem with writing to `" + m_ptarget -> fileName() + "`";
+		return false;
+	}
+
+	m_bytes += length;
+	return true;
+}
@@ -0,0 +1,69 @@
+#ifndef SPLITTER_H_
+#define SPLITTER_H_
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QAtomicInt>
+
+#include <glib.h>
+
+#include "KernelCopy.h"
+
+class QFile;
+class GdpFile;
+class PacketIndex;
+struct PacketRecord;
+
+// Cuts a dump into chunks of about a duration or a size that can be
+// processed on their own. Cuts fall only before buffers without the
+// DELTA_UNIT flag, and each chunk after the first starts with the current
+// STREAM_START, CAPS and SEGMENT packets, packetized again, so it decodes
+// without the chunks before it. Runs of packets are copied by the kernel
+// where it can (see KernelCopy); gdp archives are written from memory.
+class Splitter: public QObject
+{
+	Q_OBJECT
+	public:
+		explicit Splitter(QObject *parent = 0);
+
+		// limits of a chunk; 0 turns a limit off, and a chunk goes on past
+		// them until the next keyframe
+		void setMaxDuration(guint64 duration);
+		void setMaxBytes(qint64 bytes);
+		void setWindowSize(qint64 bytes);
+
+		// writes the chunks to the <output> directory, named after the dump
+		bool run(const QString &fileName, PacketIndex *pindex, const QString &output);
+
+		QStringList chunks() const;
+		qint64 bytesWritten() const;
+		QString errorString() const;
+
+	public slots:
+		void cancel();
+
+	signals:
+		void progress(qint64 done, qint64 total);
+
+	private:
+		bool startChunk();
+		bool writeState(GdpFile &file, const PacketRecord &record);
+		bool flush(GdpFile &file, int source);
+
+		guint64 m_maxDuration;
+		qint64 m_maxBytes;
+		qint64 m_windowSize;
+		QAtomicInt m_cancel;
+		KernelCopy m_copy;
+		QFile *m_ptarget;
+		QString m_baseName;
+		qint64 m_runStart;
+		qint64 m_runEnd;
+		QStringList m_chunks;
+		qint64 m_bytes;
+		QString m_error;
+};
+
+
+#endif
@@ -0,0 +1,246 @@
+#include "Stats.h"
+
+#include <QAtomicInteger>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QVector>
+#include <QThread>
+#include <QFile>
+#include <QTextStream>
+#include <QCoreApplication>
+
+namespace
+{
+	struct TraceEvent
+	{
+		int stage;
+		quintptr thread;
+		qint64 start;
+		qint64 duration;
+	};
+
+	// keeps a trace of a long session at a few tens of megabytes
+	const int MAX_TRACE_EVENTS = 1000000;
+
+	QAtomicInteger<quint64> s_counters[Stats::CounterCount];
+	QAtomicInteger<quint64> s_stageTimes[Stats::StageCount];
+	QAtomicInteger<quint64> s_stageCounts[Stats::StageCount];
+
+	QAtomicInt s_tracing(0);
+	QMutex s_traceMutex;
+	QVector<TraceEvent> s_trace;
+
+	const char *s_counterNames[Stats::CounterCount] =
+	{
+		"bytes_read",
+		"buffer_packets",
+		"caps_packets",
+		"event_packets",
+		"allocations",
+		"cache_hits",
+		"cache_misses"
+	};
+
+	const char *s_stageNames[Stats::StageCount] =
+	{
+		"read",
+		"header_crc",
+		"payload_crc",
+		"index",
+		"caps_parse",
+		"structure_parse",
+		"item_creation",
+		"process_events"
+	};
+
+	QElapsedTimer startedTimer()
+	{
+		QElapsedTimer timer;
+		timer.start();
+
+		return timer;
+	}
+
+	const QElapsedTimer &clock()
+	{
+		static const QElapsedTimer timer = startedTimer();
+		return timer;
+	}
+}
+
+
+Stats::Timer::Timer(Stage stage):
+	m_stage(stage),
+	m_start(Stats::now())
+{
+}
+
+
+Stats::Timer::~Timer()
+{
+	Stats::addTime(m_stage, m_start, Stats::now() - m_start);
+}
+
+
+void Stats::add(Counter counter, qint64 value)
+{
+	s_counters[counter].fetchAndAddRelaxed(value);
+}
+
+
+quint64 Stats::counter(Counter counter)
+{
+	return s_counters[counter].load();
+}
+
+
+void Stats::addTime(Stage stage, qint64 start, qint64 duration)
+{
+	s_stageTimes[stage].fetchAndAddRelaxed(duration);
+	s_stageCounts[stage].fetchAndAddRelaxed(1);
+
+	if(!s_tracing.load())
+		return;
+
+	TraceEvent event;
+	event.stage = stage;
+	event.thread = (quintptr) QThread::currentThreadId();
+	event.start = start;
+	event.duration = duration;
+
+	QMutexLocker locker(&s_traceMutex);
+	if(s_trace.size() < MAX_TRACE_EVENTS)
+		s_trace.append(event);
+}
+
+
+quint64 Stats::stageTime(Stage stage)
+{
+	return s_stageTimes[stage].load();
+}
+
+
+quint64 Stats::stageCount(Stage stage)
+{
+	return s_stageCounts[stage].load();
+}
+
+
+qint64 Stats::now()
+{
+	return clock().nsecsElapsed();
+}
+
+
+void Stats::reset()
+{
+	for(int i = 0; i < CounterCount; i++)
+		s_counters[i].store(0);
+
+	for(int i = 0; i < StageCount; i++)
+	{
+		s_stageTimes[i].store(0);
+		s_stageCounts[i].store(0);
+	}
+
+	QMutexLocker locker(&s_traceMutex);
+	s_trace.clear();
+}
+
+
+const char *Stats::name(Counter counter)
+{
+	return s_counterNames[counter];
+}
+
+
+const char *Stats::name(Stage stage)
+{
+	return s_stageNames[stage];
+}
+
+
+QString Stats::summary()
+{
+	quint64 packets = counter(BufferPackets) + counter(CapsPackets) + counter(EventPackets);
+	quint64 lookups = counter(CacheHits) + counter(CacheMisses);
+
+	QString str = "packets: " + QString::number(packets);
+	str += "  read: " + QString::number(counter(BytesRead) / (1024 * 1024)) + " MB";
+	str += "  crc: " + QString::number((stageTime(StageHeaderCrc) + stageTime(StagePayloadCrc)) / 1000000) + " ms";
+
+	if(lookups)
+		str += "  cache hits: " + QString::number(100 * counter(CacheHits) / lookups) + "%";
+
+	return str;
+}
+
+
+QJsonObject Stats::toJson()
+{
+	QJsonObject counters;
+	for(int i = 0; i < CounterCount; i++)
+		counters.insert(s_counterNames[i], (double) counter((Counter) i));
+
+	QJsonObject stages;
+	for(int i = 0; i < StageCount; i++)
+	{
+		QJsonObject stage;
+		stage.insert("count", (double) stageCount((Stage) i));
+		stage.insert("time_ns", (double) stageTime((Stage) i));
+		stages.insert(s_stageNames[i], stage);
+	}
+
+	QJsonObject res;
+	res.insert("counters", counters);
+	res.insert("stages", stages);
+
+	return res;
+}
+
+
+void Stats::setTracing(bool enabled)
+{
+	clock();
+	s_tracing.store(enabled ? 1 : 0);
+}
+
+
+bool Stats::isTracing()
+{
+	return s_tracing.load();
+}
+
+
+bool Stats::writeTrace(const QString &fileName)
+{
+	QFile file(fileName);
+	if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+		return false;
+
+	QTextStream stream(&file);
+	qint64 pid = QCoreApplication::applicationPid();
+
+	stream << "{\"traceEvents\":[\n";
+
+	QMutexLocker locker(&s_traceMutex);
+	for(int i = 0; i < s_trace.size(); i++)
+	{
+		const TraceEvent &event = s_trace[i];
+
+		if(i)
+			stream << ",\n";
+
+		// timestamps of the trace event format are in microseconds
+		stream << "{\"name\":\"" << s_stageNames[event.stage] << "\",\"ph\":\"X\",\"pid\":" << pid
+			<< ",\"tid\":" << (quint64) event.thread
+			<< ",\"ts\":" << QString::number(event.start / 1000.0, 'f', 3)
+			<< ",\"dur\":" << QString::number(event.duration / 1000.0, 'f', 3) << "}";
+	}
+
+	stream << "\n]}\n";
+	stream.flush();
+
+	return file.error() == QFile::NoError;
+}
@@ -0,0 +1,72 @@
+#ifndef STATS_H_
+#define STATS_H_
+
+#include <QString>
+#include <QJsonObject>
+
+// Process-wide counters and per-stage timers. Updates are lock-free atomic
+// additions so they stay enabled all the time; when tracing is turned on
+// every timed section is also recorded as a trace event that can be written
+// in the Trace Event Format understood by chrome://tracing and Perfetto.
+class Stats
+{
+	public:
+		enum Counter
+		{
+			BytesRead,
+			BufferPackets,
+			CapsPackets,
+			EventPackets,
+			Allocations,
+			CacheHits,
+			CacheMisses,
+			CounterCount
+		};
+
+		enum Stage
+		{
+			StageRead,
+			StageHeaderCrc,
+			StagePayloadCrc,
+			StageIndex,
+			StageCapsParse,
+			StageStructureParse,
+			StageItemCreation,
+			StageProcessEvents,
+			StageCount
+		};
+
+		class Timer
+		{
+			public:
+				explicit Timer(Stage stage);
+				~Timer();
+
+			private:
+				Q_DISABLE_COPY(Timer)
+
+				Stage m_stage;
+				qint64 m_start;
+		};
+
+		static void add(Counter counter, qint64 value = 1);
+		static quint64 counter(Counter counter);
+		static void addTime(Stage stage, qint64 start, qint64 duration);
+		static quint64 stageTime(Stage stage);
+		static quint64 stageCount(Stage stage);
+		static qint64 now();
+		static void reset();
+
+		static const char *name(Counter counter);
+		static const char *name(Stage stage);
+
+		static QString summary();
+		static QJsonObject toJson();
+
+		static void setTracing(bool enabled);
+		static bool isTracing();
+		static bool writeTrace(const QString &fileName);
+};
+
+
+#endif
@@ -0,0 +1,60 @@
+#include "StatsPanel.h"
+#include "Stats.h"
+
+#include <QVBoxLayout>
+#include <QTreeWidgetItem>
+#include <QHeaderView>
+
+StatsPanel::StatsPanel(QWidget *parent):
+	QWidget(parent)
+{
+	m_ptree = new QTreeWidget();
+	m_ptree -> setColumnCount(3);
+	m_ptree -> setHeaderLabels(QStringList() << "Name" << "Count" << "Time, ms");
+	m_ptree -> setRootIsDecorated(false);
+
+	for(int i = 0; i < Stats::CounterCount; i++)
+		m_ptree -> addTopLevelItem(new QTreeWidgetItem(QStringList(Stats::name((Stats::Counter) i))));
+
+	for(int i = 0; i < Stats::StageCount; i++)
+		m_ptree -> addTopLevelItem(new QTreeWidgetItem(QStringList(Stats::name((Stats::Stage) i))));
+
+	QVBoxLayout *playout = new QVBoxLayout();
+	playout -> setContentsMargins(0, 0, 0, 0);
+	playout -> addWidget(m_ptree);
+	setLayout(playout);
+
+	m_timer.setInterval(500);
+	connect(&m_timer, SIGNAL(timeout()), SLOT(slotRefresh()));
+}
+
+
+void StatsPanel::slotRefresh()
+{
+	for(int i = 0; i < Stats::CounterCount; i++)
+		m_ptree -> topLevelItem(i) -> setText(1, QString::number(Stats::counter((Stats::Counter) i)));
+
+	for(int i = 0; i < Stats::StageCount; i++)
+	{
+		QTreeWidgetItem *pitem = m_ptree -> topLevelItem(Stats::CounterCount + i);
+		pitem -> setText(1, QString::number(Stats::stageCount((Stats::Stage) i)));
+		pitem -> setText(2, QString::number(Stats::stageTime((Stats::Stage) i) / 1000000.0, 'f', 1));
+	}
+}
+
+
+void StatsPanel::showEvent(QShowEvent *pevent)
+{
+	slotRefresh();
+	m_timer.start();
+
+	QWidget::showEvent(pevent);
+}
+
+
+void StatsPanel::hideEvent(QHideEvent *pevent)
+{
+	m_timer.stop();
+
+	QWidget::hideEvent(pevent);
+}
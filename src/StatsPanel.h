@@ -0,0 +1,27 @@
+#ifndef STATS_PANEL_H_
+#define STATS_PANEL_H_
+
+#include <QWidget>
+#include <QTreeWidget>
+#include <QTimer>
+
+class StatsPanel: public QWidget
+{
+	Q_OBJECT
+	public:
+		StatsPanel(QWidget *parent = 0);
+
+	public slots:
+		void slotRefresh();
+
+	protected:
+		virtual void showEvent(QShowEvent *);
+		virtual void hideEvent(QHideEvent *);
+
+	private:
+		QTreeWidget *m_ptree;
+		QTimer m_timer;
+};
+
+
+#endif
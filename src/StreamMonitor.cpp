@@ -0,0 +1,348 @@
+#include "StreamMonitor.h"
+
+#include <QTcpSocket>
+#include <QTimer>
+#include <QUrl>
+
+#include <cstring>
+
+// bytes read from a file per poll, so one busy stream does not hold up the rest
+static const qint64 POLL_BYTES = 16 * 1024 * 1024;
+
+static const qint64 READ_CHUNK = 1024 * 1024;
+
+// caps and event payloads larger than this are skipped like buffers
+static const qint64 MAX_KEPT_PAYLOAD = 1024 * 1024;
+
+static const int RECONNECT_MS = 1000;
+
+static bool isHeader(const guint8 *header)
+{
+	int major = GST_DP_HEADER_MAJOR_VERSION(header);
+	int minor = GST_DP_HEADER_MINOR_VERSION(header);
+
+	if(!((major == 1 && minor == 0) || (major == 0 && minor == 2)) || header[3] != 0)
+		return false;
+
+	int type = GST_DP_HEADER_PAYLOAD_TYPE(header);
+	if(type != GST_DP_PAYLOAD_BUFFER && type != GST_DP_PAYLOAD_CAPS && type < GST_DP_PAYLOAD_EVENT_NONE)
+		return false;
+
+	return gst_dp_validate_header(GST_DP_HEADER_LENGTH, header);
+}
+
+
+StreamMonitor::StreamMonitor(const QString &source, QObject *parent):
+	QObject(parent),
+	m_source(source),
+	m_port(0),
+	m_offset(0),
+	m_psocket(NULL),
+	m_gapThreshold(100 * GST_MSECOND),
+	m_lastData(-1)
+{
+	QUrl url(source);
+	if(url.scheme() == "tcp")
+	{
+		m_host = url.host();
+		m_port = url.port();
+	}
+	else
+		m_file.setFileName(source);
+
+	m_clock.start();
+	m_stats.packets = 0;
+	m_stats.buffers = 0;
+	m_stats.bytes = 0;
+	m_stats.capsChanges = 0;
+	m_stats.gaps = 0;
+	m_stats.backwards = 0;
+	m_stats.resyncs = 0;
+	m_stats.skippedBytes = 0;
+	m_stats.maxGap = 0;
+	m_stats.lastGap = 0;
+	m_stats.lastPts = GST_CLOCK_TIME_NONE;
+
+	for(int i = 0; i < BITRATE_BUCKETS; i++)
+	{
+		m_bucketBytes[i] = 0;
+		m_bucketSecond[i] = -1;
+	}
+
+	reset();
+}
+
+
+void StreamMonitor::setGapThreshold(guint64 threshold)
+{
+	m_gapThreshold = threshold;
+}
+
+
+QString StreamMonitor::source() const
+{
+	return m_source;
+}
+
+
+void StreamMonitor::start()
+{
+	if(m_port)
+	{
+		m_psocket = new QTcpSocket(this);
+		connect(m_psocket, SIGNAL(readyRead()), SLOT(slotReadyRead()));
+		connect(m_psocket, SIGNAL(disconnected()), SLOT(slotDisconnected()));
+		connect(m_psocket, SIGNAL(error(QAbstractSocket::SocketError)), SLOT(slotDisconnected()));
+		slotConnect();
+	}
+	else
+		poll();
+}
+
+
+void StreamMonitor::reset()
+{
+	m_headerFill = 0;
+	m_payloadLeft = 0;
+	m_keepPayload = false;
+	m_resyncing = false;
+	m_payload.clear();
+	m_nextPts = GST_CLOCK_TIME_NONE;
+}
+
+
+void StreamMonitor::poll()
+{
+	if(m_port)
+		return;
+
+	if(!m_file.isOpen() && !m_file.open(QIODevice::ReadOnly | QIODevice::Unbuffered))
+		return;
+
+	// a file that got shorter was rotated or truncated, it starts over
+	if(m_file.size() < m_offset)
+	{
+		m_file.close();
+		m_offset = 0;
+		reset();
+
+		if(!m_file.open(QIODevice::ReadOnly | QIODevice::Unbuffered))
+			return;
+	}
+
+	QByteArray chunk;
+	for(qint64 read = 0; read < POLL_BYTES && m_file.size() > m_offset; )
+	{
+		chunk = m_file.read(qMin(READ_CHUNK, m_file.size() - m_offset));
+		if(chunk.isEmpty())
+			break;
+
+		consume((const guint8 *) chunk.constData(), chunk.size());
+		m_offset += chunk.size();
+		read += chunk.size();
+	}
+}
+
+
+void StreamMonitor::slotConnect()
+{
+	if(m_psocket -> state() == QAbstractSocket::UnconnectedState)
+		m_psocket -> connectToHost(m_host, m_port);
+}
+
+
+void StreamMonitor::slotReadyRead()
+{
+	while(m_psocket -> bytesAvailable() > 0)
+	{
+		QByteArray chunk = m_psocket -> read(READ_CHUNK);
+		if(chunk.isEmpty())
+			break;
+
+		consume((const guint8 *) chunk.constData(), chunk.size());
+	}
+}
+
+
+void StreamMonitor::slotDisconnected()
+{
+	// the server starts a new stream for the next connection
+	reset();
+	m_psocket -> abort();
+	QTimer::singleShot(RECONNECT_MS, this, SLOT(slotConnect()));
+}
+
+
+void StreamMonitor::addBytes(qint64 bytes)
+{
+	qint64 second = m_clock.elapsed() / 1000;
+	int bucket = second % BITRATE_BUCKETS;
+
+	if(m_bucketSecond[bucket] != second)
+	{
+		m_bucketSecond[bucket] = second;
+		m_bucketBytes[bucket] = 0;
+	}
+
+	m_bucketBytes[bucket] += bytes;
+}
+
+
+void StreamMonitor::consume(const guint8 *data, qint64 length)
+{
+	m_lastData = m_clock.elapsed();
+
+	while(length > 0)
+	{
+		if(m_headerFill < GST_DP_HEADER_LENGTH)
+		{
+			int count = qMin<qint64>(GST_DP_HEADER_LENGTH - m_headerFill, length);
+			memcpy(m_header + m_headerFill, data, count);
+			m_headerFill += count;
+			data += count;
+			length -= count;
+
+			if(m_headerFill < GST_DP_HEADER_LENGTH)
+				break;
+
+			if(!isHeader(m_header))
+			{
+				// one byte further on, counting a lost sync once
+				if(!m_resyncing)
+					m_stats.resyncs++;
+				m_resyncing = true;
+				m_stats.skippedBytes++;
+
+				memmove(m_header, m_header + 1, GST_DP_HEADER_LENGTH - 1);
+				m_headerFill--;
+				continue;
+			}
+
+			m_resyncing = false;
+			m_payloadLeft = GST_DP_HEADER_PAYLOAD_LENGTH(m_header);
+			m_keepPayload = GST_DP_HEADER_PAYLOAD_TYPE(m_header) != GST_DP_PAYLOAD_BUFFER && m_payloadLeft <= MAX_KEPT_PAYLOAD;
+			m_payload.clear();
+		}
+
+		qint64 count = qMin(m_payloadLeft, length);
+		if(m_keepPayload)
+			m_payload.append((const char *) data, count);
+
+		m_payloadLeft -= count;
+		data += count;
+		length -= count;
+
+		if(m_payloadLeft == 0)
+		{
+			packet();
+			m_headerFill = 0;
+		}
+	}
+}
+
+
+void StreamMonitor::packet()
+{
+	m_stats.packets++;
+
+	int type = GST_DP_HEADER_PAYLOAD_TYPE(m_header);
+	const guint8 *payload = m_payload.isEmpty() ? NULL : (const guint8 *) m_payload.constData();
+
+	if(type == GST_DP_PAYLOAD_BUFFER)
+	{
+		guint64 length = GST_DP_HEADER_PAYLOAD_LENGTH(m_header);
+		guint64 pts = GST_DP_HEADER_TIMESTAMP(m_header);
+		guint64 duration = GST_DP_HEADER_DURATION(m_header);
+
+		m_stats.buffers++;
+		m_stats.bytes += length;
+		addBytes(length);
+
+		if(!GST_CLOCK_TIME_IS_VALID(pts))
+			return;
+
+		if(GST_CLOCK_TIME_IS_VALID(m_nextPts))
+		{
+			if(pts > m_nextPts + m_gapThreshold)
+			{
+				m_stats.gaps++;
+				m_stats.lastGap = pts - m_nextPts;
+				m_stats.maxGap = qMax(m_stats.maxGap, m_stats.lastGap);
+			}
+			else if(GST_CLOCK_TIME_IS_VALID(m_stats.lastPts) && pts + m_gapThreshold < m_stats.lastPts)
+				m_stats.backwards++;
+		}
+
+		// reordered frames do not move the expected time back
+		guint64 end = pts + (GST_CLOCK_TIME_IS_VALID(duration) ? duration : 0);
+		if(!GST_CLOCK_TIME_IS_VALID(m_nextPts) || end > m_nextPts)
+			m_nextPts = end;
+
+		m_stats.lastPts = pts;
+		return;
+	}
+
+	GstCaps *pcaps = NULL;
+	if(type == GST_DP_PAYLOAD_CAPS)
+	{
+		if(payload)
+			pcaps = gst_dp_caps_from_packet(GST_DP_HEADER_LENGTH, m_header, payload);
+	}
+	else
+	{
+		GstEventType eventType = (GstEventType) (type - GST_DP_PAYLOAD_EVENT_NONE);
+		m_stats.events[gst_event_type_get_name(eventType)]++;
+
+		// a new timeline, whatever it starts at is no gap
+		if(eventType == GST_EVENT_SEGMENT || eventType == GST_EVENT_FLUSH_STOP)
+			m_nextPts = GST_CLOCK_TIME_NONE;
+
+		if(eventType == GST_EVENT_CAPS && (payload || !GST_DP_HEADER_PAYLOAD_LENGTH(m_header)))
+		{
+			GstEvent *pevent = gst_dp_event_from_packet(GST_DP_HEADER_LENGTH, m_header, payload);
+			if(pevent)
+			{
+				GstCaps *peventCaps = NULL;
+				gst_event_parse_caps(pevent, &peventCaps);
+				if(peventCaps)
+					pcaps = gst_caps_ref(peventCaps);
+				gst_event_unref(pevent);
+			}
+		}
+	}
+
+	if(pcaps)
+	{
+		gchar *str = gst_caps_to_string(pcaps);
+		QString caps = QString::fromUtf8(str);
+		g_free(str);
+		gst_caps_unref(pcaps);
+
+		if(!m_stats.caps.isEmpty() && caps != m_stats.caps)
+			m_stats.capsChanges++;
+		m_stats.caps = caps;
+	}
+}
+
+
+StreamStats StreamMonitor::stats() const
+{
+	StreamStats stats = m_stats;
+
+	stats.up = m_port ? m_psocket && m_psocket -> state() == QAbstractSocket::ConnectedState : m_file.isOpen() && m_file.exists();
+	stats.secondsSinceData = m_lastData < 0 ? -1 : (m_clock.elapsed() - m_lastData) / 1000.0;
+
+	// the current second is still filling up, so it is left out; just after
+	// the start fewer full seconds are there
+	qint64 second = m_clock.elapsed() / 1000;
+	qint64 bytes = 0;
+	for(int i = 0; i < BITRATE_BUCKETS; i++)
+	{
+		if(m_bucketSecond[i] >= second - BITRATE_SECONDS && m_bucketSecond[i] < second)
+			bytes += m_bucketBytes[i];
+	}
+
+	qint64 seconds = qMin<qint64>(second, BITRATE_SECONDS);
+	stats.bitrate = seconds ? bytes * 8.0 / seconds : 0;
+	return stats;
+}
@@ -0,0 +1,108 @@
+#ifndef STREAM_MONITOR_H_
+#define STREAM_MONITOR_H_
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QFile>
+#include <QElapsedTimer>
+#include <QMap>
+
+#include <glib.h>
+
+#include "dataprotocol.h"
+
+class QTcpSocket;
+
+// Counters and rolling values of one monitored stream.
+struct StreamStats
+{
+	bool up;
+	qint64 packets;
+	qint64 buffers;
+	qint64 bytes;
+	qint64 capsChanges;
+	qint64 gaps;
+	qint64 backwards;
+	qint64 resyncs;
+	qint64 skippedBytes;
+	guint64 maxGap;
+	guint64 lastGap;
+	guint64 lastPts;
+	double bitrate;
+	double secondsSinceData;
+	QString caps;
+	QMap<QString, qint64> events;
+};
+
+// Follows a growing gdp file or a gdp stream from a TCP server (tcpserversink
+// after gdppay) and keeps StreamStats on it. Packets are parsed as the bytes
+// come, buffer payloads are counted but never held, so memory stays the
+// same however long the stream runs. Files are read by poll(), sockets when
+// they have data, both from the event loop of the caller's thread.
+class StreamMonitor: public QObject
+{
+	Q_OBJECT
+	public:
+		explicit StreamMonitor(const QString &source, QObject *parent = 0);
+
+		// buffers starting later than this after the end of the previous
+		// one count as a gap
+		void setGapThreshold(guint64 threshold);
+
+		void start();
+
+		QString source() const;
+		StreamStats stats() const;
+
+	public slots:
+		// reads what was added to a followed file since the last call
+		void poll();
+
+	private slots:
+		void slotReadyRead();
+		void slotDisconnected();
+		void slotConnect();
+
+	private:
+		// one bucket more than the seconds of the bitrate, for the second
+		// that is filling up
+		enum
+		{
+			BITRATE_SECONDS = 10,
+			BITRATE_BUCKETS = BITRATE_SECONDS + 1
+		};
+
+		void reset();
+		void consume(const guint8 *data, qint64 length);
+		void packet();
+		void addBytes(qint64 bytes);
+
+		QString m_source;
+		QString m_host;
+		quint16 m_port;
+		QFile m_file;
+		qint64 m_offset;
+		QTcpSocket *m_psocket;
+		guint64 m_gapThreshold;
+
+		// parser state, the header being filled or the payload being skipped
+		guint8 m_header[GST_DP_HEADER_LENGTH];
+		int m_headerFill;
+		qint64 m_payloadLeft;
+		bool m_keepPayload;
+		bool m_resyncing;
+		QByteArray m_payload;
+
+		StreamStats m_stats;
+		guint64 m_nextPts;
+		QElapsedTimer m_clock;
+		qint64 m_lastData;
+
+		// bytes received in each of the last seconds
+		qint64 m_bucketBytes[BITRATE_BUCKETS];
+		qint64 m_bucketSecond[BITRATE_BUCKETS];
+};
+
+
+#endif
@@ -0,0 +1,214 @@
+#include "TextIndex.h"
+#include "GdpFile.h"
+#include "dataprotocol.h"
+
+#include <QByteArrayMatcher>
+
+// texts are lower-cased, stored and compared in pieces of this size
+static const qint64 TEXT_CHUNK = 1024 * 1024;
+
+// slots of the hash table looked at for one text
+static const int PROBES = 4;
+
+namespace
+{
+	// FNV-1a over the lower-cased text
+	quint64 hashOf(const char *text, qint64 length)
+	{
+		quint64 hash = Q_UINT64_C(14695981039346656037);
+
+		for(qint64 done = 0; done < length; done += TEXT_CHUNK)
+		{
+			QByteArray chunk = QByteArray(text + done, qMin(length - done, TEXT_CHUNK)).toLower();
+			for(int i = 0; i < chunk.size(); i++)
+			{
+				hash ^= (uchar) chunk[i];
+				hash *= Q_UINT64_C(1099511628211);
+			}
+		}
+
+		return hash;
+	}
+}
+
+
+TextIndex::TextIndex(qint64 memoryBytes):
+	m_text(TEXT_CHUNK)
+{
+	// half of the memory goes to the hash table, the rest to mapped pages
+	int slots = 1024;
+	while((qint64) slots * 2 * sizeof(Slot) <= memoryBytes / 2 && slots < (1 << 26))
+		slots *= 2;
+
+	Slot empty;
+	empty.hash = 0;
+	empty.id = -1;
+	m_slots.fill(empty, slots);
+
+	m_text.setMaxMappedBytes(memoryBytes / 4);
+	m_strings.setMaxMappedBytes(memoryBytes / 8);
+	m_entries.setMaxMappedBytes(memoryBytes / 8);
+}
+
+
+bool TextIndex::open(const QString &dir)
+{
+	return m_text.open(dir) && m_strings.open(dir) && m_entries.open(dir);
+}
+
+
+void TextIndex::add(qint64 row, const PacketRecord &record, GdpFile &file)
+{
+	if(record.payloadType == GST_DP_PAYLOAD_BUFFER || !record.payloadLength)
+		return;
+
+	const guint8 *header = file.data(record.filePos, GST_DP_HEADER_LENGTH + (qint64) record.payloadLength);
+	if(!header)
+		return;
+
+	// payloads are written with their terminating zero
+	const char *payload = (const char *) header + GST_DP_HEADER_LENGTH;
+	qint64 length = qstrnlen(payload, record.payloadLength);
+
+	quint64 hash = hashOf(payload, length);
+	int id = find(hash, payload, length);
+	if(id < 0)
+		id = store(hash, payload, length);
+	if(id < 0)
+		return;
+
+	TextEntry entry;
+	entry.row = row;
+	entry.string = id;
+	m_entries.append(entry);
+}
+
+
+int TextIndex::find(quint64 hash, const char *text, qint64 length) const
+{
+	const int mask = m_slots.size() - 1;
+	for(int i = 0; i < PROBES; i++)
+	{
+		const Slot &slot = m_slots[(hash + i) & mask];
+		if(slot.id < 0)
+			return -1;
+
+		if(slot.hash == hash && equals(slot.id, text, length))
+			return slot.id;
+	}
+
+	return -1;
+}
+
+
+bool TextIndex::equals(int id, const char *text, qint64 length) const
+{
+	TextString string = m_strings.at(id);
+	if(string.length != length)
+		return false;
+
+	QByteArray stored;
+	for(qint64 done = 0; done < length; done += TEXT_CHUNK)
+	{
+		qint64 n = qMin(length - done, TEXT_CHUNK);
+		stored.resize(n);
+		if(m_text.read(string.offset + done, n, stored.data()) != n)
+			return false;
+
+		if(stored != QByteArray::fromRawData(text + done, n).toLower())
+			return false;
+	}
+
+	return true;
+}
+
+
+int TextIndex::store(quint64 hash, const char *text, qint64 length)
+{
+	TextString string;
+	string.offset = m_text.size();
+	string.length = length;
+
+	for(qint64 done = 0; done < length; done += TEXT_CHUNK)
+	{
+		QByteArray chunk = QByteArray(text + done, qMin(length - done, TEXT_CHUNK)).toLower();
+		if(!m_text.append(chunk.constData(), chunk.size()))
+			return -1;
+	}
+
+	int id = m_strings.size();
+	if(!m_strings.append(string))
+		return -1;
+
+	// an empty slot is taken, or else one of the probed slots is reused
+	const int mask = m_slots.size() - 1;
+	int target = (hash + (hash >> 32) % PROBES) & mask;
+	for(int i = 0; i < PROBES; i++)
+	{
+		if(m_slots[(hash + i) & mask].id < 0)
+		{
+			target = (hash + i) & mask;
+			break;
+		}
+	}
+
+	m_slots[target].hash = hash;
+	m_slots[target].id = id;
+
+	return id;
+}
+
+
+int TextIndex::stringCount() const
+{
+	return m_strings.size();
+}
+
+
+// the text is searched piece by piece, with pieces overlapping by the
+// pattern length, so a text of any size takes a bounded amount of memory
+bool TextIndex::contains(int id, const QByteArrayMatcher &matcher) const
+{
+	TextString string = m_strings.at(id);
+	const qint64 overlap = qMax(0, matcher.pattern().size() - 1);
+
+	QByteArray chunk;
+	for(qint64 done = 0; done < string.length; done += TEXT_CHUNK)
+	{
+		qint64 first = qMax<qint64>(0, done - overlap);
+		qint64 n = qMin(string.length, done + TEXT_CHUNK) - first;
+
+		chunk.resize(n);
+		if(m_text.read(string.offset + first, n, chunk.data()) != n)
+			return false;
+
+		if(matcher.indexIn(chunk) >= 0)
+			return true;
+	}
+
+	return matcher.pattern().isEmpty();
+}
+
+
+qint64 TextIndex::size() const
+{
+	return m_entries.size();
+}
+
+
+qint64 TextIndex::row(qint64 i) const
+{
+	return m_entries.at(i).row;
+}
+
+
+int TextIndex::stringOf(qint64 i) const
+{
+	return m_entries.at(i).string;
+}
+
+
+qint64 TextIndex::read(qint64 first, qint64 count, TextEntry *out) const
+{
+	return m_entries.read(first, count, out);
+}
@@ -0,0 +1,74 @@
+#ifndef TEXT_INDEX_H_
+#define TEXT_INDEX_H_
+
+#include <QByteArray>
+#include <QVector>
+#include <QString>
+#include <QDir>
+
+#include "PacketIndex.h"
+#include "PagedArray.h"
+
+class GdpFile;
+class QByteArrayMatcher;
+
+// place of a string in the text store
+struct TextString
+{
+	qint64 offset;
+	qint64 length;
+};
+
+
+// caps or event packet and the number of its text
+struct TextEntry
+{
+	qint64 row;
+	qint64 string;
+};
+
+
+// Text of the caps and event packets of a dump, collected while the dump is
+// indexed. The payload of these packets is the serialized caps or structure
+// (tag lists included), so it is taken as is without decoding. Texts are
+// kept lower-cased in a paged store, and packets refer to them by number.
+// Repeated texts are found through a hash table of a fixed size, so a text
+// that was pushed out of it is stored again instead of shared.
+class TextIndex
+{
+	public:
+		explicit TextIndex(qint64 memoryBytes = 16 * 1024 * 1024);
+
+		bool open(const QString &dir = QDir::tempPath());
+
+		void add(qint64 row, const PacketRecord &record, GdpFile &file);
+
+		int stringCount() const;
+		bool contains(int id, const QByteArrayMatcher &matcher) const;
+
+		qint64 size() const;
+		qint64 row(qint64 i) const;
+		int stringOf(qint64 i) const;
+		qint64 read(qint64 first, qint64 count, TextEntry *out) const;
+
+	private:
+		Q_DISABLE_COPY(TextIndex)
+
+		struct Slot
+		{
+			quint64 hash;
+			qint32 id;
+		};
+
+		int find(quint64 hash, const char *text, qint64 length) const;
+		bool equals(int id, const char *text, qint64 length) const;
+		int store(quint64 hash, const char *text, qint64 length);
+
+		QVector<Slot> m_slots;
+		PagedArray<char> m_text;
+		PagedArray<TextString> m_strings;
+		PagedArray<TextEntry> m_entries;
+};
+
+
+#endif
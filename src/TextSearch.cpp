@@ -0,0 +1,145 @@
+#include "TextSearch.h"
+#include "TextIndex.h"
+
+#include <QRunnable>
+#include <QMutexLocker>
+#include <QByteArrayMatcher>
+
+// packets tested between two publications of the matches
+static const int BATCH_SIZE = 4096;
+
+class TextSearchTask: public QRunnable
+{
+	public:
+		TextSearchTask(TextSearch *psearch, int generation, const QByteArray &text):
+			m_psearch(psearch),
+			m_generation(generation),
+			m_text(text)
+		{
+		}
+
+		virtual void run()
+		{
+			m_psearch -> search(m_generation, m_text);
+		}
+
+	private:
+		TextSearch *m_psearch;
+		int m_generation;
+		QByteArray m_text;
+};
+
+
+TextSearch::TextSearch(QSharedPointer<TextIndex> pindex, QObject *parent):
+	QObject(parent),
+	m_pindex(pindex),
+	m_generation(0),
+	m_finished(1)
+{
+	m_pool.setMaxThreadCount(1);
+}
+
+
+TextSearch::~TextSearch()
+{
+	stop();
+	m_pool.waitForDone();
+}
+
+
+void TextSearch::start(const QString &text)
+{
+	stop();
+
+	{
+		QMutexLocker lock(&m_mutex);
+		m_matches.clear();
+	}
+
+	if(text.isEmpty())
+	{
+		emit finished();
+		return;
+	}
+
+	m_finished.store(0);
+	m_pool.start(new TextSearchTask(this, m_generation.load(), text.toUtf8().toLower()));
+}
+
+
+void TextSearch::stop()
+{
+	// a running search sees the new generation and gives up
+	m_generation.fetchAndAddRelaxed(1);
+	m_finished.store(1);
+}
+
+
+bool TextSearch::isFinished() const
+{
+	return m_finished.load();
+}
+
+
+QVector<qint64> TextSearch::matches() const
+{
+	QMutexLocker lock(&m_mutex);
+	return m_matches;
+}
+
+
+void TextSearch::search(int generation, const QByteArray &text)
+{
+	// 0 not tested yet, 1 matches, 2 does not
+	QVector<quint8> state(m_pindex -> stringCount(), 0);
+	QByteArrayMatcher matcher(text);
+	QVector<TextEntry> entries(BATCH_SIZE);
+	QVector<qint64> batch;
+
+	const qint64 size = m_pindex -> size();
+
+	for(qint64 first = 0; first < size; first += BATCH_SIZE)
+	{
+		qint64 read = m_pindex -> read(first, BATCH_SIZE, entries.data());
+		for(qint64 i = 0; i < read; i++)
+		{
+			int id = (int) entries[i].string;
+			if(id >= state.size())
+				state.resize(m_pindex -> stringCount());
+
+			if(!state[id])
+				state[id] = m_pindex -> contains(id, matcher) ? 1 : 2;
+
+			if(state[id] == 1)
+				batch.append(entries[i].row);
+		}
+
+		if(m_generation.load() != generation)
+			return;
+
+		if(batch.isEmpty())
+			continue;
+
+		qint64 count;
+		{
+			QMutexLocker lock(&m_mutex);
+
+			// start() clears the matches under the lock after moving on
+			// to a new generation
+			if(m_generation.load() != generation)
+				return;
+
+			m_matches += batch;
+			count = m_matches.size();
+		}
+
+		batch.clear();
+		emit matchesFound(count);
+	}
+
+	if(m_generation.load() == generation)
+	{
+		m_finished.store(1);
+		emit finished();
+	}
+}
@@ -0,0 +1,48 @@
+#ifndef TEXT_SEARCH_H_
+#define TEXT_SEARCH_H_
+
+#include <QObject>
+#include <QSharedPointer>
+#include <QThreadPool>
+#include <QMutex>
+#include <QVector>
+#include <QAtomicInt>
+
+class TextIndex;
+
+// Case-insensitive substring search over a TextIndex, run on a worker
+// thread. Every distinct string is tested once, the first time a packet
+// refers to it. Matching rows are published in index order in batches, so
+// the first matches can be shown while the rest of the dump is searched.
+class TextSearch: public QObject
+{
+	Q_OBJECT
+	public:
+		TextSearch(QSharedPointer<TextIndex> pindex, QObject *parent = 0);
+		~TextSearch();
+
+		void start(const QString &text);
+		void stop();
+
+		bool isFinished() const;
+		QVector<qint64> matches() const;
+
+	signals:
+		void matchesFound(qint64 count);
+		void finished();
+
+	private:
+		friend class TextSearchTask;
+
+		void search(int generation, const QByteArray &text);
+
+		QSharedPointer<TextIndex> m_pindex;
+		QThreadPool m_pool;
+		mutable QMutex m_mutex;
+		QVector<qint64> m_matches;
+		QAtomicInt m_generation;
+		QAtomicInt m_finished;
+};
+
+
+#endif
@@ -0,0 +1,608 @@
+#include "ThumbnailProvider.h"
+#include "GdpFile.h"
+#include "dataprotocol.h"
+
+#include <QRunnable>
+#include <QThread>
+#include <QMutexLocker>
+#include <QFileInfo>
+#include <QDir>
+#include <QDirIterator>
+#include <QMultiMap>
+#include <QFile>
+#include <QDateTime>
+#include <QCryptographicHash>
+#include <QStandardPaths>
+#include <QElapsedTimer>
+
+#include <gst/gst.h>
+#include <gst/app/gstappsrc.h>
+#include <gst/app/gstappsink.h>
+#include <gst/video/video.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+#include <sys/time.h>
+
+namespace
+{
+	// mirrors GstAutoplugSelectResult of decodebin, which is not in a public header
+	enum AutoplugSelectResult
+	{
+		AUTOPLUG_SELECT_TRY,
+		AUTOPLUG_SELECT_EXPOSE,
+		AUTOPLUG_SELECT_SKIP
+	};
+
+	// longest run of delta buffers fed to the decoder in front of a frame
+	const int MAX_GOP = 1000;
+
+	// time a decode pipeline may stay without producing a frame
+	const int DECODE_TIMEOUT = 10000;
+
+	// delta frames asked for on demand that keep showing a thumbnail
+	const int MAX_ON_DEMAND = 4096;
+
+	// size of the disk cache, and the age at which the thumbnails of a dump
+	// not opened since are removed
+	const qint64 DISK_CACHE_BYTES = Q_INT64_C(1024) * 1024 * 1024;
+	const int DISK_CACHE_DAYS = 30;
+
+	AutoplugSelectResult autoplugSelect(GstElement *, GstPad *, GstCaps *, GstElementFactory *pfactory, gpointer)
+	{
+		const gchar *klass = gst_element_factory_get_metadata(pfactory, GST_ELEMENT_METADATA_KLASS);
+
+		if(klass && strstr(klass, "Hardware"))
+			return AUTOPLUG_SELECT_SKIP;
+
+		return AUTOPLUG_SELECT_TRY;
+	}
+
+	QByteArray readCaps(GdpFile &file, const PacketRecord &record)
+	{
+		QByteArray res;
+
+		if(!record.payloadLength)
+			return res;
+
+		const guint8 *header = file.data(record.filePos, GST_DP_HEADER_LENGTH + (qint64) record.payloadLength);
+		if(!header)
+			return res;
+
+		const guint8 *payload = header + GST_DP_HEADER_LENGTH;
+		GstCaps *caps = NULL;
+
+		if(record.payloadType == GST_DP_PAYLOAD_CAPS)
+			caps = gst_dp_caps_from_packet(GST_DP_HEADER_LENGTH, header, payload);
+		else
+		{
+			GstEvent *event = gst_dp_event_from_packet(GST_DP_HEADER_LENGTH, header, payload);
+			if(event)
+			{
+				GstCaps *eventCaps = NULL;
+				gst_event_parse_caps(event, &eventCaps);
+				if(eventCaps)
+					caps = gst_caps_ref(eventCaps);
+				gst_event_unref(event);
+			}
+		}
+
+		if(caps)
+		{
+			gchar *str = gst_caps_to_string(caps);
+			res = str;
+			g_free(str);
+			gst_caps_unref(caps);
+		}
+
+		return res;
+	}
+
+	// Removes the directories under <root> of dumps not opened for
+	// DISK_CACHE_DAYS, then the least recently opened ones until the rest
+	// fit DISK_CACHE_BYTES. The directory of the open dump, <keep>, stays.
+	void pruneDiskCache(const QString &root, const QString &keep)
+	{
+		const QDateTime expiry = QDateTime::currentDateTime().addDays(-DISK_CACHE_DAYS);
+		QMultiMap<QDateTime, QString> dirs;
+		QHash<QString, qint64> sizes;
+		qint64 total = 0;
+
+		QDirIterator it(root, QDir::Dirs | QDir::NoDotAndDotDot);
+		while(it.hasNext())
+		{
+			QString dir = it.next();
+			qint64 size = 0;
+
+			QDirIterator files(dir, QDir::Files);
+			while(files.hasNext())
+			{
+				files.next();
+				size += files.fileInfo().size();
+			}
+
+			total += size;
+			if(QFileInfo(dir).absoluteFilePath() == QFileInfo(keep).absoluteFilePath())
+				continue;
+
+			QDateTime used = it.fileInfo().lastModified();
+			if(used < expiry)
+			{
+				QDir(dir).removeRecursively();
+				total -= size;
+				continue;
+			}
+
+			dirs.insert(used, dir);
+			sizes.insert(dir, size);
+		}
+
+		// oldest first
+		QMultiMap<QDateTime, QString>::const_iterator oldest;
+		for(oldest = dirs.constBegin(); oldest != dirs.constEnd() && total > DISK_CACHE_BYTES; ++oldest)
+		{
+			if(QDir(oldest.value()).removeRecursively())
+				total -= sizes.value(oldest.value());
+		}
+	}
+}
+
+
+class ThumbnailTask: public QRunnable
+{
+	public:
+		ThumbnailTask(ThumbnailProvider *pprovider, bool scan):
+			m_pprovider(pprovider),
+			m_scan(scan)
+		{
+		}
+
+		virtual void run()
+		{
+			if(m_scan)
+				m_pprovider -> scan();
+			else
+				m_pprovider -> work();
+		}
+
+	private:
+		ThumbnailProvider *m_pprovider;
+		bool m_scan;
+};
+
+
+ThumbnailProvider::ThumbnailProvider(QSharedPointer<PacketIndex> pindex, const QString &fileName, QObject *parent):
+	QObject(parent),
+	m_pindex(pindex),
+	m_fileName(fileName),
+	m_windowSize(64 * 1024 * 1024),
+	m_workers(0),
+	m_ready(0),
+	m_stopping(0),
+	m_video(false)
+{
+	m_pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() - 1));
+	setCacheSize(32 * 1024 * 1024);
+
+	QFileInfo info(fileName);
+	QByteArray key = info.absoluteFilePath().toUtf8() + ":" + QByteArray::number(info.size()) + ":" +
+		QByteArray::number(info.lastModified().toMSecsSinceEpoch());
+
+	m_cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/thumbnails/" +
+		QCryptographicHash::hash(key, QCryptographicHash::Sha1).toHex();
+	QDir().mkpath(m_cacheDir);
+
+	// the time of the directory tells when the dump was last opened
+	utimes(QFile::encodeName(m_cacheDir).constData(), NULL);
+
+	m_keyframes.open();
+}
+
+
+ThumbnailProvider::~ThumbnailProvider()
+{
+	m_stopping.store(1);
+
+	{
+		QMutexLocker locker(&m_mutex);
+		m_pending.clear();
+	}
+
+	m_pool.waitForDone();
+}
+
+
+QSharedPointer<PacketIndex> ThumbnailProvider::packetIndex() const
+{
+	return m_pindex;
+}
+
+
+void ThumbnailProvider::setCacheSize(qint64 bytes)
+{
+	QMutexLocker locker(&m_mutex);
+	m_cache.setMaxCost(qMax<qint64>(1, qMin<qint64>(bytes / 1024, INT_MAX)));
+}
+
+
+// the window is shared by the decoding workers
+void ThumbnailProvider::setWindowSize(qint64 bytes)
+{
+	m_windowSize = bytes;
+}
+
+
+void ThumbnailProvider::start()
+{
+	m_pool.start(new ThumbnailTask(this, true));
+}
+
+
+bool ThumbnailProvider::isReady() const
+{
+	return m_ready.loadAcquire();
+}
+
+
+bool ThumbnailProvider::isVideo() const
+{
+	return isReady() && m_video;
+}
+
+
+qint64 ThumbnailProvider::keyframeCount() const
+{
+	if(!isReady())
+		return 0;
+
+	return m_keyframes.size();
+}
+
+
+qint64 ThumbnailProvider::keyframe(qint64 i) const
+{
+	return m_keyframes.at(i);
+}
+
+
+qint64 ThumbnailProvider::keyframeIndex(qint64 row) const
+{
+	qint64 first = 0;
+	qint64 count = keyframeCount();
+
+	while(count > 0)
+	{
+		qint64 step = count / 2;
+		if(m_keyframes.at(first + step) < row)
+		{
+			first += step + 1;
+			count -= step + 1;
+		}
+		else
+			count = step;
+	}
+
+	return first < keyframeCount() && m_keyframes.at(first) == row ? first : -1;
+}
+
+
+bool ThumbnailProvider::hasThumbnail(qint64 row, const PacketRecord &record) const
+{
+	if(!isVideo() || record.payloadType != GST_DP_PAYLOAD_BUFFER)
+		return false;
+
+	if(!(record.bufferFlags & GST_BUFFER_FLAG_DELTA_UNIT))
+		return true;
+
+	QMutexLocker locker(&m_mutex);
+	return m_onDemand.contains(row);
+}
+
+
+QImage ThumbnailProvider::thumbnail(qint64 row, Priority priority)
+{
+	{
+		QMutexLocker locker(&m_mutex);
+		QImage *pimage = m_cache.object(row);
+		if(pimage)
+			return *pimage;
+	}
+
+	request(row, priority);
+	return QImage();
+}
+
+
+void ThumbnailProvider::request(qint64 row, Priority priority)
+{
+	if(!isVideo())
+		return;
+
+	QMutexLocker locker(&m_mutex);
+
+	if(priority == OnDemand && !m_onDemand.contains(row))
+	{
+		m_onDemand.insert(row);
+		m_onDemandOrder.enqueue(row);
+		if(m_onDemandOrder.size() > MAX_ON_DEMAND)
+			m_onDemand.remove(m_onDemandOrder.dequeue());
+	}
+
+	if(m_cache.contains(row) || m_running.contains(row))
+		return;
+
+	QHash<qint64, int>::iterator it = m_pending.find(row);
+	if(it != m_pending.end())
+	{
+		*it = qMax<int>(*it, priority);
+		return;
+	}
+
+	m_pending.insert(row, priority);
+
+	if(m_workers < m_pool.maxThreadCount())
+	{
+		m_workers++;
+		m_pool.start(new ThumbnailTask(this, false));
+	}
+}
+
+
+void ThumbnailProvider::dropRequests(Priority priority)
+{
+	QMutexLocker locker(&m_mutex);
+
+	QHash<qint64, int>::iterator it = m_pending.begin();
+	while(it != m_pending.end())
+	{
+		if(*it == priority)
+			it = m_pending.erase(it);
+		else
+			++it;
+	}
+}
+
+
+void ThumbnailProvider::scan()
+{
+	pruneDiskCache(QFileInfo(m_cacheDir).absolutePath(), m_cacheDir);
+
+	GdpFile file;
+	file.open(m_fileName);
+	file.setWindowSize(4 * 1024 * 1024);
+
+	bool video = false;
+	QVector<PacketRecord> chunk(65536);
+	QVector<qint64> keyframes;
+	const qint64 size = m_pindex -> size();
+
+	for(qint64 first = 0; first < size && !m_stopping.load(); first += chunk.size())
+	{
+		qint64 count = m_pindex -> read(first, chunk.size(), chunk.data());
+		keyframes.clear();
+
+		for(qint64 i = 0; i < count; i++)
+		{
+			const PacketRecord &record = chunk[i];
+
+			if(record.payloadType == GST_DP_PAYLOAD_BUFFER)
+			{
+				if(video && !(record.bufferFlags & GST_BUFFER_FLAG_DELTA_UNIT))
+					keyframes.append(first + i);
+			}
+			else if(record.payloadType == GST_DP_PAYLOAD_CAPS ||
+				record.payloadType == GST_DP_PAYLOAD_EVENT_NONE + GST_EVENT_CAPS)
+			{
+				QByteArray caps = readCaps(file, record);
+				if(caps.isEmpty())
+					continue;
+
+				m_capsRows.append(first + i);
+				m_caps.append(caps);
+
+				video = caps.startsWith("video/") || caps.startsWith("image/");
+				m_video = m_video || video;
+			}
+		}
+
+		m_keyframes.append(keyframes.constData(), keyframes.size());
+	}
+
+	m_ready.storeRelease(1);
+	emit ready();
+}
+
+
+void ThumbnailProvider::work()
+{
+	qint64 row;
+	while(takeRequest(&row))
+	{
+		QImage image = decode(row);
+
+		{
+			QMutexLocker locker(&m_mutex);
+			m_running.remove(row);
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+			qint64 bytes = image.sizeInBytes();
+#else
+			qint64 bytes = image.byteCount();
+#endif
+			m_cache.insert(row, new QImage(image), qMax<qint64>(1, bytes / 1024));
+		}
+
+		emit thumbnailReady(row);
+	}
+}
+
+
+bool ThumbnailProvider::takeRequest(qint64 *prow)
+{
+	QMutexLocker locker(&m_mutex);
+
+	if(m_stopping.load() || m_pending.isEmpty())
+	{
+		m_workers--;
+		return false;
+	}
+
+	QHash<qint64, int>::iterator best = m_pending.begin();
+	for(QHash<qint64, int>::iterator it = m_pending.begin(); it != m_pending.end(); ++it)
+		if(*it > *best)
+			best = it;
+
+	*prow = best.key();
+	m_pending.erase(best);
+	m_running.insert(*prow);
+
+	return true;
+}
+
+
+QImage ThumbnailProvider::decode(qint64 row)
+{
+	PacketRecord target = m_pindex -> at(row);
+	QString path = diskPath(target.filePos);
+
+	QImage image;
+	if(image.load(path))
+		return image;
+
+	int capsIndex = std::upper_bound(m_capsRows.begin(), m_capsRows.end(), row) - m_capsRows.begin() - 1;
+	if(capsIndex < 0)
+		return image;
+
+	// start from the closest keyframe so the decoder has a reference
+	qint64 first = row;
+	for(int steps = 0; steps < MAX_GOP && first > m_capsRows[capsIndex] + 1; steps++)
+	{
+		PacketRecord record = m_pindex -> at(first);
+		if(record.payloadType == GST_DP_PAYLOAD_BUFFER && !(record.bufferFlags & GST_BUFFER_FLAG_DELTA_UNIT))
+			break;
+		first--;
+	}
+
+	QByteArray description = "appsrc name=src format=time ! decodebin name=dec ! videoconvert ! videoscale ! "
+		"video/x-raw,format=RGB,pixel-aspect-ratio=1/1,width=" + QByteArray::number(WIDTH) + " ! appsink name=sink sync=false";
+
+	GError *perror = NULL;
+	GstElement *ppipeline = gst_parse_launch(description.constData(), &perror);
+
+	if(!ppipeline)
+	{
+		g_clear_error(&perror);
+		return image;
+	}
+
+	GstElement *psrc = gst_bin_get_by_name(GST_BIN(ppipeline), "src");
+	GstElement *pdec = gst_bin_get_by_name(GST_BIN(ppipeline), "dec");
+	GstElement *psink = gst_bin_get_by_name(GST_BIN(ppipeline), "sink");
+	GstBus *pbus = gst_element_get_bus(ppipeline);
+
+	g_signal_connect(pdec, "autoplug-select", G_CALLBACK(autoplugSelect), NULL);
+
+	GstCaps *pcaps = gst_caps_from_string(m_caps[capsIndex].constData());
+	gst_app_src_set_caps(GST_APP_SRC(psrc), pcaps);
+	if(pcaps)
+		gst_caps_unref(pcaps);
+
+	gst_element_set_state(ppipeline, GST_STATE_PLAYING);
+
+	GdpFile file;
+	file.open(m_fileName);
+	file.setWindowSize(m_windowSize / m_pool.maxThreadCount());
+
+	for(qint64 i = first; i <= row && !m_stopping.load(); i++)
+	{
+		PacketRecord record = m_pindex -> at(i);
+		if(record.payloadType != GST_DP_PAYLOAD_BUFFER || !record.payloadLength)
+			continue;
+
+		const guint8 *data = file.data(record.filePos + GST_DP_HEADER_LENGTH, record.payloadLength);
+		if(!data)
+			break;
+
+		GstBuffer *pbuffer = gst_buffer_new_allocate(NULL, record.payloadLength, NULL);
+		gst_buffer_fill(pbuffer, 0, data, record.payloadLength);
+		GST_BUFFER_PTS(pbuffer) = record.timestamp;
+		GST_BUFFER_DURATION(pbuffer) = record.duration;
+		GST_BUFFER_OFFSET(pbuffer) = record.offset;
+		GST_BUFFER_OFFSET_END(pbuffer) = record.offsetEnd;
+		GST_BUFFER_FLAGS(pbuffer) = record.bufferFlags;
+
+		if(gst_app_src_push_buffer(GST_APP_SRC(psrc), pbuffer) != GST_FLOW_OK)
+			break;
+	}
+
+	gst_app_src_end_of_stream(GST_APP_SRC(psrc));
+
+	GstSample *plast = NULL;
+	QElapsedTimer timer;
+	timer.start();
+
+	while(!m_stopping.load() && timer.elapsed() < DECODE_TIMEOUT)
+	{
+		GstSample *psample = gst_app_sink_try_pull_sample(GST_APP_SINK(psink), 100 * GST_MSECOND);
+
+		if(!psample)
+		{
+			if(gst_app_sink_is_eos(GST_APP_SINK(psink)))
+				break;
+
+			GstMessage *pmsg = gst_bus_pop_filtered(pbus, GST_MESSAGE_ERROR);
+			if(pmsg)
+			{
+				gst_message_unref(pmsg);
+				break;
+			}
+
+			continue;
+		}
+
+		bool exact = GST_BUFFER_PTS(gst_sample_get_buffer(psample)) == target.timestamp;
+
+		if(plast)
+			gst_sample_unref(plast);
+		plast = psample;
+
+		if(exact)
+			break;
+	}
+
+	if(plast)
+	{
+		GstVideoInfo info;
+		GstMapInfo map;
+		GstBuffer *pbuffer = gst_sample_get_buffer(plast);
+
+		if(gst_video_info_from_caps(&info, gst_sample_get_caps(plast)) && gst_buffer_map(pbuffer, &map, GST_MAP_READ))
+		{
+			image = QImage(map.data, GST_VIDEO_INFO_WIDTH(&info), GST_VIDEO_INFO_HEIGHT(&info),
+				GST_VIDEO_INFO_PLANE_STRIDE(&info, 0), QImage::Format_RGB888).copy();
+			gst_buffer_unmap(pbuffer, &map);
+		}
+
+		gst_sample_unref(plast);
+	}
+
+	gst_element_set_state(ppipeline, GST_STATE_NULL);
+
+	gst_object_unref(pbus);
+	gst_object_unref(psink);
+	gst_object_unref(pdec);
+	gst_object_unref(psrc);
+	gst_object_unref(ppipeline);
+
+	if(!image.isNull())
+		image.save(path, "JPG");
+
+	return image;
+}
+
+
+QString ThumbnailProvider::diskPath(qint64 filePos) const
+{
+	return m_cacheDir + "/" + QString::number(filePos) + ".jpg";
+}
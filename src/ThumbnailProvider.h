@@ -0,0 +1,99 @@
+#ifndef THUMBNAIL_PROVIDER_H_
+#define THUMBNAIL_PROVIDER_H_
+
+#include <QObject>
+#include <QSharedPointer>
+#include <QThreadPool>
+#include <QMutex>
+#include <QHash>
+#include <QSet>
+#include <QCache>
+#include <QImage>
+#include <QVector>
+#include <QByteArray>
+#include <QAtomicInt>
+#include <QQueue>
+
+#include "PacketIndex.h"
+#include "PagedArray.h"
+
+// Decodes video buffers of a dump into small images. Requests are queued by
+// priority and served by a pool of worker threads, each running its own
+// appsrc ! decodebin ! videoconvert ! videoscale ! appsink pipeline built from
+// the caps recorded in the dump. Only software decoders are used. Results are
+// kept in a memory cache and in a per-dump directory of the disk cache; the
+// directories of other dumps are removed when old or over the size of the
+// disk cache. Keyframe rows are kept in a paged array.
+class ThumbnailProvider: public QObject
+{
+	Q_OBJECT
+	public:
+		enum Priority
+		{
+			Background,
+			Strip,
+			Visible,
+			OnDemand
+		};
+
+		ThumbnailProvider(QSharedPointer<PacketIndex> pindex, const QString &fileName, QObject *parent = 0);
+		~ThumbnailProvider();
+
+		QSharedPointer<PacketIndex> packetIndex() const;
+
+		void setCacheSize(qint64 bytes);
+		void setWindowSize(qint64 bytes);
+		void start();
+
+		bool isReady() const;
+		bool isVideo() const;
+		qint64 keyframeCount() const;
+		qint64 keyframe(qint64 i) const;
+
+		// number of the keyframe at <row>, or -1
+		qint64 keyframeIndex(qint64 row) const;
+
+		bool hasThumbnail(qint64 row, const PacketRecord &record) const;
+		QImage thumbnail(qint64 row, Priority priority);
+		void request(qint64 row, Priority priority);
+		void dropRequests(Priority priority);
+
+		static const int WIDTH = 160;
+
+	signals:
+		void ready();
+		void thumbnailReady(qint64 row);
+
+	private:
+		friend class ThumbnailTask;
+
+		void scan();
+		void work();
+		bool takeRequest(qint64 *prow);
+		QImage decode(qint64 row);
+		QString diskPath(qint64 filePos) const;
+
+		QSharedPointer<PacketIndex> m_pindex;
+		QString m_fileName;
+		QString m_cacheDir;
+
+		QThreadPool m_pool;
+		qint64 m_windowSize;
+		mutable QMutex m_mutex;
+		QHash<qint64, int> m_pending;
+		QSet<qint64> m_running;
+		QSet<qint64> m_onDemand;
+		QQueue<qint64> m_onDemandOrder;
+		QCache<qint64, QImage> m_cache;
+		int m_workers;
+
+		QAtomicInt m_ready;
+		QAtomicInt m_stopping;
+		bool m_video;
+		PagedArray<qint64> m_keyframes;
+		QVector<qint64> m_capsRows;
+		QVector<QByteArray> m_caps;
+};
+
+
+#endif
@@ -0,0 +1,125 @@
+#include "ThumbnailStrip.h"
+#include "ThumbnailProvider.h"
+#include "PacketModel.h"
+
+#include <QScrollBar>
+
+#include <climits>
+
+ThumbnailStripModel::ThumbnailStripModel(ThumbnailProvider *pprovider, QObject *parent):
+	QAbstractListModel(parent),
+	m_pprovider(pprovider),
+	m_count(0)
+{
+	connect(m_pprovider, SIGNAL(ready()), SLOT(slotReady()));
+	connect(m_pprovider, SIGNAL(thumbnailReady(qint64)), SLOT(slotThumbnailReady(qint64)));
+
+	if(m_pprovider -> isReady())
+		slotReady();
+}
+
+
+qint64 ThumbnailStripModel::packetRow(int row) const
+{
+	if(row < 0 || row >= m_count)
+		return -1;
+
+	return m_pprovider -> keyframe(row);
+}
+
+
+int ThumbnailStripModel::rowCount(const QModelIndex &parent) const
+{
+	if(parent.isValid())
+		return 0;
+
+	return m_count;
+}
+
+
+QVariant ThumbnailStripModel::data(const QModelIndex &index, int role) const
+{
+	if(!index.isValid() || index.row() >= m_count)
+		return QVariant();
+
+	qint64 row = m_pprovider -> keyframe(index.row());
+
+	if(role == Qt::DisplayRole)
+		return PacketModel::title(m_pprovider -> packetIndex() -> at(row));
+	else if(role == Qt::DecorationRole)
+	{
+		QImage image = m_pprovider -> thumbnail(row, ThumbnailProvider::Strip);
+		if(!image.isNull())
+			return image;
+	}
+
+	return QVariant();
+}
+
+
+void ThumbnailStripModel::slotReady()
+{
+	beginResetModel();
+	// the keyframes stay in the provider, the strip shows as many as a view
+	// can have rows
+	m_count = (int) qMin<qint64>(m_pprovider -> keyframeCount(), INT_MAX);
+	endResetModel();
+}
+
+
+void ThumbnailStripModel::slotThumbnailReady(qint64 row)
+{
+	qint64 i = m_pprovider -> keyframeIndex(row);
+
+	if(i >= 0 && i < m_count)
+	{
+		QModelIndex idx = index((int) i);
+		emit dataChanged(idx, idx);
+	}
+}
+
+
+ThumbnailStrip::ThumbnailStrip(QWidget *parent):
+	QListView(parent),
+	m_pprovider(NULL),
+	m_pmodel(NULL)
+{
+	setViewMode(QListView::IconMode);
+	setFlow(QListView::LeftToRight);
+	setWrapping(false);
+	setMovement(QListView::Static);
+	setUniformItemSizes(true);
+	setIconSize(QSize(ThumbnailProvider::WIDTH, ThumbnailProvider::WIDTH * 9 / 16));
+	setHorizontalScrollMode(QAbstractItemView::ScrollPerPixel);
+
+	connect(this, SIGNAL(activated(const QModelIndex &)), SLOT(slotActivated(const QModelIndex &)));
+	connect(horizontalScrollBar(), SIGNAL(valueChanged(int)), SLOT(slotScrolled()));
+}
+
+
+void ThumbnailStrip::setProvider(ThumbnailProvider *pprovider)
+{
+	QAbstractItemModel *pold = model();
+
+	m_pprovider = pprovider;
+	m_pmodel = pprovider ? new ThumbnailStripModel(pprovider, this) : NULL;
+	setModel(m_pmodel);
+
+	delete pold;
+}
+
+
+void ThumbnailStrip::slotActivated(const QModelIndex &index)
+{
+	if(m_pmodel)
+		emit packetActivated(m_pmodel -> packetRow(index.row()));
+}
+
+
+void ThumbnailStrip::slotScrolled()
+{
+	// requests of items scrolled out are dropped, the ones in view come back
+	// through data() on the next paint
+	if(m_pprovider)
+		m_pprovider -> dropRequests(ThumbnailProvider::Strip);
+}
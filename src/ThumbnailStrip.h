@@ -0,0 +1,53 @@
+#ifndef THUMBNAIL_STRIP_H_
+#define THUMBNAIL_STRIP_H_
+
+#include <QListView>
+#include <QAbstractListModel>
+
+class ThumbnailProvider;
+
+class ThumbnailStripModel: public QAbstractListModel
+{
+	Q_OBJECT
+	public:
+		ThumbnailStripModel(ThumbnailProvider *pprovider, QObject *parent = 0);
+
+		qint64 packetRow(int row) const;
+
+		virtual int rowCount(const QModelIndex &parent = QModelIndex()) const;
+		virtual QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+
+	public slots:
+		void slotReady();
+		void slotThumbnailReady(qint64 row);
+
+	private:
+		ThumbnailProvider *m_pprovider;
+		int m_count;
+};
+
+
+// Horizontal strip of keyframe thumbnails. Only the items in view ask the
+// provider for images, so decoding follows scrolling.
+class ThumbnailStrip: public QListView
+{
+	Q_OBJECT
+	public:
+		ThumbnailStrip(QWidget *parent = 0);
+
+		void setProvider(ThumbnailProvider *pprovider);
+
+	signals:
+		void packetActivated(qint64 row);
+
+	private slots:
+		void slotActivated(const QModelIndex &index);
+		void slotScrolled();
+
+	private:
+		ThumbnailProvider *m_pprovider;
+		ThumbnailStripModel *m_pmodel;
+};
+
+
+#endif
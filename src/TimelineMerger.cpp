@@ -0,0 +1,260 @@
+#include "TimelineMerger.h"
+#include "PacketIndex.h"
+#include "dataprotocol.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+
+#include <gst/gst.h>
+
+#include <cstring>
+#include <queue>
+#include <set>
+#include <vector>
+
+// records read from each index at a time
+static const int BATCH_SIZE = 4096;
+
+const gint64 TimelineMerger::NO_GAP = G_MININT64;
+
+namespace
+{
+	struct Cursor
+	{
+		QVector<PacketRecord> records;
+		int pos;
+		int count;
+		qint64 next;
+		guint64 time;
+		guint64 lastBuffer;
+		guint64 lastEnd;
+	};
+
+	struct HeapEntry
+	{
+		guint64 time;
+		int source;
+	};
+
+	// time the next packet of the dump goes into the timeline at
+	guint64 nextTime(const Cursor &cursor, TimelineMerger::Key key)
+	{
+		const PacketRecord &record = cursor.records[cursor.pos];
+		if(record.payloadType != GST_DP_PAYLOAD_BUFFER)
+			return cursor.time;
+
+		guint64 time = key == TimelineMerger::RunningTime && GST_CLOCK_TIME_IS_VALID(record.runningTime) ? record.runningTime : record.timestamp;
+		return GST_CLOCK_TIME_IS_VALID(time) ? qMax(cursor.time, time) : cursor.time;
+	}
+
+	// greater, for a min-heap; equal times keep the order of the sources
+	struct HeapEntryGreater
+	{
+		bool operator()(const HeapEntry &a, const HeapEntry &b) const
+		{
+			return a.time > b.time || (a.time == b.time && a.source > b.source);
+		}
+	};
+}
+
+
+TimelineMerger::TimelineMerger(QObject *parent):
+	QObject(parent),
+	m_key(RunningTime),
+	m_maxMappedBytes(64 * 1024 * 1024),
+	m_cancel(0)
+{
+}
+
+
+void TimelineMerger::addSource(const QString &name, QSharedPointer<PacketIndex> pindex)
+{
+	m_names.append(name);
+	m_indexes.append(pindex);
+}
+
+
+void TimelineMerger::setKey(Key key)
+{
+	m_key = key;
+}
+
+
+void TimelineMerger::setMaxMappedBytes(qint64 bytes)
+{
+	m_maxMappedBytes = bytes;
+}
+
+
+QString TimelineMerger::errorString() const
+{
+	return m_error;
+}
+
+
+int TimelineMerger::sourceCount() const
+{
+	return m_indexes.size();
+}
+
+
+QString TimelineMerger::sourceName(int source) const
+{
+	return m_names.value(source);
+}
+
+
+QSharedPointer<PacketIndex> TimelineMerger::packetIndex(int source) const
+{
+	return m_indexes.value(source);
+}
+
+
+qint64 TimelineMerger::size() const
+{
+	return m_records.size();
+}
+
+
+MergedRecord TimelineMerger::at(qint64 row) const
+{
+	return m_records.at(row);
+}
+
+
+qint64 TimelineMerger::read(qint64 first, qint64 count, MergedRecord *out) const
+{
+	return m_records.read(first, count, out);
+}
+
+
+void TimelineMerger::cancel()
+{
+	m_cancel.store(1);
+}
+
+
+bool TimelineMerger::run()
+{
+	m_cancel.store(0);
+	m_error.clear();
+
+	if(!m_records.open(QDir::tempPath()))
+	{
+		m_error = "Problem with creating merged index in `" + QDir::tempPath() + "`";
+		return false;
+	}
+	m_records.setMaxMappedBytes(m_maxMappedBytes);
+
+	const int sources = m_indexes.size();
+	QVector<Cursor> cursors(sources);
+	std::priority_queue<HeapEntry, std::vector<HeapEntry>, HeapEntryGreater> heap;
+
+	// last buffer times of the dumps that have started and not ended, to
+	// find the slowest one
+	std::multiset<guint64> running;
+
+	qint64 total = 0;
+	for(int i = 0; i < sources; i++)
+	{
+		Cursor &cursor = cursors[i];
+		cursor.records.resize(BATCH_SIZE);
+		cursor.pos = 0;
+		cursor.count = m_indexes[i] -> read(0, BATCH_SIZE, cursor.records.data());
+		cursor.next = cursor.count;
+		cursor.time = 0;
+		cursor.lastBuffer = GST_CLOCK_TIME_NONE;
+		cursor.lastEnd = GST_CLOCK_TIME_NONE;
+		total += m_indexes[i] -> size();
+
+		if(cursor.count > 0)
+		{
+			HeapEntry entry;
+			entry.time = nextTime(cursor, m_key);
+			entry.source = i;
+			heap.push(entry);
+		}
+	}
+
+	QElapsedTimer timer;
+	timer.start();
+
+	qint64 done = 0;
+	while(!heap.empty())
+	{
+		const int source = heap.top().source;
+		heap.pop();
+
+		Cursor &cursor = cursors[source];
+		const PacketRecord &record = cursor.records[cursor.pos];
+
+		MergedRecord merged;
+		memset(&merged, 0, sizeof(merged));
+		merged.row = cursor.next - cursor.count + cursor.pos;
+		merged.source = source;
+		merged.gap = NO_GAP;
+		merged.lead = GST_CLOCK_TIME_NONE;
+
+		guint64 time = m_key == RunningTime && GST_CLOCK_TIME_IS_VALID(record.runningTime) ? record.runningTime : record.timestamp;
+		if(record.payloadType == GST_DP_PAYLOAD_BUFFER && GST_CLOCK_TIME_IS_VALID(time))
+		{
+			if(GST_CLOCK_TIME_IS_VALID(cursor.lastEnd))
+				merged.gap = (gint64) time - (gint64) cursor.lastEnd;
+
+			if(GST_CLOCK_TIME_IS_VALID(cursor.lastBuffer))
+				running.erase(running.find(cursor.lastBuffer));
+
+			// the slowest of the others; this dump is the only one left if
+			// its own time is the smallest
+			std::multiset<guint64>::const_iterator slowest = running.begin();
+			merged.lead = slowest == running.end() ? 0 : (time > *slowest ? time - *slowest : 0);
+
+			// timestamps going back do not take the dump back in the timeline
+			cursor.time = qMax(cursor.time, time);
+			cursor.lastBuffer = cursor.time;
+			cursor.lastEnd = time + (GST_CLOCK_TIME_IS_VALID(record.duration) ? record.duration : 0);
+			running.insert(cursor.lastBuffer);
+		}
+		merged.time = cursor.time;
+
+		if(!m_records.append(merged))
+		{
+			m_error = "Problem with writing merged index in `" + QDir::tempPath() + "`";
+			return false;
+		}
+
+		cursor.pos++;
+		if(cursor.pos == cursor.count)
+		{
+			cursor.pos = 0;
+			cursor.count = m_indexes[source] -> read(cursor.next, BATCH_SIZE, cursor.records.data());
+			cursor.next += cursor.count;
+		}
+
+		if(cursor.count > 0)
+		{
+			HeapEntry entry;
+			entry.time = nextTime(cursor, m_key);
+			entry.source = source;
+			heap.push(entry);
+		}
+		else if(GST_CLOCK_TIME_IS_VALID(cursor.lastBuffer))
+			running.erase(running.find(cursor.lastBuffer));
+
+		done++;
+		if(timer.elapsed() > 50)
+		{
+			emit progress(done, total);
+			timer.restart();
+
+			if(m_cancel.load())
+			{
+				m_error = "Merge cancelled";
+				return false;
+			}
+		}
+	}
+
+	emit progress(total, total);
+	return true;
+}
@@ -0,0 +1,88 @@
+#ifndef TIMELINE_MERGER_H_
+#define TIMELINE_MERGER_H_
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QSharedPointer>
+#include <QVector>
+#include <QAtomicInt>
+
+#include <glib.h>
+
+#include "PagedArray.h"
+
+class PacketIndex;
+
+// One packet of the merged timeline: where it comes from and how it stands
+// against the packets of the other dumps.
+struct MergedRecord
+{
+	qint64 row;
+	guint64 time;
+	gint64 gap;
+	guint64 lead;
+	quint32 source;
+	quint32 reserved;
+};
+
+// Interleaves the packets of several dumps of one pipeline, each already
+// indexed, into a single timeline ordered by running time or by PTS. The
+// indexes are read in batches through a heap holding one candidate per
+// dump, so the work is O(n log k) and the memory does not depend on the
+// size of the dumps; the result is a PagedArray like the indexes.
+//
+// Caps, events and buffers without the time take the time of the last
+// buffer of their dump, so every dump keeps its own order even where its
+// timestamps are not monotonic, as with reordered video. For buffers, the
+// gap is the distance from the end of the previous buffer of the same dump
+// and the lead how far the buffer is ahead of the last buffer of the
+// slowest other dump that is still running; a stalled or drifting stream
+// shows as a growing lead of the others.
+class TimelineMerger: public QObject
+{
+	Q_OBJECT
+	public:
+		enum Key
+		{
+			RunningTime,
+			Pts
+		};
+
+		static const gint64 NO_GAP;
+
+		explicit TimelineMerger(QObject *parent = 0);
+
+		void addSource(const QString &name, QSharedPointer<PacketIndex> pindex);
+		void setKey(Key key);
+		void setMaxMappedBytes(qint64 bytes);
+
+		bool run();
+		QString errorString() const;
+
+		int sourceCount() const;
+		QString sourceName(int source) const;
+		QSharedPointer<PacketIndex> packetIndex(int source) const;
+
+		qint64 size() const;
+		MergedRecord at(qint64 row) const;
+		qint64 read(qint64 first, qint64 count, MergedRecord *out) const;
+
+	public slots:
+		void cancel();
+
+	signals:
+		void progress(qint64 done, qint64 total);
+
+	private:
+		QStringList m_names;
+		QVector<QSharedPointer<PacketIndex> > m_indexes;
+		Key m_key;
+		qint64 m_maxMappedBytes;
+		PagedArray<MergedRecord> m_records;
+		QAtomicInt m_cancel;
+		QString m_error;
+};
+
+
+#endif
@@ -0,0 +1,256 @@
+#include "VideoAnalytics.h"
+#include "GdpFile.h"
+#include "dataprotocol.h"
+
+#include <QDir>
+
+#include <cstring>
+
+// consecutive frames handed to a worker at a time; the frame before each
+// run is read again for the difference of the first one
+static const int CHUNK = 32;
+
+// frames stored and flagged at a time
+static const int BATCH = 65536;
+
+// thresholds on 8-bit luma
+static const float BLACK_MEAN = 24;
+static const float BLACK_VARIANCE = 16;
+static const float FROZEN_DIFFERENCE = 0.05f;
+static const float JUMP_MEAN = 40;
+
+VideoAnalytics::VideoAnalytics(QSharedPointer<PacketIndex> pindex, const QString &fileName, QObject *parent):
+	Analyzer(pindex, fileName, CHUNK, parent),
+	m_layout(-1),
+	m_ok(true)
+{
+	m_counts[0] = m_counts[1] = m_counts[2] = 0;
+	m_frames.setMaxMappedBytes(16 * 1024 * 1024);
+}
+
+
+VideoAnalytics::~VideoAnalytics()
+{
+	stop();
+}
+
+
+qint64 VideoAnalytics::frameCount() const
+{
+	return isReady() ? m_frames.size() : 0;
+}
+
+
+VideoAnalytics::Frame VideoAnalytics::frame(qint64 i) const
+{
+	return m_frames.at(i);
+}
+
+
+qint64 VideoAnalytics::readFrames(qint64 first, qint64 count, Frame *out) const
+{
+	return m_frames.read(first, count, out);
+}
+
+
+qint64 VideoAnalytics::frameOfPacket(qint64 row) const
+{
+	const qint64 frames = frameCount();
+	qint64 low = 0, high = frames;
+	while(low < high)
+	{
+		qint64 middle = low + (high - low) / 2;
+		if(m_frames.at(middle).row < row)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	return low < frames && m_frames.at(low).row == row ? low : -1;
+}
+
+
+qint64 VideoAnalytics::count(int flag) const
+{
+	if(!isReady())
+		return 0;
+
+	switch(flag)
+	{
+		case Black: return m_counts[0];
+		case Frozen: return m_counts[1];
+		case Jump: return m_counts[2];
+	}
+
+	return 0;
+}
+
+
+bool VideoAnalytics::scanPacket(qint64 row, const PacketRecord &record, GstCaps *pcaps)
+{
+	if(pcaps)
+	{
+		VideoLayout video = VideoStats::layoutFromCaps(pcaps);
+		m_layout = video.valid ? m_layouts.size() : -1;
+		if(m_layout >= 0)
+			m_layouts.append(video);
+	}
+	else if(record.payloadType == GST_DP_PAYLOAD_BUFFER && m_layout >= 0 &&
+		record.payloadLength >= m_layouts[m_layout].size)
+	{
+		Frame frame;
+		frame.row = row;
+		frame.mean = frame.variance = 0;
+		frame.difference = -1;
+		frame.layout = m_layout;
+		frame.flags = 0;
+		m_pending.append(frame);
+
+		if(m_pending.size() == BATCH)
+			m_ok = flushFrames();
+	}
+
+	return m_ok;
+}
+
+
+bool VideoAnalytics::flushFrames()
+{
+	if(m_pending.isEmpty())
+		return true;
+
+	if(!m_frames.isOpen() && !m_frames.open(QDir::tempPath()))
+		return false;
+
+	bool res = m_frames.append(m_pending.constData(), m_pending.size());
+	m_pending.clear();
+
+	return res;
+}
+
+
+qint64 VideoAnalytics::prepare()
+{
+	m_ok = m_ok && flushFrames();
+	if(!m_ok)
+		m_frames.close();
+
+	return m_frames.size();
+}
+
+
+void VideoAnalytics::process(GdpFile &file, qint64 first, qint64 last)
+{
+	// the run is read with the frame before it, at frames[0]
+	qint64 start = qMax<qint64>(0, first - 1);
+	QVector<Frame> frames(last - start);
+	qint64 count = m_frames.read(start, frames.size(), frames.data());
+	int offset = (int) (first - start);
+
+	QByteArray current, previous;
+	bool hasPrevious = false;
+
+	if(offset && count > 1 && frames[0].layout == frames[1].layout)
+	{
+		Frame frame = frames[0];
+		PacketRecord record = m_pindex -> at(frame.row);
+		const guint8 *payload = file.data(record.filePos + GST_DP_HEADER_LENGTH, m_layouts[frame.layout].size);
+
+		if(payload)
+		{
+			measureFrame(frame, payload, previous, NULL);
+			hasPrevious = true;
+		}
+	}
+
+	for(int i = offset; i < count; i++)
+	{
+		Frame &frame = frames[i];
+		PacketRecord record = m_pindex -> at(frame.row);
+		const guint8 *payload = file.data(record.filePos + GST_DP_HEADER_LENGTH, m_layouts[frame.layout].size);
+
+		if(!payload)
+		{
+			hasPrevious = false;
+			continue;
+		}
+
+		bool sameLayout = i > offset ? frames[i - 1].layout == frame.layout : true;
+		measureFrame(frame, payload, current, hasPrevious && sameLayout ? &previous : NULL);
+
+		qSwap(current, previous);
+		hasPrevious = true;
+	}
+
+	m_frames.write(first, count - offset, frames.constData() + offset);
+}
+
+
+void VideoAnalytics::measureFrame(Frame &frame, const guint8 *payload, QByteArray &current, const QByteArray *pprevious)
+{
+	const VideoLayout &layout = m_layouts[frame.layout];
+
+	// the luma of the frame is kept for the difference with the next one
+	current.resize(layout.width * layout.height);
+	guint8 *pcurrent = (guint8 *) current.data();
+	const guint8 *pprevLuma = pprevious ? (const guint8 *) pprevious -> constData() : NULL;
+
+	quint64 sum = 0, squares = 0, difference = 0;
+
+	for(int y = 0; y < layout.height; y++)
+	{
+		const guint8 *row = payload + layout.offset + (gsize) y * layout.stride;
+		guint8 *pluma = pcurrent + (gsize) y * layout.width;
+
+		if(layout.rgb)
+			VideoStats::rgbToLuma(layout, row, pluma);
+		else
+			memcpy(pluma, row, layout.width);
+
+		VideoStats::accumulate(pluma, pprevLuma ? pprevLuma + (gsize) y * layout.width : NULL, layout.width, &sum, &squares, &difference);
+	}
+
+	const double pixels = qMax(1.0, (double) layout.width * layout.height);
+	double mean = sum / pixels;
+
+	frame.mean = mean;
+	frame.variance = qMax(0.0, squares / pixels - mean * mean);
+	frame.difference = pprevLuma ? difference / pixels : -1;
+}
+
+
+// frames are flagged against their neighbours once all are measured
+void VideoAnalytics::complete()
+{
+	const qint64 size = m_frames.size();
+	QVector<Frame> frames(BATCH);
+	Frame previous;
+	previous.layout = -1;
+
+	for(qint64 first = 0; first < size; first += BATCH)
+	{
+		qint64 count = m_frames.read(first, BATCH, frames.data());
+
+		for(int i = 0; i < count; i++)
+		{
+			Frame &frame = frames[i];
+
+			if(frame.mean < BLACK_MEAN && frame.variance < BLACK_VARIANCE)
+				frame.flags |= Black;
+
+			if(frame.difference >= 0 && frame.difference < FROZEN_DIFFERENCE)
+				frame.flags |= Frozen;
+
+			if(previous.layout == frame.layout && qAbs(frame.mean - previous.mean) > JUMP_MEAN)
+				frame.flags |= Jump;
+
+			m_counts[0] += (frame.flags & Black) != 0;
+			m_counts[1] += (frame.flags & Frozen) != 0;
+			m_counts[2] += (frame.flags & Jump) != 0;
+
+			previous = frame;
+		}
+
+		m_frames.write(first, count, frames.constData());
+	}
+}
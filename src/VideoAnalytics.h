@@ -0,0 +1,65 @@
+#ifndef VIDEO_ANALYTICS_H_
+#define VIDEO_ANALYTICS_H_
+
+#include <QVector>
+
+#include "Analyzer.h"
+#include "PagedArray.h"
+#include "VideoStats.h"
+
+// Luma statistics of every raw video frame of a dump: mean, variance and
+// mean absolute difference from the previous frame, computed in the
+// background by a pool of workers each taking runs of consecutive frames.
+// Black frames, frozen frames and sudden changes of the mean are flagged
+// once all frames are measured. The frames are kept in a paged array, and
+// the workers share the mapping window given by setWindowSize().
+class VideoAnalytics: public Analyzer
+{
+	Q_OBJECT
+	public:
+		enum Flags
+		{
+			Black = 1,
+			Frozen = 2,
+			Jump = 4
+		};
+
+		struct Frame
+		{
+			qint64 row;
+			float mean;
+			float variance;
+			float difference;
+			int layout;
+			int flags;
+		};
+
+		VideoAnalytics(QSharedPointer<PacketIndex> pindex, const QString &fileName, QObject *parent = 0);
+		~VideoAnalytics();
+
+		qint64 frameCount() const;
+		Frame frame(qint64 i) const;
+		qint64 readFrames(qint64 first, qint64 count, Frame *out) const;
+		qint64 frameOfPacket(qint64 row) const;
+		qint64 count(int flag) const;
+
+	protected:
+		virtual bool scanPacket(qint64 row, const PacketRecord &record, GstCaps *pcaps);
+		virtual qint64 prepare();
+		virtual void process(GdpFile &file, qint64 first, qint64 last);
+		virtual void complete();
+
+	private:
+		bool flushFrames();
+		void measureFrame(Frame &frame, const guint8 *payload, QByteArray &current, const QByteArray *pprevious);
+
+		PagedArray<Frame> m_frames;
+		QVector<Frame> m_pending;
+		QVector<VideoLayout> m_layouts;
+		int m_layout;
+		bool m_ok;
+		qint64 m_counts[3];
+};
+
+
+#endif
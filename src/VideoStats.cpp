@@ -0,0 +1,144 @@
+#include "VideoStats.h"
+
+#include <gst/video/video.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// pixels whose squares fit in 32-bit lanes before being added up
+static const int SEGMENT = 4096;
+
+VideoLayout VideoStats::layoutFromCaps(const GstCaps *caps)
+{
+	VideoLayout layout;
+	GstVideoInfo info;
+
+	if(!caps || !gst_video_info_from_caps(&info, caps))
+		return layout;
+
+	const GstVideoFormatInfo *pformat = info.finfo;
+	if(GST_VIDEO_FORMAT_INFO_DEPTH(pformat, 0) != 8 || GST_VIDEO_FORMAT_INFO_IS_TILED(pformat) ||
+		(GST_VIDEO_FORMAT_INFO_FLAGS(pformat) & GST_VIDEO_FORMAT_FLAG_COMPLEX))
+		return layout;
+
+	if(GST_VIDEO_INFO_IS_RGB(&info))
+	{
+		if(GST_VIDEO_INFO_COMP_PSTRIDE(&info, 0) != 4 || GST_VIDEO_INFO_N_PLANES(&info) != 1)
+			return layout;
+
+		layout.rgb = true;
+		layout.weights[GST_VIDEO_INFO_COMP_POFFSET(&info, 0)] = 77;
+		layout.weights[GST_VIDEO_INFO_COMP_POFFSET(&info, 1)] = 150;
+		layout.weights[GST_VIDEO_INFO_COMP_POFFSET(&info, 2)] = 29;
+	}
+	else if(GST_VIDEO_INFO_COMP_PSTRIDE(&info, 0) != 1)
+		return layout;
+
+	layout.valid = true;
+	layout.width = GST_VIDEO_INFO_WIDTH(&info);
+	layout.height = GST_VIDEO_INFO_HEIGHT(&info);
+	layout.stride = GST_VIDEO_INFO_PLANE_STRIDE(&info, 0);
+	layout.offset = GST_VIDEO_INFO_PLANE_OFFSET(&info, 0);
+	layout.size = GST_VIDEO_INFO_SIZE(&info);
+
+	return layout;
+}
+
+
+void VideoStats::rgbToLuma(const VideoLayout &layout, const guint8 *row, guint8 *pluma)
+{
+	const int *w = layout.weights;
+	int x = 0;
+
+#ifdef __SSE2__
+	// 16 pixels at a time: each pixel is widened to four 16-bit values,
+	// multiplied and summed by pairs with pmaddwd, and the two pair sums
+	// of a pixel are added before packing back to bytes
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i weights = _mm_setr_epi16(w[0], w[1], w[2], w[3], w[0], w[1], w[2], w[3]);
+	const __m128i round = _mm_set1_epi32(128);
+
+	for(; x + 16 <= layout.width; x += 16)
+	{
+		__m128i luma[4];
+
+		for(int i = 0; i < 4; i++)
+		{
+			__m128i v = _mm_loadu_si128((const __m128i *) (row + 4 * x + 16 * i));
+			__m128i low = _mm_madd_epi16(_mm_unpacklo_epi8(v, zero), weights);
+			__m128i high = _mm_madd_epi16(_mm_unpackhi_epi8(v, zero), weights);
+
+			low = _mm_shuffle_epi32(_mm_add_epi32(low, _mm_srli_epi64(low, 32)), _MM_SHUFFLE(3, 3, 2, 0));
+			high = _mm_shuffle_epi32(_mm_add_epi32(high, _mm_srli_epi64(high, 32)), _MM_SHUFFLE(3, 3, 2, 0));
+
+			luma[i] = _mm_srli_epi32(_mm_add_epi32(_mm_unpacklo_epi64(low, high), round), 8);
+		}
+
+		__m128i words = _mm_packs_epi32(luma[0], luma[1]);
+		__m128i words2 = _mm_packs_epi32(luma[2], luma[3]);
+		_mm_storeu_si128((__m128i *) (pluma + x), _mm_packus_epi16(words, words2));
+	}
+#endif
+
+	for(; x < layout.width; x++)
+	{
+		const guint8 *p = row + 4 * x;
+		pluma[x] = (w[0] * p[0] + w[1] * p[1] + w[2] * p[2] + w[3] * p[3] + 128) >> 8;
+	}
+}
+
+
+void VideoStats::accumulate(const guint8 *pluma, const guint8 *pprevious, int width, quint64 *psum, quint64 *psumSquares, quint64 *pdifference)
+{
+	quint64 sum = 0, squares = 0, difference = 0;
+	int x = 0;
+
+#ifdef __SSE2__
+	// psadbw against zero sums bytes, against the previous frame sums
+	// absolute differences; squares go through pmaddwd
+	const __m128i zero = _mm_setzero_si128();
+	__m128i sums = zero, differences = zero;
+
+	while(x + 16 <= width)
+	{
+		__m128i squareSums = zero;
+		int end = qMin(width - width % 16, x + SEGMENT);
+
+		for(; x < end; x += 16)
+		{
+			__m128i v = _mm_loadu_si128((const __m128i *) (pluma + x));
+			__m128i low = _mm_unpacklo_epi8(v, zero);
+			__m128i high = _mm_unpackhi_epi8(v, zero);
+
+			sums = _mm_add_epi64(sums, _mm_sad_epu8(v, zero));
+			squareSums = _mm_add_epi32(squareSums, _mm_add_epi32(_mm_madd_epi16(low, low), _mm_madd_epi16(high, high)));
+
+			if(pprevious)
+				differences = _mm_add_epi64(differences, _mm_sad_epu8(v, _mm_loadu_si128((const __m128i *) (pprevious + x))));
+		}
+
+		quint32 lanes[4];
+		_mm_storeu_si128((__m128i *) lanes, squareSums);
+		squares += (quint64) lanes[0] + lanes[1] + lanes[2] + lanes[3];
+	}
+
+	quint64 halves[2];
+	_mm_storeu_si128((__m128i *) halves, sums);
+	sum += halves[0] + halves[1];
+	_mm_storeu_si128((__m128i *) halves, differences);
+	difference += halves[0] + halves[1];
+#endif
+
+	for(; x < width; x++)
+	{
+		sum += pluma[x];
+		squares += pluma[x] * pluma[x];
+		if(pprevious)
+			difference += qAbs(pluma[x] - pprevious[x]);
+	}
+
+	*psum += sum;
+	*psumSquares += squares;
+	*pdifference += difference;
+}
@@ -0,0 +1,48 @@
+#ifndef VIDEO_STATS_H_
+#define VIDEO_STATS_H_
+
+#include <QtGlobal>
+
+#include <gst/gst.h>
+
+// Where the luma of a raw video frame is: the Y plane of 8-bit YUV and gray
+// formats, or computed from the R, G and B bytes of 4-byte RGB formats.
+struct VideoLayout
+{
+	VideoLayout():
+		valid(false),
+		rgb(false),
+		width(0),
+		height(0),
+		stride(0),
+		offset(0),
+		size(0)
+	{
+		weights[0] = weights[1] = weights[2] = weights[3] = 0;
+	}
+
+	bool valid;
+	bool rgb;
+	int width;
+	int height;
+	int stride;
+	gsize offset;
+	gsize size;
+
+	// BT.601 luma weights in 1/256 by byte of an RGB pixel
+	int weights[4];
+};
+
+// Kernels for per-frame luma statistics, working a row at a time straight
+// on payload bytes.
+class VideoStats
+{
+	public:
+		static VideoLayout layoutFromCaps(const GstCaps *caps);
+
+		static void rgbToLuma(const VideoLayout &layout, const guint8 *row, guint8 *pluma);
+		static void accumulate(const guint8 *pluma, const guint8 *pprevious, int width, quint64 *psum, quint64 *psumSquares, quint64 *pdifference);
+};
+
+
+#endif
@@ -0,0 +1,197 @@
+#include "WaveformView.h"
+#include "AudioOverview.h"
+#include "ClockTime.h"
+
+#include <QPainter>
+#include <QWheelEvent>
+#include <QMouseEvent>
+
+#include <cmath>
+
+// peaks from this level on count as clipped
+static const float CLIP_LEVEL = 0.999f;
+
+WaveformView::WaveformView(QWidget *parent):
+	QWidget(parent),
+	m_poverview(NULL),
+	m_start(0),
+	m_nsPerPixel(1),
+	m_dragX(-1),
+	m_dragStart(0)
+{
+	setMinimumHeight(60);
+}
+
+
+void WaveformView::setOverview(AudioOverview *poverview)
+{
+	m_poverview = poverview;
+	if(m_poverview)
+		connect(m_poverview, SIGNAL(finished()), SLOT(slotFinished()));
+
+	fit();
+	update();
+}
+
+
+QSize WaveformView::sizeHint() const
+{
+	return QSize(600, 120);
+}
+
+
+void WaveformView::slotFinished()
+{
+	fit();
+	update();
+}
+
+
+void WaveformView::fit()
+{
+	if(!m_poverview || !m_poverview -> bufferCount())
+		return;
+
+	m_start = m_poverview -> startTime();
+	m_nsPerPixel = qMax(1.0, (double) (m_poverview -> endTime() - m_poverview -> startTime()) / qMax(1, width()));
+}
+
+
+guint64 WaveformView::timeAt(int x) const
+{
+	return (guint64) qMax(0.0, m_start + x * m_nsPerPixel);
+}
+
+
+void WaveformView::clampStart()
+{
+	if(!m_poverview || !m_poverview -> bufferCount())
+		return;
+
+	double end = m_poverview -> endTime() - width() * m_nsPerPixel;
+	m_start = qMax<double>(m_poverview -> startTime(), qMin(m_start, end));
+}
+
+
+void WaveformView::paintEvent(QPaintEvent *)
+{
+	QPainter painter(this);
+	painter.fillRect(rect(), palette().base());
+
+	if(!m_poverview || !m_poverview -> isReady())
+	{
+		painter.drawText(rect(), Qt::AlignCenter, m_poverview ? "Measuring audio levels..." : QString());
+		return;
+	}
+
+	const int channels = m_poverview -> channels();
+	if(!channels)
+	{
+		painter.drawText(rect(), Qt::AlignCenter, "No raw audio in this dump");
+		return;
+	}
+
+	const int laneHeight = height() / channels;
+	const QColor peakColor = palette().highlight().color().lighter(150);
+	const QColor rmsColor = palette().highlight().color();
+	const QColor gapColor(255, 0, 0, 40);
+
+	QVector<AudioLevel> levels(channels);
+
+	for(int x = 0; x < width(); x++)
+	{
+		guint64 from = timeAt(x);
+		guint64 to = timeAt(x + 1);
+
+		qint64 first = m_poverview -> firstEndingAfter(from);
+		qint64 last = m_poverview -> firstStartingAt(to);
+
+		bool inside = from < m_poverview -> endTime() && to > m_poverview -> startTime();
+		bool gap = first >= last;
+		if(!gap && last - first == 1)
+			gap = m_poverview -> isGap(first);
+
+		if(gap)
+		{
+			if(inside)
+				painter.fillRect(x, 0, 1, height(), gapColor);
+			continue;
+		}
+
+		m_poverview -> levels(first, last, levels.data());
+
+		for(int c = 0; c < channels; c++)
+		{
+			const int middle = c * laneHeight + laneHeight / 2;
+			const int half = laneHeight / 2 - 1;
+
+			int peak = qRound(qMin(1.0f, levels[c].peak) * half);
+			int rms = qRound(qMin(1.0, std::sqrt(levels[c].power)) * half);
+
+			painter.setPen(levels[c].peak >= CLIP_LEVEL ? QColor(Qt::red) : peakColor);
+			painter.drawLine(x, middle - peak, x, middle + peak);
+			painter.setPen(rmsColor);
+			painter.drawLine(x, middle - rms, x, middle + rms);
+		}
+	}
+
+	painter.setPen(palette().text().color());
+	for(int c = 1; c < channels; c++)
+		painter.drawLine(0, c * laneHeight, width(), c * laneHeight);
+
+	painter.drawText(rect().adjusted(4, 2, -4, -2), Qt::AlignLeft | Qt::AlignTop, ClockTime::toString(timeAt(0)));
+	painter.drawText(rect().adjusted(4, 2, -4, -2), Qt::AlignRight | Qt::AlignTop, ClockTime::toString(timeAt(width())));
+}
+
+
+void WaveformView::wheelEvent(QWheelEvent *pevent)
+{
+	if(!m_poverview || !m_poverview -> bufferCount())
+		return;
+
+	// keep the time under the cursor in place
+	int x = pevent -> pos().x();
+	double time = m_start + x * m_nsPerPixel;
+	double maxNsPerPixel = (double) (m_poverview -> endTime() - m_poverview -> startTime()) / qMax(1, width());
+
+	m_nsPerPixel *= std::pow(0.8, pevent -> angleDelta().y() / 120.0);
+	m_nsPerPixel = qBound(1.0, m_nsPerPixel, qMax(1.0, maxNsPerPixel));
+	m_start = time - x * m_nsPerPixel;
+
+	clampStart();
+	update();
+}
+
+
+void WaveformView::mousePressEvent(QMouseEvent *pevent)
+{
+	m_dragX = pevent -> x();
+	m_dragStart = m_start;
+}
+
+
+void WaveformView::mouseMoveEvent(QMouseEvent *pevent)
+{
+	if(m_dragX < 0 || !(pevent -> buttons() & Qt::LeftButton))
+		return;
+
+	m_start = m_dragStart - (pevent -> x() - m_dragX) * m_nsPerPixel;
+	clampStart();
+	update();
+}
+
+
+void WaveformView::mouseDoubleClickEvent(QMouseEvent *pevent)
+{
+	if(!m_poverview || !m_poverview -> bufferCount())
+		return;
+
+	qint64 buffer = qMin(m_poverview -> firstEndingAfter(timeAt(pevent -> x())), m_poverview -> bufferCount() - 1);
+	emit packetActivated(m_poverview -> packetRow(buffer));
+}
+
+
+void WaveformView::resizeEvent(QResizeEvent *)
+{
+	clampStart();
+}
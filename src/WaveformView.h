@@ -0,0 +1,53 @@
+#ifndef WAVEFORM_VIEW_H_
+#define WAVEFORM_VIEW_H_
+
+#include <QWidget>
+#include <QPointer>
+
+#include <glib.h>
+
+class AudioOverview;
+
+// One lane per channel with the peak and RMS levels of an AudioOverview over
+// time. Clipped ranges are drawn in red and stretches without buffers or with
+// GAP buffers are shaded, so silence, clipping and dropouts stand out. The
+// wheel zooms around the cursor, dragging scrolls and a double click
+// activates the buffer under the cursor.
+class WaveformView: public QWidget
+{
+	Q_OBJECT
+	public:
+		WaveformView(QWidget *parent = 0);
+
+		void setOverview(AudioOverview *poverview);
+
+		virtual QSize sizeHint() const;
+
+	signals:
+		void packetActivated(qint64 row);
+
+	private slots:
+		void slotFinished();
+
+	protected:
+		virtual void paintEvent(QPaintEvent *);
+		virtual void wheelEvent(QWheelEvent *);
+		virtual void mousePressEvent(QMouseEvent *);
+		virtual void mouseMoveEvent(QMouseEvent *);
+		virtual void mouseDoubleClickEvent(QMouseEvent *);
+		virtual void resizeEvent(QResizeEvent *);
+
+	private:
+		void fit();
+		guint64 timeAt(int x) const;
+		void clampStart();
+
+		QPointer<AudioOverview> m_poverview;
+		double m_start;
+		double m_nsPerPixel;
+		int m_dragX;
+		double m_dragStart;
+};
+
+
+#endif
@@ -707,6 +707,215 @@ gst_dp_validate_packet (guint header_length, const guint8 * header,
   return TRUE;
 }
 
+/*** BATCH HEADER DECODING ***/
+
+/* number of headers whose CRCs are computed together; the table lookups of
+ * a CRC depend on each other, the ones of different headers do not */
+#define GST_DP_SCAN_LANES 4
+
+/* version bytes as one big-endian 16 bit value */
+#define GST_DP_SCAN_VERSION_0_2 0x0002
+#define GST_DP_SCAN_VERSION_1_0 0x0100
+#define GST_DP_SCAN_VERSION_ANY -1
+
+static inline guint16
+gst_dp_read_uint16 (const guint8 * p)
+{
+  guint16 v;
+
+  memcpy (&v, p, sizeof (v));
+  return GUINT16_FROM_BE (v);
+}
+
+static inline guint32
+gst_dp_read_uint32 (const guint8 * p)
+{
+  guint32 v;
+
+  memcpy (&v, p, sizeof (v));
+  return GUINT32_FROM_BE (v);
+}
+
+static inline guint64
+gst_dp_read_uint64 (const guint8 * p)
+{
+  guint64 v;
+
+  memcpy (&v, p, sizeof (v));
+  return GUINT64_FROM_BE (v);
+}
+
+static inline void
+gst_dp_crc_lanes (const guint8 * h0, const guint8 * h1, const guint8 * h2,
+    const guint8 * h3, guint16 * crc)
+{
+  guint16 c0 = CRC_INIT, c1 = CRC_INIT, c2 = CRC_INIT, c3 = CRC_INIT;
+  guint i;
+
+  /* we don't crc the last four bytes since they are crc's */
+  for (i = 0; i < GST_DP_HEADER_LENGTH - 4; i++) {
+    c0 = (guint16) ((c0 << 8) ^ gst_dp_crc_table[((c0 >> 8) & 0xff) ^ h0[i]]);
+    c1 = (guint16) ((c1 << 8) ^ gst_dp_crc_table[((c1 >> 8) & 0xff) ^ h1[i]]);
+    c2 = (guint16) ((c2 << 8) ^ gst_dp_crc_table[((c2 >> 8) & 0xff) ^ h2[i]]);
+    c3 = (guint16) ((c3 << 8) ^ gst_dp_crc_table[((c3 >> 8) & 0xff) ^ h3[i]]);
+  }
+
+  crc[0] = 0xffff ^ c0;
+  crc[1] = 0xffff ^ c1;
+  crc[2] = 0xffff ^ c2;
+  crc[3] = 0xffff ^ c3;
+}
+
+static inline void
+gst_dp_header_info_fill (GstDPHeaderInfo * info, const guint8 * h)
+{
+  info->version = gst_dp_read_uint16 (h);
+  info->flags = GST_DP_HEADER_FLAGS (h);
+  info->payload_type = gst_dp_read_uint16 (h + 4);
+  info->payload_length = gst_dp_read_uint32 (h + 6);
+  info->timestamp = gst_dp_read_uint64 (h + 10);
+  info->duration = gst_dp_read_uint64 (h + 18);
+  info->buffer_offset = gst_dp_read_uint64 (h + 26);
+  info->buffer_offset_end = gst_dp_read_uint64 (h + 34);
+  info->buffer_flags = gst_dp_read_uint16 (h + 42);
+  info->crc_payload = gst_dp_read_uint16 (h + 60);
+}
+
+/* Decodes the run of headers starting at @start that all have @version.
+ * Always inlined with a constant @version, which gives one loop per
+ * protocol version without a per-header branch on it. */
+static inline guint
+gst_dp_scan_headers_version (const guint8 * data, gsize size, gsize start,
+    GstDPHeaderInfo * infos, guint max_infos, gsize * next,
+    gboolean * invalid, const gint version)
+{
+  gsize pos = start;
+  guint n = 0, i, lane;
+
+  /* find the boundaries first, only the payload length is needed for that */
+  while (n < max_infos && pos + GST_DP_HEADER_LENGTH <= size) {
+    const guint8 *h = data + pos;
+
+    if (version != GST_DP_SCAN_VERSION_ANY
+        && gst_dp_read_uint16 (h) != version)
+      break;
+
+    infos[n++].offset = pos;
+    pos += GST_DP_HEADER_LENGTH + (gsize) gst_dp_read_uint32 (h + 6);
+  }
+
+  /* then check and decode the headers a group of lanes at a time */
+  for (i = 0; i < n; i += GST_DP_SCAN_LANES) {
+    const guint8 *h[GST_DP_SCAN_LANES];
+    guint16 crc[GST_DP_SCAN_LANES];
+    guint lanes = MIN (GST_DP_SCAN_LANES, n - i);
+
+    for (lane = 0; lane < GST_DP_SCAN_LANES; lane++)
+      h[lane] = data + infos[i + (lane < lanes ? lane : 0)].offset;
+
+    gst_dp_crc_lanes (h[0], h[1], h[2], h[3], crc);
+
+    for (lane = 0; lane < lanes; lane++) {
+      if ((GST_DP_HEADER_FLAGS (h[lane]) & GST_DP_HEADER_FLAG_CRC_HEADER)
+          && gst_dp_read_uint16 (h[lane] + 58) != crc[lane]) {
+        GST_WARNING ("header crc mismatch at %" G_GSIZE_FORMAT,
+            infos[i + lane].offset);
+        *invalid = TRUE;
+        *next = infos[i + lane].offset;
+        return i + lane;
+      }
+
+      gst_dp_header_info_fill (&infos[i + lane], h[lane]);
+    }
+  }
+
+  *next = pos;
+  return n;
+}
+
+static guint
+gst_dp_scan_headers_1_0 (const guint8 * data, gsize size, gsize start,
+    GstDPHeaderInfo * infos, guint max_infos, gsize * next,
+    gboolean * invalid)
+{
+  return gst_dp_scan_headers_version (data, size, start, infos, max_infos,
+      next, invalid, GST_DP_SCAN_VERSION_1_0);
+}
+
+static guint
+gst_dp_scan_headers_0_2 (const guint8 * data, gsize size, gsize start,
+    GstDPHeaderInfo * infos, guint max_infos, gsize * next,
+    gboolean * invalid)
+{
+  return gst_dp_scan_headers_version (data, size, start, infos, max_infos,
+      next, invalid, GST_DP_SCAN_VERSION_0_2);
+}
+
+static guint
+gst_dp_scan_headers_any (const guint8 * data, gsize size, gsize start,
+    GstDPHeaderInfo * infos, guint max_infos, gsize * next,
+    gboolean * invalid)
+{
+  return gst_dp_scan_headers_version (data, size, start, infos, max_infos,
+      next, invalid, GST_DP_SCAN_VERSION_ANY);
+}
+
+/**
+ * gst_dp_scan_headers:
+ * @data: a memory region starting with a packet header
+ * @size: the size of @data
+ * @infos: array receiving the decoded headers
+ * @max_infos: the number of elements in @infos
+ * @next: location for the offset following the last decoded packet
+ * @invalid: location for whether the scan stopped on an invalid header
+ *
+ * Finds the packets in @data by following the payload lengths and decodes
+ * every header that lies completely in @data, checking its CRC. Payloads
+ * may extend past @size and are neither read nor checked; the payload CRC
+ * is returned in the descriptors so the caller can do that.
+ *
+ * Runs of 1.0 and 0.2 headers are handled by separate loops. The scan
+ * stops after @max_infos headers, at the first header that does not fit in
+ * @data or at the first header with a CRC mismatch, in which case @invalid
+ * is set to %TRUE and @next is the offset of that header.
+ *
+ * Returns: the number of headers decoded into @infos.
+ */
+guint
+gst_dp_scan_headers (const guint8 * data, gsize size, GstDPHeaderInfo * infos,
+    guint max_infos, gsize * next, gboolean * invalid)
+{
+  gsize pos = 0;
+  guint n = 0;
+
+  g_return_val_if_fail (data != NULL || size == 0, 0);
+  g_return_val_if_fail (infos != NULL || max_infos == 0, 0);
+  g_return_val_if_fail (next != NULL, 0);
+  g_return_val_if_fail (invalid != NULL, 0);
+
+  *invalid = FALSE;
+
+  while (n < max_infos && pos + GST_DP_HEADER_LENGTH <= size && !*invalid) {
+    guint16 version = gst_dp_read_uint16 (data + pos);
+    guint got;
+
+    if (version == GST_DP_SCAN_VERSION_1_0)
+      got = gst_dp_scan_headers_1_0 (data, size, pos, infos + n,
+          max_infos - n, &pos, invalid);
+    else if (version == GST_DP_SCAN_VERSION_0_2)
+      got = gst_dp_scan_headers_0_2 (data, size, pos, infos + n,
+          max_infos - n, &pos, invalid);
+    else
+      got = gst_dp_scan_headers_any (data, size, pos, infos + n,
+          max_infos - n, &pos, invalid);
+
+    n += got;
+  }
+
+  *next = pos;
+  return n;
+}
+
 /**
  * gst_dp_packetizer_new:
  * @version: the #GstDPVersion of the protocol to packetize for.
@@ -97,6 +97,37 @@ typedef enum {
   GST_DP_PAYLOAD_EVENT_NONE      = 64,
 } GstDPPayloadType;
 
+/**
+ * GstDPHeaderInfo:
+ * @offset: position of the header in the scanned region
+ * @timestamp: the buffer timestamp
+ * @duration: the buffer duration
+ * @buffer_offset: the buffer offset
+ * @buffer_offset_end: the buffer offset end
+ * @payload_length: the length of the payload following the header
+ * @version: the protocol version bytes, major in the high byte
+ * @payload_type: the #GstDPPayloadType of the packet
+ * @buffer_flags: the buffer flags
+ * @crc_payload: the payload CRC, valid if @flags has
+ *     #GST_DP_HEADER_FLAG_CRC_PAYLOAD
+ * @flags: the #GstDPHeaderFlag of the packet
+ *
+ * A packet header decoded by gst_dp_scan_headers(), in host byte order.
+ */
+typedef struct {
+  gsize offset;
+  guint64 timestamp;
+  guint64 duration;
+  guint64 buffer_offset;
+  guint64 buffer_offset_end;
+  guint32 payload_length;
+  guint16 version;
+  guint16 payload_type;
+  guint16 buffer_flags;
+  guint16 crc_payload;
+  guint8 flags;
+} GstDPHeaderInfo;
+
 typedef gboolean (*GstDPHeaderFromBufferFunction) (const GstBuffer * buffer,
                                                    GstDPHeaderFlag flags,
                                                    guint * length,
@@ -169,6 +200,14 @@ gboolean        gst_dp_validate_packet          (guint header_length,
                                                 const guint8 * header,
                                                 const guint8 * payload);
 
+/* batch decoding */
+guint           gst_dp_scan_headers             (const guint8 * data,
+                                                gsize size,
+                                                GstDPHeaderInfo * infos,
+                                                guint max_infos,
+                                                gsize * next,
+                                                gboolean * invalid);
+
 G_END_DECLS
 
 #endif /* __GST_DATA_PROTOCOL_H__ */
@@ -1,13 +1,42 @@
 #include <QApplication>
+#include <QCommandLineParser>
 
 #include "MainWindow.h"
+#include "Cli.h"
+#include "Stats.h"
 #include <gst/gst.h>
 int main(int argc, char **argv)
 {
+	if(Cli::isCommand(argc, argv))
+	{
+		QCoreApplication app(argc, argv);
+		gst_init(&argc, &argv);
+
+		return Cli::run(app);
+	}
+
 	QApplication app(argc, argv);
 	gst_init(&argc, &argv);
+
+	QCommandLineParser parser;
+	Cli::addOptions(parser);
+	parser.process(app);
+
+	if(parser.isSet("trace"))
+		Stats::setTracing(true);
+
 	MainWindow wgt;
+	if(parser.isSet("memory-limit"))
+		wgt.setMemoryLimit(parser.value("memory-limit").toLongLong() * 1024 * 1024);
 	wgt.show();
 
-	return app.exec();
-}
\ No newline at end of file
+	if(!parser.positionalArguments().isEmpty())
+		wgt.openFile(parser.positionalArguments().first());
+
+	int res = app.exec();
+
+	if(parser.isSet("trace"))
+		Stats::writeTrace(parser.value("trace"));
+
+	return res;
+}
@@ -0,0 +1,29 @@
+######################################################################
+# Checks of the batch and SIMD kernels against plain loops, and of the
+# filter expressions; built and run with qmake && make check
+######################################################################
+
+TEMPLATE = app
+TARGET = tst_kernels
+INCLUDEPATH += ../src
+
+QT += testlib
+QT -= gui
+CONFIG += testcase console
+
+CONFIG += link_pkgconfig
+PKGCONFIG += gstreamer-1.0 gstreamer-app-1.0 gstreamer-video-1.0 libzstd
+
+# Input
+HEADERS += ../src/dataprotocol.h ../src/dp-private.h \
+	../src/PagedArray.h ../src/GdpFile.h ../src/GdpArchive.h ../src/PacketIndex.h \
+	../src/ClockTime.h ../src/ParallelSort.h ../src/Selection.h ../src/Filter.h \
+	../src/PacketTableModel.h ../src/Analyzer.h ../src/PacketCaps.h \
+	../src/NalParser.h ../src/NalAnalyzer.h ../src/AudioLevels.h \
+	../src/VideoStats.h ../src/VideoAnalytics.h
+SOURCES += tst_kernels.cpp ../src/dataprotocol.c \
+	../src/GdpFile.cpp ../src/GdpArchive.cpp ../src/PacketIndex.cpp \
+	../src/ClockTime.cpp ../src/Filter.cpp \
+	../src/PacketTableModel.cpp ../src/Analyzer.cpp ../src/PacketCaps.cpp \
+	../src/NalParser.cpp ../src/NalAnalyzer.cpp ../src/AudioLevels.cpp \
+	../src/VideoStats.cpp ../src/VideoAnalytics.cpp
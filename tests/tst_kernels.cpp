@@ -0,0 +1,498 @@
+#include <QtTest>
+#include <QByteArray>
+#include <QVector>
+#include <QDir>
+
+#include <gst/gst.h>
+
+#include <cmath>
+#include <cstring>
+
+#include "dataprotocol.h"
+#include "NalParser.h"
+#include "AudioLevels.h"
+#include "VideoStats.h"
+#include "PacketIndex.h"
+#include "Filter.h"
+
+// Compares the batch and SIMD paths of the scanning and measuring kernels
+// with plain loops over the same bytes, on random data and on lengths
+// around the vector and block sizes, and runs filter expressions over an
+// index against the predicates they stand for.
+class TestKernels: public QObject
+{
+	Q_OBJECT
+	private slots:
+		void initTestCase();
+
+		void scanHeaders();
+		void scanHeadersCorrupt();
+		void findStartCode();
+		void audioLevels();
+		void videoAccumulate();
+		void rgbToLuma();
+		void filter_data();
+		void filter();
+		void filterErrors();
+};
+
+
+namespace
+{
+	// lengths up to a few vectors, then around the audio block and the video
+	// segment
+	QVector<int> testLengths()
+	{
+		QVector<int> lengths;
+		for(int i = 0; i <= 70; i++)
+			lengths.append(i);
+
+		lengths << 255 << 256 << 257 << 4095 << 4096 << 4097 << 8200 << 10007;
+		return lengths;
+	}
+
+
+	QByteArray randomBytes(int size)
+	{
+		QByteArray res(size, '\0');
+		for(int i = 0; i < size; i++)
+			res[i] = (char) (qrand() & 0xff);
+
+		return res;
+	}
+
+
+	// dump of <count> buffers with header and payload CRCs; <poffsets>
+	// receives where each header starts
+	QByteArray makePackets(int count, QVector<gsize> *poffsets)
+	{
+		GstDPPacketizer *ppacketizer = gst_dp_packetizer_new(GST_DP_VERSION_1_0);
+		QByteArray data;
+
+		for(int i = 0; i < count; i++)
+		{
+			QByteArray payload = randomBytes(qrand() % 300);
+
+			GstBuffer *pbuffer = gst_buffer_new_allocate(NULL, payload.size(), NULL);
+			gst_buffer_fill(pbuffer, 0, payload.constData(), payload.size());
+			GST_BUFFER_PTS(pbuffer) = (guint64) i * GST_MSECOND;
+			GST_BUFFER_DURATION(pbuffer) = GST_MSECOND;
+			GST_BUFFER_OFFSET(pbuffer) = i;
+			GST_BUFFER_FLAGS(pbuffer) = (qrand() & 1) ? GST_BUFFER_FLAG_DELTA_UNIT : 0;
+
+			guint length = 0;
+			guint8 *pheader = NULL;
+			ppacketizer -> header_from_buffer(pbuffer, GST_DP_HEADER_FLAG_CRC, &length, &pheader);
+
+			poffsets -> append(data.size());
+			data.append((const char *) pheader, length);
+			data.append(payload);
+
+			g_free(pheader);
+			gst_buffer_unref(pbuffer);
+		}
+
+		gst_dp_packetizer_free(ppacketizer);
+		return data;
+	}
+
+
+	const guint8 *findStartCodeScalar(const guint8 *p, const guint8 *end)
+	{
+		for(; end - p >= 3; p++)
+		{
+			if(!p[0] && !p[1] && p[2] == 1)
+				return p;
+		}
+
+		return end;
+	}
+
+
+	float sampleOf(AudioFormat::SampleFormat format, const guint8 *p)
+	{
+		if(format == AudioFormat::S16)
+		{
+			gint16 value;
+			memcpy(&value, p, sizeof(value));
+			return value * (1.0f / 32768.0f);
+		}
+		else if(format == AudioFormat::S32)
+		{
+			gint32 value;
+			memcpy(&value, p, sizeof(value));
+			return value * (1.0f / 2147483648.0f);
+		}
+
+		float value;
+		memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+
+	enum FilterCase
+	{
+		CaseSize,
+		CaseKeyframes,
+		CaseBetween,
+		CaseNot,
+		CaseSegment,
+		CaseMissingField
+	};
+
+
+	bool expected(int id, const PacketRecord &record)
+	{
+		const bool buffer = record.payloadType == GST_DP_PAYLOAD_BUFFER;
+
+		switch(id)
+		{
+			case CaseSize:
+				return buffer && record.payloadLength > 100000;
+			case CaseKeyframes:
+				return buffer && !(record.bufferFlags & GST_BUFFER_FLAG_DELTA_UNIT);
+			case CaseBetween:
+				return buffer && record.timestamp >= GST_SECOND && record.timestamp <= 2 * GST_SECOND;
+			case CaseNot:
+				return !(record.payloadLength < 100) || record.payloadType == GST_DP_PAYLOAD_CAPS;
+			case CaseSegment:
+				return record.payloadType == GST_DP_PAYLOAD_EVENT_NONE + GST_EVENT_SEGMENT;
+			case CaseMissingField:
+				return false;
+		}
+
+		return false;
+	}
+}
+
+
+void TestKernels::initTestCase()
+{
+	gst_init(NULL, NULL);
+	gst_dp_init();
+	qsrand(1);
+}
+
+
+void TestKernels::scanHeaders()
+{
+	// counts around the four CRC lanes
+	for(int count = 0; count <= 13; count++)
+	{
+		QVector<gsize> offsets;
+		QByteArray data = makePackets(count, &offsets);
+		const guint8 *pdata = (const guint8 *) data.constData();
+
+		QVector<GstDPHeaderInfo> infos(count + 1);
+		gsize next = 0;
+		gboolean invalid = TRUE;
+
+		guint n = gst_dp_scan_headers(pdata, data.size(), infos.data(), infos.size(), &next, &invalid);
+		QCOMPARE(n, (guint) count);
+		QVERIFY(!invalid);
+		QCOMPARE(next, (gsize) data.size());
+
+		for(int i = 0; i < count; i++)
+		{
+			const guint8 *pheader = pdata + offsets[i];
+			QCOMPARE(infos[i].offset, offsets[i]);
+			QVERIFY(gst_dp_validate_header(GST_DP_HEADER_LENGTH, pheader));
+			QCOMPARE(GST_READ_UINT16_BE(pheader + 58), gst_dp_crc(pheader, 58));
+			QCOMPARE(infos[i].payload_length, gst_dp_header_payload_length(pheader));
+			QCOMPARE(infos[i].payload_type, (guint16) GST_DP_PAYLOAD_BUFFER);
+			QCOMPARE(infos[i].timestamp, (guint64) i * GST_MSECOND);
+			QCOMPARE(infos[i].buffer_offset, (guint64) i);
+		}
+
+		// stops after max_infos headers, and at a header cut by the end
+		for(int max = 0; max < count; max++)
+		{
+			n = gst_dp_scan_headers(pdata, data.size(), infos.data(), max, &next, &invalid);
+			QCOMPARE(n, (guint) max);
+			QCOMPARE(next, offsets[max]);
+
+			n = gst_dp_scan_headers(pdata, offsets[max] + GST_DP_HEADER_LENGTH - 1, infos.data(), infos.size(), &next, &invalid);
+			QCOMPARE(n, (guint) max);
+			QVERIFY(!invalid);
+			QCOMPARE(next, offsets[max]);
+		}
+	}
+}
+
+
+void TestKernels::scanHeadersCorrupt()
+{
+	const int count = 9;
+
+	for(int bad = 0; bad < count; bad++)
+	{
+		QVector<gsize> offsets;
+		QByteArray data = makePackets(count, &offsets);
+
+		// a byte of the timestamp, so the packet boundaries stay
+		data[(int) offsets[bad] + 12] = data[(int) offsets[bad] + 12] ^ 0x5a;
+		const guint8 *pdata = (const guint8 *) data.constData();
+
+		QVector<GstDPHeaderInfo> infos(count);
+		gsize next = 0;
+		gboolean invalid = FALSE;
+
+		guint n = gst_dp_scan_headers(pdata, data.size(), infos.data(), infos.size(), &next, &invalid);
+		QCOMPARE(n, (guint) bad);
+		QVERIFY(invalid);
+		QCOMPARE(next, offsets[bad]);
+
+		for(int i = 0; i < count; i++)
+			QCOMPARE((bool) gst_dp_validate_header(GST_DP_HEADER_LENGTH, pdata + offsets[i]), i != bad);
+	}
+}
+
+
+void TestKernels::findStartCode()
+{
+	QVector<int> lengths = testLengths();
+
+	for(int l = 0; l < lengths.size(); l++)
+	{
+		for(int round = 0; round < 20; round++)
+		{
+			// mostly zeros and ones, so start codes and near misses are frequent
+			QByteArray data(lengths[l], '\0');
+			for(int i = 0; i < data.size(); i++)
+				data[i] = (char) (qrand() % 4 == 0 ? qrand() % 3 : 0);
+
+			const guint8 *pbegin = (const guint8 *) data.constData();
+			const guint8 *pend = pbegin + data.size();
+
+			for(int start = 0; start <= data.size(); start += 1 + qrand() % 7)
+			{
+				const guint8 *p = pbegin + start;
+				QCOMPARE((qint64) (NalParser::findStartCode(p, pend) - pbegin), (qint64) (findStartCodeScalar(p, pend) - pbegin));
+			}
+		}
+	}
+}
+
+
+void TestKernels::audioLevels()
+{
+	const AudioFormat::SampleFormat formats[] = {AudioFormat::S16, AudioFormat::S32, AudioFormat::F32};
+	QVector<int> lengths = testLengths();
+
+	for(int f = 0; f < 3; f++)
+	{
+		for(int channels = 1; channels <= AudioFormat::MAX_CHANNELS; channels++)
+		{
+			AudioFormat format;
+			format.format = formats[f];
+			format.channels = channels;
+			format.rate = 48000;
+
+			const int size = format.sampleSize();
+
+			for(int l = 0; l < lengths.size(); l++)
+			{
+				QByteArray data = randomBytes(lengths[l] * size);
+				if(format.format == AudioFormat::F32)
+				{
+					for(int i = 0; i + 4 <= data.size(); i += 4)
+					{
+						float value = (qrand() % 20001 - 10000) / 10000.0f;
+						memcpy(data.data() + i, &value, sizeof(value));
+					}
+				}
+
+				const guint8 *pdata = (const guint8 *) data.constData();
+				const int frames = data.size() / (size * channels);
+
+				float peak[AudioFormat::MAX_CHANNELS] = {0};
+				double sum[AudioFormat::MAX_CHANNELS] = {0};
+				for(int i = 0; i < frames * channels; i++)
+				{
+					float value = sampleOf(format.format, pdata + i * size);
+					peak[i % channels] = qMax(peak[i % channels], std::fabs(value));
+					sum[i % channels] += (double) value * value;
+				}
+
+				AudioLevel levels[AudioFormat::MAX_CHANNELS];
+				AudioLevels::measure(format, pdata, data.size(), levels);
+
+				for(int c = 0; c < channels; c++)
+				{
+					double power = frames ? sum[c] / frames : 0;
+					QCOMPARE(levels[c].peak, peak[c]);
+					QVERIFY2(std::fabs(levels[c].power - power) <= 1e-5 * qMax(1.0, power),
+						qPrintable(QString("power %1 against %2").arg(levels[c].power).arg(power)));
+				}
+			}
+		}
+	}
+}
+
+
+void TestKernels::videoAccumulate()
+{
+	QVector<int> lengths = testLengths();
+
+	for(int l = 0; l < lengths.size(); l++)
+	{
+		const int width = lengths[l];
+		QByteArray luma = randomBytes(width);
+		QByteArray previous = randomBytes(width);
+		const guint8 *pluma = (const guint8 *) luma.constData();
+		const guint8 *pprevious = (const guint8 *) previous.constData();
+
+		quint64 sum = 0, squares = 0, difference = 0;
+		for(int x = 0; x < width; x++)
+		{
+			sum += pluma[x];
+			squares += pluma[x] * pluma[x];
+			difference += qAbs(pluma[x] - pprevious[x]);
+		}
+
+		// the kernel adds to what it is given
+		quint64 gotSum = 7, gotSquares = 7, gotDifference = 7;
+		VideoStats::accumulate(pluma, pprevious, width, &gotSum, &gotSquares, &gotDifference);
+		QCOMPARE(gotSum, sum + 7);
+		QCOMPARE(gotSquares, squares + 7);
+		QCOMPARE(gotDifference, difference + 7);
+
+		gotSum = gotSquares = gotDifference = 0;
+		VideoStats::accumulate(pluma, NULL, width, &gotSum, &gotSquares, &gotDifference);
+		QCOMPARE(gotSum, sum);
+		QCOMPARE(gotSquares, squares);
+		QCOMPARE(gotDifference, (quint64) 0);
+	}
+}
+
+
+void TestKernels::rgbToLuma()
+{
+	QVector<int> lengths = testLengths();
+
+	// BT.601 weights of BGRx, which add up to 256
+	VideoLayout layout;
+	layout.valid = true;
+	layout.rgb = true;
+	layout.weights[0] = 29;
+	layout.weights[1] = 150;
+	layout.weights[2] = 77;
+	layout.weights[3] = 0;
+
+	for(int l = 0; l < lengths.size(); l++)
+	{
+		layout.width = lengths[l];
+		QByteArray row = randomBytes(4 * layout.width);
+		const guint8 *prow = (const guint8 *) row.constData();
+
+		QByteArray luma(layout.width, '\0');
+		VideoStats::rgbToLuma(layout, prow, (guint8 *) luma.data());
+
+		for(int x = 0; x < layout.width; x++)
+		{
+			const guint8 *p = prow + 4 * x;
+			int value = (29 * p[0] + 150 * p[1] + 77 * p[2] + 128) >> 8;
+			QCOMPARE((int) (guint8) luma.at(x), value);
+		}
+	}
+}
+
+
+void TestKernels::filter_data()
+{
+	QTest::addColumn<QString>("expression");
+	QTest::addColumn<int>("id");
+
+	QTest::newRow("size") << QString("type == buffer && size > 100000") << (int) CaseSize;
+	QTest::newRow("keyframes") << QString("type == buffer && flags & DELTA_UNIT == 0") << (int) CaseKeyframes;
+	QTest::newRow("between") << QString("type == buffer && pts between 1s and 2000ms") << (int) CaseBetween;
+	QTest::newRow("not") << QString("!(size < 100) || type == caps") << (int) CaseNot;
+	QTest::newRow("segment") << QString("type == segment") << (int) CaseSegment;
+
+	// no dump to read the field from, so it is missing everywhere
+	QTest::newRow("missing field") << QString("proportion != 0.5") << (int) CaseMissingField;
+}
+
+
+// the expression is compiled, run over an index and its selection compared
+// with the predicate it was written from, row by row
+void TestKernels::filter()
+{
+	QFETCH(QString, expression);
+	QFETCH(int, id);
+
+	PacketIndex index;
+	QVERIFY(index.open(QDir::tempPath()));
+
+	// over two chunks of the filter, with a partial one at the end
+	const int rows = 150000;
+	for(int i = 0; i < rows; i++)
+	{
+		PacketRecord record;
+		memset(&record, 0, sizeof(record));
+
+		int kind = qrand() % 10;
+		if(kind == 0)
+			record.payloadType = GST_DP_PAYLOAD_CAPS;
+		else if(kind == 1)
+			record.payloadType = GST_DP_PAYLOAD_EVENT_NONE + GST_EVENT_SEGMENT;
+		else
+			record.payloadType = GST_DP_PAYLOAD_BUFFER;
+		record.filePos = (qint64) i * 1024;
+		record.payloadLength = qrand() % 200000;
+		record.timestamp = (guint64) i * 20 * GST_USECOND;
+		record.duration = 20 * GST_USECOND;
+		record.bufferFlags = (qrand() % 4) ? GST_BUFFER_FLAG_DELTA_UNIT : 0;
+		record.runningTime = record.timestamp;
+		record.streamTime = record.timestamp;
+
+		QVERIFY(index.append(record));
+	}
+
+	Filter filter;
+	QVERIFY2(filter.compile(expression), qPrintable(filter.errorString()));
+	QVERIFY(!filter.isEmpty());
+
+	FilterTotals totals;
+	Selection selection = filter.run(&index, QString(), &totals);
+	QCOMPARE(selection.size(), (qint64) rows);
+
+	qint64 buffers = 0, bytes = 0;
+	for(qint64 i = 0; i < rows; i++)
+	{
+		PacketRecord record = index.at(i);
+		bool match = expected(id, record);
+		QVERIFY2(selection.contains(i) == match, qPrintable(QString("row %1").arg(i)));
+
+		if(match && record.payloadType == GST_DP_PAYLOAD_BUFFER)
+		{
+			buffers++;
+			bytes += record.payloadLength;
+		}
+	}
+
+	QCOMPARE(totals.buffers, buffers);
+	QCOMPARE(totals.bytes, bytes);
+}
+
+
+void TestKernels::filterErrors()
+{
+	const char *errors[] = {"size >", "(size > 1", "type == nosuchtype", "flags & NO_SUCH_FLAG", "size > > 1"};
+
+	for(unsigned i = 0; i < sizeof(errors) / sizeof(errors[0]); i++)
+	{
+		Filter filter;
+		QVERIFY2(!filter.compile(errors[i]), errors[i]);
+		QVERIFY(!filter.errorString().isEmpty());
+		QVERIFY(filter.isEmpty());
+	}
+
+	Filter filter;
+	QVERIFY(filter.compile("  "));
+	QVERIFY(filter.isEmpty());
+}
+
+
+QTEST_GUILESS_MAIN(TestKernels)
+#include "tst_kernels.moc"